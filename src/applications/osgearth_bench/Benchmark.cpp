@@ -0,0 +1,191 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmark.h"
+#include <osgEarth/JsonUtils>
+#include <osgEarth/Version>
+#include <osgEarth/StringUtils>
+#include <osgDB/FileNameUtils>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <ctime>
+#include <cmath>
+
+using namespace osgEarth;
+using namespace osgEarth::Bench;
+
+std::vector<Entry>&
+Bench::registry()
+{
+    static std::vector<Entry> s_registry;
+    return s_registry;
+}
+
+Registrar::Registrar(const char* group, const char* name, Function function)
+{
+    Entry entry;
+    entry.name = std::string(group) + "." + name;
+    entry.function = function;
+    registry().push_back(entry);
+}
+
+std::string
+State::dataFile(const std::string& name) const
+{
+    return osgDB::concatPaths(_settings.dataPath, name);
+}
+
+void
+State::measure(const std::function<void()>& func)
+{
+    typedef std::chrono::steady_clock clock;
+
+    // warm up caches, lazy singletons, thread pools, etc.
+    func();
+
+    clock::time_point start = clock::now();
+    while (_result.runs < _settings.maxRuns)
+    {
+        clock::time_point t0 = clock::now();
+        func();
+        clock::time_point t1 = clock::now();
+
+        _result.samples.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        ++_result.runs;
+
+        double elapsed = std::chrono::duration<double>(t1 - start).count();
+        if (_result.runs >= _settings.minRuns && elapsed >= _settings.minSeconds)
+            break;
+    }
+}
+
+Result
+Bench::run(const Entry& entry, const Settings& settings)
+{
+    Result result;
+    result.name = entry.name;
+    State state(settings, result);
+    entry.function(state);
+
+    if (result.skipped.empty() && result.runs == 0u)
+        result.skipped = "benchmark did not call measure()";
+
+    return result;
+}
+
+namespace
+{
+    struct Stats
+    {
+        double min, max, mean, median, stddev;
+
+        Stats(std::vector<double> samples) :
+            min(0), max(0), mean(0), median(0), stddev(0)
+        {
+            if (samples.empty()) return;
+            std::sort(samples.begin(), samples.end());
+            min = samples.front();
+            max = samples.back();
+            median = samples[samples.size() / 2];
+            for (unsigned i = 0; i < samples.size(); ++i)
+                mean += samples[i];
+            mean /= (double)samples.size();
+            for (unsigned i = 0; i < samples.size(); ++i)
+                stddev += (samples[i] - mean)*(samples[i] - mean);
+            stddev = sqrt(stddev / (double)samples.size());
+        }
+    };
+}
+
+std::string
+Bench::toJSON(const std::vector<Result>& results, const Settings& settings)
+{
+    Json::Value root(Json::objectValue);
+
+    root["version"] = osgEarthGetVersion();
+    root["timestamp"] = (double)::time(0L);
+    root["hardware_concurrency"] = (int)std::thread::hardware_concurrency();
+    root["quick"] = settings.quick;
+
+    Json::Value list(Json::arrayValue);
+    for (unsigned i = 0; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+        Json::Value b(Json::objectValue);
+        b["name"] = r.name;
+
+        if (!r.skipped.empty())
+        {
+            b["skipped"] = r.skipped;
+        }
+        else
+        {
+            Stats stats(r.samples);
+            b["runs"] = (int)r.runs;
+            b["ns_min"] = stats.min;
+            b["ns_median"] = stats.median;
+            b["ns_mean"] = stats.mean;
+            b["ns_max"] = stats.max;
+            b["ns_stddev"] = stats.stddev;
+            if (r.itemsPerRun > 0.0 && stats.median > 0.0)
+                b["items_per_second"] = r.itemsPerRun / (stats.median * 1e-9);
+            if (r.bytesPerRun > 0.0 && stats.median > 0.0)
+                b["bytes_per_second"] = r.bytesPerRun / (stats.median * 1e-9);
+        }
+
+        if (!r.counters.empty())
+        {
+            Json::Value counters(Json::objectValue);
+            for (std::map<std::string, double>::const_iterator c = r.counters.begin(); c != r.counters.end(); ++c)
+                counters[c->first] = c->second;
+            b["counters"] = counters;
+        }
+
+        list.append(b);
+    }
+    root["benchmarks"] = list;
+
+    return Json::StyledWriter().write(root);
+}
+
+void
+Bench::print(const Result& r)
+{
+    std::cout << std::left << std::setw(40) << r.name;
+    if (!r.skipped.empty())
+    {
+        std::cout << "skipped (" << r.skipped << ")" << std::endl;
+        return;
+    }
+
+    Stats stats(r.samples);
+    std::cout
+        << std::right << std::fixed << std::setprecision(3)
+        << std::setw(12) << stats.median * 1e-6 << " ms"
+        << "  (min " << stats.min * 1e-6 << ", runs " << r.runs << ")";
+
+    if (r.itemsPerRun > 0.0 && stats.median > 0.0)
+        std::cout << "  " << std::setprecision(0) << r.itemsPerRun / (stats.median * 1e-9) << " items/s";
+
+    std::cout << std::endl;
+}
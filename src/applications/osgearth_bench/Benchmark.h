@@ -0,0 +1,143 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef OSGEARTH_BENCH_BENCHMARK_H
+#define OSGEARTH_BENCH_BENCHMARK_H 1
+
+#include <osgEarth/Common>
+#include <functional>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+
+namespace osgEarth { namespace Bench
+{
+    //! Global settings for a benchmark run
+    struct Settings
+    {
+        Settings() : minRuns(5u), maxRuns(1000u), minSeconds(0.5), quick(false) { }
+
+        //! Minimum number of measured runs per benchmark
+        unsigned minRuns;
+        //! Maximum number of measured runs per benchmark
+        unsigned maxRuns;
+        //! Keep measuring until this much time has elapsed (or maxRuns is hit)
+        double minSeconds;
+        //! Smaller problem sizes, for smoke-testing the suite
+        bool quick;
+        //! Folder containing the osgEarth sample data
+        std::string dataPath;
+    };
+
+    //! Results of one benchmark
+    struct Result
+    {
+        Result() : runs(0u), itemsPerRun(0.0), bytesPerRun(0.0) { }
+
+        std::string name;
+        std::string skipped;
+        unsigned runs;
+        double itemsPerRun;
+        double bytesPerRun;
+        //! Duration of each measured run, in nanoseconds
+        std::vector<double> samples;
+        std::map<std::string, double> counters;
+    };
+
+    /**
+     * State passed to each benchmark function. A benchmark does its
+     * (untimed) setup, then calls measure() with the code to time.
+     */
+    class State
+    {
+    public:
+        State(const Settings& settings, Result& result) :
+            _settings(settings), _result(result) { }
+
+        //! Runs "func" once to warm up, then repeatedly, recording
+        //! the duration of each run.
+        void measure(const std::function<void()>& func);
+
+        //! Number of items processed by each run (for throughput)
+        void setItemsPerRun(double value) { _result.itemsPerRun = value; }
+
+        //! Number of bytes processed by each run (for throughput)
+        void setBytesPerRun(double value) { _result.bytesPerRun = value; }
+
+        //! Record a named value in the output (e.g. a feature count)
+        void setCounter(const std::string& name, double value) { _result.counters[name] = value; }
+
+        //! Skip this benchmark, e.g. because a driver is missing
+        void skip(const std::string& reason) { _result.skipped = reason; }
+
+        //! Whether to use reduced problem sizes
+        bool quick() const { return _settings.quick; }
+
+        //! Picks a problem size based on the quick setting
+        unsigned size(unsigned full, unsigned small) const { return _settings.quick ? small : full; }
+
+        //! Full path to a file in the sample data folder
+        std::string dataFile(const std::string& name) const;
+
+    private:
+        const Settings& _settings;
+        Result& _result;
+    };
+
+    typedef std::function<void(State&)> Function;
+
+    //! A registered benchmark
+    struct Entry
+    {
+        std::string name;
+        Function function;
+    };
+
+    //! All benchmarks registered in this executable, in registration order
+    extern std::vector<Entry>& registry();
+
+    //! Adds a benchmark to the registry at static-init time
+    struct Registrar
+    {
+        Registrar(const char* group, const char* name, Function function);
+    };
+
+    //! Runs one benchmark and returns its results
+    extern Result run(const Entry& entry, const Settings& settings);
+
+    //! Serializes a set of results to JSON
+    extern std::string toJSON(const std::vector<Result>& results, const Settings& settings);
+
+    //! Writes a one-line human readable summary of a result to stdout
+    extern void print(const Result& result);
+} }
+
+/**
+ * Declares a benchmark called "GROUP.NAME". The body receives a
+ * Bench::State& called "state".
+ */
+#define OE_BENCHMARK(GROUP, NAME) \
+    static void oe_bench_##GROUP##_##NAME(osgEarth::Bench::State&); \
+    static osgEarth::Bench::Registrar oe_bench_registrar_##GROUP##_##NAME(#GROUP, #NAME, oe_bench_##GROUP##_##NAME); \
+    static void oe_bench_##GROUP##_##NAME(osgEarth::Bench::State& state)
+
+#endif // OSGEARTH_BENCH_BENCHMARK_H
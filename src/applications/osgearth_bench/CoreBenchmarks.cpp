@@ -0,0 +1,189 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmark.h"
+#include <osgEarth/Threading>
+#include <osgEarth/MemCache>
+#include <osgEarth/TileKey>
+#include <osgEarth/Profile>
+#include <osgEarth/SpatialReference>
+#include <osgEarth/GeoData>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/StringUtils>
+#include <unordered_set>
+#include <atomic>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+OE_BENCHMARK(JobArena, dispatch)
+{
+    const unsigned count = state.size(20000u, 1000u);
+
+    JobArena::setConcurrency("oe.bench", 4u);
+    JobArena* arena = JobArena::get("oe.bench");
+    std::atomic_int total(0);
+
+    state.setItemsPerRun(count);
+    state.measure([&]()
+    {
+        JobGroup group;
+        Job job(arena, &group);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            job.dispatch([&total](Cancelable*) { ++total; });
+        }
+        group.join();
+    });
+}
+
+OE_BENCHMARK(MemCache, writeRead)
+{
+    const unsigned count = state.size(1024u, 64u);
+
+    osg::ref_ptr<Cache> cache = new MemCache(count);
+    osg::ref_ptr<CacheBin> bin = cache->addBin("bench");
+    osg::ref_ptr<osg::Image> image = ImageUtils::createEmptyImage(256, 256);
+
+    std::vector<std::string> keys(count);
+    for (unsigned i = 0; i < count; ++i)
+        keys[i] = Stringify() << "key_" << i;
+
+    unsigned hits = 0u;
+    state.setItemsPerRun(count * 2u);
+    state.measure([&]()
+    {
+        hits = 0u;
+        for (unsigned i = 0; i < count; ++i)
+            bin->write(keys[i], image.get(), 0L);
+        for (unsigned i = 0; i < count; ++i)
+            if (bin->readImage(keys[i], 0L).succeeded())
+                ++hits;
+    });
+    state.setCounter("hits", hits);
+}
+
+OE_BENCHMARK(TileKey, hash)
+{
+    const unsigned dim = state.size(512u, 64u);
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+
+    std::vector<TileKey> keys;
+    keys.reserve(dim*dim);
+    for (unsigned y = 0; y < dim; ++y)
+        for (unsigned x = 0; x < dim; ++x)
+            keys.push_back(TileKey(12u, 1000u + x, 500u + y, profile.get()));
+
+    state.setItemsPerRun(keys.size());
+    state.measure([&]()
+    {
+        std::unordered_set<TileKey> set;
+        set.reserve(keys.size());
+        for (unsigned i = 0; i < keys.size(); ++i)
+            set.insert(keys[i]);
+    });
+}
+
+OE_BENCHMARK(TileID, hash)
+{
+    const unsigned dim = state.size(512u, 64u);
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+
+    std::vector<TileID> ids;
+    ids.reserve(dim*dim);
+    for (unsigned y = 0; y < dim; ++y)
+        for (unsigned x = 0; x < dim; ++x)
+            ids.push_back(TileKey(12u, 1000u + x, 500u + y, profile.get()).getID());
+
+    state.setItemsPerRun(ids.size());
+    state.measure([&]()
+    {
+        std::unordered_set<TileID> set;
+        set.reserve(ids.size());
+        for (unsigned i = 0; i < ids.size(); ++i)
+            set.insert(ids[i]);
+    });
+}
+
+OE_BENCHMARK(TileID, fromTileKey)
+{
+    const unsigned dim = state.size(512u, 64u);
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+
+    std::vector<TileKey> keys;
+    keys.reserve(dim*dim);
+    for (unsigned y = 0; y < dim; ++y)
+        for (unsigned x = 0; x < dim; ++x)
+            keys.push_back(TileKey(12u, 1000u + x, 500u + y, profile.get()));
+
+    std::vector<TileID> ids(keys.size());
+    state.setItemsPerRun(keys.size());
+    state.measure([&]()
+    {
+        for (unsigned i = 0; i < keys.size(); ++i)
+            ids[i] = keys[i].getID();
+    });
+}
+
+OE_BENCHMARK(SpatialReference, transform)
+{
+    const unsigned count = state.size(100000u, 1000u);
+
+    osg::ref_ptr<SpatialReference> wgs84 = SpatialReference::get("wgs84");
+    osg::ref_ptr<SpatialReference> mercator = SpatialReference::get("spherical-mercator");
+
+    std::vector<osg::Vec3d> source(count);
+    for (unsigned i = 0; i < count; ++i)
+        source[i].set(-180.0 + 360.0*(double)i / (double)count, -80.0 + 160.0*(double)(i % 997) / 997.0, 0.0);
+
+    std::vector<osg::Vec3d> points;
+    state.setItemsPerRun(count);
+    state.measure([&]()
+    {
+        points = source;
+        wgs84->transform(points, mercator.get());
+    });
+}
+
+OE_BENCHMARK(GeoImage, reproject)
+{
+    const unsigned dim = state.size(256u, 64u);
+
+    osg::ref_ptr<SpatialReference> wgs84 = SpatialReference::get("wgs84");
+    osg::ref_ptr<SpatialReference> mercator = SpatialReference::get("spherical-mercator");
+
+    osg::ref_ptr<osg::Image> image = ImageUtils::createEmptyImage(dim, dim);
+    ImageUtils::PixelWriter write(image.get());
+    for (unsigned t = 0; t < dim; ++t)
+        for (unsigned s = 0; s < dim; ++s)
+            write(osg::Vec4f((float)s / (float)dim, (float)t / (float)dim, 0.5f, 1.0f), s, t);
+
+    // one zoom-8 mercator tile over Boston reprojected into geodetic
+    GeoExtent extent(mercator.get(), -7983694.73, 5165920.12, -7827151.70, 5322463.15);
+    GeoImage geoImage(image.get(), extent);
+    GeoExtent outExtent = extent.transform(wgs84.get());
+
+    state.setItemsPerRun(dim*dim);
+    state.measure([&]()
+    {
+        GeoImage result = geoImage.reproject(wgs84.get(), &outExtent, dim, dim, true);
+    });
+}
@@ -0,0 +1,469 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmark.h"
+#include <osgEarth/OGRFeatureSource>
+#include <osgEarth/PackedFeatureSource>
+#include <osgEarth/GeoJSONReader>
+#include <osgEarth/FeatureTileCache>
+#include <osgEarth/Profile>
+#include <osgEarth/Tessellator>
+#include <osgEarth/GeometryCompiler>
+#include <osgEarth/Session>
+#include <osgEarth/Map>
+#include <osgEarth/PolygonSymbol>
+#include <osgEarth/ExtrusionSymbol>
+#include <osgEarth/FileUtils>
+#ifdef OSGEARTH_HAVE_MVT
+#include <osgEarth/MVT>
+#endif
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // Star-shaped polygon with a square hole, centered at (x,y)
+    Polygon* createPolygon(double x, double y, double radius, unsigned numVerts)
+    {
+        Polygon* poly = new Polygon();
+        for (unsigned i = 0; i < numVerts; ++i)
+        {
+            double a = osg::PI * 2.0 * (double)i / (double)numVerts;
+            double r = (i & 1) ? radius : radius*0.6;
+            poly->push_back(osg::Vec3d(x + r*cos(a), y + r*sin(a), 0.0));
+        }
+
+        Ring* hole = new Ring();
+        double h = radius*0.2;
+        hole->push_back(osg::Vec3d(x - h, y - h, 0.0));
+        hole->push_back(osg::Vec3d(x - h, y + h, 0.0));
+        hole->push_back(osg::Vec3d(x + h, y + h, 0.0));
+        hole->push_back(osg::Vec3d(x + h, y - h, 0.0));
+        poly->getHoles().push_back(hole);
+        return poly;
+    }
+
+    // FeatureCollection of star polygons with a handful of mixed-type
+    // properties, like a typical GeoJSON tile service response
+    std::string createGeoJSON(unsigned count)
+    {
+        std::stringstream buf;
+        buf << std::setprecision(10);
+        buf << "{\"type\":\"FeatureCollection\",\"features\":[";
+        for (unsigned i = 0; i < count; ++i)
+        {
+            osg::ref_ptr<Polygon> poly = createPolygon((double)(i % 50), (double)(i / 50), 0.4, 32u);
+            if (i > 0) buf << ",";
+            buf << "{\"type\":\"Feature\",\"id\":" << i
+                << ",\"properties\":{\"name\":\"building " << i << "\""
+                << ",\"height\":" << (i % 7 == 0 ? 10.5 : 12.0) + (double)(i % 13)
+                << ",\"floors\":" << (i % 5)
+                << ",\"residential\":" << (i % 2 == 0 ? "true" : "false")
+                << "},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[[";
+            for (unsigned v = 0; v <= poly->size(); ++v)
+            {
+                const osg::Vec3d& p = (*poly)[v % poly->size()];
+                buf << (v > 0 ? "," : "") << "[" << p.x() << "," << p.y() << "]";
+            }
+            buf << "]]}}";
+        }
+        buf << "]}";
+        return buf.str();
+    }
+}
+
+OE_BENCHMARK(OGR, readShapefile)
+{
+    osg::ref_ptr<OGRFeatureSource> source = new OGRFeatureSource();
+    source->setURL(state.dataFile("world.shp"));
+    if (source->open().isError())
+    {
+        state.skip("cannot open " + source->getURL().full());
+        return;
+    }
+
+    unsigned count = 0u;
+    state.measure([&]()
+    {
+        count = 0u;
+        osg::ref_ptr<FeatureCursor> cursor = source->createFeatureCursor(Query(), 0L);
+        while (cursor.valid() && cursor->hasMore())
+        {
+            osg::ref_ptr<Feature> f = cursor->nextFeature();
+            ++count;
+        }
+    });
+    state.setItemsPerRun(count);
+    state.setCounter("features", count);
+}
+
+namespace
+{
+    // Runs every "stride"th of "numQueries" bounding box queries laid out
+    // on a grid over the source extent, starting at "first", and returns
+    // the number of features read.
+    unsigned runBoxQueries(FeatureSource* source, unsigned numQueries, unsigned first = 0u, unsigned stride = 1u)
+    {
+        const GeoExtent& extent = source->getFeatureProfile()->getExtent();
+        unsigned dim = (unsigned)std::max(1.0, sqrt((double)numQueries));
+        double w = extent.width() / (double)dim;
+        double h = extent.height() / (double)dim;
+
+        unsigned count = 0u;
+        for (unsigned i = first; i < numQueries; i += stride)
+        {
+            double x = extent.xMin() + w * (double)(i % dim);
+            double y = extent.yMin() + h * (double)((i / dim) % dim);
+            Query query;
+            query.bounds() = Bounds(x, y, x + w, y + h);
+
+            osg::ref_ptr<FeatureCursor> cursor = source->createFeatureCursor(query, 0L);
+            while (cursor.valid() && cursor->hasMore())
+            {
+                osg::ref_ptr<Feature> f = cursor->nextFeature();
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    // Same queries, split across "numThreads" threads hitting one source
+    unsigned runParallelBoxQueries(FeatureSource* source, unsigned numQueries, unsigned numThreads)
+    {
+        std::atomic_uint total(0u);
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < numThreads; ++t)
+        {
+            threads.push_back(std::thread([&total, source, numQueries, numThreads, t]()
+            {
+                total += runBoxQueries(source, numQueries, t, numThreads);
+            }));
+        }
+        for (std::vector<std::thread>::iterator t = threads.begin(); t != threads.end(); ++t)
+            t->join();
+        return total;
+    }
+
+    void benchmarkOGRQueries(Bench::State& state, unsigned numThreads)
+    {
+        osg::ref_ptr<OGRFeatureSource> source = new OGRFeatureSource();
+        source->setURL(state.dataFile("world.shp"));
+        if (source->open().isError())
+        {
+            state.skip("cannot open " + source->getURL().full());
+            return;
+        }
+
+        const unsigned numQueries = state.size(256u, 16u);
+        unsigned count = 0u;
+        state.measure([&]()
+        {
+            count = runParallelBoxQueries(source.get(), numQueries, numThreads);
+        });
+        state.setItemsPerRun(numQueries);
+        state.setCounter("features", count);
+        state.setCounter("threads", numThreads);
+    }
+}
+
+// OGR cursors each borrow a pooled datasource handle, so queries from
+// several threads should scale instead of serializing on one handle.
+OE_BENCHMARK(OGR, queryBounds1Thread)
+{
+    benchmarkOGRQueries(state, 1u);
+}
+
+OE_BENCHMARK(OGR, queryBounds4Threads)
+{
+    benchmarkOGRQueries(state, 4u);
+}
+
+OE_BENCHMARK(OGR, queryBounds16Threads)
+{
+    benchmarkOGRQueries(state, 16u);
+}
+
+OE_BENCHMARK(PackedFeatures, queryBounds)
+{
+    osg::ref_ptr<OGRFeatureSource> input = new OGRFeatureSource();
+    input->setURL(state.dataFile("world.shp"));
+
+    std::string filename = getTempName(getTempPath(), ".oepf");
+    osg::ref_ptr<PackedFeatureSource> source = new PackedFeatureSource();
+    source->setURL(filename);
+    source->setFeatureSource(input.get());
+    if (source->open().isError())
+    {
+        ::remove(filename.c_str());
+        state.skip("cannot pack " + input->getURL().full());
+        return;
+    }
+
+    const unsigned numQueries = state.size(256u, 16u);
+    unsigned count = 0u;
+    state.measure([&]()
+    {
+        count = runBoxQueries(source.get(), numQueries);
+    });
+    state.setItemsPerRun(numQueries);
+    state.setCounter("features", count);
+
+    source->close();
+    ::remove(filename.c_str());
+}
+
+#ifdef OSGEARTH_HAVE_MVT
+namespace
+{
+    void countFeatures(const TileKey& key, const FeatureList& features, void* context)
+    {
+        *static_cast<unsigned*>(context) += features.size();
+    }
+}
+
+OE_BENCHMARK(MVT, decodeTiles)
+{
+    osg::ref_ptr<MVTFeatureSource> source = new MVTFeatureSource();
+    source->setURL(state.dataFile("honolulu.mbtiles"));
+    if (source->open().isError())
+    {
+        state.skip("cannot open " + source->getURL().full());
+        return;
+    }
+
+    const int numTiles = state.size(64u, 4u);
+    unsigned count = 0u;
+    state.measure([&]()
+    {
+        count = 0u;
+        source->iterateTiles(14, numTiles, 0, GeoExtent::INVALID, countFeatures, &count);
+    });
+    state.setItemsPerRun(count);
+    state.setCounter("features", count);
+}
+#else
+OE_BENCHMARK(MVT, decodeTiles)
+{
+    state.skip("built without MVT support");
+}
+#endif
+
+OE_BENCHMARK(GeoJSON, readNative)
+{
+    const unsigned count = state.size(5000u, 200u);
+    const std::string json = createGeoJSON(count);
+
+    GeoJSONReader reader;
+    unsigned numFeatures = 0u;
+
+    state.setBytesPerRun(json.size());
+    state.measure([&]()
+    {
+        FeatureList features;
+        reader.read(json, features);
+        numFeatures = features.size();
+    });
+    state.setItemsPerRun(numFeatures);
+    state.setCounter("features", numFeatures);
+}
+
+OE_BENCHMARK(GeoJSON, readGeometryOnly)
+{
+    const unsigned count = state.size(5000u, 200u);
+    const std::string json = createGeoJSON(count);
+
+    GeoJSONReader reader;
+    reader.setGeometryOnly(true);
+    unsigned numFeatures = 0u;
+
+    state.setBytesPerRun(json.size());
+    state.measure([&]()
+    {
+        FeatureList features;
+        reader.read(json, features);
+        numFeatures = features.size();
+    });
+    state.setItemsPerRun(numFeatures);
+    state.setCounter("features", numFeatures);
+}
+
+// The OGR route the TFS, XYZ and WFS sources took before the native
+// reader: a GeoJSON datasource per response, converted with OgrUtils.
+OE_BENCHMARK(GeoJSON, readOGR)
+{
+    const unsigned count = state.size(5000u, 200u);
+    const std::string json = createGeoJSON(count);
+
+    std::string filename = getTempName(getTempPath(), ".geojson");
+    {
+        std::ofstream fout(filename.c_str(), std::ios::out | std::ios::binary);
+        fout.write(json.c_str(), json.size());
+    }
+
+    unsigned numFeatures = 0u;
+    bool opened = true;
+
+    state.setBytesPerRun(json.size());
+    state.measure([&]()
+    {
+        numFeatures = 0u;
+        osg::ref_ptr<OGRFeatureSource> source = new OGRFeatureSource();
+        source->setURL(filename);
+        source->setOGRDriver("GeoJSON");
+        if (source->open().isError())
+        {
+            opened = false;
+            return;
+        }
+
+        FeatureList features;
+        osg::ref_ptr<FeatureCursor> cursor = source->createFeatureCursor(Query(), 0L);
+        if (cursor.valid())
+            cursor->fill(features);
+        numFeatures = features.size();
+    });
+
+    ::remove(filename.c_str());
+
+    if (!opened)
+    {
+        state.skip("OGR cannot open GeoJSON");
+        return;
+    }
+    state.setItemsPerRun(numFeatures);
+    state.setCounter("features", numFeatures);
+}
+
+// Decoding a tile persisted by the FeatureSource tile cache, against
+// parsing the same features from GeoJSON above.
+OE_BENCHMARK(FeatureTileCache, read)
+{
+    const unsigned count = state.size(5000u, 200u);
+
+    FeatureList input;
+    GeoJSONReader().read(createGeoJSON(count), input);
+
+    std::string buffer;
+    FeatureTileCache::write(input, buffer);
+    unsigned numFeatures = 0u;
+
+    state.setBytesPerRun(buffer.size());
+    state.measure([&]()
+    {
+        FeatureList features;
+        FeatureTileCache::read(buffer, 0L, features);
+        numFeatures = features.size();
+    });
+    state.setItemsPerRun(numFeatures);
+    state.setCounter("features", numFeatures);
+}
+
+// A memory hit, which copies the cached features for the caller.
+OE_BENCHMARK(FeatureTileCache, get)
+{
+    const unsigned count = state.size(5000u, 200u);
+
+    FeatureList input;
+    GeoJSONReader().read(createGeoJSON(count), input);
+
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+    TileKey key(0, 0, 0, profile.get());
+
+    osg::ref_ptr<FeatureTileCache> cache = new FeatureTileCache(256u * 1024u * 1024u);
+    cache->put(key, input);
+    unsigned numFeatures = 0u;
+
+    state.measure([&]()
+    {
+        FeatureList features;
+        cache->get(key, features);
+        numFeatures = features.size();
+    });
+    state.setItemsPerRun(numFeatures);
+    state.setCounter("features", numFeatures);
+    state.setCounter("bytes", cache->getSizeInBytes());
+}
+
+OE_BENCHMARK(Tessellator, tessellate2D)
+{
+    const unsigned count = state.size(2000u, 100u);
+
+    std::vector<osg::ref_ptr<Geometry> > polygons;
+    for (unsigned i = 0; i < count; ++i)
+        polygons.push_back(createPolygon((double)(i % 50), (double)(i / 50), 0.4, 64u));
+
+    Tessellator tess;
+    std::vector<uint32_t> indices;
+
+    state.setItemsPerRun(count);
+    state.measure([&]()
+    {
+        for (unsigned i = 0; i < polygons.size(); ++i)
+        {
+            indices.clear();
+            tess.tessellate2D(polygons[i].get(), indices);
+        }
+    });
+}
+
+OE_BENCHMARK(GeometryCompiler, extrudedPolygons)
+{
+    const unsigned count = state.size(1000u, 50u);
+
+    osg::ref_ptr<const SpatialReference> wgs84 = SpatialReference::get("wgs84");
+    GeoExtent extent(wgs84.get(), -71.2, 42.2, -70.9, 42.5);
+
+    FeatureList source;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        double x = extent.xMin() + extent.width()*(double)(i % 32) / 32.0;
+        double y = extent.yMin() + extent.height()*(double)(i / 32) / (double)(count / 32 + 1);
+        source.push_back(new Feature(createPolygon(x, y, 0.002, 12u), wgs84.get(), Style(), i));
+    }
+
+    Style style;
+    style.getOrCreate<PolygonSymbol>()->fill()->color() = Color::White;
+    style.getOrCreate<ExtrusionSymbol>()->height() = 20.0f;
+
+    osg::ref_ptr<Map> map = new Map();
+    osg::ref_ptr<Session> session = new Session(map.get());
+    osg::ref_ptr<FeatureProfile> profile = new FeatureProfile(extent);
+
+    state.setItemsPerRun(count);
+    state.measure([&]()
+    {
+        // the compiler consumes its input, so work on a copy
+        FeatureList features;
+        for (FeatureList::const_iterator i = source.begin(); i != source.end(); ++i)
+            features.push_back(new Feature(*i->get()));
+
+        FilterContext context(session.get(), profile.get(), extent);
+        GeometryCompiler compiler;
+        osg::ref_ptr<osg::Node> node = compiler.compile(features, style, context);
+    });
+}
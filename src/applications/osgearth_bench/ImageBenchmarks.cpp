@@ -0,0 +1,393 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmark.h"
+#include <osgEarth/ImageUtils>
+#include <osgEarth/ImageKernels>
+#include <osgEarth/LandCover>
+#include <cstdlib>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+// Each ImageKernels benchmark has a PixelReader twin that runs the generic
+// per-pixel path on the same input, for comparison.
+
+namespace
+{
+    osg::Image* createNoiseImage(unsigned dim, GLenum pixelFormat, GLenum dataType)
+    {
+        osg::Image* image = new osg::Image();
+        image->allocateImage(dim, dim, 1, pixelFormat, dataType);
+        std::srand(42);
+        if (dataType == GL_FLOAT)
+        {
+            float* ptr = (float*)image->data();
+            for (unsigned i = 0; i < dim*dim; ++i)
+                ptr[i] = (float)(std::rand() % 4000);
+        }
+        else
+        {
+            for (unsigned i = 0; i < image->getTotalSizeInBytes(); ++i)
+                image->data()[i] = (unsigned char)(std::rand() & 0xFF);
+        }
+        return image;
+    }
+
+    // Resize through PixelReader/PixelWriter (bilinear)
+    void resizeGeneric(const osg::Image* input, osg::Image* output)
+    {
+        ImageUtils::PixelReader read(input);
+        read.setBilinear(true);
+        ImageUtils::PixelWriter write(output);
+        osg::Vec4f color;
+        for (int t = 0; t < output->t(); ++t)
+        {
+            float v = (float)t / (float)output->t();
+            for (int s = 0; s < output->s(); ++s)
+            {
+                read(color, (float)s / (float)output->s(), v);
+                write(color, s, t);
+            }
+        }
+    }
+
+    void mipmapGeneric(const osg::Image* input, osg::Image* output)
+    {
+        // output holds the next mip level
+        ImageUtils::PixelReader read(input);
+        ImageUtils::PixelWriter write(output);
+        for (int t = 0; t < output->t(); ++t)
+        {
+            for (int s = 0; s < output->s(); ++s)
+            {
+                osg::Vec4f c =
+                    read(s * 2, t * 2) + read(s * 2 + 1, t * 2) +
+                    read(s * 2, t * 2 + 1) + read(s * 2 + 1, t * 2 + 1);
+                write(c * 0.25f, s, t);
+            }
+        }
+    }
+
+    void premultiplyGeneric(osg::Image* image)
+    {
+        ImageUtils::PixelReader read(image);
+        ImageUtils::PixelWriter write(image);
+        for (int t = 0; t < image->t(); ++t)
+        {
+            for (int s = 0; s < image->s(); ++s)
+            {
+                osg::Vec4f c = read(s, t);
+                write(osg::Vec4f(c.r()*c.a(), c.g()*c.a(), c.b()*c.a(), c.a()), s, t);
+            }
+        }
+    }
+
+    bool anyAlphaAboveGeneric(const osg::Image* image, float threshold)
+    {
+        ImageUtils::PixelReader read(image);
+        for (int t = 0; t < image->t(); ++t)
+            for (int s = 0; s < image->s(); ++s)
+                if (read(s, t).a() > threshold)
+                    return true;
+        return false;
+    }
+
+    // Coverage mappings for every third code
+    void createLandCoverMappings(LandCoverCodeTable& table, std::vector<int>& codemap)
+    {
+        std::vector<std::pair<int, int> > mappings;
+        codemap.assign(4000, -1);
+        for (int code = 0; code < 4000; code += 3)
+        {
+            mappings.push_back(std::make_pair(code, code % 32));
+            codemap[code] = code % 32;
+        }
+        table.compile(mappings);
+    }
+
+    // Per-pixel transcode through a dense code vector, as
+    // LandCoverLayer did before LandCoverCodeTable
+    unsigned transcodeGeneric(const osg::Image* input, osg::Image* output, const std::vector<int>& codemap)
+    {
+        ImageUtils::PixelReader read(input);
+        ImageUtils::PixelWriter write(output);
+        osg::Vec4f pixel;
+        unsigned pixelsWritten = 0u;
+        for (int t = 0; t < output->t(); ++t)
+        {
+            for (int s = 0; s < output->s(); ++s)
+            {
+                read(pixel, s, t);
+                int code = pixel.r() < 1.0f ? (int)(pixel.r()*255.0f) : (int)pixel.r();
+                if (code >= 0 && code < (int)codemap.size() && codemap[code] >= 0)
+                {
+                    pixel.r() = (float)codemap[code];
+                    pixelsWritten++;
+                }
+                else
+                {
+                    pixel.r() = NO_DATA_VALUE;
+                }
+                write(pixel, s, t);
+            }
+        }
+        return pixelsWritten;
+    }
+
+    // Same blend as ImageUtils::mix, per pixel
+    struct MixGeneric
+    {
+        bool operator()(const osg::Vec4f& src, osg::Vec4f& dest)
+        {
+            float sa = 0.5f * src.a();
+            dest.set(
+                dest.r()*(1.0f - sa) + src.r()*sa,
+                dest.g()*(1.0f - sa) + src.g()*sa,
+                dest.b()*(1.0f - sa) + src.b()*sa,
+                osg::maximum(sa, dest.a()));
+            return true;
+        }
+    };
+
+    struct Sizes
+    {
+        Sizes(const Bench::State& state) : dim(state.size(1024u, 128u)) { }
+        unsigned dim;
+    };
+}
+
+OE_BENCHMARK(ImageKernels, resizeRGBA8)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> input = createNoiseImage(sz.dim, GL_RGBA, GL_UNSIGNED_BYTE);
+    osg::ref_ptr<osg::Image> output = new osg::Image();
+    output->allocateImage(sz.dim * 3 / 4, sz.dim * 3 / 4, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    state.setItemsPerRun(output->s()*output->t());
+    state.setCounter(ImageKernels::getInstructionSet(), 1);
+    state.measure([&]() { ImageKernels::resize(input.get(), output.get(), true); });
+}
+
+OE_BENCHMARK(PixelReader, resizeRGBA8)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> input = createNoiseImage(sz.dim, GL_RGBA, GL_UNSIGNED_BYTE);
+    osg::ref_ptr<osg::Image> output = new osg::Image();
+    output->allocateImage(sz.dim * 3 / 4, sz.dim * 3 / 4, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    state.setItemsPerRun(output->s()*output->t());
+    state.measure([&]() { resizeGeneric(input.get(), output.get()); });
+}
+
+OE_BENCHMARK(ImageKernels, resizeR32F)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> input = createNoiseImage(sz.dim, GL_RED, GL_FLOAT);
+    osg::ref_ptr<osg::Image> output = new osg::Image();
+    output->allocateImage(sz.dim * 3 / 4, sz.dim * 3 / 4, 1, GL_RED, GL_FLOAT);
+
+    state.setItemsPerRun(output->s()*output->t());
+    state.measure([&]() { ImageKernels::resize(input.get(), output.get(), true); });
+}
+
+OE_BENCHMARK(PixelReader, resizeR32F)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> input = createNoiseImage(sz.dim, GL_RED, GL_FLOAT);
+    osg::ref_ptr<osg::Image> output = new osg::Image();
+    output->allocateImage(sz.dim * 3 / 4, sz.dim * 3 / 4, 1, GL_RED, GL_FLOAT);
+
+    state.setItemsPerRun(output->s()*output->t());
+    state.measure([&]() { resizeGeneric(input.get(), output.get()); });
+}
+
+OE_BENCHMARK(ImageKernels, mipmapRGBA8)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> input = createNoiseImage(sz.dim, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]()
+    {
+        osg::ref_ptr<const osg::Image> output = ImageUtils::mipmapImage(input.get());
+    });
+}
+
+OE_BENCHMARK(PixelReader, mipmapRGBA8)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> input = createNoiseImage(sz.dim, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    // same chain of levels, through the generic reader and writer
+    std::vector<osg::ref_ptr<osg::Image> > levels;
+    for (unsigned d = sz.dim / 2; d >= 1; d /= 2)
+    {
+        levels.push_back(new osg::Image());
+        levels.back()->allocateImage(d, d, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    }
+
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]()
+    {
+        const osg::Image* src = input.get();
+        for (unsigned i = 0; i < levels.size(); ++i)
+        {
+            mipmapGeneric(src, levels[i].get());
+            src = levels[i].get();
+        }
+    });
+}
+
+OE_BENCHMARK(ImageKernels, mixRGBA8)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> src = createNoiseImage(sz.dim, GL_RGBA, GL_UNSIGNED_BYTE);
+    osg::ref_ptr<osg::Image> dest = createNoiseImage(sz.dim, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]() { ImageKernels::mix(dest.get(), src.get(), 0.5f); });
+}
+
+OE_BENCHMARK(PixelReader, mixRGBA8)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> src = createNoiseImage(sz.dim, GL_RGBA, GL_UNSIGNED_BYTE);
+    osg::ref_ptr<osg::Image> dest = createNoiseImage(sz.dim, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    ImageUtils::PixelVisitor<MixGeneric> mixer;
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]() { mixer.accept(src.get(), dest.get()); });
+}
+
+OE_BENCHMARK(ImageKernels, convertRGB8toRGBA8)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> input = createNoiseImage(sz.dim, GL_RGB, GL_UNSIGNED_BYTE);
+    osg::ref_ptr<osg::Image> output = new osg::Image();
+    output->allocateImage(sz.dim, sz.dim, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]() { ImageKernels::convertToRGBA8(input.get(), output.get()); });
+}
+
+OE_BENCHMARK(PixelReader, convertRGB8toRGBA8)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> input = createNoiseImage(sz.dim, GL_RGB, GL_UNSIGNED_BYTE);
+    osg::ref_ptr<osg::Image> output = new osg::Image();
+    output->allocateImage(sz.dim, sz.dim, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    ImageUtils::PixelVisitor<ImageUtils::CopyImage> copier;
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]() { copier.accept(input.get(), output.get()); });
+}
+
+OE_BENCHMARK(ImageKernels, premultiplyAlpha)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> image = createNoiseImage(sz.dim, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]() { ImageKernels::premultiplyAlpha(image.get()); });
+}
+
+OE_BENCHMARK(PixelReader, premultiplyAlpha)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> image = createNoiseImage(sz.dim, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]() { premultiplyGeneric(image.get()); });
+}
+
+OE_BENCHMARK(ImageKernels, isEmptyImage)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> image = ImageUtils::createEmptyImage(sz.dim, sz.dim);
+    bool result = false;
+
+    // worst case: every pixel is examined
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]() { ImageKernels::anyAlphaAbove(image.get(), 0.0f, result); });
+}
+
+OE_BENCHMARK(PixelReader, isEmptyImage)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> image = ImageUtils::createEmptyImage(sz.dim, sz.dim);
+    bool result = false;
+
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]() { result = anyAlphaAboveGeneric(image.get(), 0.0f); });
+}
+
+OE_BENCHMARK(LandCoverCodeTable, reclassifyL8)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> input = createNoiseImage(sz.dim, GL_LUMINANCE, GL_UNSIGNED_BYTE);
+    osg::ref_ptr<osg::Image> output = LandCover::createImage(sz.dim);
+    LandCoverCodeTable table;
+    std::vector<int> codemap;
+    createLandCoverMappings(table, codemap);
+
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]() { table.reclassify(input.get(), output.get()); });
+}
+
+OE_BENCHMARK(PixelReader, reclassifyL8)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> input = createNoiseImage(sz.dim, GL_LUMINANCE, GL_UNSIGNED_BYTE);
+    osg::ref_ptr<osg::Image> output = LandCover::createImage(sz.dim);
+    LandCoverCodeTable table;
+    std::vector<int> codemap;
+    createLandCoverMappings(table, codemap);
+
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]() { transcodeGeneric(input.get(), output.get(), codemap); });
+}
+
+OE_BENCHMARK(LandCoverCodeTable, reclassifyR32F)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> input = createNoiseImage(sz.dim, GL_RED, GL_FLOAT);
+    osg::ref_ptr<osg::Image> output = LandCover::createImage(sz.dim);
+    LandCoverCodeTable table;
+    std::vector<int> codemap;
+    createLandCoverMappings(table, codemap);
+
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]() { table.reclassify(input.get(), output.get()); });
+}
+
+OE_BENCHMARK(PixelReader, reclassifyR32F)
+{
+    Sizes sz(state);
+    osg::ref_ptr<osg::Image> input = createNoiseImage(sz.dim, GL_RED, GL_FLOAT);
+    osg::ref_ptr<osg::Image> output = LandCover::createImage(sz.dim);
+    LandCoverCodeTable table;
+    std::vector<int> codemap;
+    createLandCoverMappings(table, codemap);
+
+    state.setItemsPerRun(sz.dim*sz.dim);
+    state.measure([&]() { transcodeGeneric(input.get(), output.get(), codemap); });
+}
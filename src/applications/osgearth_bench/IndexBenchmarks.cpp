@@ -0,0 +1,227 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmark.h"
+#include <osgEarth/ObjectIndex>
+#include <osgEarth/FeatureSourceIndexNode>
+#include <osgEarth/DataExtentIndex>
+#include <osgEarth/Profile>
+#include <osg/Geometry>
+#include <random>
+
+using namespace osgEarth;
+
+namespace
+{
+    osg::Geometry* createGeometry(unsigned numVerts)
+    {
+        osg::Geometry* geom = new osg::Geometry();
+        geom->setVertexArray(new osg::Vec3Array(numVerts));
+        return geom;
+    }
+
+    // Index node with "count" features tagged on a single drawable
+    FeatureSourceIndexNode* createIndexNode(FeatureSourceIndex* index, osg::Geometry* geom, unsigned count)
+    {
+        FeatureSourceIndexNode* node = new FeatureSourceIndexNode(index);
+        osg::ref_ptr<Feature> feature = new Feature(0L, 0L, Style(), 0LL);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            feature->setFID(i);
+            node->tagDrawable(geom, feature.get());
+        }
+        return node;
+    }
+}
+
+OE_BENCHMARK(FeatureSourceIndex, tag)
+{
+    const unsigned count = state.size(1000000u, 10000u);
+    osg::ref_ptr<osg::Geometry> geom = createGeometry(4);
+
+    state.setItemsPerRun(count);
+    state.measure([&]()
+    {
+        osg::ref_ptr<ObjectIndex> master = new ObjectIndex();
+        osg::ref_ptr<FeatureSourceIndex> index = new FeatureSourceIndex(0L, master.get(), FeatureSourceIndexOptions());
+        osg::ref_ptr<FeatureSourceIndexNode> node = createIndexNode(index.get(), geom.get(), count);
+    });
+}
+
+OE_BENCHMARK(FeatureSourceIndex, lookup)
+{
+    const unsigned count = state.size(1000000u, 10000u);
+    osg::ref_ptr<osg::Geometry> geom = createGeometry(4);
+    osg::ref_ptr<ObjectIndex> master = new ObjectIndex();
+    osg::ref_ptr<FeatureSourceIndex> index = new FeatureSourceIndex(0L, master.get(), FeatureSourceIndexOptions());
+    osg::ref_ptr<FeatureSourceIndexNode> node = createIndexNode(index.get(), geom.get(), count);
+
+    unsigned found = 0u;
+    state.setItemsPerRun(count);
+    state.measure([&]()
+    {
+        found = 0u;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            ObjectID oid = index->getObjectID(i);
+            if (master->get<osg::Referenced>(oid).valid() && index->getFeature(oid))
+                ++found;
+        }
+    });
+    state.setCounter("found", found);
+}
+
+OE_BENCHMARK(FeatureSourceIndex, reindex)
+{
+    const unsigned count = state.size(1000000u, 10000u);
+    const unsigned tagged = state.size(10000u, 100u);
+    osg::ref_ptr<osg::Geometry> geom = createGeometry(4);
+    osg::ref_ptr<ObjectIndex> master = new ObjectIndex();
+    osg::ref_ptr<FeatureSourceIndex> index = new FeatureSourceIndex(0L, master.get(), FeatureSourceIndexOptions());
+    osg::ref_ptr<FeatureSourceIndexNode> node = createIndexNode(index.get(), geom.get(), count);
+    FeatureSourceIndexNode::FIDMap fids = node->getFIDMap();
+
+    // simulates paging in a serialized tile: a FID table plus geometry
+    // tagged with stale object IDs that must be remapped.
+    state.setItemsPerRun(count);
+    state.measure([&]()
+    {
+        osg::ref_ptr<FeatureSourceIndexNode> loaded = new FeatureSourceIndexNode();
+        loaded->setFIDMap(fids);
+        for (unsigned i = 0; i < tagged; ++i)
+        {
+            osg::Geometry* g = createGeometry(4);
+            master->tagDrawable(g, fids.find(i * (count / tagged))->second);
+            loaded->addChild(g);
+        }
+        FeatureSourceIndexNode::reconstitute(loaded.get(), index.get());
+    });
+}
+
+namespace
+{
+    // "count" data extents tiled over the globe, with assorted level ranges,
+    // like a layer built from many separate sources
+    DataExtentList createDataExtents(unsigned count)
+    {
+        const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+        unsigned dim = (unsigned)std::max(1.0, ceil(sqrt((double)count)));
+        double w = 360.0 / (double)dim, h = 180.0 / (double)dim;
+
+        std::mt19937 gen(0);
+        std::uniform_int_distribution<unsigned> minLevel(0u, 6u), range(2u, 12u);
+
+        DataExtentList de;
+        de.reserve(count);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            double x = -180.0 + w * (double)(i % dim);
+            double y = -90.0 + h * (double)(i / dim);
+            unsigned lo = minLevel(gen);
+            de.push_back(DataExtent(GeoExtent(wgs84, x, y, x + w, y + h), lo, lo + range(gen)));
+        }
+        return de;
+    }
+
+    std::vector<TileKey> createQueryKeys(const Profile* profile, unsigned count)
+    {
+        std::mt19937 gen(1);
+        std::uniform_real_distribution<double> lon(-180.0, 180.0), lat(-90.0, 90.0);
+        std::uniform_int_distribution<unsigned> level(4u, 16u);
+
+        std::vector<TileKey> keys;
+        keys.reserve(count);
+        for (unsigned i = 0; i < count; ++i)
+            keys.push_back(profile->createTileKey(lon(gen), lat(gen), level(gen)));
+        return keys;
+    }
+
+    // The per-key work of TileLayer::getBestAvailableTileKey, either
+    // through the index or with a linear scan of the extents
+    void benchmarkDataExtents(Bench::State& state, unsigned numExtents, bool indexed)
+    {
+        osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+        DataExtentList de = createDataExtents(numExtents);
+        std::vector<TileKey> keys = createQueryKeys(profile.get(), state.size(1000u, 100u));
+        DataExtentIndex index(de);
+
+        unsigned found = 0u;
+        state.measure([&]()
+        {
+            found = 0u;
+            for (auto& key : keys)
+            {
+                int best = -1;
+                if (indexed)
+                {
+                    best = index.getBestAvailableLevel(key, key.getLOD());
+                }
+                else
+                {
+                    for (auto& e : de)
+                    {
+                        if (key.getExtent().intersects(e) && key.getLOD() >= e.minLevel().get())
+                        {
+                            best = std::max(best, (int)std::min(key.getLOD(), e.maxLevel().get()));
+                            if (best == (int)key.getLOD())
+                                break;
+                        }
+                    }
+                }
+                if (best >= 0)
+                    ++found;
+            }
+        });
+        state.setItemsPerRun(keys.size());
+        state.setCounter("extents", numExtents);
+        state.setCounter("found", found);
+    }
+}
+
+OE_BENCHMARK(DataExtentIndex, query10)
+{
+    benchmarkDataExtents(state, 10u, true);
+}
+
+OE_BENCHMARK(DataExtentIndex, query1k)
+{
+    benchmarkDataExtents(state, 1000u, true);
+}
+
+OE_BENCHMARK(DataExtentIndex, query100k)
+{
+    benchmarkDataExtents(state, state.size(100000u, 10000u), true);
+}
+
+OE_BENCHMARK(DataExtentIndex, linear10)
+{
+    benchmarkDataExtents(state, 10u, false);
+}
+
+OE_BENCHMARK(DataExtentIndex, linear1k)
+{
+    benchmarkDataExtents(state, 1000u, false);
+}
+
+OE_BENCHMARK(DataExtentIndex, linear100k)
+{
+    benchmarkDataExtents(state, state.size(100000u, 10000u), false);
+}
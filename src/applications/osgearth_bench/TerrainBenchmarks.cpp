@@ -0,0 +1,335 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmark.h"
+#include <osgEarth/Map>
+#include <osgEarth/GDAL>
+#include <osgEarth/ElevationPool>
+#include <osgEarth/Elevation>
+#include <osgEarth/TileMesh>
+#include <osgEarth/weemesh.h>
+#include <osg/Texture2D>
+#include <cmath>
+#include <cstdlib>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // Map with a single local elevation layer (Mt. Rainier, 90m)
+    Map* createElevationMap(Bench::State& state)
+    {
+        osg::ref_ptr<GDALElevationLayer> layer = new GDALElevationLayer();
+        layer->setURL(state.dataFile("terrain/mt_rainier_90m.tif"));
+        if (layer->open().isError())
+        {
+            state.skip("cannot open " + layer->getURL().full());
+            return 0L;
+        }
+        Map* map = new Map();
+        map->addLayer(layer.get());
+        return map;
+    }
+}
+
+OE_BENCHMARK(ElevationPool, sampleMapCoords)
+{
+    osg::ref_ptr<Map> map = createElevationMap(state);
+    if (!map.valid())
+        return;
+
+    const unsigned dim = state.size(256u, 32u);
+    const double lon0 = -121.85, lat0 = 46.80, span = 0.2;
+
+    std::vector<osg::Vec3d> source;
+    source.reserve(dim*dim);
+    for (unsigned y = 0; y < dim; ++y)
+        for (unsigned x = 0; x < dim; ++x)
+            source.push_back(osg::Vec3d(lon0 + span*(double)x / (double)dim, lat0 + span*(double)y / (double)dim, 0.0));
+
+    ElevationPool* pool = map->getElevationPool();
+    ElevationPool::WorkingSet ws;
+    std::vector<osg::Vec3d> points;
+    int valid = 0;
+
+    state.setItemsPerRun(source.size());
+    state.measure([&]()
+    {
+        points = source;
+        valid = pool->sampleMapCoords(points, Distance(90.0, Units::METERS), &ws, 0L);
+    });
+    state.setCounter("valid", valid);
+}
+
+OE_BENCHMARK(ElevationPool, getSample)
+{
+    osg::ref_ptr<Map> map = createElevationMap(state);
+    if (!map.valid())
+        return;
+
+    const unsigned count = state.size(4096u, 256u);
+    ElevationPool* pool = map->getElevationPool();
+    const SpatialReference* srs = map->getSRS();
+
+    std::vector<GeoPoint> points;
+    points.reserve(count);
+    for (unsigned i = 0; i < count; ++i)
+        points.push_back(GeoPoint(srs, -121.85 + 0.2*(double)(i % 64) / 64.0, 46.80 + 0.2*(double)(i / 64) / (double)(count / 64), 0.0, ALTMODE_ABSOLUTE));
+
+    // no working set, to measure the shared pool cache
+    state.setItemsPerRun(count);
+    state.measure([&]()
+    {
+        for (unsigned i = 0; i < count; ++i)
+            pool->getSample(points[i], 0L);
+    });
+}
+
+namespace
+{
+    TileKey normalMapKey(const Map* map)
+    {
+        // level 10 tile over the summit
+        GeoPoint summit(map->getSRS(), -121.76, 46.85, 0.0, ALTMODE_ABSOLUTE);
+        return map->getProfile()->createTileKey(summit.x(), summit.y(), 10u);
+    }
+
+    // Largest per-channel difference between two RG8 normal maps
+    int maxPackedDifference(const osg::Texture2D* a, const osg::Texture2D* b)
+    {
+        const osg::Image* ia = a->getImage();
+        const osg::Image* ib = b->getImage();
+        int diff = 0;
+        for (unsigned i = 0; i < ia->getTotalSizeInBytes(); ++i)
+            diff = osg::maximum(diff, std::abs((int)ia->data()[i] - (int)ib->data()[i]));
+        return diff;
+    }
+}
+
+OE_BENCHMARK(NormalMapGenerator, createNormalMap)
+{
+    osg::ref_ptr<Map> map = createElevationMap(state);
+    if (!map.valid())
+        return;
+
+    TileKey key = normalMapKey(map.get());
+    ElevationPool::WorkingSet ws;
+    NormalMapGenerator gen;
+    osg::ref_ptr<osg::Texture2D> tex;
+
+    state.setItemsPerRun(ELEVATION_TILE_SIZE*ELEVATION_TILE_SIZE);
+    state.measure([&]()
+    {
+        tex = gen.createNormalMap(key, map.get(), &ws, 0L);
+    });
+
+    osg::ref_ptr<osg::Texture2D> ref = gen.createNormalMapBySampling(key, map.get(), &ws, 0L);
+    if (tex.valid() && ref.valid())
+        state.setCounter("max_diff", maxPackedDifference(tex.get(), ref.get()));
+}
+
+OE_BENCHMARK(NormalMapGenerator, createNormalMapBySampling)
+{
+    osg::ref_ptr<Map> map = createElevationMap(state);
+    if (!map.valid())
+        return;
+
+    TileKey key = normalMapKey(map.get());
+    ElevationPool::WorkingSet ws;
+    NormalMapGenerator gen;
+    osg::ref_ptr<osg::Texture2D> tex;
+
+    state.setItemsPerRun(ELEVATION_TILE_SIZE*ELEVATION_TILE_SIZE);
+    state.measure([&]()
+    {
+        tex = gen.createNormalMapBySampling(key, map.get(), &ws, 0L);
+    });
+}
+
+// Cross-profile requests go through ImageLayer::assembleImage and
+// ElevationLayer::assembleHeightField.
+
+OE_BENCHMARK(ImageLayer, assembleImage)
+{
+    osg::ref_ptr<GDALImageLayer> layer = new GDALImageLayer();
+    layer->setURL(state.dataFile("boston-inset-wgs84.tif"));
+    if (layer->open().isError())
+    {
+        state.skip("cannot open " + layer->getURL().full());
+        return;
+    }
+
+    // spherical-mercator keys against a geodetic source, over downtown Boston
+    osg::ref_ptr<const Profile> mercator = Profile::create("spherical-mercator");
+    GeoPoint boston(SpatialReference::get("wgs84"), -71.06, 42.36, 0.0, ALTMODE_ABSOLUTE);
+    GeoPoint bostonMerc = boston.transform(mercator->getSRS());
+    TileKey center = mercator->createTileKey(bostonMerc.x(), bostonMerc.y(), 14u);
+
+    const unsigned count = state.size(9u, 1u);
+    std::vector<TileKey> keys;
+    unsigned cx, cy;
+    center.getTileXY(cx, cy);
+    for (unsigned i = 0; i < count; ++i)
+        keys.push_back(TileKey(14u, cx - 1 + i % 3, cy - 1 + i / 3, mercator.get()));
+
+    unsigned valid = 0;
+    state.setItemsPerRun(count);
+    state.measure([&]()
+    {
+        valid = 0;
+        for (unsigned i = 0; i < keys.size(); ++i)
+            if (layer->createImage(keys[i]).valid())
+                ++valid;
+    });
+    state.setCounter("valid", valid);
+}
+
+OE_BENCHMARK(ElevationLayer, assembleHeightField)
+{
+    osg::ref_ptr<GDALElevationLayer> layer = new GDALElevationLayer();
+    layer->setURL(state.dataFile("terrain/mt_rainier_90m.tif"));
+    if (layer->open().isError())
+    {
+        state.skip("cannot open " + layer->getURL().full());
+        return;
+    }
+
+    // mercator keys covering the summit
+    osg::ref_ptr<const Profile> mercator = Profile::create("spherical-mercator");
+    GeoPoint summit(SpatialReference::get("wgs84"), -121.76, 46.85, 0.0, ALTMODE_ABSOLUTE);
+    GeoPoint summitMerc = summit.transform(mercator->getSRS());
+    TileKey center = mercator->createTileKey(summitMerc.x(), summitMerc.y(), 11u);
+
+    const unsigned count = state.size(9u, 1u);
+    std::vector<TileKey> keys;
+    unsigned cx, cy;
+    center.getTileXY(cx, cy);
+    for (unsigned i = 0; i < count; ++i)
+        keys.push_back(TileKey(11u, cx - 1 + i % 3, cy - 1 + i / 3, mercator.get()));
+
+    unsigned valid = 0;
+    state.setItemsPerRun(count);
+    state.measure([&]()
+    {
+        valid = 0;
+        for (unsigned i = 0; i < keys.size(); ++i)
+            if (layer->createHeightField(keys[i], 0L).valid())
+                ++valid;
+    });
+    state.setCounter("valid", valid);
+}
+
+// Constrained tile meshes: cutting constraints into the grid (what
+// MeshEditor does on a cache miss) versus decoding a cached TileMesh.
+
+namespace
+{
+    // 17x17 grid (the Rex default tile size) over a 1km square with a
+    // winding "road" cut into it; markers as in Rex (1=visible,
+    // 2=boundary, 16=constraint).
+    void editTestMesh(unsigned tileSize, unsigned numSegments, TileMesh& out)
+    {
+        weemesh::mesh_t mesh;
+        mesh.set_boundary_marker(2);
+        mesh.set_constraint_marker(16);
+
+        const double span = 1000.0;
+        for (unsigned row = 0; row < tileSize; ++row)
+        {
+            for (unsigned col = 0; col < tileSize; ++col)
+            {
+                int marker = 1;
+                if (row == 0 || row == tileSize - 1 || col == 0 || col == tileSize - 1)
+                    marker |= 2;
+
+                int i = mesh.get_or_create_vertex(weemesh::vert_t(
+                    span*(double)col / (double)(tileSize - 1),
+                    span*(double)row / (double)(tileSize - 1),
+                    0.0), marker);
+
+                if (row > 0 && col > 0)
+                {
+                    mesh.add_triangle(i, i - 1, i - tileSize - 1);
+                    mesh.add_triangle(i, i - tileSize - 1, i - tileSize);
+                }
+            }
+        }
+
+        weemesh::vert_t p0(10.0, 20.0, 0.0);
+        for (unsigned s = 0; s < numSegments; ++s)
+        {
+            double t = (double)(s + 1) / (double)numSegments;
+            weemesh::vert_t p1(10.0 + 970.0*t, 500.0 + 400.0*sin(t*9.0), 0.0);
+            mesh.insert(weemesh::segment_t(p0, p1), 1 | 16);
+            p0 = p1;
+        }
+
+        out.clear();
+        for (unsigned i = 0; i < mesh._verts.size(); ++i)
+        {
+            const weemesh::vert_t& v = mesh._verts[i];
+            out.verts.push_back(osg::Vec3f(v.x(), v.y(), v.z()));
+            out.markers.push_back((std::uint8_t)mesh.get_marker((int)i));
+        }
+        for (const auto& tri : mesh._triangles)
+        {
+            out.indices.push_back(tri.second.i0);
+            out.indices.push_back(tri.second.i1);
+            out.indices.push_back(tri.second.i2);
+        }
+        out.hasConstraints = mesh._num_edits > 0;
+    }
+}
+
+OE_BENCHMARK(MeshEditor, insertConstraints)
+{
+    const unsigned segments = state.size(64u, 8u);
+    TileMesh mesh;
+
+    state.setItemsPerRun(segments);
+    state.measure([&]()
+    {
+        editTestMesh(17u, segments, mesh);
+    });
+    state.setCounter("triangles", mesh.indices.size() / 3);
+}
+
+OE_BENCHMARK(TileMesh, read)
+{
+    const unsigned segments = state.size(64u, 8u);
+    TileMesh mesh;
+    editTestMesh(17u, segments, mesh);
+
+    std::string record;
+    mesh.write(record);
+
+    TileMesh decoded;
+    bool ok = false;
+
+    state.setBytesPerRun(record.size());
+    state.measure([&]()
+    {
+        ok = decoded.read(record);
+    });
+    state.setCounter("record_bytes", record.size());
+    state.setCounter("valid", ok && decoded.indices == mesh.indices ? 1 : 0);
+}
@@ -0,0 +1,121 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include "Benchmark.h"
+#include <osgEarth/Notify>
+#include <osg/ArgumentParser>
+#include <fstream>
+#include <iostream>
+
+#define LC "[osgearth_bench] "
+
+using namespace osgEarth;
+using namespace osgEarth::Bench;
+
+int
+usage(char** argv)
+{
+    std::cout
+        << "Runs the osgEarth performance benchmarks headlessly.\n\n"
+        << argv[0]
+        << "\n    --list                   : list the available benchmarks and exit"
+        << "\n    --filter [string]        : only run benchmarks whose name contains this string (repeatable)"
+        << "\n    --out [file.json]        : write results as JSON to this file ('-' for stdout)"
+        << "\n    --data [path]            : location of the osgEarth sample data folder"
+        << "\n    --min-runs [n]           : minimum number of timed runs per benchmark (default 5)"
+        << "\n    --max-runs [n]           : maximum number of timed runs per benchmark (default 1000)"
+        << "\n    --min-time [seconds]     : minimum time to spend measuring each benchmark (default 0.5)"
+        << "\n    --quick                  : use small problem sizes (smoke test)"
+        << std::endl;
+
+    return 0;
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    if (arguments.read("--help") || arguments.read("-h"))
+        return usage(argv);
+
+    Settings settings;
+#ifdef OSGEARTH_BENCH_DATA_PATH
+    settings.dataPath = OSGEARTH_BENCH_DATA_PATH;
+#endif
+    arguments.read("--data", settings.dataPath);
+    arguments.read("--min-runs", settings.minRuns);
+    arguments.read("--max-runs", settings.maxRuns);
+    arguments.read("--min-time", settings.minSeconds);
+    settings.quick = arguments.read("--quick");
+
+    std::string outFile;
+    arguments.read("--out", outFile);
+
+    std::vector<std::string> filters;
+    std::string filter;
+    while (arguments.read("--filter", filter))
+        filters.push_back(filter);
+
+    const std::vector<Entry>& entries = registry();
+
+    if (arguments.read("--list"))
+    {
+        for (unsigned i = 0; i < entries.size(); ++i)
+            std::cout << entries[i].name << std::endl;
+        return 0;
+    }
+
+    std::vector<Result> results;
+    for (unsigned i = 0; i < entries.size(); ++i)
+    {
+        bool match = filters.empty();
+        for (unsigned f = 0; f < filters.size() && !match; ++f)
+            match = entries[i].name.find(filters[f]) != std::string::npos;
+        if (!match)
+            continue;
+
+        results.push_back(run(entries[i], settings));
+        if (outFile != "-")
+            print(results.back());
+    }
+
+    if (!outFile.empty())
+    {
+        std::string json = toJSON(results, settings);
+        if (outFile == "-")
+        {
+            std::cout << json;
+        }
+        else
+        {
+            std::ofstream out(outFile.c_str());
+            if (!out.is_open())
+            {
+                OE_WARN << LC << "Failed to open " << outFile << " for writing" << std::endl;
+                return -1;
+            }
+            out << json;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#define LC "[osgearth_compileearth] "
+
+#include <osgEarth/Notify>
+#include <osgEarth/Config>
+#include <osgEarth/XmlUtils>
+#include <osgEarth/URI>
+
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <osgDB/FileNameUtils>
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+using namespace osgEarth;
+
+// documentation
+int usage(char** argv)
+{
+    std::cout
+        << "Compiles an earth file to the binary format, which the earth plugin\n"
+        << "loads without parsing any XML. Any xi:include references are resolved\n"
+        << "and embedded. Load the result like any earth file.\n\n"
+        << argv[0] << " file.earth"
+        << "\n    --out [file.earthb]    : output file (default = input with an .earthb extension)"
+        << "\n    --verify               : read the output back and check it against the input"
+        << std::endl;
+
+    return -1;
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser args(&argc, argv);
+
+    if (argc < 2 || args.read("--help"))
+        return usage(argv);
+
+    std::string outFile;
+    args.read("--out", outFile);
+
+    bool verify = args.read("--verify");
+
+    std::string inFile;
+    for (int i = 1; i < args.argc(); ++i)
+    {
+        if (!args.isOption(i))
+        {
+            inFile = args[i];
+            break;
+        }
+    }
+
+    if (inFile.empty())
+        return usage(argv);
+
+    if (outFile.empty())
+        outFile = osgDB::getNameLessExtension(inFile) + ".earthb";
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    osg::ref_ptr<XmlDocument> doc = XmlDocument::load(URI(inFile));
+    if (!doc.valid())
+    {
+        OE_WARN << LC << "Failed to read " << inFile << std::endl;
+        return -1;
+    }
+
+    Config conf = doc->getConfig();
+    if (!conf.hasChild("map") && !conf.hasChild("earth"))
+    {
+        OE_WARN << LC << inFile << " is not an earth file" << std::endl;
+        return -1;
+    }
+
+    double xmlTime = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    std::string data = conf.toBinary();
+
+    std::ofstream out(outFile.c_str(), std::ios::out | std::ios::binary);
+    out.write(data.data(), data.size());
+    out.close();
+    if (!out.good())
+    {
+        OE_WARN << LC << "Failed to write " << outFile << std::endl;
+        return -1;
+    }
+
+    std::cout << "Wrote " << outFile << " (" << data.size() << " bytes)" << std::endl;
+
+    if (verify)
+    {
+        std::string written;
+        {
+            std::ifstream in(outFile.c_str(), std::ios::in | std::ios::binary);
+            written.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+
+        start = osg::Timer::instance()->tick();
+
+        Config check;
+        bool ok = check.fromBinary(written.data(), written.size(), inFile);
+
+        double binaryTime = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+        if (!ok || check.toJSON() != conf.toJSON())
+        {
+            OE_WARN << LC << "Verification failed" << std::endl;
+            return -1;
+        }
+
+        std::cout
+            << "Verified: XML parse took " << xmlTime << "s, binary decode took "
+            << binaryTime << "s" << std::endl;
+    }
+
+    return 0;
+}
@@ -31,12 +31,16 @@
 #include <osgEarth/MapNode>
 #include <osgEarth/OGRFeatureSource>
 #include <osgEarth/ImageUtils>
+#include <osgEarth/MBTiles>
 
 #include <osg/ArgumentParser>
 #include <osg/Timer>
 #include <osgDB/ReadFile>
+#include <osgDB/FileUtils>
 
 #include <iomanip>
+#include <sstream>
+#include <cstdio>
 #include <algorithm>
 #include <iterator>
 
@@ -59,13 +63,36 @@ int usage(char** argv)
         << "\n    --extents [minLat] [minLong] [maxLat] [maxLong] : Lat/Long extends to copy"
         << "\n    --no-overwrite                      : skip tiles that already exist in the destination"
         << "\n    --threads [int]                     : go faster by using [n] working threads"
+        << "\n    --journal [file]                    : process the tiles in parallel work units, recording finished units"
+        << "\n                                          in [file] so an interrupted run can resume"
+        << "\n    --processes [int]                   : split the work across [n] worker processes (avoids the GDAL and"
+        << "\n                                          scripting locks); MBTiles output is written to per-worker shards"
+        << "\n                                          that are merged at the end (cannot be combined with --journal)"
         << std::endl;
 
     return 0;
 }
 
+// Base for the tile copiers; holds the command that re-runs this program
+// as a worker when using --processes
+struct TileCopy : public TileHandler
+{
+    std::string getProcessString() const
+    {
+        return _processString;
+    }
+
+    std::string getSignature() const
+    {
+        return _signature;
+    }
+
+    std::string _processString;
+    std::string _signature;
+};
+
 // Visitor that converts image tiles
-struct ImageLayerTileCopy : public TileHandler
+struct ImageLayerTileCopy : public TileCopy
 {
     ImageLayerTileCopy(ImageLayer* source, ImageLayer* dest, bool overwrite, bool compress)
         : _source(source), _dest(dest), _overwrite(overwrite), _compress(compress)
@@ -117,7 +144,7 @@ struct ImageLayerTileCopy : public TileHandler
 };
 
 // Visitor that converts elevation tiles
-struct ElevationLayerTileCopy : public TileHandler
+struct ElevationLayerTileCopy : public TileCopy
 {
     ElevationLayerTileCopy(ElevationLayer* source, ElevationLayer* dest, bool overwrite)
         : _source(source), _dest(dest), _overwrite(overwrite)
@@ -255,6 +282,8 @@ struct ProgressReporter : public osgEarth::ProgressCallback
  *      --extents [minLat] [minLong] [maxLat] [maxLong] : Lat/Long extends to copy (*)
  *      --no-overwrite        : don't overwrite data that already exists
  *      --threads [int]       : number of threads to launch
+ *      --journal [file]      : resumable parallel run; finished work units go in [file]
+ *      --processes [int]     : number of worker processes to launch
  *
  * OSG arguments:
  *
@@ -266,6 +295,18 @@ struct ProgressReporter : public osgEarth::ProgressCallback
 int
 main(int argc, char** argv)
 {
+    // Command line for re-running this program as a worker process
+    // (without the coordinator-only arguments)
+    std::stringstream workerCommand;
+    for (int i = 0; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if ((arg == "--processes" || arg == "--journal" || arg == "--threads") && i+1 < argc)
+            ++i;
+        else if (arg != "--debug")
+            workerCommand << (i > 0 ? " " : "") << MultiprocessTileVisitor::quoteArgument(arg);
+    }
+
     osg::ArgumentParser args(&argc,argv);
 
     if ( argc == 1 )
@@ -371,6 +412,26 @@ main(int argc, char** argv)
     }
     outConf.key() = outConf.value("driver");
 
+    // Worker process mode (launched by a coordinator using --processes):
+    // handle the tiles in the task list, and write to a private shard
+    // if the output is a single-file database.
+    std::string taskFile, progressFile;
+    args.read("--tiles", taskFile);
+    args.read("--progress", progressFile);
+    int workerIndex = -1;
+    args.read("--worker", workerIndex);
+
+    bool isMBTiles = outConf.value("driver").find("mbtiles") != std::string::npos;
+    std::string outputFile = outConf.value("filename");
+    if (outputFile.empty())
+        outputFile = outConf.value("url");
+
+    if (isMBTiles && workerIndex >= 0)
+    {
+        outConf.remove("url");
+        outConf.set("filename", Stringify() << outputFile << ".shard" << workerIndex);
+    }
+
     // are we changing profiles?
     osg::ref_ptr<const Profile> outputProfile = input->getProfile();
     std::string profileString;
@@ -427,19 +488,64 @@ main(int argc, char** argv)
     bool debug = args.read("--debug");
 
     // Dump out some stuff...
-    OE_NOTICE << LC << "FROM:\n"
-        << inConf.toJSON(true)
-        << std::endl;
+    if (taskFile.empty())
+    {
+        OE_NOTICE << LC << "FROM:\n"
+            << inConf.toJSON(true)
+            << std::endl;
 
-    OE_NOTICE << LC << "TO:\n"
-        << outConf.toJSON(true)
-        << std::endl;
+        OE_NOTICE << LC << "TO:\n"
+            << outConf.toJSON(true)
+            << std::endl;
+    }
 
     // create the visitor.
     osg::ref_ptr<TileVisitor> visitor;
 
     unsigned numThreads = 1;
-    if (args.read("--threads", numThreads))
+    bool threadsSet = args.read("--threads", numThreads);
+
+    unsigned numProcesses = 0;
+    args.read("--processes", numProcesses);
+
+    std::string journal;
+    bool useJournal = args.read("--journal", journal);
+
+    if (numProcesses > 0 && useJournal)
+    {
+        OE_WARN << LC << "--journal cannot be combined with --processes" << std::endl;
+        return -1;
+    }
+
+    if (!taskFile.empty())
+    {
+        TaskList tasks(outputProfile.get());
+        if (!tasks.load(taskFile) || tasks.getKeys().empty())
+        {
+            OE_WARN << LC << "No tiles to process in " << taskFile << std::endl;
+            return -1;
+        }
+
+        TileKeyListVisitor* tkv = new TileKeyListVisitor();
+        tkv->setKeys(tasks.getKeys());
+        tkv->setProgressFile(progressFile);
+        visitor = tkv;
+    }
+    else if (numProcesses > 0)
+    {
+        MultiprocessTileVisitor* mpv = new MultiprocessTileVisitor();
+        mpv->setNumProcesses(numProcesses);
+        visitor = mpv;
+    }
+    else if (useJournal)
+    {
+        ParallelTileVisitor* ptv = new ParallelTileVisitor();
+        if (threadsSet)
+            ptv->setNumThreads( numThreads < 1 ? 1 : numThreads );
+        ptv->setJournal(journal);
+        visitor = ptv;
+    }
+    else if (threadsSet)
     {
         MultithreadedTileVisitor* mtv = new MultithreadedTileVisitor();
         mtv->setNumThreads( numThreads < 1 ? 1 : numThreads );
@@ -470,6 +576,13 @@ main(int argc, char** argv)
             overwrite));
     }
 
+    TileCopy* copier = dynamic_cast<TileCopy*>(visitor->getTileHandler());
+    if (copier)
+    {
+        copier->_processString = workerCommand.str();
+        copier->_signature = inConf.toJSON(false) + " -> " + outConf.toJSON(false);
+    }
+
     // set the manula extents, if specified:
     bool userSetExtents = false;
     double minlat, minlon, maxlat, maxlon;
@@ -547,6 +660,13 @@ main(int argc, char** argv)
         getchar();
     }
 
+    // Worker processes run quietly; the coordinator reports their progress.
+    if (!taskFile.empty())
+    {
+        visitor->run( outputProfile.get() );
+        return 0;
+    }
+
     // Ready!!!
     std::cout << "Working..." << std::endl;
 
@@ -556,6 +676,43 @@ main(int argc, char** argv)
 
     visitor->run( outputProfile.get() );
 
+    // If any worker failed, leave the shards and task lists for a retry
+    // rather than publish a partial result.
+    MultiprocessTileVisitor* mpv = dynamic_cast<MultiprocessTileVisitor*>(visitor.get());
+    if (mpv && !mpv->succeeded())
+    {
+        std::cout << std::endl << "Failed. Unfinished task lists:" << std::endl;
+        for (unsigned i = 0; i < mpv->getFailedTaskFiles().size(); ++i)
+            std::cout << "    " << mpv->getFailedTaskFiles()[i] << std::endl;
+        if (isMBTiles)
+            std::cout << "Worker shards were left next to " << outputFile << std::endl;
+        return -1;
+    }
+
+    // Merge the worker shards into the final output.
+    if (numProcesses > 0 && isMBTiles)
+    {
+        std::cout << std::endl << "Merging shards..." << std::endl;
+
+        for (unsigned i = 0; i < numProcesses; ++i)
+        {
+            std::string shard = Stringify() << outputFile << ".shard" << i;
+            if (!osgDB::fileExists(shard))
+                continue;
+
+            Status status;
+            if (dynamic_cast<MBTilesImageLayer*>(output.get()))
+                status = static_cast<MBTilesImageLayer*>(output.get())->merge(shard);
+            else if (dynamic_cast<MBTilesElevationLayer*>(output.get()))
+                status = static_cast<MBTilesElevationLayer*>(output.get())->merge(shard);
+
+            if (status.isOK())
+                ::remove(shard.c_str());
+            else
+                OE_WARN << LC << status.message() << "; leaving " << shard << " in place" << std::endl;
+        }
+    }
+
     osg::Timer_t t1 = osg::Timer::instance()->tick();
 
     std::cout
@@ -47,6 +47,7 @@ usage(const char* name, const std::string& error)
         << "\n  --extents swlong swlat nelong nelat  ; extents in degrees"
         << "\n  --out out.shp                        ; output features"
         << "\n  --include-billboard-property <name>  ; include billboard property name as attribute (optional)"
+        << "\n  --threads n                          ; number of tiles to generate in parallel (optional)"
         << std::endl;
 
     return -1;
@@ -60,9 +61,6 @@ struct App
     GroundCoverFeatureGenerator featureGen;
     osg::ref_ptr<OGRFeatureSource> outfs;
 
-    Threading::Mutexed<std::queue<FeatureList*> > outputQueue;
-    Threading::Event gate;
-
     App() { }
 
     int open(int argc, char** argv)
@@ -96,6 +94,10 @@ struct App
         featureGen.setLayer(gclayer);
         featureGen.setFactory(new TerrainTileModelFactory(mapNode->options().terrain().get()));
 
+        unsigned threads = 0u;
+        if (arguments.read("--threads", threads))
+            featureGen.setConcurrency(threads);
+
         if (featureGen.getStatus().isError())
             return usage(argv[0], featureGen.getStatus().message());
 
@@ -121,33 +123,6 @@ struct App
 
         return 0; 
     }
-
-    void exportKey(const TileKey& key)
-    {
-        // even if the output if empty, we still must push a FeatureList
-        // to the output queue b/c it's expecting an exact number of keys.
-        FeatureList* output = new FeatureList();
-        featureGen.getFeatures(key, *output);
-
-        outputQueue.lock();
-        outputQueue.push(output);
-        gate.set();
-        outputQueue.unlock();
-    }
-};
-
-struct ExportOperation : public osg::Operation
-{
-    App& _app;
-    TileKey _key;
-
-    ExportOperation(App& app, const TileKey& key) : 
-        osg::Operation("build", false), _app(app), _key(key) { }
-
-    void operator()(osg::Object*) override
-    {
-        _app.exportKey(_key);
-    }
 };
 
 int
@@ -166,54 +141,36 @@ main(int argc, char** argv)
     if (keys.empty())
         return usage(argv[0], "No data in extent");
 
-    JobArena arena("GroundCover Export", 4u);
-
     std::cout << "Exporting " << keys.size() << " keys.." << std::endl;
 
-    for(const auto& key : keys)
-    {
-        Job().dispatch(
-            [&app, key](Cancelable*)
-            {
-                app.exportKey(key);
-            }
-        );
-    }
-
     unsigned totalFeatures = 0u;
-    std::vector<TimeSpan> writeTimes;
-
-    for(unsigned i=0; i<keys.size(); )
-    {
-        app.gate.waitAndReset();
-
-        std::vector<FeatureList*> outputs;
-
-        app.outputQueue.lock();
-        while(!app.outputQueue.empty())
-        {
-            outputs.push_back(app.outputQueue.front());
-            app.outputQueue.pop();
-        }
-        app.outputQueue.unlock();
-
-        for(unsigned j=0; j<outputs.size(); ++j)
+    unsigned count = 0u;
+    TimeSpan totalWriteTime = 0;
+
+    // The generator builds tiles in parallel and hands them over in order,
+    // so features go straight to the output without piling up in memory.
+    Status status = app.featureGen.getFeatures(
+        app.extent,
+        [&](const TileKey& key, FeatureList& features)
         {
             osg::Timer_t startWrite = osg::Timer::instance()->tick();
 
-            FeatureList* output = outputs[j];
-            for(FeatureList::iterator k = output->begin(); k != output->end(); ++k)
+            for(FeatureList::iterator k = features.begin(); k != features.end(); ++k)
             {
                 app.outfs->insertFeature(k->get());
                 ++totalFeatures;
             }
 
-            delete output;
-            std::cout << "\r" << (++i) << "/" << keys.size() << std::flush;
+            std::cout << "\r" << (++count) << "/" << keys.size() << std::flush;
 
             osg::Timer_t endWrite = osg::Timer::instance()->tick();
-            writeTimes.push_back(osg::Timer::instance()->delta_s(startWrite, endWrite));
-        }
+            totalWriteTime += osg::Timer::instance()->delta_s(startWrite, endWrite);
+            return true;
+        });
+
+    if (status.isError())
+    {
+        OE_WARN << LC << status.message() << std::endl;
     }
 
     std::cout << "\nBuilding index.." << std::flush;
@@ -224,10 +181,6 @@ main(int argc, char** argv)
     osg::Timer_t end = osg::Timer::instance()->tick();
     double totalTime = osg::Timer::instance()->delta_s(start, end);
 
-    TimeSpan avgWriteTime=0, totalWriteTime=0;
-    for(int i=0; i<writeTimes.size(); ++i) totalWriteTime += writeTimes[i];
-    avgWriteTime /= writeTimes.size();
-
     std::cout 
         << "\rDone"
         << "; keys=" << keys.size()
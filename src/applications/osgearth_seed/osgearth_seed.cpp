@@ -90,7 +90,8 @@ int usage( const std::string& msg )
         << "        [--index shapefile]             ; Use the feature extents in a shapefile to set the bounding boxes for seeding" << std::endl
         << "        [--mp]                          ; Use multiprocessing to process the tiles.  Useful for GDAL sources as this avoids the global GDAL lock" << std::endl
         << "        [--mt]                          ; Use multithreading to process the tiles." << std::endl
-        << "        [--concurrency]                 ; The number of threads or processes to use if --mp or --mt are provided." << std::endl
+        << "        [--journal file]                ; Seed in parallel work units, recording finished units in a journal so an interrupted seed can resume (not with --mp or --mt)" << std::endl
+        << "        [--concurrency]                 ; The number of threads or processes to use if --mp, --mt or --journal are provided." << std::endl
         << "        [--verbose]                     ; Displays progress of the seed operation" << std::endl
         << std::endl
         << "    --purge file.earth                  ; Purges a layer cache in a .earth file (interactive)" << std::endl
@@ -138,6 +139,12 @@ int seed( osg::ArgumentParser& args )
     std::string tileList;
     while (args.read( "--tiles", tileList ) );
 
+    // set when running as a worker of a MultiprocessTileVisitor
+    std::string progressFile;
+    args.read("--progress", progressFile);
+    int workerIndex = -1;
+    args.read("--worker", workerIndex);
+
     bool verbose = args.read("--verbose");
 
     unsigned int batchSize = 0;
@@ -229,15 +236,35 @@ int seed( osg::ArgumentParser& args )
 
         TileKeyListVisitor* v = new TileKeyListVisitor();
         v->setKeys( tasks.getKeys() );
+        v->setProgressFile( progressFile );
         visitor = v;        
         OE_DEBUG << "Read task list with " << tasks.getKeys().size() << " tasks" << std::endl;
     }
   
 
+    std::string journal;
+    args.read("--journal", journal);
+    bool useMT = args.read("--mt");
+    bool useMP = args.read("--mp");
+
+    if (!journal.empty() && (useMT || useMP))
+        return usage("--journal cannot be combined with --mp or --mt");
+
     // If we dont' have a visitor create one.
     if (!visitor.valid())
     {
-        if (args.read("--mt"))
+        if (!journal.empty())
+        {
+            // Create a resumable parallel visitor
+            ParallelTileVisitor* v = new ParallelTileVisitor();
+            if (concurrency > 0)
+            {
+                v->setNumThreads(concurrency);
+            }
+            v->setJournal(journal);
+            visitor = v;
+        }
+        else if (useMT)
         {
             // Create a multithreaded visitor
             MultithreadedTileVisitor* v = new MultithreadedTileVisitor();
@@ -247,7 +274,7 @@ int seed( osg::ArgumentParser& args )
             }
             visitor = v;            
         }
-        else if (args.read("--mp"))
+        else if (useMP)
         {
             // Create a multiprocess visitor
             MultiprocessTileVisitor* v = new MultiprocessTileVisitor();
@@ -362,6 +389,14 @@ int seed( osg::ArgumentParser& args )
         {            
             osg::ref_ptr< TileLayer > layer = terrainLayers[i].get();
             OE_NOTICE << "Seeding layer" << layer->getName() << std::endl;            
+
+            // each layer needs its own journal since the work units are per-layer
+            ParallelTileVisitor* ptv = dynamic_cast<ParallelTileVisitor*>(visitor.get());
+            if (ptv)
+            {
+                ptv->setJournal(Stringify() << journal << "." << i);
+            }
+
             osg::Timer_t start = osg::Timer::instance()->tick();
             seeder.run(layer.get(), map);            
             osg::Timer_t end = osg::Timer::instance()->tick();
@@ -266,6 +266,17 @@ CacheBin::writeNode(const std::string&    key,
     return true;
 }
 
+void
+CacheBin::getRecordStatuses(const std::vector<std::string>& keys,
+                            std::vector<RecordStatus>&      output)
+{
+    output.resize(keys.size());
+    for (unsigned i = 0; i < keys.size(); ++i)
+    {
+        output[i] = getRecordStatus(keys[i]);
+    }
+}
+
 
 #undef  LC
 #define LC "[ReadImageFromCachePseudoLoader] "
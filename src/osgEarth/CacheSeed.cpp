@@ -73,6 +73,19 @@ bool CacheTileHandler::hasData( const TileKey& key ) const
     return _layer->mayHaveData(key);
 }
 
+void CacheTileHandler::getCompleted( const std::vector<TileKey>& keys, std::vector<bool>& output ) const
+{
+    // A tile that's already in the cache doesn't need seeding again
+    std::vector<CacheBin::RecordStatus> status;
+    _layer->getCacheRecordStatus( keys, status );
+
+    output.resize( keys.size() );
+    for (unsigned i = 0; i < keys.size(); ++i)
+    {
+        output[i] = (status[i] == CacheBin::STATUS_OK);
+    }
+}
+
 std::string CacheTileHandler::getProcessString() const
 {
     std::stringstream buf;
@@ -95,6 +108,13 @@ std::string CacheTileHandler::getProcessString() const
     return buf.str();
 }
 
+std::string CacheTileHandler::getSignature() const
+{
+    std::stringstream buf;
+    buf << _layer->getName() << " (" << _layer->getCacheID() << ")";
+    return buf.str();
+}
+
 
 
 /***************************************************************************************/
@@ -24,6 +24,9 @@
 #include <osgEarth/JsonUtils>
 #include <osgEarth/FileUtils>
 #include <osgDB/FileNameUtils>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
 
 using namespace osgEarth;
 
@@ -436,6 +439,234 @@ Config::readJSON(const std::string& json)
     return conf;
 }
 
+namespace
+{
+    // Binary layout, all integers little-endian u32:
+    //   header:  magic, version, string count, node count
+    //   offsets: string count + 1 offsets into the string data
+    //   nodes:   key, value, referrer, external ref (string indices),
+    //            first child, child count, flags
+    //   string data
+    const char BINARY_MAGIC[4] = { 'O', 'E', 'C', 'B' };
+    const unsigned BINARY_VERSION = 1u;
+    const std::size_t BINARY_HEADER_SIZE = 16u;
+    const unsigned BINARY_NODE_FIELDS = 7u;
+
+    enum
+    {
+        FLAG_LOCATION = 1u << 0,
+        FLAG_NUMBER   = 1u << 1
+    };
+
+    void writeU32(std::string& out, unsigned value)
+    {
+        for (int i = 0; i < 4; ++i)
+            out.push_back((char)((value >> (8 * i)) & 0xff));
+    }
+
+    unsigned readU32(const char* in)
+    {
+        unsigned value = 0u;
+        for (int i = 0; i < 4; ++i)
+            value |= (unsigned)(unsigned char)in[i] << (8 * i);
+        return value;
+    }
+
+    // Assigns each distinct string an index; index 0 is the empty string
+    struct StringTable
+    {
+        StringTable() { intern(std::string()); }
+
+        unsigned intern(const std::string& value)
+        {
+            auto i = _index.emplace(value, (unsigned)_strings.size());
+            if (i.second)
+                _strings.push_back(&i.first->first);
+            return i.first->second;
+        }
+
+        std::unordered_map<std::string, unsigned> _index;
+        std::vector<const std::string*> _strings;
+    };
+}
+
+std::string
+Config::toBinary() const
+{
+    StringTable strings;
+
+    // Flatten breadth first, so each node's children are contiguous
+    // and always come after it.
+    std::vector<const Config*> nodes;
+    std::vector<unsigned> parents;
+    std::vector<unsigned> records;
+    nodes.push_back(this);
+    parents.push_back(0u);
+
+    for (unsigned i = 0; i < nodes.size(); ++i)
+    {
+        const Config* node = nodes[i];
+
+        bool inherited = (i == 0u) || node->_referrer == nodes[parents[i]]->_referrer;
+
+        records.push_back(strings.intern(node->_key));
+        records.push_back(strings.intern(node->_defaultValue));
+        records.push_back(inherited ? 0u : strings.intern(node->_referrer));
+        records.push_back(strings.intern(node->_externalRef));
+        records.push_back((unsigned)nodes.size());
+        records.push_back((unsigned)node->_children.size());
+        records.push_back(
+            (node->_isLocation ? FLAG_LOCATION : 0u) |
+            (node->_isNumber ? FLAG_NUMBER : 0u));
+
+        for (ConfigSet::const_iterator c = node->_children.begin(); c != node->_children.end(); ++c)
+        {
+            nodes.push_back(&(*c));
+            parents.push_back(i);
+        }
+    }
+
+    std::string out;
+    out.append(BINARY_MAGIC, 4);
+    writeU32(out, BINARY_VERSION);
+    writeU32(out, (unsigned)strings._strings.size());
+    writeU32(out, (unsigned)nodes.size());
+
+    unsigned offset = 0u;
+    for (auto str : strings._strings)
+    {
+        writeU32(out, offset);
+        offset += (unsigned)str->size();
+    }
+    writeU32(out, offset);
+
+    for (auto value : records)
+        writeU32(out, value);
+
+    for (auto str : strings._strings)
+        out.append(*str);
+
+    return out;
+}
+
+bool
+Config::isBinary(const char* data, std::size_t size)
+{
+    return data && size >= BINARY_HEADER_SIZE && ::memcmp(data, BINARY_MAGIC, 4) == 0;
+}
+
+bool
+Config::fromBinary(const char* data, std::size_t size, const std::string& referrer)
+{
+    if (!isBinary(data, size))
+        return false;
+
+    if (readU32(data + 4) != BINARY_VERSION)
+    {
+        OE_WARN << LC << "Unsupported binary config version " << readU32(data + 4) << std::endl;
+        return false;
+    }
+
+    const std::size_t numStrings = readU32(data + 8);
+    const std::size_t numNodes = readU32(data + 12);
+    const std::size_t offsetsPos = BINARY_HEADER_SIZE;
+    const std::size_t nodesPos = offsetsPos + 4u * (numStrings + 1u);
+    const std::size_t stringsPos = nodesPos + 4u * BINARY_NODE_FIELDS * numNodes;
+
+    if (numStrings == 0u || numNodes == 0u || stringsPos > size)
+    {
+        OE_WARN << LC << "Corrupt binary config" << std::endl;
+        return false;
+    }
+
+    // Decode each interned string once.
+    std::vector<std::string> strings(numStrings);
+    unsigned prev = readU32(data + offsetsPos);
+    for (std::size_t i = 0; i < numStrings; ++i)
+    {
+        unsigned next = readU32(data + offsetsPos + 4u * (i + 1u));
+        if (next < prev || stringsPos + next > size)
+        {
+            OE_WARN << LC << "Corrupt binary config" << std::endl;
+            return false;
+        }
+        strings[i].assign(data + stringsPos + prev, next - prev);
+        prev = next;
+    }
+
+    // Validate the node table before touching this object. Require the
+    // exact breadth-first layout toBinary writes: each node's children
+    // start where the previous node's ended, and every node but the root
+    // is the child of exactly one earlier node. That rules out cycles and
+    // shared subtrees.
+    std::size_t cursor = 1u;
+    for (std::size_t i = 0; i < numNodes; ++i)
+    {
+        const char* rec = data + nodesPos + 4u * BINARY_NODE_FIELDS * i;
+        std::size_t firstChild = readU32(rec + 16);
+        std::size_t numChildren = readU32(rec + 20);
+        if (readU32(rec) >= numStrings ||
+            readU32(rec + 4) >= numStrings ||
+            readU32(rec + 8) >= numStrings ||
+            readU32(rec + 12) >= numStrings ||
+            cursor <= i ||
+            firstChild != cursor ||
+            numChildren > numNodes - cursor)
+        {
+            OE_WARN << LC << "Corrupt binary config" << std::endl;
+            return false;
+        }
+        cursor += numChildren;
+    }
+
+    if (cursor != numNodes)
+    {
+        OE_WARN << LC << "Corrupt binary config" << std::endl;
+        return false;
+    }
+
+    std::string rootReferrer = referrer;
+    if (!rootReferrer.empty() && !osgDB::containsServerAddress(rootReferrer) && !osgDB::isAbsolutePath(rootReferrer))
+        rootReferrer = osgEarth::getAbsolutePath(rootReferrer);
+
+    _children.clear();
+    _refMap.clear();
+
+    // Build breadth first. Every node's parent comes before it, so its
+    // Config already exists (and ConfigSet is a list, so it stays put).
+    std::vector<Config*> targets(numNodes, (Config*)0L);
+    targets[0] = this;
+    _referrer = rootReferrer;
+
+    for (std::size_t i = 0; i < numNodes; ++i)
+    {
+        const char* rec = data + nodesPos + 4u * BINARY_NODE_FIELDS * i;
+        const std::string& ref = strings[readU32(rec + 8)];
+        unsigned flags = readU32(rec + 24);
+        Config& conf = *targets[i];
+
+        conf._key = strings[readU32(rec)];
+        conf._defaultValue = strings[readU32(rec + 4)];
+        if (!ref.empty())
+            conf._referrer = ref;
+        conf._externalRef = strings[readU32(rec + 12)];
+        conf._isLocation = (flags & FLAG_LOCATION) != 0u;
+        conf._isNumber = (flags & FLAG_NUMBER) != 0u;
+
+        // children inherit the referrer unless they have their own
+        std::size_t firstChild = readU32(rec + 16);
+        std::size_t numChildren = readU32(rec + 20);
+        for (std::size_t c = firstChild; c < firstChild + numChildren; ++c)
+        {
+            conf._children.push_back(Config());
+            targets[c] = &conf._children.back();
+            targets[c]->_referrer = conf._referrer;
+        }
+    }
+
+    return true;
+}
+
 Config
 Config::operator - ( const Config& rhs ) const
 {
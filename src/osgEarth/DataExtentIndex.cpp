@@ -0,0 +1,312 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/DataExtentIndex>
+#include <osgEarth/rtree.h>
+#include <limits>
+
+using namespace osgEarth;
+
+#define LC "[DataExtentIndex] "
+
+namespace
+{
+    // x, y, level
+    typedef RTree<unsigned, double, 3> ExtentTree;
+
+    // level range of an extent with no maximum level
+    const double UNBOUNDED = (double)std::numeric_limits<unsigned>::max();
+
+    // grows query boxes so that rounding in the SRS transforms
+    // cannot drop a candidate; the exact test runs afterwards anyway
+    const double PADDING = 1e-7;
+
+    // Running answer, following the rules of the linear scan
+    // in TileLayer::getBestAvailableTileKey
+    struct Answer
+    {
+        Answer() : good(false), intersects(false), highestLOD(0u) { }
+
+        bool good;
+        bool intersects;
+        unsigned highestLOD;
+
+        void consider(const DataExtent& de, unsigned localLOD)
+        {
+            if (!de.minLevel().isSet() || localLOD >= de.minLevel().get())
+            {
+                intersects = true;
+
+                if (!de.maxLevel().isSet() || localLOD <= de.maxLevel().get())
+                    good = true;
+                else if (de.maxLevel().get() > highestLOD)
+                    highestLOD = de.maxLevel().get();
+            }
+        }
+
+        int result(unsigned localLOD) const
+        {
+            return good ? (int)localLOD : intersects ? (int)highestLOD : -1;
+        }
+    };
+
+    // Splits a geographic extent into one or two boxes that do not
+    // cross the antimeridian
+    unsigned toBoxes(const GeoExtent& extent, double box[2][4])
+    {
+        // wraps all the way around, wherever it starts
+        if (extent.width() >= 360.0)
+        {
+            box[0][0] = -180.0, box[0][1] = extent.south();
+            box[0][2] = 180.0, box[0][3] = extent.north();
+            return 1u;
+        }
+
+        GeoExtent parts[2];
+        unsigned count = 0u;
+
+        if (extent.crossesAntimeridian() && extent.splitAcrossAntimeridian(parts[0], parts[1]))
+            count = 2u;
+        else
+            parts[0] = extent, count = 1u;
+
+        for (unsigned i = 0; i < count; ++i)
+            parts[i].getBounds(box[i][0], box[i][1], box[i][2], box[i][3]);
+
+        return count;
+    }
+}
+
+DataExtentIndex::DataExtentIndex(const DataExtentList& extents) :
+    _extents(extents),
+    _tree(nullptr),
+    _minLevel(std::numeric_limits<unsigned>::max()),
+    _maxLevel(0u)
+{
+    for (auto& de : _extents)
+    {
+        if (de.isValid())
+        {
+            _geoSRS = de.getSRS()->getGeographicSRS();
+            break;
+        }
+    }
+
+    if (!_geoSRS.valid())
+        return;
+
+    ExtentTree* tree = new ExtentTree();
+    _tree = tree;
+
+    _geoExtents.resize(_extents.size());
+
+    double a_min[3], a_max[3], box[2][4];
+
+    for (unsigned i = 0; i < _extents.size(); ++i)
+    {
+        const DataExtent& de = _extents[i];
+
+        // never intersects anything
+        if (de.isInvalid())
+            continue;
+
+        _geoExtents[i] = de.transform(_geoSRS.get());
+
+        // Extents we cannot place in the tree, or whose level range is
+        // inside out, get tested on every query instead.
+        if (_geoExtents[i].isInvalid() ||
+            (de.minLevel().isSet() && de.maxLevel().isSet() && de.minLevel().get() > de.maxLevel().get()))
+        {
+            _unindexed.push_back(i);
+            continue;
+        }
+
+        unsigned minLevel = de.minLevel().isSet() ? de.minLevel().get() : 0u;
+        _minLevel = osg::minimum(_minLevel, minLevel);
+
+        if (de.maxLevel().isSet())
+            _maxLevel = osg::maximum(_maxLevel, de.maxLevel().get());
+
+        a_min[2] = (double)minLevel;
+        a_max[2] = de.maxLevel().isSet() ? (double)de.maxLevel().get() : UNBOUNDED;
+
+        unsigned count = toBoxes(_geoExtents[i], box);
+        for (unsigned b = 0; b < count; ++b)
+        {
+            a_min[0] = box[b][0], a_min[1] = box[b][1];
+            a_max[0] = box[b][2], a_max[1] = box[b][3];
+            tree->Insert(a_min, a_max, i);
+        }
+    }
+
+    OE_DEBUG << LC << "Indexed " << _extents.size() << " extents ("
+        << _unindexed.size() << " unindexed)" << std::endl;
+}
+
+DataExtentIndex::~DataExtentIndex()
+{
+    if (_tree)
+        delete static_cast<ExtentTree*>(_tree);
+}
+
+void
+DataExtentIndex::setCacheSize(unsigned value)
+{
+    if (value > 0u)
+        _cache.reset(new LRUCache<TileKey, int>(true, value));
+    else
+        _cache.reset();
+}
+
+int
+DataExtentIndex::getBestAvailableLevel(const TileKey& key, unsigned localLOD) const
+{
+    if (!key.valid())
+        return -1;
+
+    if (_cache)
+    {
+        LRUCache<TileKey, int>::Record record;
+        if (_cache->get(key, record))
+            return record.value();
+    }
+
+    int result = search(key, localLOD);
+
+    if (_cache)
+        _cache->insert(key, result);
+
+    return result;
+}
+
+int
+DataExtentIndex::search(const TileKey& key, unsigned localLOD) const
+{
+    const GeoExtent& keyExtent = key.getExtent();
+    GeoExtent keyGeo = _tree ? keyExtent.transform(_geoSRS.get()) : GeoExtent::INVALID;
+
+    // Cannot use the tree; fall back on testing every extent.
+    if (keyGeo.isInvalid())
+        return scan(key, localLOD);
+
+    // GeoExtent::intersects compares extents in different SRS's by
+    // converting both to geographic. When the key's geographic SRS is the
+    // one we indexed in, the extents are already converted.
+    const SpatialReference* keySRS = keyExtent.getSRS();
+    bool useGeoExtents = keySRS->getGeographicSRS()->isHorizEquivalentTo(_geoSRS.get());
+
+    const SpatialReference* lastSRS = nullptr;
+    bool lastSRSMatches = false;
+
+    // same test the linear scan does, with the SRS comparison memoized
+    auto intersects = [&](unsigned i) -> bool
+    {
+        const DataExtent& de = _extents[i];
+        if (de.getSRS() != lastSRS)
+        {
+            lastSRS = de.getSRS();
+            lastSRSMatches = keySRS->isHorizEquivalentTo(lastSRS);
+        }
+
+        if (lastSRSMatches)
+            return keyExtent.intersects(de, false);
+        else if (useGeoExtents)
+            return keyGeo.intersects(_geoExtents[i], false);
+        else
+            return keyExtent.intersects(de);
+    };
+
+    Answer answer;
+
+    for (auto i : _unindexed)
+    {
+        if (intersects(i))
+            answer.consider(_extents[i], localLOD);
+    }
+
+    if (answer.good)
+        return localLOD;
+
+    const ExtentTree* tree = static_cast<const ExtentTree*>(_tree);
+
+    double box[2][4];
+    unsigned count = toBoxes(keyGeo, box);
+
+    // Does any extent intersect the key at exactly level "lod"?
+    auto stab = [&](unsigned lod) -> bool
+    {
+        double a_min[3], a_max[3];
+        bool hit = false;
+
+        for (unsigned b = 0; b < count && !hit; ++b)
+        {
+            a_min[0] = box[b][0] - PADDING, a_min[1] = box[b][1] - PADDING, a_min[2] = (double)lod;
+            a_max[0] = box[b][2] + PADDING, a_max[1] = box[b][3] + PADDING, a_max[2] = (double)lod;
+
+            tree->Search(a_min, a_max, [&](const unsigned& i) -> bool
+            {
+                hit = intersects(i);
+                return !hit;
+            });
+        }
+        return hit;
+    };
+
+    // An extent spanning the key's own level means the key is good.
+    if (stab(localLOD))
+        return localLOD;
+
+    // Otherwise every intersecting extent tops out below the key, and the
+    // highest of those maximums is the first level (going down) at which
+    // something intersects.
+    if (localLOD > 0u && _minLevel <= _maxLevel)
+    {
+        for (int lod = (int)osg::minimum(localLOD - 1u, _maxLevel); lod >= (int)_minLevel; --lod)
+        {
+            if ((unsigned)lod <= answer.highestLOD && answer.intersects)
+                break;
+
+            if (stab((unsigned)lod))
+            {
+                answer.intersects = true;
+                answer.highestLOD = osg::maximum(answer.highestLOD, (unsigned)lod);
+                break;
+            }
+        }
+    }
+
+    return answer.result(localLOD);
+}
+
+int
+DataExtentIndex::scan(const TileKey& key, unsigned localLOD) const
+{
+    Answer answer;
+
+    for (auto& de : _extents)
+    {
+        if (key.getExtent().intersects(de))
+        {
+            answer.consider(de, localLOD);
+            if (answer.good)
+                break;
+        }
+    }
+
+    return answer.result(localLOD);
+}
@@ -21,6 +21,10 @@
 #include <osgEarth/Map>
 #include <osgEarth/Progress>
 #include <osgEarth/Metrics>
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
 
 using namespace osgEarth;
 
@@ -74,28 +78,57 @@ osgEarth::createEmptyNormalMapTexture()
 ElevationTexture::ElevationTexture(const TileKey& key, const GeoHeightField& in_hf, float* resolutions) :
     _tilekey(key),
     _extent(in_hf.getExtent()),
-    _resolutions(resolutions)
+    _resolutions(resolutions),
+    _uniformResolution(0.0f),
+    _extrema(FLT_MAX, -FLT_MAX),
+    _revision(0u)
 {
     if (in_hf.valid())
     {
         _heightField = in_hf.getHeightField();
 
-        osg::Vec4 value;
+        // Most tiles come from a single source at a single resolution;
+        // keep one value instead of one per sample when we can.
+        if (_resolutions)
+        {
+            unsigned count = _heightField->getNumColumns() * _heightField->getNumRows();
+            if (std::count(_resolutions, _resolutions + count, _resolutions[0]) == (std::ptrdiff_t)count)
+            {
+                _uniformResolution = _resolutions[0];
+                delete [] _resolutions;
+                _resolutions = 0L;
+            }
+        }
 
         osg::Image* heights = new osg::Image();
         heights->allocateImage(_heightField->getNumColumns(), _heightField->getNumRows(), 1, GL_RED, GL_FLOAT);
         heights->setInternalTextureFormat(GL_R32F);
 
-        ImageUtils::PixelWriter write(heights);
-        // TODO: speed this up since we know the format
+        // Copy the rows straight across, collecting the extrema and the
+        // content revision on the way through.
+        const unsigned cols = _heightField->getNumColumns();
+        const float* src = &_heightField->getFloatArray()->front();
+        std::uint64_t revision = 0xcbf29ce484222325ULL;
         for(unsigned row=0; row<_heightField->getNumRows(); ++row)
         {
-            for(unsigned col=0; col<_heightField->getNumColumns(); ++col)
+            float* dst = reinterpret_cast<float*>(heights->data(0, row));
+            for(unsigned col=0; col<cols; ++col)
             {
-                value.r() = _heightField->getHeight(col, row);
-                write(value, col, row);
+                float h = src[row*cols + col];
+                dst[col] = h;
+
+                if (h != NO_DATA_VALUE)
+                {
+                    _extrema.x() = osg::minimum(_extrema.x(), h);
+                    _extrema.y() = osg::maximum(_extrema.y(), h);
+                }
+
+                std::uint32_t bits;
+                ::memcpy(&bits, &h, sizeof(bits));
+                revision = (revision ^ bits) * 0x100000001b3ULL;
             }
         }
+        _revision = (std::size_t)(revision ^ (revision >> 32));
         setImage(heights);
 
         setDataVariance(osg::Object::STATIC);
@@ -125,6 +158,92 @@ ElevationTexture::~ElevationTexture()
         delete [] _resolutions;
 }
 
+//...................................................................
+
+CompactElevation*
+CompactElevation::create(const ElevationTexture* texture, float tolerance)
+{
+    const osg::HeightField* hf = texture ? texture->getHeightField() : 0L;
+    if (!hf || hf->getNumColumns() == 0 || hf->getNumRows() == 0)
+        return 0L;
+
+    const osg::HeightField::HeightList& heights = hf->getHeightList();
+
+    float minHeight = FLT_MAX, maxHeight = -FLT_MAX;
+    for (unsigned i = 0; i < heights.size(); ++i)
+    {
+        if (heights[i] != NO_DATA_VALUE)
+        {
+            minHeight = osg::minimum(minHeight, heights[i]);
+            maxHeight = osg::maximum(maxHeight, heights[i]);
+        }
+    }
+    if (minHeight > maxHeight)
+        minHeight = maxHeight = 0.0f; // all NO_DATA
+
+    osg::ref_ptr<CompactElevation> c = new CompactElevation();
+    c->_tilekey = texture->getTileKey();
+    c->_extent = texture->getExtent();
+    c->_cols = hf->getNumColumns();
+    c->_rows = hf->getNumRows();
+    c->_offset = minHeight;
+    c->_scale = (maxHeight - minHeight) / (float)(NO_DATA_CODE - 1);
+    c->_maxError = 0.0f;
+
+    // Measure the actual error (not just half a step) so float rounding
+    // can never push a sample past the tolerance.
+    c->_heights.resize(heights.size());
+    for (unsigned i = 0; i < heights.size(); ++i)
+    {
+        if (heights[i] == NO_DATA_VALUE)
+        {
+            c->_heights[i] = NO_DATA_CODE;
+        }
+        else
+        {
+            float q = c->_scale > 0.0f ? (heights[i] - minHeight) / c->_scale : 0.0f;
+            c->_heights[i] = (GLushort)osg::clampBetween((int)(q + 0.5f), 0, NO_DATA_CODE - 1);
+            float error = fabs(c->getHeight(i % c->_cols, i / c->_cols) - heights[i]);
+            if (error > tolerance)
+                return 0L;
+            c->_maxError = osg::maximum(c->_maxError, error);
+        }
+    }
+
+    if (texture->getResolutions())
+        c->_resolutions.assign(texture->getResolutions(), texture->getResolutions() + heights.size());
+    else
+        c->_resolutions.assign(1, texture->getResolution(0, 0));
+
+    return c.release();
+}
+
+ElevationTexture*
+CompactElevation::createTexture() const
+{
+    osg::ref_ptr<osg::HeightField> hf = new osg::HeightField();
+    hf->allocate(_cols, _rows);
+    for (unsigned row = 0; row < _rows; ++row)
+        for (unsigned col = 0; col < _cols; ++col)
+            hf->setHeight(col, row, getHeight(col, row));
+
+    float* resolutions = new float[_cols*_rows];
+    if (_resolutions.size() == 1)
+        std::fill(resolutions, resolutions + _cols*_rows, _resolutions[0]);
+    else
+        std::copy(_resolutions.begin(), _resolutions.end(), resolutions);
+
+    return new ElevationTexture(_tilekey, GeoHeightField(hf.get(), _extent), resolutions);
+}
+
+std::size_t
+CompactElevation::getSizeInBytes() const
+{
+    return sizeof(*this) +
+        _heights.size() * sizeof(GLushort) +
+        _resolutions.size() * sizeof(float);
+}
+
 ElevationSample
 ElevationTexture::getElevation(double x, double y) const
 {
@@ -149,6 +268,35 @@ ElevationTexture::getNormalMapTexture() const
     return _normalTex.get();
 }
 
+namespace
+{
+    osg::Texture2D* makeNormalMapTexture(osg::Image* image);
+
+    // one thread at a time may create the normal map for a given texture
+    Gate<void*>& normalMapGate()
+    {
+        static Gate<void*> s_gate("OE.ElevTexNormalMap");
+        return s_gate;
+    }
+}
+
+void
+ElevationTexture::setNormalMap(osg::Image* image)
+{
+    if (!_normalTex.valid() && image)
+    {
+        ScopedGate<void*> lockThis(normalMapGate(), this);
+
+        if (!_normalTex.valid())
+        {
+            _normalTex = makeNormalMapTexture(image);
+
+            // these are pooled, so do not expire them.
+            _normalTex->setUnRefImageDataAfterApply(false);
+        }
+    }
+}
+
 void
 ElevationTexture::generateNormalMap(
     const Map* map,
@@ -158,8 +306,7 @@ ElevationTexture::generateNormalMap(
     if (!_normalTex.valid())
     {
         // one thread allowed to generate the normal map
-        static Gate<void*> s_thisGate("OE.ElevTexNormalMap");
-        ScopedGate<void*> lockThis(s_thisGate, this);
+        ScopedGate<void*> lockThis(normalMapGate(), this);
 
         if (!_normalTex.valid())
         {
@@ -184,6 +331,50 @@ ElevationTexture::generateNormalMap(
 #undef LC
 #define LC "[NormalMapGenerator] "
 
+namespace
+{
+    osg::Texture2D* makeNormalMapTexture(osg::Image* image)
+    {
+        osg::Texture2D* normalTex = new osg::Texture2D(image);
+
+        normalTex->setInternalFormat(GL_RG8);
+        normalTex->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+        normalTex->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
+        normalTex->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+        normalTex->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+        normalTex->setResizeNonPowerOfTwoHint(false);
+        normalTex->setMaxAnisotropy(1.0f);
+        normalTex->setUnRefImageDataAfterApply(Registry::instance()->unRefImageDataAfterApply().get());
+
+        return normalTex;
+    }
+
+    // Bilinear sample of a row-major height grid at fractional (col, row).
+    // Caller guarantees the coordinates are within the grid.
+    inline float sampleGrid(const float* grid, int cols, int rows, double col, double row)
+    {
+        int c0 = osg::clampBetween((int)col, 0, cols - 1);
+        int r0 = osg::clampBetween((int)row, 0, rows - 1);
+        int c1 = osg::minimum(c0 + 1, cols - 1);
+        int r1 = osg::minimum(r0 + 1, rows - 1);
+        float cmix = (float)(col - (double)c0);
+        float rmix = (float)(row - (double)r0);
+
+        float h00 = grid[r0*cols + c0], h10 = grid[r0*cols + c1];
+        float h01 = grid[r1*cols + c0], h11 = grid[r1*cols + c1];
+
+        if (h00 == NO_DATA_VALUE || h10 == NO_DATA_VALUE ||
+            h01 == NO_DATA_VALUE || h11 == NO_DATA_VALUE)
+        {
+            return NO_DATA_VALUE;
+        }
+
+        float h0 = h00 + cmix*(h10 - h00);
+        float h1 = h01 + cmix*(h11 - h01);
+        return h0 + rmix*(h1 - h0);
+    }
+}
+
 osg::Texture2D*
 NormalMapGenerator::createNormalMap(
     const TileKey& key,
@@ -198,6 +389,175 @@ NormalMapGenerator::createNormalMap(
 
     ElevationPool::WorkingSet* workingSet = static_cast<ElevationPool::WorkingSet*>(ws);
 
+    ElevationPool* pool = map->getElevationPool();
+
+    // fetch the elevation tile; the normals come straight from its heights.
+    osg::ref_ptr<ElevationTexture> heights;
+    pool->getTile(key, true, heights, workingSet, progress);
+
+    if (!heights.valid() || !heights->getHeightField())
+        return NULL;
+
+    const osg::HeightField* hf = heights->getHeightField();
+    const int cols = hf->getNumColumns();
+    const int rows = hf->getNumRows();
+    const float* grid = &hf->getFloatArray()->front();
+
+    const int width = ELEVATION_TILE_SIZE;
+    const int height = ELEVATION_TILE_SIZE;
+
+    const GeoExtent& ex = key.getExtent();
+
+    // map units => grid units
+    const double toCol = (double)(cols - 1) / ex.width();
+    const double toRow = (double)(rows - 1) / ex.height();
+    const double maxCol = (double)(cols - 1) + 1e-6;
+    const double maxRow = (double)(rows - 1) + 1e-6;
+
+    // Meters per map unit, precomputed once per row. For a geographic SRS
+    // the east-west spacing shrinks with latitude (same approximation as
+    // Distance::asDistance).
+    const Units& units = key.getProfile()->getSRS()->getUnits();
+    std::vector<double> metersPerUnitX(height);
+    double metersPerUnitY;
+    if (units.isAngle())
+    {
+        metersPerUnitY = Units::convert(units, Units::DEGREES, 1.0) * 111000.0;
+        for (int t = 0; t < height; ++t)
+        {
+            double lat = ex.yMin() + ex.height()*(double)t / (double)(height - 1);
+            metersPerUnitX[t] = metersPerUnitY * cos(osg::DegreesToRadians(lat));
+        }
+    }
+    else
+    {
+        metersPerUnitY = Units::convert(units, Units::METERS, 1.0);
+        metersPerUnitX.assign(height, metersPerUnitY);
+    }
+
+    // Neighbor heights (W, E, S, N) for every texel, and the sample
+    // distance (the data resolution at that texel).
+    std::vector<float> z(width * height * 4);
+    std::vector<double> spacing(width * height);
+
+    // Neighbors that fall off the tile (only along the border when the
+    // data is at full resolution) are sampled from the pool in one batch.
+    std::vector<osg::Vec4d> edgePoints;
+    std::vector<unsigned> edgeIndex;
+
+    for (int t = 0; t < height; ++t)
+    {
+        double y = ex.yMin() + ex.height()*(double)t / (double)(height - 1);
+        int rt = (rows == height) ? t : (int)((double)t*(double)(heights->reader().t() - 1) / (double)(height - 1) + 0.5);
+
+        for (int s = 0; s < width; ++s)
+        {
+            double x = ex.xMin() + ex.width()*(double)s / (double)(width - 1);
+            int rs = (cols == width) ? s : (int)((double)s*(double)(heights->reader().s() - 1) / (double)(width - 1) + 0.5);
+
+            int i = t*width + s;
+            double r = heights->getResolution(rs, rt);
+            spacing[i] = r;
+
+            const double nx[4] = { x - r, x + r, x, x };
+            const double ny[4] = { y, y, y - r, y + r };
+
+            for (int k = 0; k < 4; ++k)
+            {
+                double col = (nx[k] - ex.xMin()) * toCol;
+                double row = (ny[k] - ex.yMin()) * toRow;
+
+                if (col >= -1e-6 && col <= maxCol && row >= -1e-6 && row <= maxRow)
+                {
+                    z[i*4 + k] = sampleGrid(grid, cols, rows, osg::maximum(col, 0.0), osg::maximum(row, 0.0));
+                }
+                else
+                {
+                    edgePoints.push_back(osg::Vec4d(nx[k], ny[k], 0.0, r));
+                    edgeIndex.push_back(i*4 + k);
+                }
+            }
+        }
+    }
+
+    if (!edgePoints.empty())
+    {
+        int sampleOK = pool->sampleMapCoords(edgePoints, workingSet, progress);
+
+        if (progress && progress->isCanceled())
+        {
+            // canceled. Bail.
+            return NULL;
+        }
+
+        if (sampleOK < 0)
+        {
+            OE_WARN << LC << "Internal error - contact support" << std::endl;
+            return NULL;
+        }
+
+        for (unsigned e = 0; e < edgePoints.size(); ++e)
+        {
+            z[edgeIndex[e]] = edgePoints[e].z();
+        }
+    }
+
+    osg::Image* image = new osg::Image();
+    image->allocateImage(width, height, 1, GL_RG, GL_UNSIGNED_BYTE);
+
+    osg::Vec3 normal;
+    osg::Vec2 packedNormal;
+
+    for (int t = 0; t < height; ++t)
+    {
+        GLubyte* out = image->data(0, t);
+
+        for (int s = 0; s < width; ++s)
+        {
+            int i = t*width + s;
+            const float* n = &z[i*4];
+
+            if (n[0] != NO_DATA_VALUE && n[1] != NO_DATA_VALUE &&
+                n[2] != NO_DATA_VALUE && n[3] != NO_DATA_VALUE)
+            {
+                // Cross product of the central differences
+                // (2dx, 0, zE-zW) x (0, 2dy, zN-zS), simplified.
+                double dx = spacing[i] * metersPerUnitX[t];
+                double dy = spacing[i] * metersPerUnitY;
+                normal.set(
+                    -2.0*dy*(n[1] - n[0]),
+                    -2.0*dx*(n[3] - n[2]),
+                    4.0*dx*dy);
+                normal.normalize();
+            }
+            else
+            {
+                normal.set(0, 0, 1);
+            }
+
+            packNormal(normal, packedNormal);
+            *out++ = (GLubyte)(packedNormal.x() * 255.0f);
+            *out++ = (GLubyte)(packedNormal.y() * 255.0f);
+        }
+    }
+
+    return makeNormalMapTexture(image);
+}
+
+osg::Texture2D*
+NormalMapGenerator::createNormalMapBySampling(
+    const TileKey& key,
+    const Map* map,
+    void* ws,
+    ProgressCallback* progress)
+{
+    if (!map)
+        return NULL;
+
+    OE_PROFILING_ZONE;
+
+    ElevationPool::WorkingSet* workingSet = static_cast<ElevationPool::WorkingSet*>(ws);
+
     osg::Image* image = new osg::Image();
     image->allocateImage(
         ELEVATION_TILE_SIZE, ELEVATION_TILE_SIZE, 1,
@@ -324,16 +684,5 @@ NormalMapGenerator::createNormalMap(
         }
     }
 
-    osg::Texture2D* normalTex = new osg::Texture2D(image);
-
-    normalTex->setInternalFormat(GL_RG8);
-    normalTex->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
-    normalTex->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
-    normalTex->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
-    normalTex->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
-    normalTex->setResizeNonPowerOfTwoHint(false);
-    normalTex->setMaxAnisotropy(1.0f);
-    normalTex->setUnRefImageDataAfterApply(Registry::instance()->unRefImageDataAfterApply().get());
-    
-    return normalTex;
+    return makeNormalMapTexture(image);
 }
@@ -22,12 +22,16 @@
 #include <osgEarth/MemCache>
 #include <osgEarth/Metrics>
 #include <osgEarth/NetworkMonitor>
+#include <osgEarth/Cache>
 #include <cinttypes>
 
 using namespace osgEarth;
 
 #define LC "[ElevationLayer] \"" << getName() << "\" : "
 
+// arena used to fetch source tiles in parallel when assembling a tile
+#define ARENA_ASSEMBLE "oe.layer.assemble"
+
 //#define ANALYZE
 
 //------------------------------------------------------------------------
@@ -41,6 +45,7 @@ ElevationLayer::Options::getConfig() const
     conf.set("nodata_policy", "default",     _noDataPolicy, NODATA_INTERPOLATE );
     conf.set("nodata_policy", "interpolate", _noDataPolicy, NODATA_INTERPOLATE );
     conf.set("nodata_policy", "msl",         _noDataPolicy, NODATA_MSL );
+    conf.set("cache_derived_data", cacheDerivedData());
     return conf;
 }
 
@@ -49,6 +54,7 @@ ElevationLayer::Options::fromConfig( const Config& conf )
 {
     _offset.init( false );
     _noDataPolicy.init( NODATA_INTERPOLATE );
+    _cacheDerivedData.init( false );
 
     conf.get("vdatum", verticalDatum() );
     conf.get("vsrs", verticalDatum() );    // back compat
@@ -56,6 +62,7 @@ ElevationLayer::Options::fromConfig( const Config& conf )
     conf.get("nodata_policy", "default",     _noDataPolicy, NODATA_INTERPOLATE );
     conf.get("nodata_policy", "interpolate", _noDataPolicy, NODATA_INTERPOLATE );
     conf.get("nodata_policy", "msl",         _noDataPolicy, NODATA_MSL );
+    conf.get("cache_derived_data", cacheDerivedData() );
 }
 
 //------------------------------------------------------------------------
@@ -146,6 +153,18 @@ ElevationLayer::getOffset() const
     return options().offset().get();
 }
 
+void
+ElevationLayer::setCacheDerivedData(bool value)
+{
+    options().cacheDerivedData() = value;
+}
+
+bool
+ElevationLayer::getCacheDerivedData() const
+{
+    return options().cacheDerivedData().get();
+}
+
 void
 ElevationLayer::setNoDataPolicy(const ElevationNoDataPolicy& value)
 {
@@ -250,19 +269,30 @@ ElevationLayer::assembleHeightField(const TileKey& key,
     // we will do that later.
     if ( intersectingTiles.size() > 0 )
     {
-        for (unsigned int i = 0; i < intersectingTiles.size(); ++i)
-        {
-            const TileKey& layerKey = intersectingTiles[i];
+        // Fetch all the intersecting tiles concurrently.
+        std::vector<GeoHeightField> fetched(intersectingTiles.size());
 
-            if ( isKeyInLegalRange(layerKey) )
+        Threading::parallelFor(
+            JobArena::get(ARENA_ASSEMBLE),
+            intersectingTiles.size(),
+            [&](unsigned i)
             {
-                GeoHeightField hf = createHeightFieldImplementation(layerKey, progress);
-                if (hf.valid())
+                const TileKey& layerKey = intersectingTiles[i];
+
+                if ( isKeyInLegalRange(layerKey) && !(progress && progress->isCanceled()) )
                 {
-                    heightFields.push_back( hf );
+                    fetched[i] = createHeightFieldImplementation(layerKey, progress);
                 }
+            });
+
+        for (unsigned int i = 0; i < fetched.size(); ++i)
+        {
+            if (fetched[i].valid())
+            {
+                heightFields.push_back( fetched[i] );
             }
         }
+        fetched.clear();
 
         // If we actually got a HeightField, resample/reproject it to match the incoming TileKey's extents.
         if (heightFields.size() > 0)
@@ -290,26 +320,43 @@ ElevationLayer::assembleHeightField(const TileKey& key,
             double dx = (maxx - minx)/(double)(width-1);
             double dy = (maxy - miny)/(double)(height-1);
 
+            // Transform the whole sample grid into the layer's SRS in one go,
+            // instead of once per sample per heightfield.
+            const SpatialReference* keySRS = key.getExtent().getSRS();
+            const SpatialReference* layerSRS = heightFields.front().getExtent().getSRS();
+
+            std::vector<osg::Vec3d> points;
+            points.reserve(width*height);
+            for (unsigned int c = 0; c < width; ++c)
+                for (unsigned r = 0; r < height; ++r)
+                    points.push_back(osg::Vec3d(minx + (dx * (double)c), miny + (dy * (double)r), 0.0));
+
+            bool transformed = keySRS->transform(points, layerSRS);
+
             //Create the new heightfield by sampling all of them.
+            //Neighboring samples usually fall in the same tile, so try the
+            //heightfield that answered last time before the others.
+            unsigned last = 0u;
+            unsigned p = 0u;
             for (unsigned int c = 0; c < width; ++c)
             {
-                double x = minx + (dx * (double)c);
-                for (unsigned r = 0; r < height; ++r)
+                for (unsigned r = 0; r < height; ++r, ++p)
                 {
-                    double y = miny + (dy * (double)r);
-
                     //For each sample point, try each heightfield.  The first one with a valid elevation wins.
                     float elevation = NO_DATA_VALUE;
-                    osg::Vec3 normal(0,0,1);
 
-                    for (GeoHeightFieldVector::iterator itr = heightFields.begin(); itr != heightFields.end(); ++itr)
+                    for (unsigned k = 0; transformed && k < heightFields.size(); ++k)
                     {
+                        unsigned h = (k == 0u) ? last : (k <= last ? k - 1u : k);
+                        const GeoHeightField& hf = heightFields[h];
+
                         // get the elevation value, at the same time transforming it vertically into the
                         // requesting key's vertical datum.
                         float e = 0.0;
-                        if (itr->getElevation(key.getExtent().getSRS(), x, y, INTERP_BILINEAR, key.getExtent().getSRS(), e))
+                        if (hf.getElevation(hf.getExtent().getSRS(), points[p].x(), points[p].y(), INTERP_BILINEAR, keySRS, e))
                         {
                             elevation = e;
+                            last = h;
                             break;
                         }
                     }
@@ -377,11 +424,9 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
     // Check the memory cache first
     bool fromMemCache = false;
 
-    // cache key combines the key with the full signature (incl vdatum)
-    // the cache key combines the Key and the horizontal profile.
-    std::string cacheKey = Cache::makeCacheKey(
-        Stringify() << key.str() << "-" << std::hex << key.getProfile()->getHorizSignature(),
-        "elevation");
+    // The persistent cache key (see getCacheKey) is only formatted
+    // if we actually touch the persistent cache.
+    std::string cacheKey;
     const CachePolicy& policy = getCacheSettings()->cachePolicy().get();
 
     char memCacheKey[64];
@@ -389,10 +434,7 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
     // Try the L2 memory cache first:
     if ( _memCache.valid() )
     {
-        sprintf(memCacheKey, "%d/%s/%s",
-            getRevision(),
-            key.str().c_str(),
-            key.getProfile()->getHorizSignature().c_str());
+        makeMemCacheKey(key, memCacheKey);
 
         CacheBin* bin = _memCache->getOrCreateDefaultBin();
         ReadResult cacheResult = bin->readObject(memCacheKey, 0L);
@@ -427,6 +469,8 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
 
         if ( cacheBin && policy.isCacheReadable() )
         {
+            if (cacheKey.empty())
+                cacheKey = getCacheKey(key);
             ReadResult r = cacheBin->readObject(cacheKey, 0L);
             if ( r.succeeded() )
             {
@@ -520,6 +564,8 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
                  policy.isCacheWriteable() )
             {
                 OE_PROFILING_ZONE_NAMED("cache write");
+                if (cacheKey.empty())
+                    cacheKey = getCacheKey(key);
                 cacheBin->write(cacheKey, hf.get(), 0L);
             }
 
@@ -570,6 +616,60 @@ ElevationLayer::writeHeightField(const TileKey& key, const osg::HeightField* hf,
     return Status::ServiceUnavailable;
 }
 
+namespace
+{
+    std::string makeNormalMapCacheKey(const TileKey& key)
+    {
+        return Cache::makeCacheKey(
+            Stringify() << key.str() << "-" << key.getProfile()->getHorizSignature(),
+            "normalmap");
+    }
+}
+
+osg::Image*
+ElevationLayer::readNormalMap(const TileKey& key, std::size_t revision)
+{
+    if (!getCacheDerivedData() || !isOpen())
+        return NULL;
+
+    const CachePolicy& policy = getCacheSettings()->cachePolicy().get();
+    if (!policy.isCacheReadable())
+        return NULL;
+
+    CacheBin* cacheBin = getCacheBin(key.getProfile());
+    if (!cacheBin)
+        return NULL;
+
+    ReadResult r = cacheBin->readImage(makeNormalMapCacheKey(key), 0L);
+    if (r.succeeded() &&
+        !policy.isExpired(r.lastModifiedTime()) &&
+        r.metadata().value("revision") == (Stringify() << std::hex << revision).str())
+    {
+        return r.releaseImage();
+    }
+
+    return NULL;
+}
+
+bool
+ElevationLayer::writeNormalMap(const TileKey& key, std::size_t revision, const osg::Image* image)
+{
+    if (!image || !getCacheDerivedData() || !isOpen())
+        return false;
+
+    const CachePolicy& policy = getCacheSettings()->cachePolicy().get();
+    if (!policy.isCacheWriteable())
+        return false;
+
+    CacheBin* cacheBin = getCacheBin(key.getProfile());
+    if (!cacheBin)
+        return false;
+
+    Config meta;
+    meta.set("revision", (Stringify() << std::hex << revision).str());
+    return cacheBin->write(makeNormalMapCacheKey(key), image, meta, 0L);
+}
+
 Status
 ElevationLayer::writeHeightFieldImplementation(const TileKey& key, const osg::HeightField* hf, ProgressCallback* progress) const
 {
@@ -19,6 +19,7 @@
 #include <osgEarth/ElevationPool>
 #include <osgEarth/Map>
 #include <osgEarth/Metrics>
+#include <osgEarth/MetricsRegistry>
 #include <osgEarth/rtree.h>
 #include <osgEarth/HeightFieldUtils>
 #include <osgEarth/Registry>
@@ -32,6 +33,38 @@ using namespace osgEarth;
 
 #define LC "[ElevationPool] "
 
+namespace
+{
+    // Locks the weak pointer stored under "key", removing it if orphaned.
+    template<typename LUT, typename KEY>
+    bool lockWeak(
+        LUT& lut,
+        const KEY& key,
+        Threading::ReadWriteMutex& mutex,
+        osg::ref_ptr<ElevationTexture>& output)
+    {
+        bool orphaned = false;
+        {
+            ScopedReadLock lock(mutex);
+
+            auto i = lut.find(key);
+            if (i != lut.end())
+            {
+                i->second.lock(output);
+                orphaned = !output.valid();
+            }
+        }
+
+        if (orphaned)
+        {
+            ScopedWriteLock lock(mutex);
+            lut.erase(key);
+        }
+
+        return output.valid();
+    }
+}
+
 ElevationPool::StrongLRU::StrongLRU(unsigned maxSize) :
     _maxSize(maxSize)
 {
@@ -57,6 +90,57 @@ ElevationPool::StrongLRU::clear()
     while(!_lru.empty())
         _lru.pop();
 }
+
+ElevationPool::CompactLRU::CompactLRU(unsigned maxSize) :
+    _mutex("OE.ElevPool.CLRU"),
+    _maxSize(maxSize)
+{
+    //nop
+}
+
+bool
+ElevationPool::CompactLRU::get(const Internal::RevElevationID& id, osg::ref_ptr<CompactElevation>& out)
+{
+    ScopedMutexLock lock(_mutex);
+    auto i = _index.find(id);
+    if (i == _index.end())
+        return false;
+
+    // move to the front (most recently used)
+    _list.splice(_list.begin(), _list, i->second);
+    out = i->second->second;
+    return true;
+}
+
+void
+ElevationPool::CompactLRU::push(const Internal::RevElevationID& id, CompactElevation* value)
+{
+    ScopedMutexLock lock(_mutex);
+    auto i = _index.find(id);
+    if (i != _index.end())
+    {
+        i->second->second = value;
+        _list.splice(_list.begin(), _list, i->second);
+        return;
+    }
+
+    _list.emplace_front(id, value);
+    _index.emplace(id, _list.begin());
+
+    while (_list.size() > _maxSize)
+    {
+        _index.erase(_list.back().first);
+        _list.pop_back();
+    }
+}
+
+void
+ElevationPool::CompactLRU::clear()
+{
+    ScopedMutexLock lock(_mutex);
+    _index.clear();
+    _list.clear();
+}
     
 
 void
@@ -72,7 +156,10 @@ ElevationPool::ElevationPool() :
     _workers(0),
     _refreshMutex("OE.ElevPool.RM"),
     _globalLUTMutex("OE.ElevPool.GLUT"),
-    _L2(64u)
+    _L2(64u),
+    _compactL2(1024u),
+    _compressionTolerance(0.0f),
+    _L2CacheSize(64u)
 {
     _L2._lru.setName("OE.ElevPool.LRU");
 
@@ -91,6 +178,62 @@ ElevationPool::clear()
     _mapDataDirty = true;
 }
 
+void
+ElevationPool::setL2CacheSize(unsigned value)
+{
+    ScopedMutexLock lock(_L2._lru);
+    _L2CacheSize = osg::maximum(value, 1u);
+    resizeL2();
+}
+
+unsigned
+ElevationPool::getL2CacheSize() const
+{
+    return _L2CacheSize;
+}
+
+void
+ElevationPool::setCompressionTolerance(float meters)
+{
+    meters = osg::maximum(meters, 0.0f);
+
+    ScopedMutexLock lock(_L2._lru);
+    _compressionTolerance.store(meters);
+    if (meters == 0.0f)
+        _compactL2.clear();
+    resizeL2();
+}
+
+void
+ElevationPool::resizeL2()
+{
+    // ASSUME _L2._lru IS LOCKED
+
+    // With compression on, the compact cache replaces the float L2 rather
+    // than adding to it; keep just enough decoded tiles for the queries
+    // in flight.
+    const unsigned decodedL2Size = 8u;
+    _L2._maxSize = _compressionTolerance.load() > 0.0f ?
+        osg::minimum(_L2CacheSize, decodedL2Size) :
+        _L2CacheSize;
+
+    while (_L2._lru.size() > _L2._maxSize)
+        _L2._lru.pop();
+}
+
+void
+ElevationPool::setCompactCacheSize(unsigned value)
+{
+    ScopedMutexLock lock(_compactL2._mutex);
+    _compactL2._maxSize = osg::maximum(value, 1u);
+}
+
+unsigned
+ElevationPool::getCompactCacheSize() const
+{
+    return _compactL2._maxSize;
+}
+
 void
 ElevationPool::setMap(const Map* map)
 {
@@ -192,9 +335,11 @@ ElevationPool::refresh(const Map* map)
     }
 
     _L2.clear();
+    _compactL2.clear();
 
     _globalLUTMutex.write_lock();
     _globalLUT.clear();
+    _globalKeyLUT.clear();
     _globalLUTMutex.write_unlock();
 }
 
@@ -246,31 +391,11 @@ ElevationPool::findExistingRaster(
 
     // Next check the system LUT -- see if someone somewhere else
     // already has it (the terrain or another WorkingSet)
-    optional<Internal::RevElevationKey> orphanedKey;
-    {
-        ScopedReadLock lock(_globalLUTMutex);
-
-        auto i = _globalLUT.find(key);
-        if (i != _globalLUT.end())
-        {
-            i->second.lock(output);
-            if (output.valid())
-            {
-                *fromLUT = true;
-            }
-            else
-            {
-                // observer was orphaned..remove it
-                orphanedKey = key;
-            }
-        }
-    }
-
-    if (orphanedKey.isSet())
-    {
-        ScopedWriteLock lock(_globalLUTMutex);
-        _globalLUT.erase(orphanedKey.get());
-    }
+    Internal::RevElevationID id(key);
+    if (id.valid())
+        *fromLUT = lockWeak(_globalLUT, id, _globalLUTMutex, output);
+    else
+        *fromLUT = lockWeak(_globalKeyLUT, key, _globalLUTMutex, output);
 
     // found it, so stick it in the L2 cache
     if (output.valid())
@@ -297,6 +422,30 @@ ElevationPool::getOrCreateRaster(
 
     findExistingRaster(key, ws, result, &fromWS, &fromL2, &fromLUT);
 
+    // next try the compact cache, which holds far more tiles than the L2
+    // but has to decode them:
+    bool fromCompact = false;
+    if (!result.valid() && _compressionTolerance.load() > 0.0f)
+    {
+        Internal::RevElevationID id(key);
+        osg::ref_ptr<CompactElevation> compact;
+        if (id.valid() && _compactL2.get(id, compact))
+        {
+            result = compact->createTexture();
+            fromCompact = true;
+        }
+    }
+
+    static MetricsRegistry::Counter& s_hits = MetricsRegistry::instance().counter(
+        "osgearth_elevation_pool_hits_total", "Elevation rasters found in the ElevationPool caches");
+    static MetricsRegistry::Counter& s_misses = MetricsRegistry::instance().counter(
+        "osgearth_elevation_pool_misses_total", "Elevation rasters the ElevationPool had to create");
+
+    if (result.valid())
+        s_hits.increment();
+    else
+        s_misses.increment();
+
     if (!result.valid())
     {
         // need to build NEW data for this key
@@ -377,8 +526,30 @@ ElevationPool::getOrCreateRaster(
     // update system weak-LUT:
     if (!fromLUT)
     {
-        ScopedWriteLock lock(_globalLUTMutex);
-        _globalLUT[key] = result.get();
+        Internal::RevElevationID id(key);
+        if (!id.valid())
+        {
+            ScopedWriteLock lock(_globalLUTMutex);
+            _globalKeyLUT[key] = result.get();
+        }
+        else
+        {
+            {
+                ScopedWriteLock lock(_globalLUTMutex);
+                _globalLUT[id] = result.get();
+            }
+
+            // keep a compact copy of new tiles so they survive L2 eviction
+            float tolerance = _compressionTolerance.load();
+            if (tolerance > 0.0f && !fromCompact)
+            {
+                osg::ref_ptr<CompactElevation> compact = CompactElevation::create(
+                    result.get(), tolerance);
+
+                if (compact.valid())
+                    _compactL2.push(id, compact.get());
+            }
+        }
     }
 
     return result;
@@ -66,6 +66,10 @@ using namespace osgEarth::Util;
 
 #define USER_OBJECT_NAME "osgEarth.FeatureModelGraph"
 
+// Tiles rebuilt after a feature change share the paging threads, so that
+// edits and paging don't oversubscribe the CPU between them.
+#define REBUILD_ARENA_NAME "oe.nodepager"
+
 // Whether to install a cull callback on PagedLODs that adds an extra
 // culling step (beyond the normal bounding sphere test) based on a
 // tile extent box compared against the frustum. This provides tighter
@@ -413,6 +417,21 @@ namespace
             node->getOrCreateStateSet()->addUniform(u);
         }
     };
+
+    // Passes feature changes on to the graph so it can rebuild the tiles they touch.
+    struct RebuildOnFeatureChange : public FeatureSourceCallback
+    {
+        osg::observer_ptr<FeatureModelGraph> _graph;
+
+        RebuildOnFeatureChange(FeatureModelGraph* graph) : _graph(graph) { }
+
+        void onFeaturesChanged(FeatureSource* source, const GeoExtent& extent, const std::vector<FeatureID>& fids) override
+        {
+            osg::ref_ptr<FeatureModelGraph> graph;
+            if (_graph.lock(graph))
+                graph->dirty(extent);
+        }
+    };
 }
 
 
@@ -423,7 +442,10 @@ FeatureModelGraph::FeatureModelGraph(const FeatureModelOptions& options) :
     _featureExtentClamped(false),
     _useTiledSource(false),
     _blacklistMutex("FMG BlackList(OE)"),
-    _isActive(false)
+    _isActive(false),
+    _tilesHighWater(64u),
+    _featureRevision(0),
+    _tilesMutex("FMG Tiles(OE)")
 {
     //NOP
 }
@@ -723,8 +745,14 @@ FeatureModelGraph::open()
 
     ADJUST_EVENT_TRAV_COUNT(this, 1);
 
+    // for swapping in tiles rebuilt after a feature change
+    ADJUST_UPDATE_TRAV_COUNT(this, 1);
+
     _isActive = true;
 
+    _featureSourceCallback = new RebuildOnFeatureChange(this);
+    _session->getFeatureSource()->addCallback(_featureSourceCallback.get());
+
     redraw();
 
     return Status::OK();
@@ -735,13 +763,20 @@ FeatureModelGraph::shutdown()
 {
     _isActive = false;
 
+    if (_featureSourceCallback.valid())
+    {
+        if (_session.valid() && _session->getFeatureSource())
+            _session->getFeatureSource()->removeCallback(_featureSourceCallback.get());
+        _featureSourceCallback = NULL;
+    }
+
     // Block until all active pager tasks have returned/canceled
     //ScopedWriteLock waiter(getSync());
 }
 
 FeatureModelGraph::~FeatureModelGraph()
 {
-    //nop
+    shutdown();
 }
 
 void
@@ -949,6 +984,14 @@ FeatureModelGraph::load(
 
     osg::ref_ptr<osg::Group> result;
 
+    // what we built for this tile, so dirty() can rebuild it later
+    bool builtTile = false;
+    FeatureLevel tileLevel(0.0f, FLT_MAX);
+    GeoExtent tileExtentBuilt;
+    optional<TileKey> tileKey;
+    osg::Node* tileGeometry = 0L;
+    int featureRevision = _featureRevision;
+
     if (_useTiledSource)
     {
         // A "tiled" source has a pre-generted tile hierarchy, but no range information.
@@ -984,6 +1027,12 @@ FeatureModelGraph::load(
 
             geometry = buildTile(level, tileExtent, &key, readOptions);
             result = geometry;
+
+            tileLevel = level;
+            tileExtentBuilt = tileExtent;
+            tileKey = key;
+            tileGeometry = geometry.get();
+            builtTile = true;
         }
 
         // check whether more levels exist below the current level.
@@ -1015,6 +1064,10 @@ FeatureModelGraph::load(
 
         FeatureLevel all(0.0f, FLT_MAX);
         result = buildTile(all, GeoExtent::INVALID, (const TileKey*)0L, readOptions);
+
+        tileLevel = all;
+        tileGeometry = result.get();
+        builtTile = true;
     }
 
     else if ((int)lod < _lodmap.size())
@@ -1038,6 +1091,11 @@ FeatureModelGraph::load(
 
             geometry = buildTile(*level, tileExtent, (const TileKey*)0L, readOptions);
             result = geometry;
+
+            tileLevel = *level;
+            tileExtentBuilt = tileExtent;
+            tileGeometry = geometry.get();
+            builtTile = true;
         }
 
         if (lod < _lodmap.size() - 1)
@@ -1066,6 +1124,23 @@ FeatureModelGraph::load(
     {
         // For some unknown reason, this breaks when I insert an LOD. -gw
         //RemoveEmptyGroupsVisitor::run( result );
+
+        if (result.get() == tileGeometry)
+        {
+            // Leaf tile: give the geometry a parent so dirty() can swap it out.
+            osg::ref_ptr<osg::Group> group = new osg::Group();
+            group->addChild(result.get());
+            result = group;
+        }
+    }
+
+    if (builtTile)
+    {
+        registerTile(
+            uri, result.get(), tileGeometry, tileLevel, tileExtentBuilt,
+            tileKey.isSet() ? &tileKey.get() : 0L,
+            readOptions,
+            featureRevision);
     }
 
     if (result->getNumChildren() == 0)
@@ -1995,6 +2070,11 @@ FeatureModelGraph::redraw()
 
     // clear it out
     removeChildren(0, getNumChildren());
+    {
+        ScopedMutexLock lock(_tilesMutex);
+        _tiles.clear();
+        _rebuiltTiles.clear();
+    }
 
     // initialize the index if necessary.
     if (_options.featureIndexing()->enabled() == true)
@@ -2017,7 +2097,19 @@ FeatureModelGraph::redraw()
         FeatureLevel defaultLevel(0.0f, FLT_MAX);
 
         //Remove all current children
-        node = buildTile(defaultLevel, GeoExtent::INVALID, 0, _session->getDBOptions());
+        int featureRevision = _featureRevision;
+        osg::ref_ptr<osg::Group> geometry = buildTile(defaultLevel, GeoExtent::INVALID, 0, _session->getDBOptions());
+
+        // hold the geometry in a group so dirty() can swap it out
+        osg::ref_ptr<osg::Group> group = new osg::Group();
+        if (geometry.valid())
+            group->addChild(geometry.get());
+
+        registerTile(
+            s_makeURI(0, 0, 0), group.get(), geometry.get(), defaultLevel, GeoExtent::INVALID, 0L,
+            _session->getDBOptions(), featureRevision);
+
+        node = group;
     }
 
 #if 0
@@ -2067,6 +2159,301 @@ FeatureModelGraph::redraw()
     runPostMergeOperations(node.get());
 }
 
+void
+FeatureModelGraph::registerTile(
+    const std::string&    uri,
+    osg::Group*           parent,
+    osg::Node*            geometry,
+    const FeatureLevel&   level,
+    const GeoExtent&      extent,
+    const TileKey*        key,
+    const osgDB::Options* readOptions,
+    int                   featureRevision)
+{
+    ScopedMutexLock lock(_tilesMutex);
+
+    // forget the tiles that paged out since we last looked
+    if (_tiles.size() >= _tilesHighWater)
+    {
+        for (std::unordered_map<std::string, TileSlot>::iterator i = _tiles.begin(); i != _tiles.end(); )
+        {
+            osg::ref_ptr<osg::Group> p;
+            if (i->second._parent.lock(p))
+                ++i;
+            else
+                i = _tiles.erase(i);
+        }
+        _tilesHighWater = osg::maximum((std::size_t)64u, _tiles.size() * 2u);
+    }
+
+    TileSlot& slot = _tiles[uri];
+    slot._parent = parent;
+    slot._geometry = geometry;
+    slot._level = level;
+    slot._extent = extent;
+    slot._key.unset();
+    if (key)
+        slot._key = *key;
+    slot._readOptions = readOptions;
+
+    // Features changed while this tile was building, so it may have
+    // missed the edit. Rebuild it; otherwise retire any rebuild still
+    // in flight for an earlier copy of the tile.
+    if (featureRevision != _featureRevision)
+        scheduleRebuild(uri, slot);
+    else
+        ++slot._revision;
+}
+
+void
+FeatureModelGraph::dirty(const GeoExtent& extent)
+{
+    if (!_isActive)
+        return;
+
+    OE_DEBUG << LC << "Features changed in " << (extent.isValid() ? extent.toString() : "unknown extent") << std::endl;
+
+    // Tiles that came up empty might not be any more, so let them load again.
+    {
+        Threading::ScopedWriteLock exclusiveLock(_blacklistMutex);
+        for (std::set<std::string>::iterator i = _blacklist.begin(); i != _blacklist.end(); )
+        {
+            unsigned lod, x, y;
+            if (!extent.isValid() ||
+                (sscanf(i->c_str(), "%u_%u_%u", &lod, &x, &y) == 3 &&
+                 s_getTileExtent(lod, x, y, _usableFeatureExtent).intersects(extent)))
+            {
+                _blacklist.erase(i++);
+            }
+            else ++i;
+        }
+    }
+
+    if (_options.nodeCaching() == true)
+    {
+        removeTilesFromCache(extent);
+    }
+
+    ScopedMutexLock lock(_tilesMutex);
+
+    ++_featureRevision;
+
+    for (std::unordered_map<std::string, TileSlot>::iterator i = _tiles.begin(); i != _tiles.end(); )
+    {
+        osg::ref_ptr<osg::Group> parent;
+        if (!i->second._parent.lock(parent))
+        {
+            // paged out; it will load fresh data if it comes back
+            i = _tiles.erase(i);
+            continue;
+        }
+
+        if (!extent.isValid() || !i->second._extent.isValid() || i->second._extent.intersects(extent))
+        {
+            scheduleRebuild(i->first, i->second);
+        }
+        ++i;
+    }
+}
+
+void
+FeatureModelGraph::scheduleRebuild(const std::string& uri, TileSlot& slot)
+{
+    // bumping the revision supersedes any rebuild of this tile still in flight
+    int revision = ++slot._revision;
+
+    osg::observer_ptr<FeatureModelGraph> graph_weak(this);
+    FeatureLevel level = slot._level;
+    GeoExtent extent = slot._extent;
+    optional<TileKey> key = slot._key;
+    osg::ref_ptr<const osgDB::Options> readOptions = slot._readOptions;
+
+    Job job(JobArena::get(REBUILD_ARENA_NAME));
+    job.setName(uri);
+    job.dispatch([graph_weak, uri, revision, level, extent, key, readOptions](Cancelable*)
+    {
+        osg::ref_ptr<FeatureModelGraph> graph;
+        if (graph_weak.lock(graph))
+        {
+            graph->rebuildTile(uri, revision, level, extent, key, readOptions.get());
+        }
+    });
+}
+
+void
+FeatureModelGraph::rebuildTile(
+    const std::string&       uri,
+    int                      revision,
+    const FeatureLevel&      level,
+    const GeoExtent&         extent,
+    const optional<TileKey>& key,
+    const osgDB::Options*    readOptions)
+{
+    OE_PROFILING_ZONE;
+
+    if (!isActive())
+        return;
+
+    // skip the work if another change superseded this one in the meantime
+    {
+        ScopedMutexLock lock(_tilesMutex);
+        std::unordered_map<std::string, TileSlot>::const_iterator i = _tiles.find(uri);
+        if (i == _tiles.end() || i->second._revision != revision)
+            return;
+    }
+
+    OE_TEST << LC << "rebuild " << uri << std::endl;
+
+    osg::ref_ptr<osg::Group> geometry = buildTile(
+        level, extent, key.isSet() ? &key.get() : 0L, readOptions);
+
+    // a build canceled by shutdown is incomplete; don't swap it in
+    if (!isActive())
+        return;
+
+    if (geometry.valid())
+    {
+        runPreMergeOperations(geometry.get());
+    }
+
+    ScopedMutexLock lock(_tilesMutex);
+    RebuiltTile rebuilt;
+    rebuilt._uri = uri;
+    rebuilt._revision = revision;
+    rebuilt._geometry = geometry.get();
+    _rebuiltTiles.push_back(rebuilt);
+}
+
+void
+FeatureModelGraph::mergeRebuiltTiles()
+{
+    std::vector<RebuiltTile> rebuilt;
+    {
+        ScopedMutexLock lock(_tilesMutex);
+        if (_rebuiltTiles.empty())
+            return;
+        rebuilt.swap(_rebuiltTiles);
+    }
+
+    for (std::vector<RebuiltTile>::iterator r = rebuilt.begin(); r != rebuilt.end(); ++r)
+    {
+        osg::ref_ptr<osg::Group> parent;
+        osg::ref_ptr<osg::Node> previous;
+        {
+            ScopedMutexLock lock(_tilesMutex);
+
+            // drop it if the tile paged out or a newer rebuild is on the way
+            std::unordered_map<std::string, TileSlot>::iterator i = _tiles.find(r->_uri);
+            if (i == _tiles.end() || i->second._revision != r->_revision || !i->second._parent.lock(parent))
+                continue;
+
+            i->second._geometry.lock(previous);
+            i->second._geometry = r->_geometry.get();
+        }
+
+        // Swap in one step so the tile never draws half-built or empty.
+        if (previous.valid() && r->_geometry.valid())
+            parent->replaceChild(previous.get(), r->_geometry.get());
+        else if (previous.valid())
+            parent->removeChild(previous.get());
+        else if (r->_geometry.valid())
+            parent->addChild(r->_geometry.get());
+
+        if (r->_geometry.valid())
+        {
+            runPostMergeOperations(r->_geometry.get());
+        }
+    }
+}
+
+void
+FeatureModelGraph::removeTilesFromCache(const GeoExtent& extent)
+{
+    osg::ref_ptr<CacheBin> cacheBin;
+    optional<CachePolicy> policy;
+    if (CacheSettings* cacheSettings = CacheSettings::get(_session->getDBOptions()))
+    {
+        policy = cacheSettings->cachePolicy();
+        cacheBin = cacheSettings->getCacheBin();
+    }
+
+    if (!cacheBin.valid() || !policy->isCacheWriteable())
+        return;
+
+    // Enumerate the cache keys of every tile, loaded or not, that the
+    // change touches. Past a modest count it's cheaper to empty the bin.
+    const unsigned maxKeys = 1024u;
+    std::vector<std::string> keys;
+    bool tooMany = !extent.isValid();
+
+    if (_useTiledSource)
+    {
+        const FeatureProfile* featureProfile = _session->getFeatureSource()->getFeatureProfile();
+        std::vector<TileKey> tileKeys;
+        for (int lod = featureProfile->getFirstLevel(); lod <= featureProfile->getMaxLevel() && !tooMany; ++lod)
+        {
+            featureProfile->getTilingProfile()->getIntersectingTiles(extent, lod, tileKeys);
+            tooMany = tileKeys.size() > maxKeys;
+        }
+
+        FeatureLevel level(0.0f, FLT_MAX);
+        for (std::vector<TileKey>::const_iterator key = tileKeys.begin(); key != tileKeys.end(); ++key)
+            keys.push_back(makeCacheKey(level, GeoExtent::INVALID, &(*key)));
+    }
+
+    else if (!_options.layout().isSet())
+    {
+        // one tile holds everything
+        keys.push_back(makeCacheKey(FeatureLevel(0.0f, FLT_MAX), GeoExtent::INVALID, 0L));
+        tooMany = false;
+    }
+
+    else if (!tooMany)
+    {
+        GeoExtent local = extent.transform(_usableFeatureExtent.getSRS());
+        tooMany = !local.isValid();
+
+        for (unsigned lod = 0; lod < _lodmap.size() && !tooMany; ++lod)
+        {
+            const FeatureLevel* level = _lodmap[lod];
+            if (!level)
+                continue;
+
+            if (lod == 0)
+            {
+                keys.push_back(makeCacheKey(*level, _usableFeatureExtent, 0L));
+                continue;
+            }
+
+            // range of tiles at this LOD that overlap the change
+            int n = 1 << lod;
+            double w = _usableFeatureExtent.width() / (double)n;
+            double h = _usableFeatureExtent.height() / (double)n;
+            int x0 = osg::clampBetween((int)floor((local.xMin() - _usableFeatureExtent.xMin()) / w), 0, n - 1);
+            int x1 = osg::clampBetween((int)floor((local.xMax() - _usableFeatureExtent.xMin()) / w), 0, n - 1);
+            int y0 = osg::clampBetween((int)floor((local.yMin() - _usableFeatureExtent.yMin()) / h), 0, n - 1);
+            int y1 = osg::clampBetween((int)floor((local.yMax() - _usableFeatureExtent.yMin()) / h), 0, n - 1);
+
+            tooMany = keys.size() + (std::size_t)(x1 - x0 + 1) * (y1 - y0 + 1) > maxKeys;
+
+            for (int x = x0; x <= x1 && !tooMany; ++x)
+                for (int y = y0; y <= y1; ++y)
+                    keys.push_back(makeCacheKey(*level, s_getTileExtent(lod, x, y, _usableFeatureExtent), 0L));
+        }
+    }
+
+    if (tooMany)
+    {
+        OE_DEBUG << LC << "Clearing the tile cache" << std::endl;
+        cacheBin->clear();
+    }
+    else
+    {
+        for (std::vector<std::string>::const_iterator key = keys.begin(); key != keys.end(); ++key)
+            cacheBin->remove(*key);
+    }
+}
+
 void
 FeatureModelGraph::traverse(osg::NodeVisitor& nv)
 {
@@ -2080,6 +2467,11 @@ FeatureModelGraph::traverse(osg::NodeVisitor& nv)
     }
     else
     {
+        if (nv.getVisitorType() == nv.UPDATE_VISITOR)
+        {
+            mergeRebuiltTiles();
+        }
+
         osg::Group::traverse(nv);
     }
 }
@@ -18,10 +18,14 @@
  */
 #include <osgEarth/FeatureSource>
 #include <osgEarth/Filter>
+#include <osgEarth/GeoJSONReader>
+#include <osgEarth/StringUtils>
+#include <osgEarth/Cache>
 
 #define LC "[FeatureSource] " << getName() << ": "
 
 using namespace osgEarth;
+using namespace osgEarth::Util;
 
 //...................................................................
 
@@ -36,6 +40,9 @@ FeatureSource::Options::getConfig() const
     conf.set( "geo_interpolation", "rhumb_line",   geoInterp(), GEOINTERP_RHUMB_LINE );
     conf.set( "fid_attribute", fidAttribute() );
     conf.set( "rewind_polygons", rewindPolygons());
+    conf.set( "attributes", attributes() );
+    conf.set( "geometry_only", geometryOnly() );
+    conf.set( "tile_cache_size", tileCacheSize() );
 
     if (!filters().empty())
     {
@@ -54,6 +61,7 @@ void
 FeatureSource::Options::fromConfig(const Config& conf)
 {
     _rewindPolygons.init(true);
+    _tileCacheSize.init(0u);
 
     conf.get( "open_write",   openWrite() );
     conf.get( "profile",      profile() );
@@ -61,6 +69,9 @@ FeatureSource::Options::fromConfig(const Config& conf)
     conf.get( "geo_interpolation", "rhumb_line",   geoInterp(), GEOINTERP_RHUMB_LINE );
     conf.get( "fid_attribute", fidAttribute() );
     conf.get( "rewind_polygons", rewindPolygons());
+    conf.get( "attributes", attributes() );
+    conf.get( "geometry_only", geometryOnly() );
+    conf.get( "tile_cache_size", tileCacheSize() );
 
     const Config& filtersConf = conf.child("filters");
     for(ConfigSet::const_iterator i = filtersConf.children().begin(); i != filtersConf.children().end(); ++i)
@@ -88,6 +99,9 @@ OE_LAYER_PROPERTY_IMPL(FeatureSource, bool, OpenWrite, openWrite);
 OE_LAYER_PROPERTY_IMPL(FeatureSource, GeoInterpolation, GeoInterpolation, geoInterp);
 OE_LAYER_PROPERTY_IMPL(FeatureSource, std::string, FIDAttribute, fidAttribute);
 OE_LAYER_PROPERTY_IMPL(FeatureSource, bool, RewindPolygons, rewindPolygons);
+OE_LAYER_PROPERTY_IMPL(FeatureSource, std::string, Attributes, attributes);
+OE_LAYER_PROPERTY_IMPL(FeatureSource, bool, GeometryOnly, geometryOnly);
+OE_LAYER_PROPERTY_IMPL(FeatureSource, unsigned, TileCacheSize, tileCacheSize);
 
 void
 FeatureSource::init()
@@ -111,9 +125,21 @@ FeatureSource::openImplementation()
         return _filters->getStatus();
     }
 
+    if (options().tileCacheSize().get() > 0u)
+    {
+        _featureTileCache = new FeatureTileCache(options().tileCacheSize().get());
+    }
+
     return Status::NoError;
 }
 
+Status
+FeatureSource::closeImplementation()
+{
+    _featureTileCache = NULL;
+    return Layer::closeImplementation();
+}
+
 const Status&
 FeatureSource::create(
     const FeatureProfile* profile,
@@ -163,6 +189,10 @@ FeatureSource::removeFromBlacklist( FeatureID fid )
     Threading::ScopedWriteLock exclusive( _blacklistMutex );
     _blacklist.erase( fid );
     _blacklistSize = _blacklist.size();
+
+    // cached tiles were filtered against the old blacklist
+    if (_featureTileCache.valid())
+        _featureTileCache->clear();
 }
 
 void
@@ -171,6 +201,9 @@ FeatureSource::clearBlacklist()
     Threading::ScopedWriteLock exclusive( _blacklistMutex );
     _blacklist.clear();
     _blacklistSize = 0u;
+
+    if (_featureTileCache.valid())
+        _featureTileCache->clear();
 }
 
 bool
@@ -211,7 +244,204 @@ FeatureSource::getExtent() const
 FeatureCursor*
 FeatureSource::createFeatureCursor(const Query& query, ProgressCallback* progress)
 {
-    return createFeatureCursorImplementation(query, progress);
+    if (!isTileCacheable(query))
+    {
+        return createFeatureCursorImplementation(query, progress);
+    }
+
+    const TileKey& key = query.tileKey().get();
+
+    // a tile read across a dirty() must not be cached
+    int revision = getRevision();
+
+    FeatureList features;
+    if (readFeatureTile(key, features))
+    {
+        return new FeatureListCursor(features);
+    }
+
+    osg::ref_ptr<FeatureCursor> cursor = createFeatureCursorImplementation(query, progress);
+    if (!cursor.valid())
+    {
+        return NULL;
+    }
+
+    cursor->fill(features);
+
+    // don't cache a partial tile
+    if ((progress == NULL || !progress->isCanceled()) && revision == getRevision())
+    {
+        writeFeatureTile(key, features);
+    }
+
+    return new FeatureListCursor(features);
+}
+
+namespace
+{
+    // No revision in the key: revisions restart in every process, so stale
+    // records are removed from the bin instead (see removeFeatureTiles).
+    std::string makeFeatureTileCacheKey(const TileKey& key)
+    {
+        return Cache::makeCacheKey(
+            key.str() + "-" + key.getProfile()->getHorizSignature(),
+            "features");
+    }
+}
+
+bool
+FeatureSource::isTileCacheable(const Query& query) const
+{
+    // Only plain tile queries; anything else is too specific to be
+    // worth remembering.
+    return
+        _featureTileCache.valid() &&
+        !isWritable() &&
+        query.tileKey().isSet() &&
+        !query.bounds().isSet() &&
+        !query.expression().isSet() &&
+        !query.orderby().isSet() &&
+        !query.limit().isSet();
+}
+
+bool
+FeatureSource::readFeatureTile(const TileKey& key, FeatureList& output)
+{
+    if (_featureTileCache->get(key, output))
+    {
+        // the blacklist may have grown since the tile was cached
+        if (_blacklistSize > 0u)
+        {
+            for (FeatureList::iterator i = output.begin(); i != output.end(); )
+            {
+                if (isBlacklisted(i->get()->getFID()))
+                    i = output.erase(i);
+                else
+                    ++i;
+            }
+        }
+        return true;
+    }
+
+    CacheSettings* cacheSettings = getCacheSettings();
+    CacheBin* bin = cacheSettings ? cacheSettings->getCacheBin() : NULL;
+    if (bin == NULL || !cacheSettings->cachePolicy()->isCacheReadable())
+    {
+        return false;
+    }
+
+    ReadResult r = bin->readString(makeFeatureTileCacheKey(key), getReadOptions());
+    if (r.failed() || cacheSettings->cachePolicy()->isExpired(r.lastModifiedTime()))
+    {
+        return false;
+    }
+
+    FeatureList features;
+    if (!FeatureTileCache::read(r.getString(), getFeatureProfile(), features))
+    {
+        OE_DEBUG << LC << key.str() << " - ignoring unreadable feature tile record" << std::endl;
+        return false;
+    }
+
+    _featureTileCache->put(key, features);
+
+    for (FeatureList::const_iterator i = features.begin(); i != features.end(); ++i)
+    {
+        if (!isBlacklisted(i->get()->getFID()))
+            output.push_back(i->get());
+    }
+    return true;
+}
+
+void
+FeatureSource::writeFeatureTile(const TileKey& key, const FeatureList& features)
+{
+    _featureTileCache->put(key, features);
+
+    // The persistent record has to describe the whole tile, so only
+    // write it while nothing is blacklisted.
+    CacheSettings* cacheSettings = getCacheSettings();
+    CacheBin* bin = cacheSettings ? cacheSettings->getCacheBin() : NULL;
+    if (bin == NULL || !cacheSettings->cachePolicy()->isCacheWriteable() || _blacklistSize > 0u)
+    {
+        return;
+    }
+
+    std::string buf;
+    if (FeatureTileCache::write(features, buf))
+    {
+        osg::ref_ptr<StringObject> record = new StringObject();
+        record->setString(buf);
+        bin->write(makeFeatureTileCacheKey(key), record.get(), getReadOptions());
+    }
+}
+
+void
+FeatureSource::dirty()
+{
+    bumpRevision();
+
+    // everything may have changed, persisted tiles included
+    removeFeatureTiles(GeoExtent::INVALID);
+}
+
+void
+FeatureSource::removeFeatureTiles(const GeoExtent& extent)
+{
+    if (!_featureTileCache.valid())
+        return;
+
+    if (extent.isValid())
+        _featureTileCache->remove(extent);
+    else
+        _featureTileCache->clear();
+
+    // Persisted tiles: drop the records for the intersecting keys at every
+    // level. That is a handful of keys for a local edit; past a modest
+    // count (or with no extent at all) it is cheaper to empty the bin.
+    CacheSettings* cacheSettings = getCacheSettings();
+    CacheBin* bin = cacheSettings ? cacheSettings->getCacheBin() : NULL;
+    const FeatureProfile* fp = getFeatureProfile();
+
+    if (bin && fp && fp->getTilingProfile() && cacheSettings->cachePolicy()->isCacheWriteable())
+    {
+        const unsigned maxKeys = 1024u;
+        std::vector<TileKey> keys;
+
+        if (extent.isValid())
+        {
+            for (int lod = fp->getFirstLevel(); lod <= fp->getMaxLevel() && keys.size() <= maxKeys; ++lod)
+            {
+                fp->getTilingProfile()->getIntersectingTiles(extent, lod, keys);
+            }
+        }
+
+        if (extent.isValid() && keys.size() <= maxKeys)
+        {
+            for (std::vector<TileKey>::const_iterator key = keys.begin(); key != keys.end(); ++key)
+            {
+                bin->remove(makeFeatureTileCacheKey(*key));
+            }
+        }
+        else
+        {
+            bin->clear();
+        }
+    }
+}
+
+void
+FeatureSource::dirtyFeatures(const GeoExtent& extent, const std::vector<FeatureID>& fids)
+{
+    bumpRevision();
+
+    removeFeatureTiles(extent);
+
+    for (CallbackVector::iterator i = _callbacks.begin(); i != _callbacks.end(); ++i)
+    {
+        FeatureSourceCallback* cb = dynamic_cast<FeatureSourceCallback*>(i->get());
+        if (cb) cb->onFeaturesChanged(this, extent, fids);
+    }
 }
 
 namespace
@@ -372,3 +602,53 @@ FeatureSource::getKeys(
 
     return output.size();
 }
+
+bool
+FeatureSource::readGeoJSON(const std::string& buffer, FeatureList& output) const
+{
+    GeoJSONReader reader;
+    reader.setFeatureProfile(getFeatureProfile());
+    reader.setRewindPolygons(options().rewindPolygons().get());
+
+    if (options().attributes().isSet() || options().geometryOnly() == true)
+    {
+        std::set<std::string> attributes;
+        if (options().attributes().isSet())
+        {
+            StringVector names;
+            StringTokenizer(options().attributes().get(), names, ", ", "", false, true);
+            attributes.insert(names.begin(), names.end());
+        }
+
+        // the FID attribute has to survive the projection
+        if (options().fidAttribute().isSet())
+        {
+            attributes.insert(options().fidAttribute().get());
+        }
+
+        if (options().geometryOnly() == true && attributes.empty())
+        {
+            reader.setGeometryOnly(true);
+        }
+        else
+        {
+            reader.setAttributes(attributes);
+        }
+    }
+
+    FeatureList features;
+    if (!reader.read(buffer, features))
+    {
+        OE_DEBUG << LC << "Native GeoJSON read failed (" << reader.getErrorMessage() << ")" << std::endl;
+        return false;
+    }
+
+    for (FeatureList::iterator i = features.begin(); i != features.end(); ++i)
+    {
+        if (!isBlacklisted(i->get()->getFID()))
+        {
+            output.push_back(i->get());
+        }
+    }
+    return true;
+}
@@ -27,24 +27,6 @@ using namespace osgEarth;
 //#undef  OE_DEBUG
 //#define OE_DEBUG OE_INFO
 
-namespace
-{
-    // nifty template to iterate over a map's keys
-    template<typename T>
-    struct KeyIter : public std::iterator<std::input_iterator_tag, typename T::value_type>
-    {
-		typename T::const_iterator it;
-        KeyIter(typename T::const_iterator i) : it(i) { }
-		KeyIter &operator++() {	++it; return *this;	}
-		KeyIter operator++(int) { KeyIter t = *this; ++*this; return t; }
-
-		typename T::key_type const *operator->() const { return &(it->first); }
-		typename T::key_type const &operator*() const {	return it->first; }
-		friend bool operator==(KeyIter const &a, KeyIter const &b) { return a.it == b.it; }
-		friend bool operator!=(KeyIter const &a, KeyIter const &b) { return a.it != b.it; }
-    };
-}
-
 //-----------------------------------------------------------------------------
 
 
@@ -70,73 +52,130 @@ FeatureSourceIndexOptions::getConfig() const
 #undef  LC
 #define LC "[FeatureSourceIndexNode] "
 
-FeatureSourceIndexNode::FeatureSourceIndexNode()
+FeatureSourceIndexNode::FeatureSourceIndexNode() :
+_refsHeld( true )
 {
     //nop
 }
 
 FeatureSourceIndexNode::FeatureSourceIndexNode(const FeatureSourceIndexNode& rhs, const osg::CopyOp& copy) :
-osg::Group(rhs, copy)
+osg::Group(rhs, copy),
+_refsHeld( false )
 {
     _index = rhs._index.get();
     _fids  = rhs._fids;
+
+    // the copy holds its own references to the index entries, but only if
+    // the original did; otherwise it waits for reIndex() like the original.
+    if ( _index.valid() && rhs._refsHeld )
+    {
+        _index->addRefs( _fids );
+        _refsHeld = true;
+    }
+    else
+    {
+        _refsHeld = _fids.empty();
+    }
 }
 
 FeatureSourceIndexNode::FeatureSourceIndexNode(FeatureSourceIndex* index) :
-_index( index )
+_index( index ),
+_refsHeld( true )
 {
     //nop
 }
 
 FeatureSourceIndexNode::~FeatureSourceIndexNode()
 {
-    if ( _index.valid() )
+    releaseRefs();
+}
+
+void
+FeatureSourceIndexNode::releaseRefs()
+{
+    // Only give back references this node actually took; a node whose FID
+    // map was set by the deserializer never registered its FIDs, and
+    // removing them would steal references owned by other nodes.
+    if ( _index.valid() && _refsHeld && !_fids.empty() )
     {
-        // must copy and clear the original list first to dereference the RefIDPair instances.
-        std::set<FeatureID> fidsToRemove;
-        fidsToRemove.insert(KeyIter<FIDMap>(_fids.begin()), KeyIter<FIDMap>(_fids.end()));
-        _fids.clear();
+        std::vector<FeatureID> fidsToRemove;
+        fidsToRemove.reserve(_fids.size());
+        for (FIDMap::const_iterator i = _fids.begin(); i != _fids.end(); ++i)
+            fidsToRemove.push_back(i->first);
 
         OE_DEBUG << LC << "Removing " << fidsToRemove.size() << " fids\n";
         _index->removeFIDs( fidsToRemove.begin(), fidsToRemove.end() );
     }
 }
 
+void
+FeatureSourceIndexNode::setIndex(FeatureSourceIndex* index)
+{
+    if ( index == _index.get() )
+        return;
+
+    releaseRefs();
+    _index = index;
+
+    // refs on the new index are taken by reIndex().
+    _refsHeld = _fids.empty();
+}
+
+// Each node holds exactly one reference per FID in the index. If this node
+// already knows the feature, just tag the geometry with the existing ObjectID.
+
 ObjectID
 FeatureSourceIndexNode::tagDrawable(osg::Drawable* drawable, Feature* feature)
 {
     if ( !feature || !_index.valid() ) return OSGEARTH_OBJECTID_EMPTY;
-    RefIDPair* r = _index->tagDrawable( drawable, feature );
-    if ( r ) _fids[ feature->getFID() ] = r;
-    return r ? r->_oid : OSGEARTH_OBJECTID_EMPTY;
+    FIDMap::const_iterator f = _fids.find( feature->getFID() );
+    if ( f != _fids.end() )
+    {
+        _index->_masterIndex->tagDrawable( drawable, f->second );
+        return f->second;
+    }
+    ObjectID oid = _index->tagDrawable( drawable, feature );
+    if ( oid != OSGEARTH_OBJECTID_EMPTY ) _fids[ feature->getFID() ] = oid;
+    return oid;
 }
 
 ObjectID
 FeatureSourceIndexNode::tagAllDrawables(osg::Node* node, Feature* feature)
 {
     if ( !feature || !_index.valid() ) return OSGEARTH_OBJECTID_EMPTY;
-    RefIDPair* r = _index->tagAllDrawables( node, feature );
-    if ( r ) _fids[ feature->getFID() ] = r;
-    return r ? r->_oid : OSGEARTH_OBJECTID_EMPTY;
+    FIDMap::const_iterator f = _fids.find( feature->getFID() );
+    if ( f != _fids.end() )
+    {
+        _index->_masterIndex->tagAllDrawables( node, f->second );
+        return f->second;
+    }
+    ObjectID oid = _index->tagAllDrawables( node, feature );
+    if ( oid != OSGEARTH_OBJECTID_EMPTY ) _fids[ feature->getFID() ] = oid;
+    return oid;
 }
 
 ObjectID
 FeatureSourceIndexNode::tagNode(osg::Node* node, Feature* feature)
 {
     if ( !feature || !_index.valid() ) return OSGEARTH_OBJECTID_EMPTY;
-    RefIDPair* r = _index->tagNode( node, feature );
-    if ( r ) _fids[ feature->getFID() ] = r;
-    return r ? r->_oid : OSGEARTH_OBJECTID_EMPTY;
+    FIDMap::const_iterator f = _fids.find( feature->getFID() );
+    if ( f != _fids.end() )
+    {
+        _index->_masterIndex->tagNode( node, f->second );
+        return f->second;
+    }
+    ObjectID oid = _index->tagNode( node, feature );
+    if ( oid != OSGEARTH_OBJECTID_EMPTY ) _fids[ feature->getFID() ] = oid;
+    return oid;
 }
 
 bool
 FeatureSourceIndexNode::getAllFIDs(std::vector<FeatureID>& output) const
 {
-    KeyIter<FIDMap> start( _fids.begin() );
-    KeyIter<FIDMap> end  ( _fids.end() );
-    for(KeyIter<FIDMap> i = start; i != end; ++i )
+    output.reserve( output.size() + _fids.size() );
+    for(FIDMap::const_iterator i = _fids.begin(); i != _fids.end(); ++i )
     {
-        output.push_back( *i );
+        output.push_back( i->first );
     }
 
     return true;
@@ -145,7 +184,12 @@ FeatureSourceIndexNode::getAllFIDs(std::vector<FeatureID>& output) const
 void
 FeatureSourceIndexNode::setFIDMap(const FeatureSourceIndexNode::FIDMap& fids)
 {
+    releaseRefs();
     _fids = fids;
+
+    // The ObjectIDs in a deserialized map are stale, so registering them now
+    // would install bogus mappings; reIndex() takes the refs instead.
+    _refsHeld = _fids.empty();
 }
 
 namespace
@@ -155,7 +199,7 @@ namespace
     struct Reconstitute : public osg::NodeVisitor
     {
         FeatureSourceIndex* _index;
-        std::map<ObjectID,ObjectID> _oldToNew;
+        ObjectIndex::ObjectIDMapping _oldToNew;
 
         Reconstitute(FeatureSourceIndex* index) :
             _index(index)
@@ -181,10 +225,9 @@ namespace
     struct ReIndex : public osg::NodeVisitor
     {
         FeatureSourceIndexNode*        _indexNode;
-        FeatureSourceIndexNode::FIDMap _newFIDMap;
-        std::map<ObjectID,ObjectID>&   _oldToNew;
+        ObjectIndex::ObjectIDMapping&  _oldToNew;
 
-        ReIndex(FeatureSourceIndexNode* indexNode, std::map<ObjectID,ObjectID>& oldToNew) :
+        ReIndex(FeatureSourceIndexNode* indexNode, ObjectIndex::ObjectIDMapping& oldToNew) :
             _indexNode(indexNode), _oldToNew(oldToNew)
         {
             setTraversalMode(TRAVERSE_ALL_CHILDREN);
@@ -193,19 +236,23 @@ namespace
 
         void apply(osg::Node& node)
         {
-            _indexNode->reIndexNode(&node, _oldToNew, _newFIDMap);
+            _indexNode->reIndexNode(&node, _oldToNew);
             traverse(node);
         }
 
         void apply(osg::Geode& geode)
         {
-            _indexNode->reIndexNode(&geode, _oldToNew, _newFIDMap);
-            for (unsigned i = 0; i < geode.getNumDrawables(); ++i)
-            {
-                _indexNode->reIndexDrawable(geode.getDrawable(i), _oldToNew, _newFIDMap);
-            }
+            // the traversal visits the drawables (see below)
+            _indexNode->reIndexNode(&geode, _oldToNew);
             traverse(geode);
         }
+
+        void apply(osg::Drawable& drawable)
+        {
+            // drawables can sit under any group, not only a Geode
+            _indexNode->reIndexNode(&drawable, _oldToNew);
+            _indexNode->reIndexDrawable(&drawable, _oldToNew);
+        }
     };
 }
 
@@ -222,29 +269,51 @@ FeatureSourceIndexNode::reconstitute(osg::Node* graph, FeatureSourceIndex* index
     graph->accept(visitor);
 }
 
+// When Feature index data is deserialized, the old serialized ObjectIDs are
+// no longer valid. The visitor re-tags the geometry with new ObjectIDs
+// (recording old->new in "oidmappings"); then a single pass over this node's
+// FID table translates it and re-installs the mappings in the index.
 void
-FeatureSourceIndexNode::reIndex(std::map<ObjectID,ObjectID>& oidmappings)
+FeatureSourceIndexNode::reIndex(ObjectIndex::ObjectIDMapping& oidmappings)
 {
     ReIndex visitor(this, oidmappings);
     this->accept(visitor);
-    _fids = visitor._newFIDMap;
+
+    // drop any refs held under the old ObjectIDs before taking new ones
+    releaseRefs();
+
+    FIDMap newFIDMap;
+    newFIDMap.reserve(_fids.size());
+    for (FIDMap::const_iterator i = _fids.begin(); i != _fids.end(); ++i)
+    {
+        ObjectIndex::ObjectIDMapping::const_iterator k = oidmappings.find(i->second);
+        if (k != oidmappings.end())
+            newFIDMap[i->first] = k->second;
+    }
+    _fids = newFIDMap;
+
+    if (_index.valid())
+        _index->addRefs(_fids);
+
+    _refsHeld = _index.valid() || _fids.empty();
+
     //OE_INFO << LC << "Reindexed " << _fids.size() << " mappings\n";
 }
 
 void
-FeatureSourceIndexNode::reIndexDrawable(osg::Drawable* drawable, std::map<ObjectID,ObjectID>& oldNew, FIDMap& newFIDMap)
+FeatureSourceIndexNode::reIndexDrawable(osg::Drawable* drawable, ObjectIndex::ObjectIDMapping& oldNew)
 {
     if ( !drawable || !_index.valid() ) return;
 
-    _index->update(drawable, oldNew, _fids, newFIDMap);
+    _index->_masterIndex->updateObjectIDs(drawable, oldNew, _index.get());
 }
 
 void
-FeatureSourceIndexNode::reIndexNode(osg::Node* node, std::map<ObjectID,ObjectID>& oldNew, FIDMap& newFIDMap)
+FeatureSourceIndexNode::reIndexNode(osg::Node* node, ObjectIndex::ObjectIDMapping& oldNew)
 {
     if (!node || !_index.valid()) return;
 
-    _index->update(node, oldNew, _fids, newFIDMap);
+    _index->_masterIndex->updateObjectID(node, oldNew, _index.get());
 }
 
 FeatureSourceIndexNode* FeatureSourceIndexNode::get(osg::Node* graph)
@@ -280,8 +349,7 @@ namespace osgEarth { namespace Serializers { namespace FeatureSourceIndexNodeCla
         {
             for (FeatureSourceIndexNode::FIDMap::const_iterator i = fids.begin(); i != fids.end(); ++i)
             {
-                const RefIDPair* idPair = i->second.get();
-                os << (double)idPair->_fid << idPair->_oid;
+                os << (double)i->first << i->second;
             }
         }
         os << os.END_BRACKET << std::endl;
@@ -297,12 +365,13 @@ namespace osgEarth { namespace Serializers { namespace FeatureSourceIndexNodeCla
         ObjectID oid;
 
         unsigned size = is.readSize();
+        fids.reserve(size);
         is >> is.BEGIN_BRACKET;
         {
             for (unsigned i=0; i<size; ++i)
             {
                 is >> fid >> oid;
-                fids[fid] = new RefIDPair(fid, oid);
+                fids[(FeatureID)fid] = oid;
             }
         }
         is >> is.END_BRACKET;
@@ -346,7 +415,11 @@ FeatureSourceIndex::~FeatureSourceIndex()
     if ( _masterIndex.valid() && !_oids.empty() )
     {
         // remove all OIDs from the master index.
-        _masterIndex->remove( KeyIter<OIDMap>(_oids.begin()), KeyIter<OIDMap>(_oids.end()) );
+        std::vector<ObjectID> oids;
+        oids.reserve(_oids.size());
+        for (OIDMap::const_iterator i = _oids.begin(); i != _oids.end(); ++i)
+            oids.push_back(i->first);
+        _masterIndex->remove( oids.begin(), oids.end() );
     }
 
     _oids.clear();
@@ -354,28 +427,36 @@ FeatureSourceIndex::~FeatureSourceIndex()
     _embeddedFeatures.clear();
 }
 
-RefIDPair*
+int
+FeatureSourceIndex::size() const
+{
+    Threading::ScopedReadLock lock(_mutex);
+    return _fids.size();
+}
+
+ObjectID
 FeatureSourceIndex::tagDrawable(osg::Drawable* drawable, Feature* feature)
 {
-    if ( !feature ) return 0L;
+    if ( !feature ) return OSGEARTH_OBJECTID_EMPTY;
 
-    Threading::ScopedMutexLock lock(_mutex);
+    Threading::ScopedWriteLock lock(_mutex);
 
-    RefIDPair* p = 0L;
+    ObjectID oid;
     FeatureID fid = feature->getFID();
 
-    FIDMap::const_iterator f = _fids.find( fid );
+    FIDMap::iterator f = _fids.find( fid );
     if ( f != _fids.end() )
     {
-        ObjectID oid = f->second->_oid;
+        oid = f->second._oid;
+        ++f->second._refs;
         _masterIndex->tagDrawable( drawable, oid );
-        p = f->second.get();
     }
     else
     {
-        ObjectID oid = _masterIndex->tagDrawable( drawable, this );
-        p = new RefIDPair( fid, oid );
-        _fids[fid] = p;
+        oid = _masterIndex->tagDrawable( drawable, this );
+        FIDEntry& entry = _fids[fid];
+        entry._oid = oid;
+        entry._refs = 1u;
         _oids[oid] = fid;
 
         if ( _embed )
@@ -384,31 +465,32 @@ FeatureSourceIndex::tagDrawable(osg::Drawable* drawable, Feature* feature)
         }
     }
 
-    return p;
+    return oid;
 }
 
-RefIDPair*
+ObjectID
 FeatureSourceIndex::tagAllDrawables(osg::Node* node, Feature* feature)
 {
-    if ( !feature ) return 0L;
+    if ( !feature ) return OSGEARTH_OBJECTID_EMPTY;
 
-    Threading::ScopedMutexLock lock(_mutex);
+    Threading::ScopedWriteLock lock(_mutex);
 
-    RefIDPair* p = 0L;
+    ObjectID oid;
     FeatureID fid = feature->getFID();
 
-    FIDMap::const_iterator f = _fids.find( fid );
+    FIDMap::iterator f = _fids.find( fid );
     if ( f != _fids.end() )
     {
-        ObjectID oid = f->second->_oid;
+        oid = f->second._oid;
+        ++f->second._refs;
         _masterIndex->tagAllDrawables( node, oid );
-        p = f->second.get();
     }
     else
     {
-        ObjectID oid = _masterIndex->tagAllDrawables( node, this );
-        p = new RefIDPair( fid, oid );
-        _fids[fid] = p;
+        oid = _masterIndex->tagAllDrawables( node, this );
+        FIDEntry& entry = _fids[fid];
+        entry._oid = oid;
+        entry._refs = 1u;
         _oids[oid] = fid;
 
         if ( _embed )
@@ -417,32 +499,32 @@ FeatureSourceIndex::tagAllDrawables(osg::Node* node, Feature* feature)
         }
     }
 
-    return p;
+    return oid;
 }
 
-RefIDPair*
+ObjectID
 FeatureSourceIndex::tagNode(osg::Node* node, Feature* feature)
 {
-    if ( !feature ) return 0L;
+    if ( !feature ) return OSGEARTH_OBJECTID_EMPTY;
 
-    Threading::ScopedMutexLock lock(_mutex);
+    Threading::ScopedWriteLock lock(_mutex);
 
-    RefIDPair* p = 0L;
-    FeatureID fid = feature->getFID();
     ObjectID oid;
+    FeatureID fid = feature->getFID();
 
-    FIDMap::const_iterator f = _fids.find( fid );
+    FIDMap::iterator f = _fids.find( fid );
     if ( f != _fids.end() )
     {
-        oid = f->second->_oid;
+        oid = f->second._oid;
+        ++f->second._refs;
         _masterIndex->tagNode( node, oid );
-        p = f->second.get();
     }
     else
     {
         oid = _masterIndex->tagNode( node, this );
-        p = new RefIDPair( fid, oid );
-        _fids[fid] = p;
+        FIDEntry& entry = _fids[fid];
+        entry._oid = oid;
+        entry._refs = 1u;
         _oids[oid] = fid;
 
         if ( _embed )
@@ -453,99 +535,68 @@ FeatureSourceIndex::tagNode(osg::Node* node, Feature* feature)
 
     OE_DEBUG << LC << "Tagging feature ID = " << fid << " => " << oid << " (" << feature->getString("name") << ")\n";
 
-    return p;
+    return oid;
+}
+
+void
+FeatureSourceIndex::addRefs(const flat_hash_map<FeatureID, ObjectID>& fids)
+{
+    Threading::ScopedWriteLock lock(_mutex);
+
+    for (flat_hash_map<FeatureID, ObjectID>::const_iterator i = fids.begin(); i != fids.end(); ++i)
+    {
+        FIDEntry& entry = _fids[i->first];
+        if ( entry._refs == 0u )
+        {
+            entry._oid = i->second;
+        }
+        else if ( i->second != entry._oid &&
+                  std::find(entry._aliases.begin(), entry._aliases.end(), i->second) == entry._aliases.end() )
+        {
+            entry._aliases.push_back( i->second );
+        }
+
+        // always map the OID, since picking on this node's geometry yields it
+        _oids[i->second] = i->first;
+        ++entry._refs;
+    }
 }
 
 Feature*
 FeatureSourceIndex::getFeature(ObjectID oid) const
 {
     Feature* feature = 0L;
-    Threading::ScopedMutexLock lock(_mutex);
-    OIDMap::const_iterator i = _oids.find( oid );
-    if ( i != _oids.end() )
+    FeatureID fid;
     {
-        FeatureID fid = i->second;
+        Threading::ScopedReadLock lock(_mutex);
+        OIDMap::const_iterator i = _oids.find( oid );
+        if ( i == _oids.end() )
+            return 0L;
+
+        fid = i->second;
 
         if ( _embed )
         {
             FeatureMap::const_iterator j = _embeddedFeatures.find( fid );
-            feature = j != _embeddedFeatures.end() ? j->second.get() : 0L;
-        }
-        else if ( _featureSource.valid() && _featureSource->supportsGetFeature() )
-        {
-            feature = _featureSource->getFeature( fid );
+            return j != _embeddedFeatures.end() ? j->second.get() : 0L;
         }
     }
+
+    // query the source outside the lock so slow sources don't block tagging
+    if ( _featureSource.valid() && _featureSource->supportsGetFeature() )
+    {
+        feature = _featureSource->getFeature( fid );
+    }
     return feature;
 }
 
 ObjectID
 FeatureSourceIndex::getObjectID(FeatureID fid) const
 {
-    Threading::ScopedMutexLock lock(_mutex);
+    Threading::ScopedReadLock lock(_mutex);
     FIDMap::const_iterator i = _fids.find(fid);
     if ( i != _fids.end() )
-        return i->second->_oid;
+        return i->second._oid;
     else
         return OSGEARTH_OBJECTID_EMPTY;
 }
-
-// When Feature index data is deserialized, the old serialized ObjectIDs are
-// no longer valid. This method will re-install the mappings in the master index
-// and write new local mappings with new ObjectIDs.
-void
-FeatureSourceIndex::update(osg::Drawable* drawable, std::map<ObjectID,ObjectID>& oldToNew, const FIDMap& oldFIDMap, FIDMap& newFIDMap)
-{
-    unsigned count = 0;
-    if (_masterIndex->updateObjectIDs(drawable, oldToNew, this))
-    {
-        for (std::map<ObjectID, ObjectID>::const_iterator i = oldToNew.begin(); i != oldToNew.end(); ++i)
-        {
-            const ObjectID& oldoid = i->first;
-            const ObjectID& newoid = i->second;
-
-            for (FIDMap::const_iterator j = oldFIDMap.begin(); j != oldFIDMap.end(); ++j)
-            {
-                const RefIDPair* rip = j->second.get();
-                if (rip && rip->_oid == oldoid)
-                {
-                    RefIDPair* newrip = new RefIDPair(rip->_fid, newoid);
-                    _oids[newoid] = rip->_fid;
-                    _fids[rip->_fid] = newrip;
-                    newFIDMap[rip->_fid] = newrip;
-                    ++count;
-                }
-            }
-        }
-    }
-}
-
-// When Feature index data is deserialized, the old serialized ObjectIDs are
-// no longer valid. This method will re-install the mappings in the master index
-// and write new local mappings with new ObjectIDs.
-void
-FeatureSourceIndex::update(osg::Node* node, std::map<ObjectID,ObjectID>& oldToNew, const FIDMap& oldFIDMap, FIDMap& newFIDMap)
-{
-    unsigned count = 0;
-    if (_masterIndex->updateObjectID(node, oldToNew, this))
-    {
-        for (std::map<ObjectID, ObjectID>::const_iterator i = oldToNew.begin(); i != oldToNew.end(); ++i)
-        {
-            const ObjectID& oldoid = i->first;
-            const ObjectID& newoid = i->second;
-
-            for (FIDMap::const_iterator j = oldFIDMap.begin(); j != oldFIDMap.end(); ++j)
-            {
-                const RefIDPair* rip = j->second.get();
-                if (rip && rip->_oid == oldoid)
-                {
-                    RefIDPair* newrip = new RefIDPair(rip->_fid, newoid);
-                    _oids[newoid] = rip->_fid;
-                    _fids[rip->_fid] = newrip;
-                    newFIDMap[rip->_fid] = newrip;
-                    ++count;
-                }
-            }
-        }
-    }
-}
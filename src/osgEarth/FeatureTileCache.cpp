@@ -0,0 +1,584 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/FeatureTileCache>
+#include <osgEarth/Endian>
+#include <cstring>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    const char MAGIC[4] = { 'O', 'E', 'F', 'L' };
+    const std::uint16_t VERSION = 1;
+
+    // magic, version, reserved, feature count
+    const std::size_t HEADER_SIZE = 4 + 2 + 2 + 4;
+
+    // deepest multi-geometry nesting read() will follow
+    const unsigned MAX_DEPTH = 8u;
+
+    enum FeatureFlags
+    {
+        FLAG_HAS_GEOMETRY = 1 << 0
+    };
+
+    struct Writer
+    {
+        std::string& out;
+        Writer(std::string& s) : out(s) { }
+
+        void put8(std::uint8_t value)
+        {
+            out.push_back((char)value);
+        }
+
+        void put16(std::uint16_t value)
+        {
+            value = OE_ENCODE_SHORT(value);
+            out.append((const char*)&value, 2);
+        }
+
+        void put32(std::uint32_t value)
+        {
+            value = OE_ENCODE_INT(value);
+            out.append((const char*)&value, 4);
+        }
+
+        void put64(std::uint64_t value)
+        {
+            value = htobe64(value);
+            out.append((const char*)&value, 8);
+        }
+
+        void putDouble(double value)
+        {
+            std::uint64_t bits = OE_ENCODE_DOUBLE(value);
+            out.append((const char*)&bits, 8);
+        }
+
+        void putString(const std::string& value)
+        {
+            put32((std::uint32_t)value.size());
+            out.append(value);
+        }
+
+        void putPoints(const Geometry* geom)
+        {
+            put32((std::uint32_t)geom->size());
+            for (Geometry::const_iterator p = geom->begin(); p != geom->end(); ++p)
+            {
+                putDouble(p->x());
+                putDouble(p->y());
+                putDouble(p->z());
+            }
+        }
+
+        void putGeometry(const Geometry* geom)
+        {
+            put8((std::uint8_t)geom->getType());
+
+            if (geom->getType() == Geometry::TYPE_MULTI)
+            {
+                const GeometryCollection& parts = static_cast<const MultiGeometry*>(geom)->getComponents();
+                std::uint32_t count = 0u;
+                for (GeometryCollection::const_iterator i = parts.begin(); i != parts.end(); ++i)
+                    if (i->valid()) ++count;
+                put32(count);
+                for (GeometryCollection::const_iterator i = parts.begin(); i != parts.end(); ++i)
+                    if (i->valid()) putGeometry(i->get());
+                return;
+            }
+
+            putPoints(geom);
+
+            if (geom->getType() == Geometry::TYPE_POLYGON)
+            {
+                const RingCollection& holes = static_cast<const Polygon*>(geom)->getHoles();
+                std::uint32_t count = 0u;
+                for (RingCollection::const_iterator h = holes.begin(); h != holes.end(); ++h)
+                    if (h->valid()) ++count;
+                put32(count);
+                for (RingCollection::const_iterator h = holes.begin(); h != holes.end(); ++h)
+                    if (h->valid()) putPoints(h->get());
+            }
+        }
+    };
+
+    struct Reader
+    {
+        const char* p;
+        const char* end;
+        Reader(const std::string& s) : p(s.data()), end(s.data() + s.size()) { }
+
+        bool has(std::size_t n) const
+        {
+            return (std::size_t)(end - p) >= n;
+        }
+
+        bool get8(std::uint8_t& value)
+        {
+            if (!has(1)) return false;
+            value = (std::uint8_t)*p++;
+            return true;
+        }
+
+        bool get16(std::uint16_t& value)
+        {
+            if (!has(2)) return false;
+            ::memcpy(&value, p, 2); p += 2;
+            value = OE_DECODE_SHORT(value);
+            return true;
+        }
+
+        bool get32(std::uint32_t& value)
+        {
+            if (!has(4)) return false;
+            ::memcpy(&value, p, 4); p += 4;
+            value = OE_DECODE_INT(value);
+            return true;
+        }
+
+        bool get64(std::uint64_t& value)
+        {
+            if (!has(8)) return false;
+            ::memcpy(&value, p, 8); p += 8;
+            value = be64toh(value);
+            return true;
+        }
+
+        bool getDouble(double& value)
+        {
+            if (!has(8)) return false;
+            std::uint64_t bits;
+            ::memcpy(&bits, p, 8); p += 8;
+            value = OE_DECODE_DOUBLE(bits);
+            return true;
+        }
+
+        bool getString(std::string& value)
+        {
+            std::uint32_t length;
+            if (!get32(length) || !has(length)) return false;
+            value.assign(p, length);
+            p += length;
+            return true;
+        }
+
+        bool getPoints(Geometry* geom)
+        {
+            std::uint32_t count;
+            if (!get32(count) || !has((std::size_t)count * 24u)) return false;
+            geom->resize(count);
+            for (std::uint32_t i = 0; i < count; ++i)
+            {
+                osg::Vec3d& v = (*geom)[i];
+                getDouble(v.x());
+                getDouble(v.y());
+                getDouble(v.z());
+            }
+            return true;
+        }
+
+        Geometry* getGeometry(unsigned depth)
+        {
+            std::uint8_t type;
+            if (depth > MAX_DEPTH || !get8(type))
+                return 0L;
+
+            osg::ref_ptr<Geometry> geom;
+            switch (type)
+            {
+            case Geometry::TYPE_POINT:      geom = new Point(); break;
+            case Geometry::TYPE_POINTSET:   geom = new PointSet(); break;
+            case Geometry::TYPE_LINESTRING: geom = new LineString(); break;
+            case Geometry::TYPE_RING:       geom = new Ring(); break;
+            case Geometry::TYPE_POLYGON:    geom = new Polygon(); break;
+            case Geometry::TYPE_MULTI:
+            {
+                osg::ref_ptr<MultiGeometry> multi = new MultiGeometry();
+                std::uint32_t count;
+                if (!get32(count)) return 0L;
+                for (std::uint32_t i = 0; i < count; ++i)
+                {
+                    Geometry* part = getGeometry(depth + 1u);
+                    if (!part) return 0L;
+                    multi->add(part);
+                }
+                return multi.release();
+            }
+            default:
+                return 0L;
+            }
+
+            if (!getPoints(geom.get()))
+                return 0L;
+
+            if (type == Geometry::TYPE_POLYGON)
+            {
+                std::uint32_t count;
+                if (!get32(count)) return 0L;
+                Polygon* poly = static_cast<Polygon*>(geom.get());
+                for (std::uint32_t i = 0; i < count; ++i)
+                {
+                    osg::ref_ptr<Ring> hole = new Ring();
+                    if (!getPoints(hole.get())) return 0L;
+                    poly->getHoles().push_back(hole.get());
+                }
+            }
+
+            return geom.release();
+        }
+    };
+
+    std::size_t geometrySize(const Geometry* geom)
+    {
+        std::size_t bytes = sizeof(Geometry) + geom->size() * sizeof(osg::Vec3d);
+        if (geom->getType() == Geometry::TYPE_MULTI)
+        {
+            const GeometryCollection& parts = static_cast<const MultiGeometry*>(geom)->getComponents();
+            for (GeometryCollection::const_iterator i = parts.begin(); i != parts.end(); ++i)
+                if (i->valid()) bytes += geometrySize(i->get());
+        }
+        else if (geom->getType() == Geometry::TYPE_POLYGON)
+        {
+            const RingCollection& holes = static_cast<const Polygon*>(geom)->getHoles();
+            for (RingCollection::const_iterator h = holes.begin(); h != holes.end(); ++h)
+                if (h->valid()) bytes += geometrySize(h->get());
+        }
+        return bytes;
+    }
+}
+
+//........................................................................
+
+FeatureTileCache::FeatureTileCache(std::size_t maxBytes) :
+    _maxBytes(maxBytes),
+    _bytes(0u),
+    _hits(0u),
+    _misses(0u),
+    _mutex("OE.FeatureTileCache")
+{
+    //nop
+}
+
+bool
+FeatureTileCache::get(const TileKey& key, FeatureList& output)
+{
+    FeatureList features;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+
+        std::unordered_map<TileKey, Entry>::iterator i = _entries.find(key);
+        if (i == _entries.end())
+        {
+            ++_misses;
+            return false;
+        }
+
+        ++_hits;
+        _lru.splice(_lru.begin(), _lru, i->second.lru);
+        features = i->second.features;
+    }
+
+    // copy outside the lock; the cached features themselves are never modified
+    for (FeatureList::const_iterator f = features.begin(); f != features.end(); ++f)
+    {
+        output.push_back(new Feature(*f->get(), osg::CopyOp::DEEP_COPY_ALL));
+    }
+    return true;
+}
+
+void
+FeatureTileCache::put(const TileKey& key, const FeatureList& features)
+{
+    Entry entry;
+    entry.bytes = sizeof(Entry);
+    for (FeatureList::const_iterator f = features.begin(); f != features.end(); ++f)
+    {
+        entry.features.push_back(new Feature(*f->get(), osg::CopyOp::DEEP_COPY_ALL));
+        entry.bytes += getSizeInBytes(f->get());
+    }
+
+    if (entry.bytes > _maxBytes)
+        return;
+
+    Threading::ScopedMutexLock lock(_mutex);
+
+    std::unordered_map<TileKey, Entry>::iterator i = _entries.find(key);
+    if (i != _entries.end())
+    {
+        _bytes -= i->second.bytes;
+        _lru.erase(i->second.lru);
+        _entries.erase(i);
+    }
+
+    while (!_lru.empty() && _bytes + entry.bytes > _maxBytes)
+    {
+        std::unordered_map<TileKey, Entry>::iterator victim = _entries.find(_lru.back());
+        _bytes -= victim->second.bytes;
+        _entries.erase(victim);
+        _lru.pop_back();
+    }
+
+    _lru.push_front(key);
+    _bytes += entry.bytes;
+
+    Entry& slot = _entries[key];
+    slot.features.swap(entry.features);
+    slot.bytes = entry.bytes;
+    slot.lru = _lru.begin();
+}
+
+void
+FeatureTileCache::remove(const GeoExtent& extent)
+{
+    if (!extent.isValid())
+    {
+        clear();
+        return;
+    }
+
+    Threading::ScopedMutexLock lock(_mutex);
+
+    for (std::unordered_map<TileKey, Entry>::iterator i = _entries.begin(); i != _entries.end(); )
+    {
+        if (i->first.getExtent().intersects(extent))
+        {
+            _bytes -= i->second.bytes;
+            _lru.erase(i->second.lru);
+            i = _entries.erase(i);
+        }
+        else ++i;
+    }
+}
+
+void
+FeatureTileCache::clear()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _entries.clear();
+    _lru.clear();
+    _bytes = 0u;
+}
+
+std::size_t
+FeatureTileCache::getSizeInBytes() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _bytes;
+}
+
+std::size_t
+FeatureTileCache::getSizeInBytes(const Feature* feature)
+{
+    std::size_t bytes = sizeof(Feature);
+
+    if (feature->getGeometry())
+        bytes += geometrySize(feature->getGeometry());
+
+    const AttributeTable& attrs = feature->getAttrs();
+    for (AttributeTable::const_iterator a = attrs.begin(); a != attrs.end(); ++a)
+    {
+        // map node overhead, name, and any out-of-line value storage
+        bytes += sizeof(AttributeTable::value_type) + 32u + a->first.size();
+        bytes += a->second.second.stringValue.size();
+        bytes += a->second.second.doubleArrayValue.size() * sizeof(double);
+    }
+
+    return bytes;
+}
+
+bool
+FeatureTileCache::write(const FeatureList& features, std::string& out)
+{
+    out.clear();
+    Writer w(out);
+
+    out.append(MAGIC, 4);
+    w.put16(VERSION);
+    w.put16(0u);
+    w.put32((std::uint32_t)features.size());
+
+    for (FeatureList::const_iterator i = features.begin(); i != features.end(); ++i)
+    {
+        const Feature* feature = i->get();
+
+        // embedded styles are not worth an encoding of their own
+        if (feature->style().isSet())
+        {
+            out.clear();
+            return false;
+        }
+
+        w.put64((std::uint64_t)feature->getFID());
+        w.put8(feature->getGeometry() ? FLAG_HAS_GEOMETRY : 0u);
+        if (feature->getGeometry())
+            w.putGeometry(feature->getGeometry());
+
+        const AttributeTable& attrs = feature->getAttrs();
+        w.put32((std::uint32_t)attrs.size());
+        for (AttributeTable::const_iterator a = attrs.begin(); a != attrs.end(); ++a)
+        {
+            const AttributeValueUnion& value = a->second.second;
+            w.putString(a->first);
+            w.put8((std::uint8_t)a->second.first);
+            w.put8(value.set ? 1u : 0u);
+            if (!value.set)
+                continue;
+
+            switch (a->second.first)
+            {
+            case ATTRTYPE_INT:
+                w.put64((std::uint64_t)value.intValue);
+                break;
+            case ATTRTYPE_DOUBLE:
+                w.putDouble(value.doubleValue);
+                break;
+            case ATTRTYPE_BOOL:
+                w.put8(value.boolValue ? 1u : 0u);
+                break;
+            case ATTRTYPE_DOUBLEARRAY:
+                w.put32((std::uint32_t)value.doubleArrayValue.size());
+                for (std::vector<double>::const_iterator d = value.doubleArrayValue.begin(); d != value.doubleArrayValue.end(); ++d)
+                    w.putDouble(*d);
+                break;
+            default:
+                w.putString(value.stringValue);
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool
+FeatureTileCache::read(const std::string& in, const FeatureProfile* profile, FeatureList& output)
+{
+    if (in.size() < HEADER_SIZE || ::memcmp(in.data(), MAGIC, 4) != 0)
+        return false;
+
+    Reader r(in);
+    r.p += 4;
+
+    std::uint16_t version, reserved;
+    std::uint32_t count;
+    r.get16(version);
+    r.get16(reserved);
+    r.get32(count);
+    if (version != VERSION)
+        return false;
+
+    const SpatialReference* srs = profile ? profile->getSRS() : 0L;
+
+    FeatureList features;
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        std::uint64_t fid;
+        std::uint8_t flags;
+        if (!r.get64(fid) || !r.get8(flags))
+            return false;
+
+        osg::ref_ptr<Geometry> geom;
+        if (flags & FLAG_HAS_GEOMETRY)
+        {
+            geom = r.getGeometry(0u);
+            if (!geom.valid())
+                return false;
+        }
+
+        osg::ref_ptr<Feature> feature = new Feature(geom.get(), srs, Style(), (FeatureID)fid);
+        if (profile && profile->geoInterp().isSet())
+            feature->geoInterp() = profile->geoInterp().get();
+
+        std::uint32_t numAttrs;
+        if (!r.get32(numAttrs))
+            return false;
+
+        std::string name, stringValue;
+        for (std::uint32_t a = 0; a < numAttrs; ++a)
+        {
+            std::uint8_t type, set;
+            if (!r.getString(name) || !r.get8(type) || !r.get8(set) || type > ATTRTYPE_DOUBLEARRAY)
+                return false;
+
+            if (!set)
+            {
+                feature->setNull(name, (AttributeType)type);
+                continue;
+            }
+
+            bool ok = true;
+            switch (type)
+            {
+            case ATTRTYPE_INT:
+            {
+                std::uint64_t value;
+                ok = r.get64(value);
+                feature->set(name, (long long)value);
+                break;
+            }
+            case ATTRTYPE_DOUBLE:
+            {
+                double value = 0.0;
+                ok = r.getDouble(value);
+                feature->set(name, value);
+                break;
+            }
+            case ATTRTYPE_BOOL:
+            {
+                std::uint8_t value = 0u;
+                ok = r.get8(value);
+                feature->set(name, value != 0u);
+                break;
+            }
+            case ATTRTYPE_DOUBLEARRAY:
+            {
+                std::uint32_t size;
+                ok = r.get32(size) && r.has((std::size_t)size * 8u);
+                if (ok)
+                {
+                    std::vector<double> values(size);
+                    for (std::uint32_t d = 0; d < size; ++d)
+                        r.getDouble(values[d]);
+                    feature->set(name, values);
+                }
+                break;
+            }
+            default:
+                ok = r.getString(stringValue);
+                feature->set(name, stringValue);
+                break;
+            }
+
+            if (!ok)
+                return false;
+        }
+
+        features.push_back(feature.get());
+    }
+
+    // trailing bytes mean this is not a record we wrote
+    if (r.p != r.end)
+        return false;
+
+    output.insert(output.end(), features.begin(), features.end());
+    return true;
+}
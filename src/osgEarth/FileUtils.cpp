@@ -118,6 +118,12 @@
 #  define S_ISDIR(mode)    (mode&__S_IFDIR)
 #endif
 
+// for MappedFile
+#ifndef _WIN32
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#endif
+
 
 #define LC "[FileUtils] "
 
@@ -514,3 +520,90 @@ void CollectFilesVisitor::handleFile( const std::string& filename )
 	filenames.push_back( filename );
 }
 
+/**************************************************/
+MappedFile::MappedFile() :
+    _data(0L),
+    _size(0u),
+    _file(0L),
+    _mapping(0L),
+    _fd(-1)
+{
+    //nop
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+bool
+MappedFile::map(const std::string& filename, Access access)
+{
+    unmap();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        access == ACCESS_RANDOM ? FILE_FLAG_RANDOM_ACCESS : FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    _file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        unmap();
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    _mapping = mapping;
+    if (mapping)
+        _data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (_data)
+        _size = (std::size_t)size.QuadPart;
+#else
+    _fd = ::open(filename.c_str(), O_RDONLY);
+    if (_fd < 0)
+        return false;
+
+    struct stat info;
+    if (::fstat(_fd, &info) != 0 || info.st_size == 0)
+    {
+        unmap();
+        return false;
+    }
+
+    void* ptr = ::mmap(0L, (size_t)info.st_size, PROT_READ, MAP_SHARED, _fd, 0);
+    if (ptr != MAP_FAILED)
+    {
+        _data = (const char*)ptr;
+        _size = (std::size_t)info.st_size;
+        ::madvise(ptr, _size, access == ACCESS_RANDOM ? MADV_RANDOM : MADV_SEQUENTIAL);
+    }
+#endif
+
+    if (!_data)
+    {
+        unmap();
+        return false;
+    }
+    return true;
+}
+
+void
+MappedFile::unmap()
+{
+#ifdef _WIN32
+    if (_data) UnmapViewOfFile(_data);
+    if (_mapping) CloseHandle((HANDLE)_mapping);
+    if (_file) CloseHandle((HANDLE)_file);
+#else
+    if (_data) ::munmap((void*)_data, _size);
+    if (_fd >= 0) ::close(_fd);
+#endif
+    _data = 0L;
+    _size = 0u;
+    _file = 0L;
+    _mapping = 0L;
+    _fd = -1;
+}
@@ -0,0 +1,959 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/GeoJSONReader>
+#include <osgEarth/StringUtils>
+#include <unordered_map>
+#include <cstdlib>
+#include <climits>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // Maximum nesting of arrays/objects we are willing to skip over.
+    const int MAX_NESTING = 256;
+
+    // Exact powers of ten for the fast number path
+    const double POW10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    void appendUTF8(std::string& out, unsigned cp)
+    {
+        if (cp < 0x80) {
+            out.push_back((char)cp);
+        }
+        else if (cp < 0x800) {
+            out.push_back((char)(0xC0 | (cp >> 6)));
+            out.push_back((char)(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000) {
+            out.push_back((char)(0xE0 | (cp >> 12)));
+            out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (cp & 0x3F)));
+        }
+        else {
+            out.push_back((char)(0xF0 | (cp >> 18)));
+            out.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    /**
+     * Pull tokenizer over a JSON text buffer. Values are consumed
+     * in document order and never stored in an intermediate tree.
+     */
+    struct Lexer
+    {
+        const char* begin;
+        const char* p;
+        const char* end;
+        int nesting;
+        std::string error;
+
+        Lexer(const char* data, std::size_t length) :
+            begin(data), p(data), end(data + length), nesting(0) { }
+
+        bool fail(const char* message)
+        {
+            if (error.empty())
+                error = Stringify() << message << " at offset " << (p - begin);
+            return false;
+        }
+
+        void ws()
+        {
+            while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+                ++p;
+        }
+
+        char peek()
+        {
+            ws();
+            return p < end ? *p : 0;
+        }
+
+        bool accept(char c)
+        {
+            if (peek() == c) { ++p; return true; }
+            return false;
+        }
+
+        bool expect(char c)
+        {
+            if (accept(c)) return true;
+            return fail(c == '"' ? "expected a string" : "unexpected character");
+        }
+
+        bool literal(const char* word)
+        {
+            ws();
+            for (const char* w = word; *w; ++w, ++p)
+                if (p == end || *p != *w)
+                    return fail("invalid literal");
+            return true;
+        }
+
+        bool hex4(unsigned& cp)
+        {
+            if (end - p < 4) return fail("truncated escape");
+            cp = 0u;
+            for (int i = 0; i < 4; ++i, ++p)
+            {
+                char c = *p;
+                cp <<= 4;
+                if (c >= '0' && c <= '9') cp |= (unsigned)(c - '0');
+                else if (c >= 'a' && c <= 'f') cp |= (unsigned)(c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F') cp |= (unsigned)(c - 'A' + 10);
+                else return fail("invalid unicode escape");
+            }
+            return true;
+        }
+
+        bool string(std::string& out)
+        {
+            if (!expect('"')) return false;
+            out.clear();
+            while (p < end)
+            {
+                const char* run = p;
+                while (p < end && *p != '"' && *p != '\\') ++p;
+                out.append(run, p);
+                if (p == end) break;
+                if (*p++ == '"') return true;
+                if (p == end) break;
+
+                char c = *p++;
+                switch (c)
+                {
+                case '"': case '\\': case '/': out.push_back(c); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u':
+                {
+                    unsigned cp;
+                    if (!hex4(cp)) return false;
+                    if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+                    {
+                        p += 2;
+                        unsigned lo;
+                        if (!hex4(lo)) return false;
+                        if (lo >= 0xDC00 && lo < 0xE000)
+                        {
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        }
+                        else
+                        {
+                            appendUTF8(out, cp);
+                            cp = lo;
+                        }
+                    }
+                    appendUTF8(out, cp);
+                    break;
+                }
+                default:
+                    return fail("invalid escape sequence");
+                }
+            }
+            return fail("unterminated string");
+        }
+
+        bool skipString()
+        {
+            if (!expect('"')) return false;
+            while (p < end)
+            {
+                if (*p == '\\') {
+                    if (end - p < 2) break;
+                    p += 2;
+                }
+                else if (*p++ == '"') return true;
+            }
+            return fail("unterminated string");
+        }
+
+        // Reads a number. Integers that fit in 64 bits come back with
+        // isInt=true; everything else is a double.
+        bool number(double& d, long long& i, bool& isInt)
+        {
+            ws();
+            const char* start = p;
+            bool negative = false;
+            if (p < end && *p == '-') { negative = true; ++p; }
+            if (p == end || !isDigit(*p))
+                return fail("expected a value");
+
+            unsigned long long mantissa = 0ull;
+            int digits = 0, exp10 = 0;
+            isInt = true;
+
+            for (; p < end && isDigit(*p); ++p)
+            {
+                if (digits < 19) {
+                    mantissa = mantissa * 10ull + (unsigned)(*p - '0');
+                    if (mantissa > 0ull) ++digits;
+                }
+                else ++exp10;
+            }
+
+            if (p < end && *p == '.')
+            {
+                isInt = false;
+                ++p;
+                if (p == end || !isDigit(*p))
+                    return fail("malformed number");
+                for (; p < end && isDigit(*p); ++p)
+                {
+                    if (digits < 19) {
+                        mantissa = mantissa * 10ull + (unsigned)(*p - '0');
+                        if (mantissa > 0ull) ++digits;
+                        --exp10;
+                    }
+                }
+            }
+
+            if (p < end && (*p == 'e' || *p == 'E'))
+            {
+                isInt = false;
+                ++p;
+                bool negativeExp = false;
+                if (p < end && (*p == '+' || *p == '-')) { negativeExp = (*p == '-'); ++p; }
+                if (p == end || !isDigit(*p))
+                    return fail("malformed number");
+                int e = 0;
+                for (; p < end && isDigit(*p); ++p)
+                    if (e < 100000) e = e * 10 + (*p - '0');
+                exp10 += negativeExp ? -e : e;
+            }
+
+            if (isInt && (exp10 != 0 || mantissa > (unsigned long long)LLONG_MAX))
+            {
+                isInt = false;
+            }
+
+            if (isInt)
+            {
+                i = negative ? -(long long)mantissa : (long long)mantissa;
+                d = (double)i;
+            }
+            else if (mantissa <= (1ull << 53) && exp10 >= -22 && exp10 <= 22)
+            {
+                // both operands are exact, so this rounds correctly
+                d = exp10 < 0 ? (double)mantissa / POW10[-exp10] : (double)mantissa * POW10[exp10];
+                if (negative) d = -d;
+            }
+            else
+            {
+                std::string text(start, p);
+                d = ::strtod(text.c_str(), 0L);
+            }
+            return true;
+        }
+
+        bool skipValue()
+        {
+            switch (peek())
+            {
+            case '"':
+                return skipString();
+            case '{':
+                return members([this](const std::string&) { return skipValue(); });
+            case '[':
+                return elements([this]() { return skipValue(); });
+            case 't':
+                return literal("true");
+            case 'f':
+                return literal("false");
+            case 'n':
+                return literal("null");
+            default:
+                double d; long long i; bool isInt;
+                return number(d, i, isInt);
+            }
+        }
+
+        //! Iterates over the members of an object, calling "member" with
+        //! each key. "member" must consume the value.
+        template<typename F>
+        bool members(F&& member)
+        {
+            if (!expect('{')) return false;
+            if (++nesting > MAX_NESTING) return fail("nesting too deep");
+            if (!accept('}'))
+            {
+                std::string key;
+                do {
+                    if (!string(key) || !expect(':') || !member(key))
+                        return false;
+                } while (accept(','));
+                if (!expect('}')) return false;
+            }
+            --nesting;
+            return true;
+        }
+
+        //! Iterates over the elements of an array, calling "element" for
+        //! each one. "element" must consume the value.
+        template<typename F>
+        bool elements(F&& element)
+        {
+            if (!expect('[')) return false;
+            if (++nesting > MAX_NESTING) return fail("nesting too deep");
+            if (!accept(']'))
+            {
+                do {
+                    if (!element())
+                        return false;
+                } while (accept(','));
+                if (!expect(']')) return false;
+            }
+            --nesting;
+            return true;
+        }
+    };
+
+    /**
+     * A "coordinates" member flattened into one point array.
+     * "rings" holds the end offset (into points) of each list of positions,
+     * and "groups" holds the end offset (into rings) of each list of lists.
+     */
+    struct Coords
+    {
+        std::vector<osg::Vec3d> points;
+        std::vector<unsigned> rings;
+        std::vector<unsigned> groups;
+        int depth;
+
+        Coords() : depth(0) { }
+
+        void clear() { points.clear(); rings.clear(); groups.clear(); depth = 0; }
+    };
+
+    // Parses a coordinate array, setting "depth" to its nesting level
+    // (1 = a single position, 4 = MultiPolygon) or 0 if it is empty.
+    bool parseCoords(Lexer& lex, Coords& c, int& depth, int level)
+    {
+        if (level > 4)
+            return lex.fail("coordinates nested too deeply");
+
+        if (!lex.expect('['))
+            return false;
+
+        char next = lex.peek();
+        if (next == '-' || isDigit(next))
+        {
+            // a position; ordinates past Z are ignored
+            double v[3] = { 0.0, 0.0, 0.0 };
+            int count = 0;
+            do {
+                double d; long long i; bool isInt;
+                if (!lex.number(d, i, isInt))
+                    return false;
+                if (count < 3) v[count] = d;
+                ++count;
+            } while (lex.accept(','));
+
+            if (count < 2)
+                return lex.fail("position needs at least two ordinates");
+
+            c.points.push_back(osg::Vec3d(v[0], v[1], v[2]));
+            depth = 1;
+            return lex.expect(']');
+        }
+
+        depth = 0;
+        if (lex.accept(']'))
+            return true;
+
+        do {
+            int child = 0;
+            if (!parseCoords(lex, c, child, level + 1))
+                return false;
+
+            if (child > 0)
+            {
+                if (depth > 0 && depth != child + 1)
+                    return lex.fail("inconsistent coordinate nesting");
+                depth = child + 1;
+
+                if (child == 2) c.rings.push_back(c.points.size());
+                else if (child == 3) c.groups.push_back(c.rings.size());
+            }
+        } while (lex.accept(','));
+
+        return lex.expect(']');
+    }
+
+    // Appends points to a geometry, dropping consecutive duplicates
+    // the same way OgrUtils::populate does.
+    void append(Geometry* target, const Coords& c, unsigned first, unsigned last)
+    {
+        for (unsigned i = first; i < last; ++i)
+        {
+            const osg::Vec3d& p = c.points[i];
+            if (target->size() == 0 || p != target->back())
+                target->push_back(p);
+        }
+    }
+
+    Polygon* makePolygon(const Coords& c, unsigned firstRing, unsigned lastRing, bool rewind)
+    {
+        Polygon* output = 0L;
+        for (unsigned r = firstRing; r < lastRing; ++r)
+        {
+            unsigned first = r > 0 ? c.rings[r - 1] : 0u;
+            unsigned last = c.rings[r];
+
+            if (r == firstRing)
+            {
+                output = new Polygon(last - first);
+                append(output, c, first, last);
+                if (rewind)
+                {
+                    output->open();
+                    output->rewind(Ring::ORIENTATION_CCW);
+                }
+            }
+            else
+            {
+                Ring* hole = new Ring(last - first);
+                append(hole, c, first, last);
+                if (rewind)
+                {
+                    hole->open();
+                    hole->rewind(Ring::ORIENTATION_CW);
+                }
+                output->getHoles().push_back(hole);
+            }
+        }
+        return output;
+    }
+
+    // Members of a GeoJSON geometry object, gathered in any order
+    struct GeometryState
+    {
+        std::string type;
+        Coords coords;
+        GeometryCollection parts;
+
+        void clear() { type.clear(); coords.clear(); parts.clear(); }
+    };
+
+    bool parseGeometry(Lexer& lex, GeometryState& state, bool rewind, osg::ref_ptr<Geometry>& output);
+
+    // Handles one member of a geometry object. Sets "handled" to false
+    // if the key is not a geometry member (and leaves the value alone).
+    bool geometryMember(Lexer& lex, const std::string& key, GeometryState& state, bool rewind, bool& handled)
+    {
+        handled = true;
+        if (key == "type")
+        {
+            return lex.string(state.type);
+        }
+        else if (key == "coordinates")
+        {
+            return parseCoords(lex, state.coords, state.coords.depth, 1);
+        }
+        else if (key == "geometries")
+        {
+            return lex.elements([&]() -> bool
+            {
+                GeometryState child;
+                osg::ref_ptr<Geometry> part;
+                if (!parseGeometry(lex, child, rewind, part))
+                    return false;
+                if (part.valid())
+                    state.parts.push_back(part.get());
+                return true;
+            });
+        }
+        handled = false;
+        return true;
+    }
+
+    // Builds the osgEarth geometry for a parsed geometry object.
+    // Empty geometries come back NULL.
+    bool buildGeometry(Lexer& lex, const GeometryState& state, bool rewind, osg::ref_ptr<Geometry>& output)
+    {
+        const Coords& c = state.coords;
+        const std::string& type = state.type;
+
+        if (type == "GeometryCollection")
+        {
+            if (!state.parts.empty())
+                output = new MultiGeometry(state.parts);
+            return true;
+        }
+
+        int depth =
+            type == "Point" ? 1 :
+            type == "MultiPoint" || type == "LineString" ? 2 :
+            type == "MultiLineString" || type == "Polygon" ? 3 :
+            type == "MultiPolygon" ? 4 :
+            0;
+
+        if (depth == 0)
+        {
+            return lex.fail("unsupported geometry type");
+        }
+
+        if (c.depth == 0)
+        {
+            // "coordinates": [] is a legal empty geometry
+            return true;
+        }
+
+        if (c.depth != depth)
+        {
+            return lex.fail("coordinate nesting does not match the geometry type");
+        }
+
+        if (type == "Point")
+        {
+            output = new Point(1);
+            append(output.get(), c, 0u, c.points.size());
+        }
+        else if (type == "MultiPoint")
+        {
+            output = new PointSet(c.points.size());
+            append(output.get(), c, 0u, c.points.size());
+        }
+        else if (type == "LineString")
+        {
+            output = new LineString(c.points.size());
+            append(output.get(), c, 0u, c.points.size());
+        }
+        else if (type == "MultiLineString")
+        {
+            MultiGeometry* multi = new MultiGeometry();
+            for (unsigned r = 0; r < c.rings.size(); ++r)
+            {
+                unsigned first = r > 0 ? c.rings[r - 1] : 0u;
+                LineString* line = new LineString(c.rings[r] - first);
+                append(line, c, first, c.rings[r]);
+                multi->add(line);
+            }
+            output = multi;
+        }
+        else if (type == "Polygon")
+        {
+            output = makePolygon(c, 0u, c.rings.size(), rewind);
+        }
+        else // MultiPolygon
+        {
+            MultiGeometry* multi = new MultiGeometry();
+            for (unsigned g = 0; g < c.groups.size(); ++g)
+            {
+                unsigned first = g > 0 ? c.groups[g - 1] : 0u;
+                if (first < c.groups[g])
+                    multi->add(makePolygon(c, first, c.groups[g], rewind));
+            }
+            output = multi;
+        }
+        return true;
+    }
+
+    bool parseGeometry(Lexer& lex, GeometryState& state, bool rewind, osg::ref_ptr<Geometry>& output)
+    {
+        if (lex.peek() == 'n')
+            return lex.literal("null");
+
+        state.clear();
+        bool ok = lex.members([&](const std::string& key) -> bool
+        {
+            bool handled;
+            if (!geometryMember(lex, key, state, rewind, handled))
+                return false;
+            return handled || lex.skipValue();
+        });
+
+        return ok && buildGeometry(lex, state, rewind, output);
+    }
+
+    // Schema inference for one property across all features
+    struct Field
+    {
+        AttributeType type;
+        unsigned count;
+        bool mixed;
+        bool nulls;
+
+        Field() : type(ATTRTYPE_UNSPECIFIED), count(0u), mixed(false), nulls(false) { }
+    };
+
+    // Order in which types widen when a property mixes them
+    int rank(AttributeType type)
+    {
+        switch (type)
+        {
+        case ATTRTYPE_BOOL:   return 1;
+        case ATTRTYPE_INT:    return 2;
+        case ATTRTYPE_DOUBLE: return 3;
+        case ATTRTYPE_STRING: return 4;
+        default:              return 0;
+        }
+    }
+
+    void merge(Field& field, AttributeType type)
+    {
+        if (type == ATTRTYPE_UNSPECIFIED)
+        {
+            field.nulls = true;
+        }
+        else if (field.type == ATTRTYPE_UNSPECIFIED)
+        {
+            field.type = type;
+        }
+        else if (field.type != type)
+        {
+            field.mixed = true;
+            if (rank(type) > rank(field.type))
+                field.type = type;
+        }
+    }
+
+    // Members of a GeoJSON feature object, gathered in any order
+    struct FeatureState
+    {
+        osg::ref_ptr<Feature> feature;
+        osg::ref_ptr<Geometry> geometry;
+        bool hasFID;
+        FeatureID fid;
+        std::string stringID;
+
+        FeatureState() : hasFID(false), fid(0) { }
+    };
+
+    struct Context
+    {
+        Lexer lex;
+        const SpatialReference* srs;
+        const FeatureProfile* profile;
+        bool rewind;
+        bool geometryOnly;
+        const std::set<std::string>& attributes;
+        std::unordered_map<std::string, Field> fields;
+        FeatureList features;
+        GeometryState geometry;
+        std::string name, text;
+
+        Context(const char* data, std::size_t length, const std::set<std::string>& attrs) :
+            lex(data, length), srs(0L), profile(0L), rewind(true), geometryOnly(false), attributes(attrs) { }
+
+        bool wanted(const std::string& lowerName) const
+        {
+            return attributes.empty() || attributes.find(lowerName) != attributes.end();
+        }
+
+        Feature* newFeature() const
+        {
+            Feature* f = new Feature(0L, srs, Style(), 0);
+            if (profile && profile->geoInterp().isSet())
+                f->geoInterp() = profile->geoInterp().get();
+            return f;
+        }
+
+        bool parseProperties(Feature* f)
+        {
+            return lex.members([&](const std::string& key) -> bool
+            {
+                name.assign(key);
+                for (std::string::iterator c = name.begin(); c != name.end(); ++c)
+                    *c = ::tolower(*c);
+
+                if (!wanted(name))
+                    return lex.skipValue();
+
+                AttributeType type;
+                switch (lex.peek())
+                {
+                case '"':
+                    if (!lex.string(text)) return false;
+                    f->set(name, text);
+                    type = ATTRTYPE_STRING;
+                    break;
+                case 't':
+                case 'f':
+                {
+                    bool value = lex.peek() == 't';
+                    if (!lex.literal(value ? "true" : "false")) return false;
+                    f->set(name, value);
+                    type = ATTRTYPE_BOOL;
+                    break;
+                }
+                case 'n':
+                    if (!lex.literal("null")) return false;
+                    f->setNull(name);
+                    type = ATTRTYPE_UNSPECIFIED;
+                    break;
+                case '{':
+                case '[':
+                {
+                    // nested values are kept as their JSON text, like OGR does
+                    const char* start = lex.p;
+                    if (!lex.skipValue()) return false;
+                    f->set(name, std::string(start, lex.p));
+                    type = ATTRTYPE_STRING;
+                    break;
+                }
+                default:
+                {
+                    double d; long long i; bool isInt;
+                    if (!lex.number(d, i, isInt)) return false;
+                    if (isInt) f->set(name, i);
+                    else f->set(name, d);
+                    type = isInt ? ATTRTYPE_INT : ATTRTYPE_DOUBLE;
+                    break;
+                }
+                }
+
+                Field& field = fields[name];
+                ++field.count;
+                merge(field, type);
+                return true;
+            });
+        }
+
+        // Handles one member of a feature object. Sets "handled" to false
+        // if the key is not a feature member (and leaves the value alone).
+        bool featureMember(const std::string& key, FeatureState& state, bool& handled)
+        {
+            handled = true;
+            if (key == "geometry")
+            {
+                return parseGeometry(lex, geometry, rewind, state.geometry);
+            }
+            else if (key == "properties")
+            {
+                if (geometryOnly)
+                    return lex.skipValue();
+                if (lex.peek() == 'n')
+                    return lex.literal("null");
+                return parseProperties(state.feature.get());
+            }
+            else if (key == "id")
+            {
+                char next = lex.peek();
+                if (next == '"')
+                    return lex.string(state.stringID);
+                if (next == '-' || isDigit(next))
+                {
+                    double d; long long i; bool isInt;
+                    if (!lex.number(d, i, isInt)) return false;
+                    if (isInt) { state.fid = i; state.hasFID = true; }
+                    return true;
+                }
+                return lex.skipValue();
+            }
+            handled = false;
+            return true;
+        }
+
+        void finishFeature(FeatureState& state)
+        {
+            Feature* f = state.feature.get();
+            f->setGeometry(state.geometry.get());
+
+            // OGR numbers features sequentially when they carry no integer ID
+            f->setFID(state.hasFID ? state.fid : (FeatureID)features.size());
+
+            // ...and exposes a string ID as a regular attribute
+            if (!state.stringID.empty() && !geometryOnly && wanted("id") && !f->hasAttr("id"))
+            {
+                f->set("id", state.stringID);
+                Field& field = fields["id"];
+                ++field.count;
+                merge(field, ATTRTYPE_STRING);
+            }
+
+            features.push_back(f);
+        }
+
+        bool parseFeature()
+        {
+            FeatureState state;
+            state.feature = newFeature();
+
+            bool ok = lex.members([&](const std::string& key) -> bool
+            {
+                bool handled;
+                if (!featureMember(key, state, handled))
+                    return false;
+                return handled || lex.skipValue();
+            });
+
+            if (ok)
+                finishFeature(state);
+            return ok;
+        }
+
+        // Applies the inferred schema so every feature carries every
+        // property with the same type, then records the schema.
+        void applySchema(FeatureSchema& schema)
+        {
+            std::vector<std::pair<std::string, AttributeType> > fixes;
+
+            for (std::unordered_map<std::string, Field>::const_iterator i = fields.begin(); i != fields.end(); ++i)
+            {
+                AttributeType type = i->second.type != ATTRTYPE_UNSPECIFIED ? i->second.type : ATTRTYPE_STRING;
+                schema[i->first] = type;
+
+                if (i->second.mixed || i->second.nulls || i->second.count < features.size())
+                    fixes.push_back(std::make_pair(i->first, type));
+            }
+
+            if (fixes.empty())
+                return;
+
+            for (FeatureList::iterator f = features.begin(); f != features.end(); ++f)
+            {
+                Feature* feature = f->get();
+                const AttributeTable& attrs = feature->getAttrs();
+
+                for (unsigned i = 0; i < fixes.size(); ++i)
+                {
+                    const std::string& name = fixes[i].first;
+                    AttributeType type = fixes[i].second;
+
+                    AttributeTable::const_iterator a = attrs.find(name);
+                    if (a == attrs.end() || !a->second.second.set)
+                    {
+                        feature->setNull(name, type);
+                    }
+                    else if (a->second.first != type)
+                    {
+                        if (type == ATTRTYPE_STRING)
+                            feature->set(name, a->second.getString());
+                        else if (type == ATTRTYPE_DOUBLE)
+                            feature->set(name, a->second.getDouble());
+                        else if (type == ATTRTYPE_INT)
+                            feature->set(name, a->second.getInt());
+                    }
+                }
+            }
+        }
+    };
+}
+
+GeoJSONReader::GeoJSONReader() :
+    _rewindPolygons(true),
+    _geometryOnly(false)
+{
+    //nop
+}
+
+void
+GeoJSONReader::setAttributes(const std::set<std::string>& value)
+{
+    _attributes.clear();
+    for (std::set<std::string>::const_iterator i = value.begin(); i != value.end(); ++i)
+        _attributes.insert(toLower(*i));
+}
+
+bool
+GeoJSONReader::read(const char* data, std::size_t length, FeatureList& output)
+{
+    _schema.clear();
+    _error.clear();
+
+    Context ctx(data, length, _attributes);
+    ctx.profile = _profile.get();
+    ctx.srs = _profile.valid() ? _profile->getSRS() : 0L;
+    ctx.rewind = _rewindPolygons;
+    ctx.geometryOnly = _geometryOnly;
+
+    Lexer& lex = ctx.lex;
+
+    if (lex.peek() != '{')
+    {
+        _error = "not a GeoJSON object";
+        return false;
+    }
+
+    // The top-level object may be a FeatureCollection, a Feature or a
+    // bare geometry, and "type" is not required to come first, so
+    // accept the members of all three and sort it out afterwards.
+    FeatureState top;
+    top.feature = ctx.newFeature();
+    GeometryState bare;
+    bool sawFeatures = false;
+
+    bool ok = lex.members([&](const std::string& key) -> bool
+    {
+        if (key == "features")
+        {
+            sawFeatures = true;
+            return lex.elements([&]() { return ctx.parseFeature(); });
+        }
+
+        bool handled;
+        if (!ctx.featureMember(key, top, handled))
+            return false;
+        if (!handled && !geometryMember(lex, key, bare, ctx.rewind, handled))
+            return false;
+        return handled || lex.skipValue();
+    });
+
+    if (ok)
+    {
+        if (lex.peek() != 0)
+        {
+            ok = lex.fail("trailing characters");
+        }
+        else if (bare.type == "FeatureCollection" || (bare.type.empty() && sawFeatures))
+        {
+            // features are already in the context
+        }
+        else if (bare.type == "Feature")
+        {
+            ctx.finishFeature(top);
+        }
+        else if (!bare.type.empty())
+        {
+            osg::ref_ptr<Geometry> geom;
+            ok = buildGeometry(lex, bare, ctx.rewind, geom);
+            if (ok && geom.valid())
+            {
+                top.geometry = geom.get();
+                ctx.finishFeature(top);
+            }
+        }
+        else
+        {
+            ok = lex.fail("missing GeoJSON type");
+        }
+    }
+
+    if (!ok)
+    {
+        _error = lex.error;
+        return false;
+    }
+
+    ctx.applySchema(_schema);
+    output.splice(output.end(), ctx.features);
+    return true;
+}
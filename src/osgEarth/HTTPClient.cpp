@@ -19,6 +19,7 @@
 #include <osgEarth/HTTPClient>
 #include <osgEarth/Progress>
 #include <osgEarth/Metrics>
+#include <osgEarth/MetricsRegistry>
 #include <osgEarth/Version>
 #include <osgDB/ReadFile>
 #include <osgDB/FileNameUtils>
@@ -1462,7 +1463,24 @@ HTTPClient::doGet(const HTTPRequest&    request,
 
     initialize();
 
+    static MetricsRegistry::Counter& s_requests = MetricsRegistry::instance().counter(
+        "osgearth_http_requests_total", "HTTP GET requests issued");
+    static MetricsRegistry::Counter& s_errors = MetricsRegistry::instance().counter(
+        "osgearth_http_errors_total", "HTTP GET requests that did not return 200 OK");
+    static MetricsRegistry::Counter& s_bytes = MetricsRegistry::instance().counter(
+        "osgearth_http_bytes_downloaded_total", "Bytes received in HTTP responses");
+    static MetricsRegistry::Histogram& s_latency = MetricsRegistry::instance().histogram(
+        "osgearth_http_request_seconds", "HTTP GET request latency");
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     HTTPResponse response = _impl->doGet(request, options, progress);
+    s_latency.record(std::chrono::steady_clock::now() - start);
+
+    s_requests.increment();
+    if (response.getCode() != HTTPResponse::OK && !response.isCanceled())
+        s_errors.increment();
+    for (unsigned i = 0; i < response.getNumParts(); ++i)
+        s_bytes.increment(response.getPartSize(i));
 
     OE_PROFILING_ZONE_TEXT(Stringify() << "response_code " << response.getCode());
     if (response.isCanceled())
@@ -0,0 +1,723 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/ImageKernels>
+#include <osg/Math>
+#include <vector>
+#include <cstring>
+#include <cmath>
+
+#if defined(__AVX2__)
+#  define OE_KERNELS_AVX2
+#  define OE_KERNELS_SSSE3
+#  define OE_KERNELS_SSE2
+#  include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define OE_KERNELS_SSE2
+#  include <emmintrin.h>
+#  if defined(__SSSE3__)
+#    define OE_KERNELS_SSSE3
+#    include <tmmintrin.h>
+#  endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define OE_KERNELS_NEON
+#  include <arm_neon.h>
+#endif
+
+using namespace osgEarth::Util;
+
+namespace
+{
+    using namespace osgEarth::Util::ImageKernels;
+
+    //........................................................................
+    // Layout traits
+
+    template<Layout L> struct Traits;
+    template<> struct Traits<LAYOUT_RGBA8> { typedef GLubyte T; enum { C = 4 }; };
+    template<> struct Traits<LAYOUT_RGB8>  { typedef GLubyte T; enum { C = 3 }; };
+    template<> struct Traits<LAYOUT_R32F>  { typedef GLfloat T; enum { C = 1 }; };
+    template<> struct Traits<LAYOUT_R16>   { typedef GLushort T; enum { C = 1 }; };
+    template<> struct Traits<LAYOUT_L8>    { typedef GLubyte T; enum { C = 1 }; };
+
+    // float => channel value, rounding to nearest for the integer types
+    template<typename T> inline T toChannel(float v) { return (T)(v + 0.5f); }
+    template<> inline GLfloat toChannel<GLfloat>(float v) { return v; }
+
+    // average of four channel values
+    template<typename T> inline T average4(T a, T b, T c, T d) {
+        return (T)(((unsigned)a + (unsigned)b + (unsigned)c + (unsigned)d + 2u) >> 2);
+    }
+    template<> inline GLfloat average4<GLfloat>(GLfloat a, GLfloat b, GLfloat c, GLfloat d) {
+        return (a + b + c + d) * 0.25f;
+    }
+
+    // round(x/255) for 0 <= x <= 65025
+    inline unsigned div255(unsigned x) {
+        x += 128u;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    //........................................................................
+    // resize
+
+    // Source indices and weights for one output column (or row)
+    struct Tap
+    {
+        int i0, i1;
+        float w0, w1;
+    };
+
+    // Same sample positions and weights as ImageUtils::resizeImage
+    void computeTaps(unsigned in_n, unsigned out_n, bool bilinear, std::vector<Tap>& taps)
+    {
+        taps.resize(out_n);
+        for (unsigned o = 0; o < out_n; ++o)
+        {
+            float ratio = (float)o / (float)out_n;
+            float x = ratio * (float)in_n;
+            if (x >= (float)in_n) x = (float)(in_n - 1);
+            else if (x < 0.0f) x = 0.0f;
+
+            Tap& tap = taps[o];
+            if (bilinear)
+            {
+                int lo = osg::maximum((int)floor(x), 0);
+                int hi = osg::maximum(osg::minimum((int)ceil(x), (int)in_n - 1), 0);
+                if (lo > hi) lo = hi;
+                tap.i0 = lo;
+                tap.i1 = hi;
+                if (lo == hi)
+                {
+                    tap.w0 = 1.0f, tap.w1 = 0.0f;
+                }
+                else
+                {
+                    tap.w0 = (float)((double)hi - x);
+                    tap.w1 = (float)(x - (double)lo);
+                }
+            }
+            else
+            {
+                int n = (x - (int)x) <= (ceil(x) - x) ?
+                    (int)x :
+                    osg::minimum(1 + (int)x, (int)in_n - 1);
+                tap.i0 = tap.i1 = n;
+                tap.w0 = 1.0f, tap.w1 = 0.0f;
+            }
+        }
+    }
+
+    template<Layout L>
+    void resizeLayout(const osg::Image* in, osg::Image* out, bool bilinear)
+    {
+        typedef typename Traits<L>::T T;
+        const int C = Traits<L>::C;
+
+        std::vector<Tap> cols, rows;
+        computeTaps(in->s(), out->s(), bilinear, cols);
+        computeTaps(in->t(), out->t(), bilinear, rows);
+
+        const int layers = osg::minimum(in->r(), out->r());
+
+        for (int r = 0; r < layers; ++r)
+        {
+            for (unsigned t = 0; t < rows.size(); ++t)
+            {
+                const Tap& rt = rows[t];
+                const T* row0 = (const T*)in->data(0, rt.i0, r);
+                const T* row1 = (const T*)in->data(0, rt.i1, r);
+                T* dst = (T*)out->data(0, t, r);
+
+                if (!bilinear)
+                {
+                    for (unsigned s = 0; s < cols.size(); ++s)
+                    {
+                        const T* p = row0 + cols[s].i0*C;
+                        for (int k = 0; k < C; ++k)
+                            *dst++ = p[k];
+                    }
+                }
+                else
+                {
+                    for (unsigned s = 0; s < cols.size(); ++s)
+                    {
+                        const Tap& ct = cols[s];
+                        const T* ll = row0 + ct.i0*C;
+                        const T* lr = row0 + ct.i1*C;
+                        const T* ul = row1 + ct.i0*C;
+                        const T* ur = row1 + ct.i1*C;
+                        for (int k = 0; k < C; ++k)
+                        {
+                            float lower = (float)ll[k] * ct.w0 + (float)lr[k] * ct.w1;
+                            float upper = (float)ul[k] * ct.w0 + (float)ur[k] * ct.w1;
+                            *dst++ = toChannel<T>(lower * rt.w0 + upper * rt.w1);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    //........................................................................
+    // mipmaps
+
+    // 2x2 box filter of one RGBA8 row pair; returns the number of output
+    // pixels written.
+    inline int boxRowRGBA8(const GLubyte* r0, const GLubyte* r1, GLubyte* out, int n)
+    {
+        int s = 0;
+#if defined(OE_KERNELS_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i bias = _mm_set1_epi16(2);
+        for (; s + 4 <= n; s += 4)
+        {
+            __m128i a0 = _mm_loadu_si128((const __m128i*)(r0 + s * 8));
+            __m128i a1 = _mm_loadu_si128((const __m128i*)(r0 + s * 8 + 16));
+            __m128i b0 = _mm_loadu_si128((const __m128i*)(r1 + s * 8));
+            __m128i b1 = _mm_loadu_si128((const __m128i*)(r1 + s * 8 + 16));
+
+            // vertical sums, two pixels per register
+            __m128i v0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+            __m128i v1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+            __m128i v2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+            __m128i v3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+            // horizontal pair sums
+            __m128i h0 = _mm_add_epi16(_mm_unpacklo_epi64(v0, v1), _mm_unpackhi_epi64(v0, v1));
+            __m128i h1 = _mm_add_epi16(_mm_unpacklo_epi64(v2, v3), _mm_unpackhi_epi64(v2, v3));
+
+            h0 = _mm_srli_epi16(_mm_add_epi16(h0, bias), 2);
+            h1 = _mm_srli_epi16(_mm_add_epi16(h1, bias), 2);
+
+            _mm_storeu_si128((__m128i*)(out + s * 4), _mm_packus_epi16(h0, h1));
+        }
+#elif defined(OE_KERNELS_NEON)
+        for (; s + 4 <= n; s += 4)
+        {
+            // even and odd pixels
+            uint32x4x2_t p0 = vld2q_u32((const uint32_t*)(r0 + s * 8));
+            uint32x4x2_t p1 = vld2q_u32((const uint32_t*)(r1 + s * 8));
+            uint8x16_t e0 = vreinterpretq_u8_u32(p0.val[0]), o0 = vreinterpretq_u8_u32(p0.val[1]);
+            uint8x16_t e1 = vreinterpretq_u8_u32(p1.val[0]), o1 = vreinterpretq_u8_u32(p1.val[1]);
+
+            uint16x8_t lo = vaddl_u8(vget_low_u8(e0), vget_low_u8(o0));
+            lo = vaddw_u8(lo, vget_low_u8(e1));
+            lo = vaddw_u8(lo, vget_low_u8(o1));
+            uint16x8_t hi = vaddl_u8(vget_high_u8(e0), vget_high_u8(o0));
+            hi = vaddw_u8(hi, vget_high_u8(e1));
+            hi = vaddw_u8(hi, vget_high_u8(o1));
+
+            vst1q_u8(out + s * 4, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+        }
+#endif
+        return s;
+    }
+
+    template<Layout L>
+    void boxFilter(
+        const unsigned char* src, int srcS, int srcT, unsigned srcStep,
+        unsigned char* dst, int dstS, int dstT, unsigned dstStep)
+    {
+        typedef typename Traits<L>::T T;
+        const int C = Traits<L>::C;
+
+        // a dimension of 1 is only filtered along the other axis
+        const int sx = srcS > 1 ? 2 : 1;
+        const int sy = srcT > 1 ? 2 : 1;
+
+        for (int t = 0; t < dstT; ++t)
+        {
+            const unsigned char* r0 = src + (t*sy)*srcStep;
+            const unsigned char* r1 = src + (t*sy + sy - 1)*srcStep;
+            unsigned char* outRow = dst + t*dstStep;
+
+            int s = 0;
+            if (L == LAYOUT_RGBA8 && sx == 2 && sy == 2)
+                s = boxRowRGBA8(r0, r1, outRow, dstS);
+
+            const T* a = (const T*)r0;
+            const T* b = (const T*)r1;
+            T* out = (T*)outRow;
+            for (; s < dstS; ++s)
+            {
+                const T* a0 = a + (s*sx)*C;
+                const T* a1 = a + (s*sx + sx - 1)*C;
+                const T* b0 = b + (s*sx)*C;
+                const T* b1 = b + (s*sx + sx - 1)*C;
+                for (int k = 0; k < C; ++k)
+                    out[s*C + k] = average4<T>(a0[k], a1[k], b0[k], b1[k]);
+            }
+        }
+    }
+
+    template<Layout L>
+    void mipmapLayout(osg::Image* image)
+    {
+        const GLenum pf = image->getPixelFormat();
+        const GLenum dt = image->getDataType();
+        const int packing = image->getPacking();
+
+        int srcS = image->s(), srcT = image->t();
+        const unsigned char* src = image->data();
+        unsigned srcStep = image->getRowStepInBytes();
+
+        for (unsigned level = 1; level < image->getNumMipmapLevels(); ++level)
+        {
+            int dstS = osg::maximum(srcS >> 1, 1);
+            int dstT = osg::maximum(srcT >> 1, 1);
+            unsigned char* dst = image->getMipmapData(level);
+            unsigned dstStep = osg::Image::computeRowWidthInBytes(dstS, pf, dt, packing);
+
+            boxFilter<L>(src, srcS, srcT, srcStep, dst, dstS, dstT, dstStep);
+
+            src = dst, srcS = dstS, srcT = dstT, srcStep = dstStep;
+        }
+    }
+
+    //........................................................................
+    // mix
+
+    template<int SC, int DC>
+    void mixLayout(osg::Image* dest, const osg::Image* src, float a)
+    {
+        const float toUnit = 1.0f / 255.0f;
+
+        for (int r = 0; r < src->r(); ++r)
+        {
+            for (int t = 0; t < src->t(); ++t)
+            {
+                const GLubyte* sp = src->data(0, t, r);
+                GLubyte* dp = dest->data(0, t, r);
+
+                for (int s = 0; s < src->s(); ++s, sp += SC, dp += DC)
+                {
+                    float sa = SC == 4 ? a * (float)sp[3] * toUnit : a;
+                    float ia = 1.0f - sa;
+                    dp[0] = toChannel<GLubyte>((float)dp[0] * ia + (float)sp[0] * sa);
+                    dp[1] = toChannel<GLubyte>((float)dp[1] * ia + (float)sp[1] * sa);
+                    dp[2] = toChannel<GLubyte>((float)dp[2] * ia + (float)sp[2] * sa);
+                    if (DC == 4)
+                        dp[DC - 1] = toChannel<GLubyte>(osg::maximum(sa * 255.0f, (float)dp[DC - 1]));
+                }
+            }
+        }
+    }
+
+    //........................................................................
+    // RGB8 => RGBA8
+
+    // Converts one row; returns the number of pixels converted.
+    inline int rgbToRGBARow(const GLubyte* in, GLubyte* out, int n)
+    {
+        int s = 0;
+#if defined(OE_KERNELS_AVX2)
+        {
+            const __m256i shuffle = _mm256_setr_epi8(
+                0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+
+            // each 128-bit half reads 16 bytes but uses 12, so stay clear of the row end
+            for (; s + 10 <= n; s += 8)
+            {
+                __m128i lo = _mm_loadu_si128((const __m128i*)(in + s * 3));
+                __m128i hi = _mm_loadu_si128((const __m128i*)(in + s * 3 + 12));
+                __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+                v = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), alpha);
+                _mm256_storeu_si256((__m256i*)(out + s * 4), v);
+            }
+        }
+#endif
+#if defined(OE_KERNELS_SSSE3)
+        {
+            const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+            for (; s + 6 <= n; s += 4)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)(in + s * 3));
+                v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha);
+                _mm_storeu_si128((__m128i*)(out + s * 4), v);
+            }
+        }
+#elif defined(OE_KERNELS_NEON)
+        for (; s + 16 <= n; s += 16)
+        {
+            uint8x16x3_t rgb = vld3q_u8(in + s * 3);
+            uint8x16x4_t rgba;
+            rgba.val[0] = rgb.val[0];
+            rgba.val[1] = rgb.val[1];
+            rgba.val[2] = rgb.val[2];
+            rgba.val[3] = vdupq_n_u8(255);
+            vst4q_u8(out + s * 4, rgba);
+        }
+#endif
+        return s;
+    }
+
+    //........................................................................
+    // premultiplied alpha
+
+    // Premultiplies one row; returns the number of pixels processed.
+    inline int premultiplyRow(GLubyte* p, int n)
+    {
+        int s = 0;
+#if defined(OE_KERNELS_AVX2)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i half = _mm256_set1_epi16(128);
+            const __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000);
+
+            for (; s + 8 <= n; s += 8)
+            {
+                __m256i v = _mm256_loadu_si256((const __m256i*)(p + s * 4));
+                __m256i lo = _mm256_unpacklo_epi8(v, zero);
+                __m256i hi = _mm256_unpackhi_epi8(v, zero);
+
+                // broadcast each pixel's alpha across its four channels
+                __m256i alo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+                __m256i ahi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+                lo = _mm256_add_epi16(_mm256_mullo_epi16(lo, alo), half);
+                hi = _mm256_add_epi16(_mm256_mullo_epi16(hi, ahi), half);
+                lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+                hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+
+                __m256i result = _mm256_packus_epi16(lo, hi);
+                result = _mm256_or_si256(_mm256_andnot_si256(alphaMask, result), _mm256_and_si256(alphaMask, v));
+                _mm256_storeu_si256((__m256i*)(p + s * 4), result);
+            }
+        }
+#endif
+#if defined(OE_KERNELS_SSE2)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i half = _mm_set1_epi16(128);
+            const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+
+            for (; s + 4 <= n; s += 4)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)(p + s * 4));
+                __m128i lo = _mm_unpacklo_epi8(v, zero);
+                __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+                __m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+                __m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+                lo = _mm_add_epi16(_mm_mullo_epi16(lo, alo), half);
+                hi = _mm_add_epi16(_mm_mullo_epi16(hi, ahi), half);
+                lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+                hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+                __m128i result = _mm_packus_epi16(lo, hi);
+                result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, v));
+                _mm_storeu_si128((__m128i*)(p + s * 4), result);
+            }
+        }
+#elif defined(OE_KERNELS_NEON)
+        {
+            const uint16x8_t half = vdupq_n_u16(128);
+
+            for (; s + 16 <= n; s += 16)
+            {
+                uint8x16x4_t px = vld4q_u8(p + s * 4);
+                for (int c = 0; c < 3; ++c)
+                {
+                    uint16x8_t lo = vaddq_u16(vmull_u8(vget_low_u8(px.val[c]), vget_low_u8(px.val[3])), half);
+                    uint16x8_t hi = vaddq_u16(vmull_u8(vget_high_u8(px.val[c]), vget_high_u8(px.val[3])), half);
+                    px.val[c] = vcombine_u8(
+                        vshrn_n_u16(vsraq_n_u16(lo, lo, 8), 8),
+                        vshrn_n_u16(vsraq_n_u16(hi, hi, 8), 8));
+                }
+                vst4q_u8(p + s * 4, px);
+            }
+        }
+#endif
+        return s;
+    }
+
+    //........................................................................
+    // alpha test
+
+    // True if any of the first n pixels has alpha >= minAlpha (minAlpha > 0).
+    inline bool alphaRowAtLeast(const GLubyte* p, int n, GLubyte minAlpha)
+    {
+        int s = 0;
+#if defined(OE_KERNELS_AVX2)
+        {
+            // saturating subtract zeroes the color lanes and any alpha below minAlpha
+            const __m256i limit = _mm256_set1_epi32((int)(((unsigned)(minAlpha - 1) << 24) | 0x00FFFFFFu));
+            const __m256i zero = _mm256_setzero_si256();
+            for (; s + 8 <= n; s += 8)
+            {
+                __m256i v = _mm256_subs_epu8(_mm256_loadu_si256((const __m256i*)(p + s * 4)), limit);
+                if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)) != -1)
+                {
+                    return true;
+                }
+            }
+        }
+#endif
+#if defined(OE_KERNELS_SSE2)
+        {
+            const __m128i limit = _mm_set1_epi32((int)(((unsigned)(minAlpha - 1) << 24) | 0x00FFFFFFu));
+            const __m128i zero = _mm_setzero_si128();
+            for (; s + 4 <= n; s += 4)
+            {
+                __m128i v = _mm_subs_epu8(_mm_loadu_si128((const __m128i*)(p + s * 4)), limit);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) != 0xFFFF)
+                {
+                    return true;
+                }
+            }
+        }
+#elif defined(OE_KERNELS_NEON)
+        {
+            const uint8x16_t limit = vdupq_n_u8(minAlpha);
+            for (; s + 16 <= n; s += 16)
+            {
+                uint8x16x4_t px = vld4q_u8(p + s * 4);
+                uint8x16_t hit = vcgeq_u8(px.val[3], limit);
+                uint8x8_t any = vorr_u8(vget_low_u8(hit), vget_high_u8(hit));
+                if (vget_lane_u64(vreinterpret_u64_u8(any), 0) != 0)
+                {
+                    return true;
+                }
+            }
+        }
+#endif
+        for (; s < n; ++s)
+        {
+            if (p[s * 4 + 3] >= minAlpha)
+                return true;
+        }
+        return false;
+    }
+}
+
+namespace osgEarth { namespace Util { namespace ImageKernels
+{
+    Layout getLayout(const osg::Image* image)
+    {
+        if (!image || image->isCompressed())
+            return LAYOUT_UNSUPPORTED;
+
+        const GLenum pf = image->getPixelFormat();
+        const GLenum dt = image->getDataType();
+        const bool single = pf == GL_RED || pf == GL_LUMINANCE;
+
+        if (dt == GL_UNSIGNED_BYTE)
+        {
+            if (pf == GL_RGBA) return LAYOUT_RGBA8;
+            if (pf == GL_RGB) return LAYOUT_RGB8;
+            if (single) return LAYOUT_L8;
+        }
+        else if (dt == GL_FLOAT && single)
+        {
+            return LAYOUT_R32F;
+        }
+        else if (dt == GL_UNSIGNED_SHORT && single)
+        {
+            return LAYOUT_R16;
+        }
+        return LAYOUT_UNSUPPORTED;
+    }
+
+    const char* getInstructionSet()
+    {
+#if defined(OE_KERNELS_AVX2)
+        return "avx2";
+#elif defined(OE_KERNELS_SSE2)
+        return "sse2";
+#elif defined(OE_KERNELS_NEON)
+        return "neon";
+#else
+        return "scalar";
+#endif
+    }
+
+    bool resize(const osg::Image* input, osg::Image* output, bool bilinear)
+    {
+        if (!input || !output || input->s() == 0 || input->t() == 0)
+            return false;
+
+        Layout layout = getLayout(input);
+        if (layout == LAYOUT_UNSUPPORTED ||
+            layout != getLayout(output) ||
+            input->getPixelFormat() != output->getPixelFormat())
+        {
+            return false;
+        }
+
+        switch (layout)
+        {
+        case LAYOUT_RGBA8: resizeLayout<LAYOUT_RGBA8>(input, output, bilinear); break;
+        case LAYOUT_RGB8:  resizeLayout<LAYOUT_RGB8>(input, output, bilinear); break;
+        case LAYOUT_R32F:  resizeLayout<LAYOUT_R32F>(input, output, bilinear); break;
+        case LAYOUT_R16:   resizeLayout<LAYOUT_R16>(input, output, bilinear); break;
+        case LAYOUT_L8:    resizeLayout<LAYOUT_L8>(input, output, bilinear); break;
+        default: return false;
+        }
+        return true;
+    }
+
+    bool generateMipmaps(osg::Image* image)
+    {
+        if (!image || image->r() != 1 || image->getNumMipmapLevels() < 2 || image->getRowLength() != 0)
+            return false;
+
+        // odd dimensions need a general resampling filter
+        const int s = image->s(), t = image->t();
+        if ((s & (s - 1)) != 0 || (t & (t - 1)) != 0)
+            return false;
+
+        switch (getLayout(image))
+        {
+        case LAYOUT_RGBA8: mipmapLayout<LAYOUT_RGBA8>(image); break;
+        case LAYOUT_RGB8:  mipmapLayout<LAYOUT_RGB8>(image); break;
+        case LAYOUT_R32F:  mipmapLayout<LAYOUT_R32F>(image); break;
+        case LAYOUT_R16:   mipmapLayout<LAYOUT_R16>(image); break;
+        case LAYOUT_L8:    mipmapLayout<LAYOUT_L8>(image); break;
+        default: return false;
+        }
+        return true;
+    }
+
+    bool mix(osg::Image* dest, const osg::Image* src, float a)
+    {
+        if (!dest || !src || dest->s() != src->s() || dest->t() != src->t() || dest->r() != src->r())
+            return false;
+
+        Layout sl = getLayout(src), dl = getLayout(dest);
+        a = osg::clampBetween(a, 0.0f, 1.0f);
+
+        if (sl == LAYOUT_RGBA8 && dl == LAYOUT_RGBA8) mixLayout<4, 4>(dest, src, a);
+        else if (sl == LAYOUT_RGB8 && dl == LAYOUT_RGBA8) mixLayout<3, 4>(dest, src, a);
+        else if (sl == LAYOUT_RGBA8 && dl == LAYOUT_RGB8) mixLayout<4, 3>(dest, src, a);
+        else if (sl == LAYOUT_RGB8 && dl == LAYOUT_RGB8) mixLayout<3, 3>(dest, src, a);
+        else return false;
+
+        return true;
+    }
+
+    bool convertToRGBA8(const osg::Image* input, osg::Image* output)
+    {
+        if (!input || !output || getLayout(output) != LAYOUT_RGBA8 ||
+            input->s() != output->s() || input->t() != output->t() || input->r() != output->r())
+        {
+            return false;
+        }
+
+        Layout layout = getLayout(input);
+        if (layout != LAYOUT_RGB8 && layout != LAYOUT_L8 && layout != LAYOUT_RGBA8)
+            return false;
+
+        const int n = input->s();
+
+        for (int r = 0; r < input->r(); ++r)
+        {
+            for (int t = 0; t < input->t(); ++t)
+            {
+                const GLubyte* in = input->data(0, t, r);
+                GLubyte* out = output->data(0, t, r);
+
+                if (layout == LAYOUT_RGBA8)
+                {
+                    ::memcpy(out, in, n * 4);
+                }
+                else if (layout == LAYOUT_RGB8)
+                {
+                    for (int s = rgbToRGBARow(in, out, n); s < n; ++s)
+                    {
+                        out[s * 4 + 0] = in[s * 3 + 0];
+                        out[s * 4 + 1] = in[s * 3 + 1];
+                        out[s * 4 + 2] = in[s * 3 + 2];
+                        out[s * 4 + 3] = 255;
+                    }
+                }
+                else // LAYOUT_L8
+                {
+                    for (int s = 0; s < n; ++s)
+                    {
+                        out[s * 4 + 0] = out[s * 4 + 1] = out[s * 4 + 2] = in[s];
+                        out[s * 4 + 3] = 255;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    bool premultiplyAlpha(osg::Image* image)
+    {
+        if (getLayout(image) != LAYOUT_RGBA8)
+            return false;
+
+        const int n = image->s();
+
+        for (int r = 0; r < image->r(); ++r)
+        {
+            for (int t = 0; t < image->t(); ++t)
+            {
+                GLubyte* p = image->data(0, t, r);
+                for (int s = premultiplyRow(p, n); s < n; ++s)
+                {
+                    GLubyte* px = p + s * 4;
+                    unsigned a = px[3];
+                    px[0] = (GLubyte)div255(px[0] * a);
+                    px[1] = (GLubyte)div255(px[1] * a);
+                    px[2] = (GLubyte)div255(px[2] * a);
+                }
+            }
+        }
+        return true;
+    }
+
+    bool anyAlphaAbove(const osg::Image* image, float threshold, bool& result)
+    {
+        if (getLayout(image) != LAYOUT_RGBA8)
+            return false;
+
+        result = false;
+
+        // smallest alpha byte that passes the same test as
+        // PixelReader (normalized alpha > threshold)
+        int minAlpha = 0;
+        while (minAlpha < 256 && (float)((double)minAlpha * (1.0 / 255.0)) <= threshold)
+            ++minAlpha;
+
+        if (minAlpha > 255 || image->s() == 0)
+            return true;
+
+        if (minAlpha == 0)
+        {
+            result = image->t() > 0 && image->r() > 0;
+            return true;
+        }
+
+        for (int r = 0; r < image->r() && !result; ++r)
+        {
+            for (int t = 0; t < image->t() && !result; ++t)
+            {
+                result = alphaRowAtLeast(image->data(0, t, r), image->s(), (GLubyte)minAlpha);
+            }
+        }
+        return true;
+    }
+} } }
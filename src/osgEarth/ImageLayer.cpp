@@ -22,6 +22,7 @@
 #include <osgEarth/Progress>
 #include <osgEarth/Capabilities>
 #include <osgEarth/Metrics>
+#include <osgEarth/MetricsRegistry>
 #include <osgEarth/NetworkMonitor>
 #include <cinttypes>
 
@@ -29,6 +30,9 @@ using namespace osgEarth;
 
 #define LC "[ImageLayer] \"" << getName() << "\" "
 
+// arena used to fetch source tiles in parallel when assembling a tile
+#define ARENA_ASSEMBLE "oe.layer.assemble"
+
 // TESTING
 //#undef  OE_DEBUG
 //#define OE_DEBUG OE_INFO
@@ -370,6 +374,13 @@ ImageLayer::createImage(
 
     NetworkMonitor::ScopedRequestLayer layerRequest(getName());
 
+    static MetricsRegistry::Histogram& s_latency = MetricsRegistry::instance().histogram(
+        "osgearth_image_layer_create_image_seconds", "Time to create an image tile in an ImageLayer");
+    static MetricsRegistry::Counter& s_empty = MetricsRegistry::instance().counter(
+        "osgearth_image_layer_empty_results_total", "ImageLayer tile requests that produced no image");
+
+    MetricsRegistry::ScopedTimer timer(s_latency);
+
     // prevents 2 threads from creating the same object at the same time
     //TODO use a GATE here on the key?
     //_sentry.lock(key);
@@ -378,6 +389,9 @@ ImageLayer::createImage(
 
     //_sentry.unlock(key);
 
+    if (!result.valid())
+        s_empty.increment();
+
     return result;
 }
 
@@ -404,10 +418,9 @@ ImageLayer::createImageInKeyProfile(
     OE_DEBUG << LC << "create image for \"" << key.str() << "\", ext= "
         << key.getExtent().toString() << std::endl;
 
-    // the cache key combines the Key and the horizontal profile.
-    std::string cacheKey = Cache::makeCacheKey(
-        Stringify() << key.str() << "-" << std::hex << key.getProfile()->getHorizSignature(),
-        "image");
+    // The persistent cache key (see getCacheKey) is only formatted
+    // if we actually touch the persistent cache.
+    std::string cacheKey;
 
     // The L2 cache key includes the layer revision of course!
     char memCacheKey[64];
@@ -417,10 +430,7 @@ ImageLayer::createImageInKeyProfile(
     // Check the layer L2 cache first
     if ( _memCache.valid() )
     {
-        sprintf(memCacheKey, "%d/%s/%s", 
-            getRevision(), 
-            key.str().c_str(), 
-            key.getProfile()->getHorizSignature().c_str());
+        makeMemCacheKey(key, memCacheKey);
 
         CacheBin* bin = _memCache->getOrCreateDefaultBin();
         ReadResult result = bin->readObject(memCacheKey, 0L);
@@ -447,6 +457,8 @@ ImageLayer::createImageInKeyProfile(
     // map profile, we can try this first.
     if ( cacheBin && policy.isCacheReadable() )
     {
+        if (cacheKey.empty())
+            cacheKey = getCacheKey(key);
         ReadResult r = cacheBin->readImage(cacheKey, 0L);
         if ( r.succeeded() )
         {
@@ -515,6 +527,8 @@ ImageLayer::createImageInKeyProfile(
                 OE_INFO << LC << "WARNING! mismatched extents." << std::endl;
             }
 
+            if (cacheKey.empty())
+                cacheKey = getCacheKey(key);
             cacheBin->write(cacheKey, result.getImage(), 0L);
         }
     }
@@ -561,57 +575,63 @@ ImageLayer::assembleImage(
 
     if ( intersectingKeys.size() > 0 )
     {
-        double dst_minx, dst_miny, dst_maxx, dst_maxy;
-        key.getExtent().getBounds(dst_minx, dst_miny, dst_maxx, dst_maxy);
+        // Make sure all images in mosaic are based on "RGBA - unsigned byte" pixels.
+        // This is not the smarter choice (in some case RGB would be sufficient) but
+        // it ensure consistency between all images / layers.
+        //
+        // The main drawback is probably the CPU memory foot-print which would be reduced by allocating RGB instead of RGBA images.
+        // On GPU side, this should not change anything because of data alignements : often RGB and RGBA textures have the same memory footprint
+        //
+        auto normalize = [this](GeoImage& image)
+        {
+            if ( image.valid() && !isCoverage() &&
+                 (   (image.getImage()->getDataType() != GL_UNSIGNED_BYTE)
+                  || (image.getImage()->getPixelFormat() != GL_RGBA) ) )
+            {
+                osg::ref_ptr<osg::Image> convertedImg = ImageUtils::convertToRGBA8(image.getImage());
+                if (convertedImg.valid())
+                {
+                    image = GeoImage(convertedImg.get(), image.getExtent());
+                }
+            }
+        };
+
+        // Fetch all the intersecting tiles concurrently.
+        std::vector<GeoImage> images(intersectingKeys.size());
+
+        Threading::parallelFor(
+            JobArena::get(ARENA_ASSEMBLE),
+            intersectingKeys.size(),
+            [&](unsigned i)
+            {
+                if (progress && progress->isCanceled())
+                    return;
+
+                images[i] = createImageInKeyProfile(intersectingKeys[i], progress);
+                normalize(images[i]);
+            });
 
         // if we find at least one "real" tile in the mosaic, then the whole result tile is
         // "real" (i.e. not a fallback tile)
-        bool retry = false;
+        bool retry = progress && progress->isCanceled();
         ImageMosaic mosaic;
 
         // keep track of failed tiles.
         std::vector<TileKey> failedKeys;
 
-        for( std::vector<TileKey>::iterator k = intersectingKeys.begin(); k != intersectingKeys.end(); ++k )
+        for (unsigned i = 0; i < intersectingKeys.size(); ++i)
         {
-            GeoImage image = createImageInKeyProfile(*k, progress);
-
-            if ( image.valid() )
+            if ( images[i].valid() )
             {
-                if ( !isCoverage() )
-                {
-                    // Make sure all images in mosaic are based on "RGBA - unsigned byte" pixels.
-                    // This is not the smarter choice (in some case RGB would be sufficient) but
-                    // it ensure consistency between all images / layers.
-                    //
-                    // The main drawback is probably the CPU memory foot-print which would be reduced by allocating RGB instead of RGBA images.
-                    // On GPU side, this should not change anything because of data alignements : often RGB and RGBA textures have the same memory footprint
-                    //
-                    if (   (image.getImage()->getDataType() != GL_UNSIGNED_BYTE)
-                        || (image.getImage()->getPixelFormat() != GL_RGBA) )
-                    {
-                        osg::ref_ptr<osg::Image> convertedImg = ImageUtils::convertToRGBA8(image.getImage());
-                        if (convertedImg.valid())
-                        {
-                            image = GeoImage(convertedImg.get(), image.getExtent());
-                        }
-                    }
-                }
-
-                mosaic.getImages().push_back( TileImage(image.getImage(), *k) );
+                mosaic.getImages().push_back( TileImage(images[i].getImage(), intersectingKeys[i]) );
             }
             else
             {
                 // the tile source did not return a tile, so make a note of it.
-                failedKeys.push_back( *k );
-
-                if (progress && progress->isCanceled())
-                {
-                    retry = true;
-                    break;
-                }
+                failedKeys.push_back( intersectingKeys[i] );
             }
         }
+        images.clear();
 
         // Fail is: a) we got no data and the LOD is greater than zero; or
         // b) the operation was canceled mid-stream.
@@ -626,47 +646,49 @@ ImageLayer::assembleImage(
         // fall back on a lower resolution.
         // So now we go through the failed keys and try to fall back on lower resolution data
         // to fill in the gaps. The entire mosaic must be populated or this qualifies as a bad tile.
-        for(std::vector<TileKey>::iterator k = failedKeys.begin(); k != failedKeys.end(); ++k)
-        {
-            GeoImage image;
+        std::vector<GeoImage> fallbacks(failedKeys.size());
 
-            for(TileKey parentKey = k->createParentKey();
-                parentKey.valid() && !image.valid();
-                parentKey = parentKey.createParentKey())
+        Threading::parallelFor(
+            JobArena::get(ARENA_ASSEMBLE),
+            failedKeys.size(),
+            [&](unsigned i)
             {
-                image = createImageImplementation( parentKey, progress );
-                if ( image.valid() )
+                const TileKey& k = failedKeys[i];
+                GeoImage image;
+
+                for(TileKey parentKey = k.createParentKey();
+                    parentKey.valid() && !image.valid();
+                    parentKey = parentKey.createParentKey())
                 {
-                    GeoImage cropped;
+                    if (progress && progress->isCanceled())
+                        return;
 
-                    if ( !isCoverage() )
+                    image = createImageImplementation( parentKey, progress );
+                    if ( image.valid() )
                     {
-                        if (   (image.getImage()->getDataType() != GL_UNSIGNED_BYTE)
-                            || (image.getImage()->getPixelFormat() != GL_RGBA) )
+                        if ( !isCoverage() )
                         {
-                            osg::ref_ptr<osg::Image> convertedImg = ImageUtils::convertToRGBA8(image.getImage());
-                            if (convertedImg.valid())
-                            {
-                                image = GeoImage(convertedImg.get(), image.getExtent());
-                            }
+                            normalize(image);
+                            fallbacks[i] = image.crop( k.getExtent(), false, image.getImage()->s(), image.getImage()->t() );
                         }
 
-                        cropped = image.crop( k->getExtent(), false, image.getImage()->s(), image.getImage()->t() );
-                    }
-
-                    else
-                    {
-                        // TODO: may not work.... test; tilekey extent will <> cropped extent
-                        cropped = image.crop( k->getExtent(), true, image.getImage()->s(), image.getImage()->t(), false );
+                        else
+                        {
+                            // TODO: may not work.... test; tilekey extent will <> cropped extent
+                            fallbacks[i] = image.crop( k.getExtent(), true, image.getImage()->s(), image.getImage()->t(), false );
+                        }
                     }
-
-                    // and queue it.
-                    mosaic.getImages().push_back( TileImage(cropped.getImage(), *k) );
-
                 }
-            }
+            });
 
-            if ( !image.valid() )
+        for (unsigned i = 0; i < failedKeys.size(); ++i)
+        {
+            if ( fallbacks[i].valid() )
+            {
+                // and queue it.
+                mosaic.getImages().push_back( TileImage(fallbacks[i].getImage(), failedKeys[i]) );
+            }
+            else
             {
                 // a tile completely failed, even with fallback. Eject.
                 OE_DEBUG << LC << "Couldn't fallback on tiles for ImageMosaic" << std::endl;
@@ -674,36 +696,57 @@ ImageLayer::assembleImage(
             }
         }
 
-        // all set. Mosaic all the images together.
-        double rxmin, rymin, rxmax, rymax;
-        mosaic.getExtents( rxmin, rymin, rxmax, rymax );
+        const GeoExtent& extent = key.getExtent();
+
+        if ( mosaic.getImages().empty() )
+        {
+            OE_DEBUG << LC << "assembleImage: no data (" << key.str() << ")" << std::endl;
+        }
+        else if ( mosaic.getImages().front().getImage()->r() == 1 )
+        {
+            // Sample the tiles directly into the requesting key's extent; no need
+            // to build the full mosaic first. Coverage values are not blended.
+            osg::ref_ptr<osg::Image> image = mosaic.createImage(
+                getProfile()->getSRS(),
+                extent,
+                getTileSize(), getTileSize(),
+                !isCoverage());
 
-        mosaicedImage = GeoImage(
-            mosaic.createImage(),
-            GeoExtent( getProfile()->getSRS(), rxmin, rymin, rxmax, rymax ) );
+            if ( image.valid() )
+            {
+                result = GeoImage(image.get(), extent);
+            }
+        }
+        else
+        {
+            // 3D images: mosaic all the images together, then
+            // transform the mosaic into the requesting key's extent.
+            double rxmin, rymin, rxmax, rymax;
+            mosaic.getExtents( rxmin, rymin, rxmax, rymax );
+
+            mosaicedImage = GeoImage(
+                mosaic.createImage(),
+                GeoExtent( getProfile()->getSRS(), rxmin, rymin, rxmax, rymax ) );
+
+            if ( mosaicedImage.valid() )
+            {
+                // GeoImage::reproject() will automatically crop the image to the correct extents.
+                // so there is no need to crop after reprojection. Also note that if the SRS's are the
+                // same (even though extents are different), then this operation is technically not a
+                // reprojection but merely a resampling.
+                result = mosaicedImage.reproject(
+                    key.getProfile()->getSRS(),
+                    &extent,
+                    getTileSize(), getTileSize(),
+                    true);
+            }
+        }
     }
     else
     {
         OE_DEBUG << LC << "assembleImage: no intersections (" << key.str() << ")" << std::endl;
     }
 
-    // Final step: transform the mosaic into the requesting key's extent.
-    if ( mosaicedImage.valid() )
-    {
-        // GeoImage::reproject() will automatically crop the image to the correct extents.
-        // so there is no need to crop after reprojection. Also note that if the SRS's are the
-        // same (even though extents are different), then this operation is technically not a
-        // reprojection but merely a resampling.
-
-        const GeoExtent& extent = key.getExtent();
-
-        result = mosaicedImage.reproject(
-            key.getProfile()->getSRS(),
-            &extent,
-            getTileSize(), getTileSize(),
-            true);
-    }
-
     if (progress && progress->isCanceled())
     {
         return GeoImage::INVALID;
@@ -18,6 +18,9 @@
  */
 
 #include <osgEarth/ImageMosaic>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/SpatialReference>
+#include <cmath>
 
 #define LC "[ImageMosaic] "
 
@@ -131,4 +134,138 @@ ImageMosaic::createImage()
     return image.release();
 }
 
+osg::Image*
+ImageMosaic::createImage(
+    const SpatialReference* tileSRS,
+    const GeoExtent& extent,
+    unsigned width,
+    unsigned height,
+    bool bilinear)
+{
+    if (_images.empty() || !tileSRS || !extent.isValid() || width < 2 || height < 2)
+        return 0L;
+
+    // the first valid tile sets the tile size and the pixel format
+    const TileImage* tile = 0L;
+    for (unsigned i = 0; i < _images.size() && !tile; ++i)
+        if (_images[i]._image.valid())
+            tile = &_images[i];
+
+    if (!tile)
+        return 0L;
+
+    const int tileWidth = tile->_image->s();
+    const int tileHeight = tile->_image->t();
+
+    unsigned int minTileX = tile->_tileX, maxTileX = tile->_tileX;
+    unsigned int minTileY = tile->_tileY, maxTileY = tile->_tileY;
+    for (TileImageList::const_iterator i = _images.begin(); i != _images.end(); ++i)
+    {
+        minTileX = osg::minimum(minTileX, i->_tileX);
+        maxTileX = osg::maximum(maxTileX, i->_tileX);
+        minTileY = osg::minimum(minTileY, i->_tileY);
+        maxTileY = osg::maximum(maxTileY, i->_tileY);
+    }
+
+    const int tilesWide = maxTileX - minTileX + 1;
+    const int tilesHigh = maxTileY - minTileY + 1;
+
+    // Tile lookup: one reader per grid cell of the (virtual) mosaic, with
+    // row 0 at the bottom to match image row order.
+    std::vector<ImageUtils::PixelReader> readers(tilesWide*tilesHigh);
+    for (TileImageList::const_iterator i = _images.begin(); i != _images.end(); ++i)
+    {
+        if (i->_image.valid())
+        {
+            int cell = (maxTileY - i->_tileY)*tilesWide + (i->_tileX - minTileX);
+            readers[cell].setImage(i->_image.get());
+        }
+    }
+
+    double minX, minY, maxX, maxY;
+    getExtents(minX, minY, maxX, maxY);
+
+    const int pixelsWide = tilesWide * tileWidth;
+    const int pixelsHigh = tilesHigh * tileHeight;
+    const double pixelsPerX = (double)pixelsWide / (maxX - minX);
+    const double pixelsPerY = (double)pixelsHigh / (maxY - minY);
+
+    // Reads a pixel of the virtual mosaic; missing tiles read as
+    // transparent white, as in createImage().
+    osg::Vec4f texel;
+    auto read = [&](int px, int py, osg::Vec4f& out)
+    {
+        px = osg::clampBetween(px, 0, pixelsWide - 1);
+        py = osg::clampBetween(py, 0, pixelsHigh - 1);
+        const ImageUtils::PixelReader& reader = readers[(py / tileHeight)*tilesWide + (px / tileWidth)];
+        if (reader._image == 0L)
+        {
+            out.set(1, 1, 1, 0);
+            return;
+        }
+        int s = px % tileWidth, t = py % tileHeight;
+        if (reader.s() != tileWidth) s = s * reader.s() / tileWidth;
+        if (reader.t() != tileHeight) t = t * reader.t() / tileHeight;
+        reader(out, s, t);
+    };
+
+    // pixel centers of the output image, in the tile SRS (column-major)
+    const double dx = extent.width() / (double)width;
+    const double dy = extent.height() / (double)height;
+    std::vector<double> xs(width*height), ys(width*height);
+
+    if (!extent.getSRS()->transformExtentPoints(
+        tileSRS,
+        extent.xMin() + 0.5*dx, extent.yMin() + 0.5*dy,
+        extent.xMax() - 0.5*dx, extent.yMax() - 0.5*dy,
+        &xs[0], &ys[0], width, height))
+    {
+        return 0L;
+    }
+
+    osg::ref_ptr<osg::Image> image = new osg::Image();
+    image->allocateImage(width, height, 1, tile->_image->getPixelFormat(), tile->_image->getDataType());
+    image->setInternalTextureFormat(tile->_image->getInternalTextureFormat());
+    memset(image->data(), 0, image->getTotalSizeInBytes());
+
+    ImageUtils::PixelWriter write(image.get());
+    osg::Vec4f color, ll, lr, ul, ur;
+
+    unsigned p = 0;
+    for (unsigned c = 0; c < width; ++c)
+    {
+        for (unsigned r = 0; r < height; ++r, ++p)
+        {
+            double x = xs[p], y = ys[p];
+            if (x < minX || x > maxX || y < minY || y > maxY)
+                continue;
+
+            // mosaic pixel coordinates, with pixel centers on the integers
+            double px = (x - minX)*pixelsPerX - 0.5;
+            double py = (y - minY)*pixelsPerY - 0.5;
+
+            if (!bilinear)
+            {
+                read((int)floor(px + 0.5), (int)floor(py + 0.5), color);
+            }
+            else
+            {
+                int px0 = (int)floor(px), py0 = (int)floor(py);
+                float fx = (float)(px - (double)px0), fy = (float)(py - (double)py0);
+                read(px0, py0, ll);
+                read(px0 + 1, py0, lr);
+                read(px0, py0 + 1, ul);
+                read(px0 + 1, py0 + 1, ur);
+                color =
+                    (ll*(1.0f - fx) + lr*fx) * (1.0f - fy) +
+                    (ul*(1.0f - fx) + ur*fx) * fy;
+            }
+
+            write(color, c, r);
+        }
+    }
+
+    return image.release();
+}
+
 /***************************************************************************/
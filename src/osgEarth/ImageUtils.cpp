@@ -18,6 +18,7 @@
  */
 
 #include <osgEarth/ImageUtils>
+#include <osgEarth/ImageKernels>
 #include <osgEarth/Registry>
 #include <osgEarth/Capabilities>
 #include <osgEarth/Metrics>
@@ -213,6 +214,10 @@ ImageUtils::resizeImage(const osg::Image* input,
     {
         memcpy( output->data(), input->data(), input->getTotalSizeInBytes() );
     }
+    else if ( mipmapLevel == 0 && ImageKernels::resize(input, output.get(), bilinear) )
+    {
+        // handled by a format-specialized kernel
+    }
     else
     {
         PixelReader read( input );
@@ -518,20 +523,24 @@ ImageUtils::mipmapImage(const osg::Image* input)
     psm.pack_row_length = input->getRowLength();
     psm.unpack_alignment = input->getPacking();
 
-    for(int level=1; level<numLevels; ++level)
+    // power-of-two images in the common formats use a box-filter kernel
+    if (!ImageKernels::generateMipmaps(output))
     {
-        // OSG-custom gluScaleImage that does not require a graphics context
-        GLint status = gluScaleImage(
-            &psm,
-            output->getPixelFormat(),
-            output->s(),
-            output->t(),
-            output->getDataType(),
-            output->data(),
-            output->s() >> level,
-            output->t() >> level,
-            output->getDataType(),
-            output->getMipmapData(level));
+        for(int level=1; level<numLevels; ++level)
+        {
+            // OSG-custom gluScaleImage that does not require a graphics context
+            GLint status = gluScaleImage(
+                &psm,
+                output->getPixelFormat(),
+                output->s(),
+                output->t(),
+                output->getDataType(),
+                output->data(),
+                output->s() >> level,
+                output->t() >> level,
+                output->getDataType(),
+                output->getMipmapData(level));
+        }
     }
 
     return output;
@@ -604,20 +613,24 @@ ImageUtils::mipmapImageInPlace(osg::Image* input)
     psm.pack_row_length = input->getRowLength();
     psm.unpack_alignment = input->getPacking();
 
-    for(int level=1; level<numLevels; ++level)
-    {
-        // OSG-custom gluScaleImage that does not require a graphics context
-        GLint status = gluScaleImage(
-            &psm,
-            input->getPixelFormat(),
-            input->s(),
-            input->t(),
-            input->getDataType(),
-            input->data(),
-            input->s() >> level,
-            input->t() >> level,
-            input->getDataType(),
-            input->getMipmapData(level));
+    // power-of-two images in the common formats use a box-filter kernel
+    if (!ImageKernels::generateMipmaps(input))
+    {
+        for(int level=1; level<numLevels; ++level)
+        {
+            // OSG-custom gluScaleImage that does not require a graphics context
+            GLint status = gluScaleImage(
+                &psm,
+                input->getPixelFormat(),
+                input->s(),
+                input->t(),
+                input->getDataType(),
+                input->data(),
+                input->s() >> level,
+                input->t() >> level,
+                input->getDataType(),
+                input->getMipmapData(level));
+        }
     }
 }
 
@@ -918,6 +931,9 @@ ImageUtils::mix(osg::Image* dest, const osg::Image* src, float a)
         return false;
     }
 
+    if (ImageKernels::mix(dest, src, a))
+        return true;
+
     PixelVisitor<MixImage> mixer;
     mixer._a = osg::clampBetween( a, 0.0f, 1.0f );
     mixer._srcHasAlpha = hasAlphaChannel(src); //src->getPixelSizeInBits() == 32;
@@ -1085,6 +1101,10 @@ ImageUtils::isEmptyImage(const osg::Image* image, float alphaThreshold)
     if ( !hasAlphaChannel(image) || !PixelReader::supports(image) )
         return false;
 
+    bool visible;
+    if (ImageKernels::anyAlphaAbove(image, alphaThreshold, visible))
+        return !visible;
+
     PixelReader read(image);
     for(unsigned r=0; r<(unsigned)image->r(); ++r)
     {
@@ -1280,35 +1300,15 @@ ImageUtils::convert(const osg::Image* image, GLenum pixelFormat, GLenum dataType
         return cloneImage(image);
     }
 
-    // Fast conversion if possible : RGB8 to RGBA8
-    if ( dataType == GL_UNSIGNED_BYTE && pixelFormat == GL_RGBA && image->getDataType() == GL_UNSIGNED_BYTE && image->getPixelFormat() == GL_RGB)
+    // Fast conversion if possible : RGB8 or L8 to RGBA8
+    if ( dataType == GL_UNSIGNED_BYTE && pixelFormat == GL_RGBA &&
+         (ImageKernels::getLayout(image) == ImageKernels::LAYOUT_RGB8 ||
+          ImageKernels::getLayout(image) == ImageKernels::LAYOUT_L8) )
     {
-        // Do fast conversion
         osg::Image* result = new osg::Image();
         result->allocateImage(image->s(), image->t(), image->r(), GL_RGBA, GL_UNSIGNED_BYTE);
         result->setInternalTextureFormat(GL_RGBA8);
-
-        const unsigned char* pSrcData = image->data();
-        unsigned char* pDstData = result->data();
-        int srcIndex = 0;
-        int dstIndex = 0;
-
-        // Convert all pixels except last one by reading 32bits chunks
-        for (int i=0; i<image->t()*image->s()*image->r()-1; i++)
-        {
-            unsigned int srcValue = *((const unsigned int*) (pSrcData + srcIndex)) | 0xFF000000;
-            *((unsigned int*) (pDstData + dstIndex)) = srcValue;
-
-            srcIndex += 3;
-            dstIndex += 4;
-        }
-
-        // Convert last pixel
-        pDstData[dstIndex + 0] = pSrcData[srcIndex + 0];
-        pDstData[dstIndex + 1] = pSrcData[srcIndex + 1];
-        pDstData[dstIndex + 2] = pSrcData[srcIndex + 2];
-        pDstData[dstIndex + 3] = 0xFF;
-
+        ImageKernels::convertToRGBA8(image, result);
         return result;
     }
 
@@ -1446,6 +1446,9 @@ ImageUtils::convertToPremultipliedAlpha(osg::Image* image)
     if ( !PixelReader::supports(image) || !PixelWriter::supports(image) )
         return false;
 
+    if (ImageKernels::premultiplyAlpha(image))
+        return true;
+
     PixelReader read(image);
     PixelWriter write(image);
     for(int r=0; r<image->r(); ++r) {
@@ -19,11 +19,17 @@
 #include <osgEarth/LandCover>
 #include <osgEarth/XmlUtils>
 #include <osgEarth/Registry>
+#include <osgEarth/ImageKernels>
+#include <osgEarth/ImageUtils>
 #include <osg/Texture2D>
+#include <algorithm>
+#include <cfloat>
+#include <map>
 
 #define LC "[LandCover] "
 
 using namespace osgEarth;
+using namespace osgEarth::Util;
 
 //............................................................................
 
@@ -293,6 +299,228 @@ LandCoverValueMapping::getConfig() const
 
 //...........................................................................
 
+#undef  LC
+#define LC "[LandCoverCodeTable] "
+
+namespace
+{
+    // Codes above this go into the sorted list instead of the dense table
+    const int MAX_DENSE_CODE = 65535;
+
+    template<typename T>
+    unsigned reclassifyRows(
+        const osg::Image* input, unsigned stride,
+        osg::Image* output, const float* table)
+    {
+        unsigned numWritten = 0u;
+        for (int t = 0; t < output->t(); ++t)
+        {
+            const T* in = (const T*)input->data(0, t);
+            float* out = (float*)output->data(0, t);
+            for (int s = 0; s < output->s(); ++s, in += stride)
+            {
+                out[s] = table[*in];
+                numWritten += (out[s] != NO_DATA_VALUE) ? 1u : 0u;
+            }
+        }
+        return numWritten;
+    }
+}
+
+LandCoverCodeTable::LandCoverCodeTable() :
+    _numMapped(0u)
+{
+    std::fill(_byteTable, _byteTable + 256, NO_DATA_VALUE);
+}
+
+void
+LandCoverCodeTable::compile(
+    const LandCoverValueMappingVector& mappings,
+    const LandCoverDictionary* dictionary)
+{
+    std::vector<std::pair<int, int> > codeToValue;
+    codeToValue.reserve(mappings.size());
+
+    for (LandCoverValueMappingVector::const_iterator k = mappings.begin();
+        k != mappings.end();
+        ++k)
+    {
+        const LandCoverValueMapping* mapping = k->get();
+        const LandCoverClass* lcClass = dictionary ?
+            dictionary->getClassByName(mapping->getLandCoverClassName()) : 0L;
+        if (lcClass)
+        {
+            codeToValue.push_back(std::make_pair(mapping->getValue(), lcClass->getValue()));
+        }
+    }
+
+    compile(codeToValue);
+}
+
+void
+LandCoverCodeTable::compile(const std::vector<std::pair<int, int> >& codeToValue)
+{
+    _dense.clear();
+    _sparse.clear();
+    _numMapped = 0u;
+
+    int highestCode = -1;
+    for (unsigned i = 0; i < codeToValue.size(); ++i)
+    {
+        if (codeToValue[i].first >= 0)
+            highestCode = osg::maximum(highestCode, codeToValue[i].first);
+    }
+
+    // later mappings override earlier ones, as they always have
+    std::map<int, float> mapped;
+    for (unsigned i = 0; i < codeToValue.size(); ++i)
+    {
+        if (codeToValue[i].first >= 0)
+        {
+            if (codeToValue[i].second >= 0)
+                mapped[codeToValue[i].first] = (float)codeToValue[i].second;
+            else
+                mapped.erase(codeToValue[i].first);
+        }
+    }
+    _numMapped = mapped.size();
+
+    if (highestCode <= MAX_DENSE_CODE)
+    {
+        _dense.assign(highestCode + 1, NO_DATA_VALUE);
+        for (std::map<int, float>::const_iterator i = mapped.begin(); i != mapped.end(); ++i)
+            _dense[i->first] = i->second;
+    }
+    else
+    {
+        OE_DEBUG << LC << "Highest code " << highestCode << " is too large for a dense table; using a sorted list" << std::endl;
+        _sparse.assign(mapped.begin(), mapped.end());
+    }
+
+    // Evaluate every possible 8-bit input exactly as the PixelReader would
+    // present it, so the byte path matches per-pixel reclassification.
+    for (unsigned b = 0; b < 256; ++b)
+    {
+        _byteTable[b] = reclassify((float)((double)b * (1.0 / 255.0)));
+    }
+}
+
+float
+LandCoverCodeTable::lookup(int code) const
+{
+    if (code < 0)
+        return NO_DATA_VALUE;
+
+    if (code < (int)_dense.size())
+        return _dense[code];
+
+    if (!_sparse.empty())
+    {
+        std::vector<std::pair<int, float> >::const_iterator i = std::lower_bound(
+            _sparse.begin(), _sparse.end(), std::make_pair(code, -FLT_MAX));
+        if (i != _sparse.end() && i->first == code)
+            return i->second;
+    }
+
+    return NO_DATA_VALUE;
+}
+
+float
+LandCoverCodeTable::reclassify(float value) const
+{
+    // the negated comparisons also reject NaN
+    if (value == NO_DATA_VALUE || !(value < 2147483647.0f))
+        return NO_DATA_VALUE;
+
+    if (value < 1.0f)
+    {
+        // normalized code; convert to unnormalized.
+        // e.g., data coming from a server might be encoded this way
+        return value > -1.0f ? lookup((int)(value*255.0f)) : NO_DATA_VALUE;
+    }
+
+    return lookup((int)value);
+}
+
+unsigned
+LandCoverCodeTable::reclassify(const osg::Image* input, osg::Image* output) const
+{
+    if (!input || !output)
+        return 0u;
+
+    // Raw single-pass paths. Each reads the first channel of the input at
+    // the output's dimensions, just like the per-pixel fallback below.
+    if (ImageKernels::getLayout(output) == ImageKernels::LAYOUT_R32F &&
+        input->s() >= output->s() && input->t() >= output->t())
+    {
+        switch (ImageKernels::getLayout(input))
+        {
+        case ImageKernels::LAYOUT_L8:
+            return reclassifyRows<GLubyte>(input, 1, output, _byteTable);
+        case ImageKernels::LAYOUT_RGB8:
+            return reclassifyRows<GLubyte>(input, 3, output, _byteTable);
+        case ImageKernels::LAYOUT_RGBA8:
+            return reclassifyRows<GLubyte>(input, 4, output, _byteTable);
+
+        case ImageKernels::LAYOUT_R16:
+        {
+            unsigned numWritten = 0u;
+            for (int t = 0; t < output->t(); ++t)
+            {
+                const GLushort* in = (const GLushort*)input->data(0, t);
+                float* out = (float*)output->data(0, t);
+                for (int s = 0; s < output->s(); ++s)
+                {
+                    out[s] = lookup(in[s]);
+                    numWritten += (out[s] != NO_DATA_VALUE) ? 1u : 0u;
+                }
+            }
+            return numWritten;
+        }
+
+        case ImageKernels::LAYOUT_R32F:
+        {
+            unsigned numWritten = 0u;
+            for (int t = 0; t < output->t(); ++t)
+            {
+                const float* in = (const float*)input->data(0, t);
+                float* out = (float*)output->data(0, t);
+                for (int s = 0; s < output->s(); ++s)
+                {
+                    out[s] = reclassify(in[s]);
+                    numWritten += (out[s] != NO_DATA_VALUE) ? 1u : 0u;
+                }
+            }
+            return numWritten;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    // Any other format goes through the PixelReader.
+    ImageUtils::PixelReader read(input);
+    ImageUtils::PixelWriter write(output);
+    osg::Vec4 pixel;
+    unsigned numWritten = 0u;
+
+    for (int t = 0; t < output->t(); ++t)
+    {
+        for (int s = 0; s < output->s(); ++s)
+        {
+            read(pixel, s, t);
+            pixel.r() = reclassify(pixel.r());
+            write(pixel, s, t);
+            if (pixel.r() != NO_DATA_VALUE)
+                ++numWritten;
+        }
+    }
+    return numWritten;
+}
+
+//...........................................................................
+
 #undef  LC
 #define LC "[LandCoverCoverageLayer] "
 
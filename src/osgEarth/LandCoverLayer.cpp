@@ -289,62 +289,9 @@ LandCoverLayer::createImageImplementation(const TileKey& key, ProgressCallback*
 
         osg::ref_ptr<osg::Image> output = LandCover::createImage(getTileSize());
 
-        ImageUtils::PixelReader read(img.getImage());
-        ImageUtils::PixelWriter write(output.get());
-
-        osg::Vec4 pixel;
-        bool wrotePixel;
-        unsigned pixelsWritten = 0u;
-
-        // Transcode the layer-specific codes into the dictionary codes:
-        for (int t = 0; t < output->t(); ++t)
-        {
-            for (int s = 0; s < output->s(); ++s)
-            {
-                read(pixel, s, t);
-
-                wrotePixel = false;
-
-                if (pixel.r() != NO_DATA_VALUE)
-                {
-                    if (pixel.r() < 1.0f)
-                    {
-                        // normalized code; convert to unnormalized.
-                        // e.g., data coming from a server might be encoded this way
-                        int code = (int)(pixel.r()*255.0f);
-                        if (code < _codemap.size())
-                        {
-                            int value = _codemap[code];
-                            if (value >= 0)
-                            {
-                                pixel.r() = (float)value;
-                                write(pixel, s, t);
-                                wrotePixel = true;
-                                pixelsWritten++;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        // unnormalized
-                        int code = (int)pixel.r();
-                        if (code < _codemap.size() && _codemap[code] >= 0)
-                        {
-                            pixel.r() = (float)_codemap[code];
-                            write(pixel, s, t);
-                            wrotePixel = true;
-                            pixelsWritten++;
-                        }
-                    }
-                }
-
-                if (!wrotePixel)
-                {
-                    pixel.r() = NO_DATA_VALUE;
-                    write(pixel, s, t);
-                }
-            }
-        }
+        // Transcode the layer-specific codes into the dictionary codes
+        // in a single table-driven pass:
+        unsigned pixelsWritten = _codemap.reclassify(img.getImage(), output.get());
 
         if (pixelsWritten > 0)
             return GeoImage(output.get(), key.getExtent());
@@ -556,7 +503,7 @@ LandCoverLayer::createFractalEnhancedImage(const TileKey& key, ProgressCallback*
 // Constructs a code map (int to int) for a coverage layer. We will use this
 // code map to map coverage layer codes to dictionary codes.
 void
-LandCoverLayer::buildCodeMap(CodeMap& codemap)
+LandCoverLayer::buildCodeMap(LandCoverCodeTable& codemap)
 {
     if (options().mappings().empty()) {
         OE_WARN << LC << "ILLEGAL: no coverage mappings\n";
@@ -569,32 +516,7 @@ LandCoverLayer::buildCodeMap(CodeMap& codemap)
 
     //OE_INFO << LC << "Building code map for " << coverage->getName() << "..." << std::endl;
 
-    int highestValue = 0;
-
-    for (LandCoverValueMappingVector::const_iterator k = options().mappings().begin();
-        k != options().mappings().end();
-        ++k)
-    {
-        const LandCoverValueMapping* mapping = k->get();
-        int value = mapping->getValue();
-        if (value > highestValue)
-            highestValue = value;
-    }
-
-    codemap.assign(highestValue + 1, -1);
-
-    for (LandCoverValueMappingVector::const_iterator k = options().mappings().begin();
-        k != options().mappings().end();
-        ++k)
-    {
-        const LandCoverValueMapping* mapping = k->get();
-        int value = mapping->getValue();
-        const LandCoverClass* lcClass = _lcDictionary->getClassByName(mapping->getLandCoverClassName());
-        if (lcClass)
-        {
-            codemap[value] = lcClass->getValue();
-        }
-    }
+    codemap.compile(options().mappings(), _lcDictionary.get());
 }
 
 //........................................................................
@@ -614,6 +536,110 @@ LandCoverLayerVector::LandCoverLayerVector(const LandCoverLayerVector& rhs) :
     //nop
 }
 
+namespace
+{
+    // Column (or row) of a component tile to read for each output column
+    // (or row), given the scale/bias into that tile.
+    void buildIndex(std::vector<int>& index, int count, double scale, double bias, int limit)
+    {
+        index.resize(count);
+        for (int i = 0; i < count; ++i)
+            index[i] = osg::clampBetween((int)(i*scale + bias), 0, limit - 1);
+    }
+
+    // Whether a (scaled/biased) window of a land cover image
+    // contains any NO_DATA values.
+    bool containsNoData(const osg::Image* image, int width, int height,
+                        double scale, double sbias, double tbias)
+    {
+        std::vector<int> sIndex, tIndex;
+        buildIndex(sIndex, width, scale, sbias, image->s());
+        buildIndex(tIndex, height, scale, tbias, image->t());
+
+        if (LandCover::isLandCover(image))
+        {
+            for (int t = 0; t < height; ++t)
+            {
+                const float* in = (const float*)image->data(0, tIndex[t]);
+                for (int s = 0; s < width; ++s)
+                {
+                    if (in[sIndex[s]] == NO_DATA_VALUE)
+                        return true;
+                }
+            }
+        }
+        else
+        {
+            ImageUtils::PixelReader read(image);
+            osg::Vec4 value;
+            for (int t = 0; t < height; ++t)
+            {
+                for (int s = 0; s < width; ++s)
+                {
+                    read(value, sIndex[s], tIndex[t]);
+                    if (value.r() == NO_DATA_VALUE)
+                        return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Fills the NO_DATA values in "output" from the (scaled/biased) "input"
+    // image and returns the number of NO_DATA values that remain.
+    unsigned compositeUnder(osg::Image* output, const osg::Image* input,
+                            double scale, double sbias, double tbias)
+    {
+        std::vector<int> sIndex, tIndex;
+        buildIndex(sIndex, output->s(), scale, sbias, input->s());
+        buildIndex(tIndex, output->t(), scale, tbias, input->t());
+
+        unsigned numNoDataValues = 0u;
+
+        if (LandCover::isLandCover(output) && LandCover::isLandCover(input))
+        {
+            for (int t = 0; t < output->t(); ++t)
+            {
+                float* out = (float*)output->data(0, t);
+                const float* in = (const float*)input->data(0, tIndex[t]);
+                for (int s = 0; s < output->s(); ++s)
+                {
+                    if (out[s] == NO_DATA_VALUE)
+                    {
+                        out[s] = in[sIndex[s]];
+                        if (out[s] == NO_DATA_VALUE)
+                            numNoDataValues++;
+                    }
+                }
+            }
+        }
+        else
+        {
+            ImageUtils::PixelReader readInput(input);
+            ImageUtils::PixelReader readOutput(output);
+            ImageUtils::PixelWriter writeOutput(output);
+            osg::Vec4 value;
+
+            for (int t = 0; t < output->t(); ++t)
+            {
+                for (int s = 0; s < output->s(); ++s)
+                {
+                    readOutput(value, s, t);
+                    if (value.r() == NO_DATA_VALUE)
+                    {
+                        readInput(value, sIndex[s], tIndex[t]);
+                        if (value.r() == NO_DATA_VALUE)
+                            numNoDataValues++;
+                        else
+                            writeOutput(value, s, t);
+                    }
+                }
+            }
+        }
+        return numNoDataValues;
+    }
+}
+
 // Composites a vector of land cover images into a single image.
 bool
 LandCoverLayerVector::populateLandCoverImage(
@@ -638,7 +664,6 @@ LandCoverLayerVector::populateLandCoverImage(
     bool fallback = false;          // whether to fall back on parent tiles for a component
     bool needsClone = false;        // whether to clone the output image
 
-    osg::Vec4 value;
     unsigned numValues = 0u;
     unsigned numNoDataValues = 1u;
 
@@ -678,32 +703,20 @@ LandCoverLayerVector::populateLandCoverImage(
         if (!comp.valid())
             continue;  
         
-        ImageUtils::PixelReader readInput(comp.getImage());
+        const osg::Image* input = comp.getImage();
 
         // scale and bias to read an ancestor (fallback) tile if necessary.
         double 
             scale = compScaleBias(0,0), 
-            sbias = compScaleBias(3,0)*readInput.s(),
-            tbias = compScaleBias(3,1)*readInput.t();
+            sbias = compScaleBias(3,0)*input->s(),
+            tbias = compScaleBias(3,1)*input->t();
 
         // If this is the first image, scan the image for NO_DATA values.
         if (!output.valid())
         {
-            numNoDataValues = 0u;
-
-            for(int t=0; t<readInput.t() && numNoDataValues == 0u; ++t)
-            {
-                for(int s=0; s<readInput.s() && numNoDataValues == 0u; ++s)
-                {
-                    readInput(value, (int)(s*scale+sbias), (int)(t*scale+tbias));
-                    if (value.r() == NO_DATA_VALUE)
-                    {
-                        numNoDataValues++;
-                    }
-                }
-            }
+            numNoDataValues = containsNoData(input, input->s(), input->t(), scale, sbias, tbias) ? 1u : 0u;
 
-            output = const_cast<osg::Image*>(comp.getImage());
+            output = const_cast<osg::Image*>(input);
             numValues = output->s() * output->t();
             needsClone = true;
             fallback = true;
@@ -720,28 +733,7 @@ LandCoverLayerVector::populateLandCoverImage(
 
         // now composite this image under the previous one, 
         // accumulating a count of NO_DATA values along the way.
-        ImageUtils::PixelReader readOutput(output.get());
-        ImageUtils::PixelWriter writeOutput(output.get());
-
-        numNoDataValues = 0u;
-
-        for(int t=0; t<readOutput.t(); ++t)
-        {
-            for(int s=0; s<readOutput.s(); ++s)
-            {
-                readOutput(value, s, t);
-
-                if (value.r() == NO_DATA_VALUE)
-                {
-                    readInput(value, (int)(s*scale+sbias), (int)(t*scale+tbias));
-
-                    if (value.r() == NO_DATA_VALUE)
-                        numNoDataValues++;
-                    else
-                        writeOutput(value, s, t);
-                }
-            }
-        }
+        numNoDataValues = compositeUnder(output.get(), input, scale, sbias, tbias);
     }
 
     // If the image is ALL nodata ... return NULL.
@@ -186,6 +186,11 @@ bool MBTilesImageLayer::putMetaData(const std::string& name, const std::string&
     return _driver.putMetaData(name, value);
 }
 
+Status MBTilesImageLayer::merge(const std::string& filename)
+{
+    return _driver.merge(filename);
+}
+
 //...................................................................
 
 Config
@@ -317,6 +322,11 @@ bool MBTilesElevationLayer::putMetaData(const std::string& name, const std::stri
     return _driver.putMetaData(name, value);
 }
 
+Status MBTilesElevationLayer::merge(const std::string& filename)
+{
+    return _driver.merge(filename);
+}
+
 //...................................................................
 
 #undef LC
@@ -883,6 +893,55 @@ MBTiles::Driver::putMetaData(const std::string& key, const std::string& value)
     return true;
 }
 
+Status
+MBTiles::Driver::merge(const std::string& filename)
+{
+    Threading::ScopedMutexLock exclusiveLock(_mutex);
+
+    sqlite3* database = (sqlite3*)_database;
+    if (!database)
+        return Status(Status::ResourceUnavailable, "Database is not open");
+
+    // Attach the other database and copy its tiles table in one transaction;
+    // much faster than decoding and re-encoding each tile.
+    sqlite3_stmt* attach = 0L;
+    std::string query = "ATTACH DATABASE ? AS shard";
+    if (SQLITE_OK != sqlite3_prepare_v2(database, query.c_str(), -1, &attach, 0L))
+    {
+        return Status(Status::GeneralError, Stringify()
+            << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database));
+    }
+    sqlite3_bind_text(attach, 1, filename.c_str(), filename.length(), SQLITE_STATIC);
+    int rc = sqlite3_step(attach);
+    sqlite3_finalize(attach);
+    if (rc != SQLITE_DONE)
+    {
+        return Status(Status::ResourceUnavailable, Stringify()
+            << "Failed to attach \"" << filename << "\": " << sqlite3_errmsg(database));
+    }
+
+    Status status;
+    char* errorMsg = 0L;
+    query =
+        "BEGIN TRANSACTION; "
+        "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) "
+        "SELECT zoom_level, tile_column, tile_row, tile_data FROM shard.tiles; "
+        "COMMIT;";
+    if (SQLITE_OK != sqlite3_exec(database, query.c_str(), 0L, 0L, &errorMsg))
+    {
+        status = Status(Status::GeneralError, Stringify()
+            << "Failed to merge \"" << filename << "\": " << (errorMsg ? errorMsg : "unknown error"));
+        sqlite3_free(errorMsg);
+        sqlite3_exec(database, "ROLLBACK;", 0L, 0L, 0L);
+    }
+
+    sqlite3_exec(database, "DETACH DATABASE shard;", 0L, 0L, 0L);
+
+    computeLevels();
+
+    return status;
+}
+
 void
 MBTiles::Driver::computeLevels()
 {
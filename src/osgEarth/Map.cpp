@@ -19,6 +19,7 @@
 #include <osgEarth/Map>
 #include <osgEarth/MapModelChange>
 #include <osgEarth/Registry>
+#include <osgEarth/TileKey>
 
 using namespace osgEarth;
 
@@ -270,6 +271,10 @@ Map::setProfile(const Profile* value)
             _profileNoVDatum = _profile;
         }
 
+        // Terrain engines key their tiles by TileID, so claim an intern
+        // slot for the map profile before layers start filling the table.
+        TileID::internProfile(_profile.get());
+
         // finally, fire an event if the profile has been set.
         OE_INFO << LC << "Map profile is: " << _profile->toString() << std::endl;
     }
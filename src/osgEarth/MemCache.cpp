@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/MemCache>
+#include <osgEarth/MetricsRegistry>
 
 using namespace osgEarth;
 
@@ -35,7 +36,10 @@ namespace
     {
         MemCacheBin( const std::string& id, unsigned maxSize )
             : CacheBin( id ),
-              _lru    ( true /* MT-safe */, maxSize )
+              _lru    ( true /* MT-safe */, maxSize ),
+              _reads  ( MetricsRegistry::instance().counter("osgearth_cache_reads_total", "Cache bin read requests", "driver=\"memory\"") ),
+              _hits   ( MetricsRegistry::instance().counter("osgearth_cache_hits_total", "Cache bin reads that found a record", "driver=\"memory\"") ),
+              _writes ( MetricsRegistry::instance().counter("osgearth_cache_writes_total", "Cache bin writes", "driver=\"memory\"") )
         {
             //nop
         }
@@ -45,6 +49,10 @@ namespace
             MemCacheLRU::Record rec;
             _lru.get(key, rec);
 
+            _reads.increment();
+            if (rec.valid())
+                _hits.increment();
+
             // clone required since the cache is in memory
 
             if ( rec.valid() )
@@ -77,6 +85,7 @@ namespace
         {
             if ( object ) 
             {
+                _writes.increment();
 #ifdef CLONE_DATA
                 osg::ref_ptr<const osg::Object> cloned = osg::clone(object, osg::CopyOp::DEEP_COPY_ALL);
                 _lru.insert( key, std::make_pair(cloned.get(), meta) );
@@ -120,6 +129,9 @@ namespace
         }
 
         MemCacheLRU _lru;
+        MetricsRegistry::Counter& _reads;
+        MetricsRegistry::Counter& _hits;
+        MetricsRegistry::Counter& _writes;
     };
     
 
@@ -0,0 +1,251 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/MergeScheduler>
+#include <algorithm>
+#include <chrono>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[MergeScheduler] "
+
+namespace
+{
+    // weight of the newest sample in the moving average cost
+    const double COST_ALPHA = 0.2;
+
+    // heap order: higher priority first, then first come first served
+    struct RunsLater
+    {
+        template<typename ENTRY>
+        bool operator()(const ENTRY& lhs, const ENTRY& rhs) const
+        {
+            if (lhs._priority != rhs._priority)
+                return lhs._priority < rhs._priority;
+            return lhs._sequence > rhs._sequence;
+        }
+    };
+
+    std::uint64_t steadyClockMicros()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+MergeScheduler::MergeScheduler(const std::string& metricsPrefix) :
+    _sequence(0u),
+    _maxMergesPerFrame(0u),
+    _timeBudget(0u),
+    _clock(steadyClockMicros),
+    _mutex("OE.MergeScheduler"),
+    _queueDepth(nullptr),
+    _merges(nullptr),
+    _mergeTime(nullptr),
+    _waitTime(nullptr)
+{
+    if (!metricsPrefix.empty())
+    {
+        MetricsRegistry& reg = MetricsRegistry::instance();
+
+        _queueDepth = &reg.gauge(
+            metricsPrefix + "_merge_queue_depth",
+            "Loaded data waiting to merge into the scene graph");
+
+        _merges = &reg.counter(
+            metricsPrefix + "_merges_total",
+            "Loaded data merged into the scene graph");
+
+        _mergeTime = &reg.histogram(
+            metricsPrefix + "_merge_seconds",
+            "Time spent merging one result into the scene graph");
+
+        _waitTime = &reg.histogram(
+            metricsPrefix + "_merge_wait_seconds",
+            "Time between a result being ready to merge and being merged");
+    }
+}
+
+MergeScheduler::~MergeScheduler()
+{
+    clear();
+}
+
+void
+MergeScheduler::setMaxMergesPerFrame(unsigned value)
+{
+    _maxMergesPerFrame = value;
+}
+
+void
+MergeScheduler::setTimeBudget(unsigned micros)
+{
+    _timeBudget = micros;
+}
+
+void
+MergeScheduler::push(const Merge& merge, const Priority& priority, const std::string& category)
+{
+    push(merge, priority, priority ? priority() : 0.0f, category);
+}
+
+void
+MergeScheduler::push(const Merge& merge, float priority, const std::string& category)
+{
+    push(merge, nullptr, priority, category);
+}
+
+void
+MergeScheduler::push(const Merge& merge, const Priority& priorityFunction, float priority, const std::string& category)
+{
+    Entry entry;
+    entry._merge = merge;
+    entry._priorityFunction = priorityFunction;
+    entry._priority = priority;
+    entry._queued = _clock();
+
+    Threading::ScopedMutexLock lock(_mutex);
+
+    // unordered_map nodes are stable, so the entry can point at its cost record
+    entry._cost = &(*_costs.emplace(category, Cost()).first);
+    entry._sequence = _sequence++;
+    _queue.emplace_back(std::move(entry));
+    std::push_heap(_queue.begin(), _queue.end(), RunsLater());
+
+    if (_queueDepth)
+        _queueDepth->add(1);
+}
+
+unsigned
+MergeScheduler::run()
+{
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+
+        if (_queue.empty())
+            return 0u;
+
+        // Priorities change as the camera moves, so re-evaluate them
+        // every frame and rebuild the heap (linear time); each merge
+        // then pops in log time, so a frame that only runs a few merges
+        // does not pay to order the whole queue.
+        bool changed = false;
+        for (auto& entry : _queue)
+        {
+            if (entry._priorityFunction)
+            {
+                entry._priority = entry._priorityFunction();
+                changed = true;
+            }
+        }
+
+        if (changed)
+            std::make_heap(_queue.begin(), _queue.end(), RunsLater());
+    }
+
+    unsigned count = 0u;
+    std::uint64_t spent = 0u;
+
+    while (true)
+    {
+        Entry next;
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+
+            if (_queue.empty())
+                break;
+
+            if (_maxMergesPerFrame > 0u && count >= _maxMergesPerFrame)
+                break;
+
+            // Always do at least one merge per frame, even if it blows the
+            // budget, so an expensive merge cannot stall the queue.
+            if (_timeBudget > 0u && count > 0u)
+            {
+                double estimate = _queue.front()._cost->second._average;
+                if ((double)spent + estimate > (double)_timeBudget)
+                    break;
+            }
+
+            std::pop_heap(_queue.begin(), _queue.end(), RunsLater());
+            next = std::move(_queue.back());
+            _queue.pop_back();
+        }
+
+        if (_queueDepth)
+            _queueDepth->add(-1);
+
+        // run the merge outside the lock; it may queue more work.
+        std::uint64_t start = _clock();
+        bool merged = next._merge();
+        std::uint64_t end = _clock();
+
+        std::uint64_t elapsed = end > start ? end - start : 0u;
+        spent += elapsed;
+
+        if (merged)
+        {
+            ++count;
+
+            {
+                Threading::ScopedMutexLock lock(_mutex);
+                Cost& cost = next._cost->second;
+                if (cost._samples++ == 0u)
+                    cost._average = (double)elapsed;
+                else
+                    cost._average += COST_ALPHA * ((double)elapsed - cost._average);
+            }
+
+            if (_merges)
+                _merges->increment();
+            if (_mergeTime)
+                _mergeTime->record(elapsed);
+            if (_waitTime)
+                _waitTime->record(start > next._queued ? start - next._queued : 0u);
+        }
+    }
+
+    return count;
+}
+
+void
+MergeScheduler::clear()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    if (_queueDepth)
+        _queueDepth->add(-(std::int64_t)_queue.size());
+
+    _queue.clear();
+}
+
+std::size_t
+MergeScheduler::getQueueSize() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _queue.size();
+}
+
+double
+MergeScheduler::getEstimatedCost(const std::string& category) const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    auto i = _costs.find(category);
+    return i != _costs.end() ? i->second._average : 0.0;
+}
@@ -0,0 +1,352 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/MetricsRegistry>
+#include <osgEarth/JsonUtils>
+#include <osgEarth/Notify>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[MetricsRegistry] "
+
+//...................................................................
+
+const std::uint64_t MetricsRegistry::Histogram::EXPORT_BOUNDS[NUM_EXPORT_BOUNDS] = {
+    100, 250, 500, 1000, 2500, 5000, 10000,
+    25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000 };
+
+MetricsRegistry::Histogram::Histogram()
+{
+    reset();
+}
+
+void
+MetricsRegistry::Histogram::reset()
+{
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i)
+        _buckets[i] = 0u;
+    for (unsigned i = 0; i < NUM_EXPORT_BOUNDS; ++i)
+        _exportBuckets[i] = 0u;
+    _count = 0u;
+    _sum = 0u;
+    _max = 0u;
+}
+
+unsigned
+MetricsRegistry::Histogram::bucketOf(std::uint64_t v)
+{
+    if (v < (std::uint64_t)SUB_BUCKETS)
+        return (unsigned)v;
+
+    unsigned msb = 0u;
+    for (std::uint64_t t = v; t > 1u; t >>= 1)
+        ++msb;
+
+    if (msb >= (unsigned)MAX_EXPONENT)
+        return NUM_BUCKETS - 1;
+
+    unsigned sub = (unsigned)(v >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return SUB_BUCKETS + (msb - SUB_BUCKET_BITS) * SUB_BUCKETS + sub;
+}
+
+std::uint64_t
+MetricsRegistry::Histogram::bucketUpperBound(unsigned b)
+{
+    // exclusive upper bound == lower bound of the next bucket
+    ++b;
+    if (b < (unsigned)SUB_BUCKETS)
+        return b;
+
+    unsigned msb = (b - SUB_BUCKETS) / SUB_BUCKETS + SUB_BUCKET_BITS;
+    unsigned sub = (b - SUB_BUCKETS) % SUB_BUCKETS;
+    return ((std::uint64_t)SUB_BUCKETS + sub) << (msb - SUB_BUCKET_BITS);
+}
+
+void
+MetricsRegistry::Histogram::record(std::uint64_t v)
+{
+    _buckets[bucketOf(v)].fetch_add(1u, std::memory_order_relaxed);
+
+    for (unsigned i = 0; i < NUM_EXPORT_BOUNDS; ++i)
+    {
+        if (v <= EXPORT_BOUNDS[i])
+        {
+            _exportBuckets[i].fetch_add(1u, std::memory_order_relaxed);
+            break;
+        }
+    }
+
+    _count.fetch_add(1u, std::memory_order_relaxed);
+    _sum.fetch_add(v, std::memory_order_relaxed);
+
+    std::uint64_t prev = _max.load(std::memory_order_relaxed);
+    while (v > prev && !_max.compare_exchange_weak(prev, v, std::memory_order_relaxed));
+}
+
+std::uint64_t
+MetricsRegistry::Histogram::percentile(double q) const
+{
+    std::uint64_t total = count();
+    if (total == 0u)
+        return 0u;
+
+    std::uint64_t target = (std::uint64_t)(q * (double)total + 0.5);
+    if (target == 0u) target = 1u;
+
+    std::uint64_t running = 0u;
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i)
+    {
+        running += _buckets[i].load(std::memory_order_relaxed);
+        if (running >= target)
+            return std::min(bucketUpperBound(i), max());
+    }
+    return max();
+}
+
+std::uint64_t
+MetricsRegistry::Histogram::countAtOrBelow(std::uint64_t v) const
+{
+    std::uint64_t running = 0u;
+    for (unsigned i = 0; i <= bucketOf(v); ++i)
+        running += _buckets[i].load(std::memory_order_relaxed);
+    return running;
+}
+
+std::uint64_t
+MetricsRegistry::Histogram::countAtOrBelowExportBound(unsigned b) const
+{
+    std::uint64_t running = 0u;
+    for (unsigned i = 0; i <= b && i < NUM_EXPORT_BOUNDS; ++i)
+        running += _exportBuckets[i].load(std::memory_order_relaxed);
+    return running;
+}
+
+//...................................................................
+
+MetricsRegistry&
+MetricsRegistry::instance()
+{
+    static MetricsRegistry s_instance;
+    return s_instance;
+}
+
+MetricsRegistry::MetricsRegistry() :
+    _mutex("OE.MetricsRegistry")
+{
+    //nop
+}
+
+MetricsRegistry::Family&
+MetricsRegistry::family(const std::string& name, const std::string& help, Type type)
+{
+    // assume mutex is locked
+    std::map<std::string, Family>::iterator i = _families.find(name);
+    if (i == _families.end())
+    {
+        Family& f = _families[name];
+        f.type = type;
+        f.help = help;
+        return f;
+    }
+    if (i->second.type != type)
+    {
+        // A name has exactly one type in the exposition formats. Hand back a
+        // working metric, but keep it out of the exported family.
+        std::map<std::string, Family>::iterator c = _conflicts.find(name);
+        if (c == _conflicts.end())
+        {
+            OE_WARN << LC << "Metric \"" << name << "\" is already registered with a different type; "
+                << "the new registration will not be exported" << std::endl;
+            c = _conflicts.insert(std::make_pair(name, Family())).first;
+        }
+        c->second.type = type;
+        return c->second;
+    }
+    return i->second;
+}
+
+MetricsRegistry::Counter&
+MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    std::shared_ptr<Counter>& m = family(name, help, COUNTER).counters[labels];
+    if (!m) m = std::make_shared<Counter>();
+    return *m;
+}
+
+MetricsRegistry::Gauge&
+MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    std::shared_ptr<Gauge>& m = family(name, help, GAUGE).gauges[labels];
+    if (!m) m = std::make_shared<Gauge>();
+    return *m;
+}
+
+MetricsRegistry::Histogram&
+MetricsRegistry::histogram(const std::string& name, const std::string& help, const std::string& labels)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    std::shared_ptr<Histogram>& m = family(name, help, HISTOGRAM).histograms[labels];
+    if (!m) m = std::make_shared<Histogram>();
+    return *m;
+}
+
+void
+MetricsRegistry::reset()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    for (std::map<std::string, Family>* families : { &_families, &_conflicts })
+    {
+        for (std::map<std::string, Family>::iterator f = families->begin(); f != families->end(); ++f)
+        {
+            for (auto& i : f->second.counters) i.second->reset();
+            for (auto& i : f->second.gauges) i.second->reset();
+            for (auto& i : f->second.histograms) i.second->reset();
+        }
+    }
+}
+
+namespace
+{
+    std::string withLabels(const std::string& name, const std::string& labels, const std::string& extra = "")
+    {
+        if (labels.empty() && extra.empty())
+            return name;
+        std::string sep = !labels.empty() && !extra.empty() ? "," : "";
+        return name + "{" + labels + sep + extra + "}";
+    }
+}
+
+std::string
+MetricsRegistry::toPrometheus() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    std::stringstream buf;
+    buf << std::setprecision(10);
+
+    for (std::map<std::string, Family>::const_iterator f = _families.begin(); f != _families.end(); ++f)
+    {
+        const std::string& name = f->first;
+        const Family& family = f->second;
+
+        buf << "# HELP " << name << " " << family.help << "\n";
+
+        if (family.type == COUNTER)
+        {
+            buf << "# TYPE " << name << " counter\n";
+            for (auto& i : family.counters)
+                buf << withLabels(name, i.first) << " " << i.second->value() << "\n";
+        }
+        else if (family.type == GAUGE)
+        {
+            buf << "# TYPE " << name << " gauge\n";
+            for (auto& i : family.gauges)
+                buf << withLabels(name, i.first) << " " << i.second->value() << "\n";
+        }
+        else
+        {
+            buf << "# TYPE " << name << " histogram\n";
+            for (auto& i : family.histograms)
+            {
+                const Histogram& h = *i.second;
+                for (unsigned b = 0; b < Histogram::NUM_EXPORT_BOUNDS; ++b)
+                {
+                    std::stringstream le;
+                    le << "le=\"" << (double)Histogram::EXPORT_BOUNDS[b] * 1e-6 << "\"";
+                    buf << withLabels(name + "_bucket", i.first, le.str()) << " "
+                        << h.countAtOrBelowExportBound(b) << "\n";
+                }
+                buf << withLabels(name + "_bucket", i.first, "le=\"+Inf\"") << " " << h.count() << "\n";
+                buf << withLabels(name + "_sum", i.first) << " " << (double)h.sum() * 1e-6 << "\n";
+                buf << withLabels(name + "_count", i.first) << " " << h.count() << "\n";
+            }
+        }
+    }
+
+    return buf.str();
+}
+
+std::string
+MetricsRegistry::toJSON() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    Json::Value counters(Json::arrayValue);
+    Json::Value gauges(Json::arrayValue);
+    Json::Value histograms(Json::arrayValue);
+
+    for (std::map<std::string, Family>::const_iterator f = _families.begin(); f != _families.end(); ++f)
+    {
+        const Family& family = f->second;
+
+        if (family.type == COUNTER)
+        {
+            for (auto& i : family.counters)
+            {
+                Json::Value m(Json::objectValue);
+                m["name"] = f->first;
+                if (!i.first.empty()) m["labels"] = i.first;
+                m["value"] = (double)i.second->value();
+                counters.append(m);
+            }
+        }
+        else if (family.type == GAUGE)
+        {
+            for (auto& i : family.gauges)
+            {
+                Json::Value m(Json::objectValue);
+                m["name"] = f->first;
+                if (!i.first.empty()) m["labels"] = i.first;
+                m["value"] = (double)i.second->value();
+                gauges.append(m);
+            }
+        }
+        else
+        {
+            for (auto& i : family.histograms)
+            {
+                const Histogram& h = *i.second;
+                Json::Value m(Json::objectValue);
+                m["name"] = f->first;
+                if (!i.first.empty()) m["labels"] = i.first;
+                m["count"] = (double)h.count();
+                m["sum_seconds"] = (double)h.sum() * 1e-6;
+                m["max_seconds"] = (double)h.max() * 1e-6;
+                m["p50_seconds"] = (double)h.percentile(0.50) * 1e-6;
+                m["p90_seconds"] = (double)h.percentile(0.90) * 1e-6;
+                m["p99_seconds"] = (double)h.percentile(0.99) * 1e-6;
+                histograms.append(m);
+            }
+        }
+    }
+
+    Json::Value root(Json::objectValue);
+    root["counters"] = counters;
+    root["gauges"] = gauges;
+    root["histograms"] = histograms;
+    return Json::StyledWriter().write(root);
+}
@@ -84,8 +84,98 @@ namespace osgEarth { namespace OGR
 
 //........................................................................
 
+OGR::HandlePool::HandlePool(const std::string& source, const std::string& layer, unsigned maxIdle) :
+    _source(source),
+    _layer(layer),
+    _maxIdle(maxIdle),
+    _closed(false),
+    _mutex("OE.OGRFeatureSource.handles")
+{
+    //nop
+}
+
+OGR::HandlePool::~HandlePool()
+{
+    close();
+}
+
+bool
+OGR::HandlePool::acquire(Handles& output)
+{
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        if (!_idle.empty())
+        {
+            output = _idle.back();
+            _idle.pop_back();
+            return true;
+        }
+    }
+
+    // Nothing idle; open a new handle outside the lock so that other
+    // threads can keep borrowing and returning handles meanwhile.
+    // Not OGROpenShared: that hands every caller on the same thread the
+    // same handle, and a pooled handle has to have exactly one user.
+    OGRSFDriverH driver = 0L;
+    output.dsHandle = OGROpen(_source.c_str(), 0, &driver);
+    output.layerHandle = output.dsHandle ? OGR::openLayer(output.dsHandle, _layer) : 0L;
+    if (!output.layerHandle)
+    {
+        if (output.dsHandle)
+            OGRReleaseDataSource(output.dsHandle);
+        output.dsHandle = 0L;
+        return false;
+    }
+    return true;
+}
+
+void
+OGR::HandlePool::release(const Handles& handles)
+{
+    if (!handles.dsHandle)
+        return;
+
+    // don't let one cursor's filters leak into the next
+    if (handles.layerHandle)
+    {
+        OGR_L_SetSpatialFilter(handles.layerHandle, 0L);
+        OGR_L_SetAttributeFilter(handles.layerHandle, 0L);
+        OGR_L_ResetReading(handles.layerHandle);
+    }
+
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        if (!_closed && _idle.size() < _maxIdle)
+        {
+            _idle.push_back(handles);
+            return;
+        }
+    }
+
+    OGRReleaseDataSource(handles.dsHandle);
+}
+
+void
+OGR::HandlePool::close()
+{
+    std::vector<Handles> idle;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        _closed = true;
+        idle.swap(_idle);
+    }
+
+    for (std::vector<Handles>::const_iterator i = idle.begin(); i != idle.end(); ++i)
+    {
+        OGRReleaseDataSource(i->dsHandle);
+    }
+}
+
+//........................................................................
+
 OGR::OGRFeatureCursor::OGRFeatureCursor(OGRDataSourceH              dsHandle,
                                         OGRLayerH                   layerHandle,
+                                        HandlePool*                 pool,
                                         const FeatureSource*        source,
                                         const FeatureProfile*       profile,
                                         const Query&                query,
@@ -97,6 +187,7 @@ FeatureCursor     ( progress ),
 _source           ( source ),
 _dsHandle         ( dsHandle ),
 _layerHandle      ( layerHandle ),
+_pool             ( pool ),
 _resultSetHandle  ( 0L ),
 _spatialFilter    ( 0L ),
 _query            ( query ),
@@ -228,7 +319,19 @@ OGR::OGRFeatureCursor::~OGRFeatureCursor()
         OGR_G_DestroyGeometry( _spatialFilter );
 
     if ( _dsHandle )
-        OGRReleaseDataSource( _dsHandle );
+    {
+        if ( _pool.valid() )
+        {
+            HandlePool::Handles handles;
+            handles.dsHandle = _dsHandle;
+            handles.layerHandle = _layerHandle;
+            _pool->release( handles );
+        }
+        else
+        {
+            OGRReleaseDataSource( _dsHandle );
+        }
+    }
 }
 
 bool
@@ -355,12 +458,15 @@ OGRFeatureSource::Options::getConfig() const
     conf.set("geometry_url", _geometryUrl);
     conf.set("layer", _layer);
     conf.set("query", _query);
+    conf.set("max_handles", _maxHandles);
     return conf;
 }
 
 void
 OGRFeatureSource::Options::fromConfig(const Config& conf)
 {
+    maxHandles().init(Threading::getConcurrency());
+
     conf.get("url", _url);
     conf.get("connection", _connection);
     conf.get("ogr_driver", _ogrDriver);
@@ -370,6 +476,7 @@ OGRFeatureSource::Options::fromConfig(const Config& conf)
     conf.get("geometry_url", _geometryUrl);
     conf.get("layer", _layer);
     conf.get("query", _query);
+    conf.get("max_handles", _maxHandles);
 }
 
 //........................................................................
@@ -383,6 +490,7 @@ OE_LAYER_PROPERTY_IMPL(OGRFeatureSource, std::string, OGRDriver, ogrDriver);
 OE_LAYER_PROPERTY_IMPL(OGRFeatureSource, URI, GeometryURL, geometryUrl);
 OE_LAYER_PROPERTY_IMPL(OGRFeatureSource, std::string, Layer, layer);
 OE_LAYER_PROPERTY_IMPL(OGRFeatureSource, Query, Query, query);
+OE_LAYER_PROPERTY_IMPL(OGRFeatureSource, unsigned, MaxHandles, maxHandles);
 
 void
 OGRFeatureSource::init()
@@ -400,6 +508,13 @@ OGRFeatureSource::init()
 Status
 OGRFeatureSource::closeImplementation()
 {
+    if (_handles.valid())
+    {
+        // cursors still holding handles will close them on release
+        _handles->close();
+        _handles = 0L;
+    }
+
     if (_layerHandle)
     {
         if (_needsSync)
@@ -652,6 +767,13 @@ OGRFeatureSource::openImplementation()
         {
             _geometryType = Geometry::TYPE_MULTI;
         }
+
+        // Read-only handles for cursors and getFeature. A writable source
+        // keeps none idle, so each cursor opens a fresh view of the data.
+        _handles = new OGR::HandlePool(
+            _source,
+            options().layer().value(),
+            _writable ? 0u : options().maxHandles().get());
     }
 
     // finally, if we're establish a profile, set it for this source.
@@ -762,6 +884,8 @@ OGRFeatureSource::create(const FeatureProfile* profile,
 
     _geometryType = geometryType;
 
+    _handles = new OGR::HandlePool(_source, options().layer().value(), 0u);
+
     setStatus(Status::NoError);
     return getStatus();
 }
@@ -795,19 +919,10 @@ OGRFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
     }
     else
     {
-        OGRDataSourceH dsHandle = 0L;
-        OGRLayerH layerHandle = 0L;
-
-        // open the handles safely:
-        // Each cursor requires its own DS handle so that multi-threaded access will work.
-        // The cursor impl will dispose of the new DS handle.
-        dsHandle = OGROpenShared(_source.c_str(), 0, &_ogrDriverHandle);
-        if (dsHandle)
-        {
-            layerHandle = OGR::openLayer(dsHandle, options().layer().get());
-        }
-
-        if (dsHandle && layerHandle)
+        // Each cursor borrows its own handles from the pool so that
+        // multi-threaded access will work; the cursor gives them back.
+        OGR::HandlePool::Handles handles;
+        if (_handles.valid() && _handles->acquire(handles))
         {
             Query newQuery(query);
             if (options().query().isSet())
@@ -819,8 +934,9 @@ OGRFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
 
             // cursor is responsible for the OGR handles.
             return new OGR::OGRFeatureCursor(
-                dsHandle,
-                layerHandle,
+                handles.dsHandle,
+                handles.layerHandle,
+                _handles.get(),
                 this,
                 getFeatureProfile(),
                 newQuery,
@@ -831,11 +947,6 @@ OGRFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
         }
         else
         {
-            if (dsHandle)
-            {
-                OGRReleaseDataSource(dsHandle);
-            }
-
             return 0L;
         }
     }
@@ -846,9 +957,25 @@ OGRFeatureSource::deleteFeature(FeatureID fid)
 {
     if (_writable && _layerHandle)
     {
+        // remember where the feature was, for the change notification
+        GeoExtent extent;
+        OGRFeatureH handle = OGR_L_GetFeature(_layerHandle, fid);
+        if (handle)
+        {
+            OGRGeometryH geom = OGR_F_GetGeometryRef(handle);
+            if (geom)
+            {
+                OGREnvelope env;
+                OGR_G_GetEnvelope(geom, &env);
+                extent = GeoExtent(getFeatureProfile()->getSRS(), env.MinX, env.MinY, env.MaxX, env.MaxY);
+            }
+            OGR_F_Destroy(handle);
+        }
+
         if (OGR_L_DeleteFeature(_layerHandle, fid) == OGRERR_NONE)
         {
             _needsSync = true;
+            dirtyFeatures(extent, std::vector<FeatureID>(1, fid));
             return true;
         }
     }
@@ -874,12 +1001,23 @@ OGRFeatureSource::getFeature(FeatureID fid)
 
     if (_layerHandle && !isBlacklisted(fid))
     {
-        OGRFeatureH handle = OGR_L_GetFeature(_layerHandle, fid);
+        // The main handle belongs to the thread that opened the source,
+        // so read-only lookups go through the pool instead.
+        OGR::HandlePool::Handles handles;
+        bool pooled = !_writable && _handles.valid() && _handles->acquire(handles);
+        OGRLayerH layerHandle = pooled ? handles.layerHandle : _layerHandle;
+
+        OGRFeatureH handle = OGR_L_GetFeature(layerHandle, fid);
         if (handle)
         {
             result = OgrUtils::createFeature(handle, getFeatureProfile(), *_options->rewindPolygons());
             OGR_F_Destroy(handle);
         }
+
+        if (pooled)
+        {
+            _handles->release(handles);
+        }
     }
     return result;
 }
@@ -899,6 +1037,8 @@ OGRFeatureSource::getSchema() const
 bool
 OGRFeatureSource::insertFeature(Feature* feature)
 {
+    FeatureID fid = 0;
+
     OGRFeatureH feature_handle = OGR_F_Create(OGR_L_GetLayerDefn(_layerHandle));
     if (feature_handle)
     {
@@ -951,6 +1091,8 @@ OGRFeatureSource::insertFeature(Feature* feature)
             return false;
         }
 
+        fid = OGR_F_GetFID(feature_handle);
+
         // clean up the feature
         OGR_F_Destroy(feature_handle);
     }
@@ -961,7 +1103,7 @@ OGRFeatureSource::insertFeature(Feature* feature)
         return false;
     }
 
-    dirty();
+    dirtyFeatures(feature->getExtent(), std::vector<FeatureID>(1, fid));
 
     return true;
 }
@@ -98,7 +98,7 @@ ObjectIndex::setObjectIDAtrribLocation(int value)
 ObjectID
 ObjectIndex::insert(osg::Referenced* object)
 {
-    Threading::ScopedMutexLock excl( _mutex );
+    Threading::ScopedWriteLock excl( _mutex );
     return insertImpl( object );
 }
 
@@ -120,10 +120,17 @@ ObjectIndex::getImpl(ObjectID id) const
     return i != _index.end() ? i->second.get() : 0L;
 }
 
+unsigned
+ObjectIndex::size() const
+{
+    Threading::ScopedReadLock lock(_mutex);
+    return _index.size();
+}
+
 void
 ObjectIndex::remove(ObjectID id)
 {
-    Threading::ScopedMutexLock excl(_mutex);
+    Threading::ScopedWriteLock excl(_mutex);
     removeImpl(id);
 }
 
@@ -139,7 +146,7 @@ ObjectIndex::removeImpl(ObjectID id)
 ObjectID
 ObjectIndex::tagDrawable(osg::Drawable* drawable, osg::Referenced* object)
 {
-    Threading::ScopedMutexLock lock(_mutex);
+    Threading::ScopedWriteLock lock(_mutex);
     ObjectID oid = insertImpl(object);
     tagDrawable(drawable, oid);
     return oid;
@@ -191,7 +198,7 @@ namespace
 ObjectID
 ObjectIndex::tagAllDrawables(osg::Node* node, osg::Referenced* object)
 {
-    Threading::ScopedMutexLock lock(_mutex);
+    Threading::ScopedWriteLock lock(_mutex);
     ObjectID oid = insertImpl(object);
     tagAllDrawables(node, oid);
     return oid;
@@ -210,7 +217,7 @@ ObjectIndex::tagAllDrawables(osg::Node* node, ObjectID id) const
 ObjectID
 ObjectIndex::tagNode(osg::Node* node, osg::Referenced* object)
 {
-    Threading::ScopedMutexLock lock(_mutex);
+    Threading::ScopedWriteLock lock(_mutex);
     ObjectID oid = insertImpl(object);
     tagNode(node, oid);
     return oid;
@@ -261,7 +268,7 @@ ObjectIndex::getObjectID(osg::Node* node, ObjectID& output) const
 
 bool
 ObjectIndex::updateObjectIDs(osg::Drawable* drawable,
-                             std::map<ObjectID, ObjectID>& oldNewMap,
+                             ObjectIDMapping& oldNewMap,
                              osg::Referenced* object)
 {
     // in a drawable, replaces each OIDs in map.first with the corresponding OID in map.second
@@ -274,10 +281,21 @@ ObjectIndex::updateObjectIDs(osg::Drawable* drawable,
     if ( !oids ) return false;
     if (oids->empty()) return false;
     
+    // Vertices of the same object are contiguous, so remember the last
+    // mapping and skip the table lookup on runs of identical IDs.
+    ObjectID lastoid = OSGEARTH_OBJECTID_EMPTY;
+    ObjectID lastnewoid = OSGEARTH_OBJECTID_EMPTY;
+
     for (ObjectIDArray::iterator i = oids->begin(); i != oids->end(); ++i)
     {
+        if (*i == lastoid && lastoid != OSGEARTH_OBJECTID_EMPTY)
+        {
+            *i = lastnewoid;
+            continue;
+        }
+
         ObjectID newoid;
-        std::map<ObjectID, ObjectID>::iterator k = oldNewMap.find(*i);
+        ObjectIDMapping::iterator k = oldNewMap.find(*i);
         if (k != oldNewMap.end()) {
             newoid = k->second;
         }
@@ -285,6 +303,8 @@ ObjectIndex::updateObjectIDs(osg::Drawable* drawable,
             newoid = insert(object);
             oldNewMap[*i] = newoid;
         }
+        lastoid = *i;
+        lastnewoid = newoid;
         *i = newoid;
     }
 
@@ -295,7 +315,7 @@ ObjectIndex::updateObjectIDs(osg::Drawable* drawable,
 
 bool
 ObjectIndex::updateObjectID(osg::Node* node,
-                            std::map<ObjectID, ObjectID>& oldNewMap,
+                            ObjectIDMapping& oldNewMap,
                             osg::Referenced* object)
 {
     if (!node) return false;
@@ -310,7 +330,7 @@ ObjectIndex::updateObjectID(osg::Node* node,
     uniform->get(oldoid);
 
     ObjectID newoid;
-    std::map<ObjectID, ObjectID>::iterator k = oldNewMap.find(oldoid);
+    ObjectIDMapping::iterator k = oldNewMap.find(oldoid);
     if (k != oldNewMap.end()) {
         newoid = k->second;
     }
@@ -0,0 +1,1236 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/PackedFeatureSource>
+#include <osgEarth/FeatureCursor>
+#include <osgEarth/Filter>
+#include <osgEarth/FileUtils>
+#include <osgEarth/StringUtils>
+#include <osgDB/FileUtils>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <cfloat>
+#include <queue>
+
+#define LC "[PackedFeatureSource] " << getName() << ": "
+
+using namespace osgEarth;
+
+//........................................................................
+// Store file layout
+//
+// The file is a fixed header followed by 8-byte aligned sections. Values
+// are stored in the byte order of the machine that built the store, so
+// they can be used straight out of the mapping; a store built on a machine
+// with the other byte order is rejected and must be rebuilt.
+//
+//   srs        WKT of the feature profile SRS
+//   levels     end node index of each R-tree level (leaves first)
+//   nodes      R-tree nodes; leaf i covers feature i, the root is last
+//   features   one record per feature, in Hilbert order
+//   fids       (fid, position) pairs sorted by fid, for getFeature()
+//   parts      geometry parts (rings, lines, point sets)
+//   coords     x,y,z doubles for every part
+//   fields     attribute column descriptors
+//   columns    per field: one fixed-width value per feature + null bitmap
+//   strings    field names, then string attribute values
+
+namespace osgEarth { namespace Packed
+{
+    const char          MAGIC[4]   = { 'O', 'E', 'P', 'F' };
+    const std::uint32_t VERSION    = 1u;
+    const std::uint32_t BYTE_ORDER = 0x01020304u;
+
+    struct Header
+    {
+        char          magic[4];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        std::uint32_t nodeSize;
+        std::uint64_t numFeatures;
+        std::uint64_t numNodes;
+        std::uint64_t numParts;
+        std::uint64_t numCoords;
+        std::uint32_t numFields;
+        std::uint32_t numLevels;
+        std::uint32_t geometryType;
+        std::uint32_t reserved;
+        double        extent[4];
+        std::uint64_t srsOffset;
+        std::uint64_t srsLength;
+        std::uint64_t levelsOffset;
+        std::uint64_t nodesOffset;
+        std::uint64_t featuresOffset;
+        std::uint64_t fidsOffset;
+        std::uint64_t partsOffset;
+        std::uint64_t coordsOffset;
+        std::uint64_t fieldsOffset;
+        std::uint64_t stringsOffset;
+        std::uint64_t stringsLength;
+    };
+
+    // R-tree node: xmin, ymin, xmax, ymax, then the feature position (leaf)
+    // or the index of the first child node (interior)
+    struct Node
+    {
+        double        box[4];
+        std::uint64_t index;
+    };
+
+    enum FeatureFlags
+    {
+        FLAG_MULTI       = 1u << 0,
+        FLAG_NO_GEOMETRY = 1u << 1
+    };
+
+    struct FeatureRecord
+    {
+        std::int64_t  fid;
+        std::uint64_t firstPart;
+        std::uint32_t numParts;
+        std::uint32_t flags;
+    };
+
+    struct FIDEntry
+    {
+        std::int64_t  fid;
+        std::uint64_t position;
+    };
+
+    enum PartRole
+    {
+        ROLE_POINT = 1,
+        ROLE_POINTSET,
+        ROLE_LINESTRING,
+        ROLE_RING,
+        ROLE_POLYGON,
+        ROLE_HOLE       // belongs to the preceding ROLE_POLYGON
+    };
+
+    struct Part
+    {
+        std::uint64_t firstCoord;
+        std::uint32_t numCoords;
+        std::uint32_t role;
+    };
+
+    struct Field
+    {
+        std::uint64_t nameOffset;
+        std::uint32_t nameLength;
+        std::uint32_t type;
+        std::uint64_t dataOffset;
+        std::uint64_t nullsOffset;
+    };
+
+    struct StringRef
+    {
+        std::uint64_t offset;
+        std::uint32_t length;
+        std::uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 176, "unexpected Header size");
+    static_assert(sizeof(Node) == 40, "unexpected Node size");
+    static_assert(sizeof(FeatureRecord) == 24, "unexpected FeatureRecord size");
+    static_assert(sizeof(FIDEntry) == 16, "unexpected FIDEntry size");
+    static_assert(sizeof(Part) == 16, "unexpected Part size");
+    static_assert(sizeof(Field) == 32, "unexpected Field size");
+    static_assert(sizeof(StringRef) == 16, "unexpected StringRef size");
+    static_assert(sizeof(osg::Vec3d) == 3 * sizeof(double), "unexpected Vec3d layout");
+
+    inline std::uint64_t align8(std::uint64_t value)
+    {
+        return (value + 7u) & ~std::uint64_t(7u);
+    }
+
+    // Width of one value in a column of the given type
+    inline std::uint64_t columnWidth(std::uint32_t type)
+    {
+        return
+            type == ATTRTYPE_STRING ? sizeof(StringRef) :
+            type == ATTRTYPE_BOOL ? 1u :
+            8u;
+    }
+
+    // Whether "count" items of "width" bytes starting at "offset" fit within
+    // "limit" bytes, without overflowing
+    inline bool fits(std::uint64_t offset, std::uint64_t count, std::uint64_t width, std::uint64_t limit)
+    {
+        return offset <= limit && count <= (limit - offset) / width;
+    }
+
+    inline bool aligned(std::uint64_t offset)
+    {
+        return (offset & 7u) == 0u;
+    }
+
+    inline bool intersects(const double* a, const Bounds& b)
+    {
+        return a[0] <= b.xMax() && a[2] >= b.xMin() && a[1] <= b.yMax() && a[3] >= b.yMin();
+    }
+
+    // Hilbert curve distance of a point on a 65536x65536 grid
+    std::uint32_t hilbert(std::uint32_t x, std::uint32_t y)
+    {
+        const std::uint32_t n = 1u << 16;
+        std::uint32_t d = 0u;
+        for (std::uint32_t s = n >> 1; s > 0u; s >>= 1)
+        {
+            std::uint32_t rx = (x & s) ? 1u : 0u;
+            std::uint32_t ry = (y & s) ? 1u : 0u;
+            d += s * s * ((3u * rx) ^ ry);
+            if (ry == 0u)
+            {
+                if (rx == 1u)
+                {
+                    x = n - 1u - x;
+                    y = n - 1u - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    // Flattens a geometry into parts and coordinates. Nested multi-geometries
+    // come back as a single level of components.
+    void encode(const Geometry* geom, std::vector<Part>& parts, std::vector<osg::Vec3d>& coords)
+    {
+        std::uint32_t role = 0u;
+        switch (geom->getType())
+        {
+        case Geometry::TYPE_MULTI:
+        {
+            const GeometryCollection& comps = static_cast<const MultiGeometry*>(geom)->getComponents();
+            for (GeometryCollection::const_iterator i = comps.begin(); i != comps.end(); ++i)
+                if (i->valid())
+                    encode(i->get(), parts, coords);
+            return;
+        }
+        case Geometry::TYPE_POINT:      role = ROLE_POINT; break;
+        case Geometry::TYPE_POINTSET:   role = ROLE_POINTSET; break;
+        case Geometry::TYPE_LINESTRING: role = ROLE_LINESTRING; break;
+        case Geometry::TYPE_RING:       role = ROLE_RING; break;
+        case Geometry::TYPE_POLYGON:    role = ROLE_POLYGON; break;
+        default: return;
+        }
+
+        Part part;
+        part.firstCoord = coords.size();
+        part.numCoords = geom->size();
+        part.role = role;
+        parts.push_back(part);
+        coords.insert(coords.end(), geom->begin(), geom->end());
+
+        if (role == ROLE_POLYGON)
+        {
+            const RingCollection& holes = static_cast<const Polygon*>(geom)->getHoles();
+            for (RingCollection::const_iterator h = holes.begin(); h != holes.end(); ++h)
+            {
+                if (!h->valid()) continue;
+                part.firstCoord = coords.size();
+                part.numCoords = h->get()->size();
+                part.role = ROLE_HOLE;
+                parts.push_back(part);
+                coords.insert(coords.end(), h->get()->begin(), h->get()->end());
+            }
+        }
+    }
+
+    /**
+     * Read-only view of a mapped store file. Immutable once opened, so any
+     * number of threads may query it at once.
+     */
+    class Store : public osg::Referenced
+    {
+    public:
+        static Store* open(const std::string& filename, std::string& error);
+
+        const Header& header() const { return *reinterpret_cast<const Header*>(_data); }
+
+        std::string srsWKT() const
+        {
+            return std::string(_data + header().srsOffset, header().srsLength);
+        }
+
+        const std::vector<std::string>& fieldNames() const { return _names; }
+
+        const Field& field(unsigned i) const
+        {
+            return reinterpret_cast<const Field*>(_data + header().fieldsOffset)[i];
+        }
+
+        //! Positions of all features whose bounding box intersects "bounds"
+        //! (all features if "bounds" is NULL), in store order.
+        void query(const Bounds* bounds, std::vector<std::uint64_t>& output) const;
+
+        //! Position of the feature with the given FID
+        bool find(FeatureID fid, std::uint64_t& position) const;
+
+        //! Builds the feature at a position
+        Feature* createFeature(std::uint64_t position, const FeatureProfile* profile) const;
+
+    protected:
+        Store();
+        virtual ~Store() { }
+
+        bool validate(std::string& error);
+
+        Util::MappedFile _file;
+        const char* _data;
+        std::uint64_t _size;
+        std::vector<std::string> _names;
+    };
+
+    Store::Store() :
+        _data(0L),
+        _size(0u)
+    {
+        //nop
+    }
+
+    bool Store::validate(std::string& error)
+    {
+        if (_size < sizeof(Header) || ::memcmp(header().magic, MAGIC, 4) != 0)
+        {
+            error = "not a packed feature store";
+            return false;
+        }
+
+        const Header& h = header();
+        if (h.version != VERSION)
+        {
+            error = Stringify() << "unsupported store version " << h.version;
+            return false;
+        }
+        if (h.byteOrder != BYTE_ORDER)
+        {
+            error = "store was built with a different byte order; rebuild it";
+            return false;
+        }
+
+        // every section has to lie inside the file
+        std::uint64_t n = h.numFeatures;
+        bool ok =
+            h.nodeSize >= 2u &&
+            fits(h.srsOffset, h.srsLength, 1u, _size) &&
+            fits(h.levelsOffset, h.numLevels, 8u, _size) &&
+            fits(h.nodesOffset, h.numNodes, sizeof(Node), _size) &&
+            fits(h.featuresOffset, n, sizeof(FeatureRecord), _size) &&
+            fits(h.fidsOffset, n, sizeof(FIDEntry), _size) &&
+            fits(h.partsOffset, h.numParts, sizeof(Part), _size) &&
+            fits(h.coordsOffset, h.numCoords, sizeof(osg::Vec3d), _size) &&
+            fits(h.fieldsOffset, h.numFields, sizeof(Field), _size) &&
+            fits(h.stringsOffset, h.stringsLength, 1u, _size) &&
+            aligned(h.levelsOffset) && aligned(h.nodesOffset) && aligned(h.featuresOffset) &&
+            aligned(h.fidsOffset) && aligned(h.partsOffset) && aligned(h.coordsOffset) &&
+            aligned(h.fieldsOffset);
+
+        // R-tree levels end where they should. Nodes, records, parts and
+        // string values are checked when a query reaches them, so opening
+        // a store doesn't have to touch every page of it.
+        if (ok && n > 0u)
+        {
+            const std::uint64_t* levels = reinterpret_cast<const std::uint64_t*>(_data + h.levelsOffset);
+            ok = h.numLevels > 0u && levels[0] == n && levels[h.numLevels - 1] == h.numNodes;
+            for (unsigned i = 1; ok && i < h.numLevels; ++i)
+                ok = levels[i] > levels[i - 1];
+        }
+
+        for (unsigned i = 0; ok && i < h.numFields; ++i)
+        {
+            const Field& f = field(i);
+            ok =
+                fits(f.nameOffset, f.nameLength, 1u, h.stringsLength) &&
+                fits(f.dataOffset, n, columnWidth(f.type), _size) &&
+                fits(f.nullsOffset, (n + 7u) / 8u, 1u, _size) &&
+                aligned(f.dataOffset);
+
+            if (ok)
+                _names.push_back(std::string(_data + h.stringsOffset + f.nameOffset, f.nameLength));
+        }
+
+        if (!ok)
+        {
+            error = "store is truncated or damaged";
+            return false;
+        }
+        return true;
+    }
+
+    Store* Store::open(const std::string& filename, std::string& error)
+    {
+        osg::ref_ptr<Store> store = new Store();
+        if (!store->_file.map(filename, Util::MappedFile::ACCESS_RANDOM))
+        {
+            error = "cannot open or map file";
+            return 0L;
+        }
+
+        store->_data = store->_file.data();
+        store->_size = store->_file.size();
+        if (!store->validate(error))
+            return 0L;
+        return store.release();
+    }
+
+    void Store::query(const Bounds* bounds, std::vector<std::uint64_t>& output) const
+    {
+        const Header& h = header();
+        if (h.numFeatures == 0u)
+            return;
+
+        if (!bounds)
+        {
+            output.reserve(output.size() + h.numFeatures);
+            for (std::uint64_t i = 0; i < h.numFeatures; ++i)
+                output.push_back(i);
+            return;
+        }
+
+        const Node* nodes = reinterpret_cast<const Node*>(_data + h.nodesOffset);
+        const std::uint64_t* levels = reinterpret_cast<const std::uint64_t*>(_data + h.levelsOffset);
+
+        // (node index, level) pairs still to visit, starting at the root
+        std::vector<std::pair<std::uint64_t, unsigned> > stack;
+        stack.push_back(std::make_pair(h.numNodes - 1u, h.numLevels - 1u));
+
+        while (!stack.empty())
+        {
+            std::uint64_t i = stack.back().first;
+            unsigned level = stack.back().second;
+            stack.pop_back();
+
+            const Node& node = nodes[i];
+            if (!intersects(node.box, *bounds))
+                continue;
+
+            // a damaged node is skipped along with everything below it
+            if (level == 0u)
+            {
+                if (node.index < h.numFeatures)
+                    output.push_back(node.index);
+            }
+            else
+            {
+                // children lie in the level below this one
+                std::uint64_t childBegin = level > 1u ? levels[level - 2u] : 0u;
+                std::uint64_t childEnd = levels[level - 1u];
+                if (node.index < childBegin || node.index >= childEnd)
+                    continue;
+
+                std::uint64_t end = std::min(node.index + h.nodeSize, childEnd);
+                for (std::uint64_t c = node.index; c < end; ++c)
+                    stack.push_back(std::make_pair(c, level - 1u));
+            }
+        }
+
+        // store order keeps neighboring features together in the mapping
+        std::sort(output.begin(), output.end());
+    }
+
+    bool Store::find(FeatureID fid, std::uint64_t& position) const
+    {
+        const Header& h = header();
+        const FIDEntry* begin = reinterpret_cast<const FIDEntry*>(_data + h.fidsOffset);
+        const FIDEntry* end = begin + h.numFeatures;
+        FIDEntry key;
+        key.fid = fid;
+        const FIDEntry* i = std::lower_bound(begin, end, key,
+            [](const FIDEntry& a, const FIDEntry& b) { return a.fid < b.fid; });
+        if (i == end || i->fid != fid || i->position >= h.numFeatures)
+            return false;
+        position = i->position;
+        return true;
+    }
+
+    Feature* Store::createFeature(std::uint64_t s, const FeatureProfile* profile) const
+    {
+        const Header& h = header();
+        if (s >= h.numFeatures)
+            return 0L;
+
+        const FeatureRecord& record = reinterpret_cast<const FeatureRecord*>(_data + h.featuresOffset)[s];
+        if (!fits(record.firstPart, record.numParts, 1u, h.numParts))
+            return 0L;
+
+        // geometry
+        osg::ref_ptr<Geometry> geom;
+        if ((record.flags & FLAG_NO_GEOMETRY) == 0u)
+        {
+            osg::ref_ptr<MultiGeometry> multi = (record.flags & FLAG_MULTI) ? new MultiGeometry() : 0L;
+            const Part* parts = reinterpret_cast<const Part*>(_data + h.partsOffset) + record.firstPart;
+            const osg::Vec3d* coords = reinterpret_cast<const osg::Vec3d*>(_data + h.coordsOffset);
+            Polygon* polygon = 0L;
+
+            for (std::uint32_t p = 0; p < record.numParts; ++p)
+            {
+                const Part& part = parts[p];
+                if (!fits(part.firstCoord, part.numCoords, 1u, h.numCoords))
+                    return 0L;
+
+                Geometry* g = 0L;
+                switch (part.role)
+                {
+                case ROLE_POINT:      g = new Point(part.numCoords); break;
+                case ROLE_POINTSET:   g = new PointSet(part.numCoords); break;
+                case ROLE_LINESTRING: g = new LineString(part.numCoords); break;
+                case ROLE_RING:       g = new Ring(part.numCoords); break;
+                case ROLE_POLYGON:    g = polygon = new Polygon(part.numCoords); break;
+                case ROLE_HOLE:       g = new Ring(part.numCoords); break;
+                default:              return 0L;
+                }
+
+                const osg::Vec3d* first = coords + part.firstCoord;
+                g->assign(first, first + part.numCoords);
+
+                if (part.role == ROLE_HOLE)
+                {
+                    osg::ref_ptr<Ring> hole = static_cast<Ring*>(g);
+                    if (polygon)
+                        polygon->getHoles().push_back(hole.get());
+                }
+                else if (multi.valid())
+                {
+                    multi->add(g);
+                }
+                else
+                {
+                    geom = g;
+                }
+            }
+
+            if (multi.valid())
+                geom = multi.get();
+        }
+
+        Feature* feature = new Feature(geom.get(), profile ? profile->getSRS() : 0L, Style(), record.fid);
+        if (profile && profile->geoInterp().isSet())
+            feature->geoInterp() = profile->geoInterp().get();
+
+        // attributes
+        const char* strings = _data + h.stringsOffset;
+        for (unsigned i = 0; i < h.numFields; ++i)
+        {
+            const Field& f = field(i);
+            const std::string& name = _names[i];
+            AttributeType type = (AttributeType)f.type;
+
+            const std::uint8_t* nulls = reinterpret_cast<const std::uint8_t*>(_data + f.nullsOffset);
+            if ((nulls[s >> 3] & (1u << (s & 7u))) == 0u)
+            {
+                feature->setNull(name, type);
+                continue;
+            }
+
+            const char* value = _data + f.dataOffset + s * columnWidth(f.type);
+            switch (type)
+            {
+            case ATTRTYPE_INT:
+                feature->set(name, *reinterpret_cast<const long long*>(value));
+                break;
+            case ATTRTYPE_DOUBLE:
+                feature->set(name, *reinterpret_cast<const double*>(value));
+                break;
+            case ATTRTYPE_BOOL:
+                feature->set(name, *value != 0);
+                break;
+            case ATTRTYPE_STRING:
+            {
+                const StringRef& ref = *reinterpret_cast<const StringRef*>(value);
+                if (fits(ref.offset, ref.length, 1u, h.stringsLength))
+                    feature->set(name, std::string(strings + ref.offset, ref.length));
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        return feature;
+    }
+
+    /**
+     * Cursor over the results of a store query. Features are built in
+     * chunks so the filters see reasonably sized batches.
+     */
+    class PackedFeatureCursor : public FeatureCursor
+    {
+    public:
+        PackedFeatureCursor(
+            const Store* store,
+            std::vector<std::uint64_t>& hits,
+            const FeatureSource* source,
+            const FeatureProfile* profile,
+            const GeoExtent& extent,
+            const FeatureFilterChain* filters,
+            unsigned limit,
+            ProgressCallback* progress) :
+
+            FeatureCursor(progress),
+            _store(store),
+            _source(source),
+            _profile(profile),
+            _extent(extent),
+            _filters(filters),
+            _next(0u),
+            _remaining(limit)
+        {
+            _hits.swap(hits);
+            readChunk();
+        }
+
+        bool hasMore() const
+        {
+            return !_queue.empty();
+        }
+
+        Feature* nextFeature()
+        {
+            if (!hasMore())
+                return 0L;
+
+            if (_queue.size() == 1u)
+                readChunk();
+
+            _lastFeatureReturned = _queue.front();
+            _queue.pop();
+            return _lastFeatureReturned.get();
+        }
+
+    private:
+        void readChunk()
+        {
+            const unsigned chunkSize = 500u;
+
+            while (_queue.size() < chunkSize && _next < _hits.size() && _remaining > 0u)
+            {
+                FeatureList chunk;
+                while (chunk.size() < chunkSize && _next < _hits.size() && _remaining > 0u)
+                {
+                    osg::ref_ptr<Feature> feature = _store->createFeature(_hits[_next++], _profile.get());
+                    if (feature.valid() && (!_source.valid() || !_source->isBlacklisted(feature->getFID())))
+                    {
+                        chunk.push_back(feature.get());
+                        --_remaining;
+                    }
+                }
+
+                if (_filters.valid() && !_filters->empty())
+                {
+                    FilterContext cx;
+                    cx.setProfile(_profile.get());
+                    cx.extent() = _extent;
+                    for (FeatureFilterChain::const_iterator i = _filters->begin(); i != _filters->end(); ++i)
+                        cx = i->get()->push(chunk, cx);
+                }
+
+                for (FeatureList::const_iterator i = chunk.begin(); i != chunk.end(); ++i)
+                    _queue.push(i->get());
+            }
+        }
+
+        osg::ref_ptr<const Store> _store;
+        osg::ref_ptr<const FeatureSource> _source;
+        osg::ref_ptr<const FeatureProfile> _profile;
+        GeoExtent _extent;
+        osg::ref_ptr<const FeatureFilterChain> _filters;
+        std::vector<std::uint64_t> _hits;
+        std::size_t _next;
+        unsigned _remaining;
+        std::queue< osg::ref_ptr<Feature> > _queue;
+        osg::ref_ptr<Feature> _lastFeatureReturned;
+    };
+
+    // Per-feature bookkeeping while building a store
+    struct BuildInfo
+    {
+        double        box[4];
+        std::int64_t  fid;
+        std::uint32_t hilbert;
+        std::uint32_t numParts;
+        std::uint64_t numCoords;
+    };
+
+    // Type a field ends up with when features disagree about it
+    AttributeType widen(AttributeType a, AttributeType b)
+    {
+        if (a == ATTRTYPE_UNSPECIFIED || a == b) return b;
+        if (b == ATTRTYPE_UNSPECIFIED) return a;
+        if ((a == ATTRTYPE_INT && b == ATTRTYPE_DOUBLE) || (a == ATTRTYPE_DOUBLE && b == ATTRTYPE_INT))
+            return ATTRTYPE_DOUBLE;
+        if ((a == ATTRTYPE_BOOL && b == ATTRTYPE_INT) || (a == ATTRTYPE_INT && b == ATTRTYPE_BOOL))
+            return ATTRTYPE_INT;
+        return ATTRTYPE_STRING;
+    }
+
+    template<typename T>
+    void writeAt(std::fstream& out, std::uint64_t offset, const T* data, std::uint64_t count)
+    {
+        if (count == 0u) return;
+        out.seekp((std::streamoff)offset);
+        out.write(reinterpret_cast<const char*>(data), (std::streamsize)(count * sizeof(T)));
+    }
+} }
+
+using namespace osgEarth::Packed;
+
+//........................................................................
+
+Config
+PackedFeatureSource::Options::getConfig() const
+{
+    Config conf = FeatureSource::Options::getConfig();
+    conf.set("url", _url);
+    conf.set("node_size", _nodeSize);
+    featureSource().set(conf, "features");
+    return conf;
+}
+
+void
+PackedFeatureSource::Options::fromConfig(const Config& conf)
+{
+    nodeSize().init(16u);
+
+    conf.get("url", _url);
+    conf.get("node_size", _nodeSize);
+    featureSource().get(conf, "features");
+}
+
+//........................................................................
+
+REGISTER_OSGEARTH_LAYER(packedfeatures, PackedFeatureSource);
+
+OE_LAYER_PROPERTY_IMPL(PackedFeatureSource, URI, URL, url);
+OE_LAYER_PROPERTY_IMPL(PackedFeatureSource, unsigned, NodeSize, nodeSize);
+
+void
+PackedFeatureSource::init()
+{
+    FeatureSource::init();
+    _geometryType = Geometry::TYPE_UNKNOWN;
+}
+
+PackedFeatureSource::~PackedFeatureSource()
+{
+    //nop
+}
+
+void
+PackedFeatureSource::setFeatureSource(FeatureSource* value)
+{
+    options().featureSource().setLayer(value);
+}
+
+FeatureSource*
+PackedFeatureSource::getFeatureSource() const
+{
+    return options().featureSource().getLayer();
+}
+
+Status
+PackedFeatureSource::openImplementation()
+{
+    Status parent = FeatureSource::openImplementation();
+    if (parent.isError())
+        return parent;
+
+    if (!options().url().isSet())
+        return Status(Status::ConfigurationError, "Missing required url");
+
+    std::string filename = options().url()->full();
+
+    if (!osgDB::fileExists(filename))
+    {
+        Status fsStatus = options().featureSource().open(getReadOptions());
+        if (fsStatus.isError())
+            return fsStatus;
+
+        if (!getFeatureSource())
+        {
+            return Status(Status::ResourceUnavailable, Stringify()
+                << "\"" << filename << "\" does not exist and there is no source to build it from");
+        }
+
+        OE_INFO << LC << "Building packed store \"" << filename << "\"" << std::endl;
+        Status buildStatus = build(getFeatureSource(), filename, options().nodeSize().get());
+        if (buildStatus.isError())
+            return buildStatus;
+    }
+
+    std::string error;
+    _store = Store::open(filename, error);
+    if (!_store.valid())
+    {
+        return Status(Status::ResourceUnavailable, Stringify()
+            << "Failed to open \"" << filename << "\": " << error);
+    }
+
+    const Header& h = _store->header();
+
+    osg::ref_ptr<const SpatialReference> srs = SpatialReference::create(_store->srsWKT());
+    if (!srs.valid())
+    {
+        _store = 0L;
+        return Status(Status::ResourceUnavailable, Stringify() << "Unrecognized SRS in \"" << filename << "\"");
+    }
+
+    FeatureProfile* featureProfile = new FeatureProfile(GeoExtent(
+        srs.get(), h.extent[0], h.extent[1], h.extent[2], h.extent[3]));
+
+    if (options().geoInterp().isSet())
+    {
+        featureProfile->geoInterp() = options().geoInterp().get();
+    }
+    setFeatureProfile(featureProfile);
+
+    _schema.clear();
+    for (unsigned i = 0; i < h.numFields; ++i)
+    {
+        _schema[_store->fieldNames()[i]] = (AttributeType)_store->field(i).type;
+    }
+    _geometryType = (Geometry::Type)h.geometryType;
+
+    OE_INFO << LC << "Opened \"" << filename << "\" with " << h.numFeatures << " features" << std::endl;
+
+    return Status::NoError;
+}
+
+Status
+PackedFeatureSource::closeImplementation()
+{
+    _store = 0L;
+    options().featureSource().close();
+    return FeatureSource::closeImplementation();
+}
+
+void
+PackedFeatureSource::addedToMap(const Map* map)
+{
+    FeatureSource::addedToMap(map);
+    options().featureSource().addedToMap(map);
+}
+
+void
+PackedFeatureSource::removedFromMap(const Map* map)
+{
+    options().featureSource().removedFromMap(map);
+    FeatureSource::removedFromMap(map);
+}
+
+FeatureCursor*
+PackedFeatureSource::createFeatureCursorImplementation(const Query& query, ProgressCallback* progress)
+{
+    if (!_store.valid())
+        return 0L;
+
+    // Better no answer than an unfiltered one
+    if (query.expression().isSet())
+    {
+        OE_WARN << LC << "Query expressions are not supported" << std::endl;
+        return 0L;
+    }
+
+    const FeatureProfile* profile = getFeatureProfile();
+    GeoExtent extent = profile->getExtent();
+
+    optional<Bounds> bounds = query.bounds();
+    if (!bounds.isSet() && query.tileKey().isSet())
+    {
+        GeoExtent localEx = query.tileKey()->getExtent().transform(profile->getSRS());
+        bounds = localEx.bounds();
+    }
+    if (bounds.isSet())
+    {
+        extent = GeoExtent(profile->getSRS(), bounds.get());
+    }
+
+    std::vector<std::uint64_t> hits;
+    _store->query(bounds.isSet() ? &bounds.get() : 0L, hits);
+
+    unsigned limit = query.limit().isSet() && query.limit().get() >= 0 ? (unsigned)query.limit().get() : ~0u;
+
+    return new PackedFeatureCursor(
+        _store.get(),
+        hits,
+        this,
+        profile,
+        extent,
+        getFilters(),
+        limit,
+        progress);
+}
+
+int
+PackedFeatureSource::getFeatureCount() const
+{
+    return _store.valid() ? (int)_store->header().numFeatures : -1;
+}
+
+Feature*
+PackedFeatureSource::getFeature(FeatureID fid)
+{
+    std::uint64_t position;
+    if (_store.valid() && !isBlacklisted(fid) && _store->find(fid, position))
+    {
+        return _store->createFeature(position, getFeatureProfile());
+    }
+    return 0L;
+}
+
+#undef  LC
+#define LC "[PackedFeatureSource] "
+
+Status
+PackedFeatureSource::build(
+    FeatureSource* input,
+    const std::string& filename,
+    unsigned nodeSize,
+    ProgressCallback* progress)
+{
+    if (!input || !input->getFeatureProfile())
+        return Status(Status::ConfigurationError, "Input feature source is not open");
+
+    const FeatureProfile* profile = input->getFeatureProfile();
+    if (profile->isTiled())
+        return Status(Status::ConfigurationError, "Cannot pack a tiled feature source");
+
+    nodeSize = osg::clampBetween(nodeSize, 2u, 65535u);
+
+    // Pass 1: bounding boxes, geometry sizes and the attribute schema.
+    // Only this summary is held in memory; the geometry and attribute data
+    // are streamed from the source again in pass 2.
+    std::vector<BuildInfo> infos;
+    std::map<std::string, AttributeType> schema;
+    std::vector<Part> parts;
+    std::vector<osg::Vec3d> coords;
+    Bounds dataBounds;
+
+    osg::ref_ptr<FeatureCursor> cursor = input->createFeatureCursor(Query(), progress);
+    while (cursor.valid() && cursor->hasMore())
+    {
+        if (progress && progress->isCanceled())
+            return Status(Status::GeneralError, "Canceled");
+
+        Feature* feature = cursor->nextFeature();
+
+        BuildInfo info;
+        info.fid = feature->getFID();
+        info.hilbert = ~0u;
+        info.box[0] = info.box[1] = DBL_MAX;
+        info.box[2] = info.box[3] = -DBL_MAX;
+
+        parts.clear();
+        coords.clear();
+        if (feature->getGeometry())
+            encode(feature->getGeometry(), parts, coords);
+
+        for (std::vector<osg::Vec3d>::const_iterator c = coords.begin(); c != coords.end(); ++c)
+        {
+            info.box[0] = std::min(info.box[0], c->x());
+            info.box[1] = std::min(info.box[1], c->y());
+            info.box[2] = std::max(info.box[2], c->x());
+            info.box[3] = std::max(info.box[3], c->y());
+        }
+        if (!coords.empty())
+        {
+            dataBounds.expandBy(info.box[0], info.box[1], 0.0);
+            dataBounds.expandBy(info.box[2], info.box[3], 0.0);
+        }
+        info.numParts = parts.size();
+        info.numCoords = coords.size();
+        infos.push_back(info);
+
+        const AttributeTable& attrs = feature->getAttrs();
+        for (AttributeTable::const_iterator a = attrs.begin(); a != attrs.end(); ++a)
+        {
+            if (a->second.first != ATTRTYPE_DOUBLEARRAY)
+            {
+                AttributeType& type = schema[a->first];
+                type = widen(type, a->second.second.set ? a->second.first : ATTRTYPE_UNSPECIFIED);
+            }
+        }
+    }
+    cursor = 0L;
+
+    const std::uint64_t n = infos.size();
+
+    // Order the features along a Hilbert curve through their box centers;
+    // features without geometry go last and are never hit by a bbox query.
+    double width = std::max(dataBounds.width(), 1e-12);
+    double height = std::max(dataBounds.height(), 1e-12);
+    for (std::vector<BuildInfo>::iterator i = infos.begin(); i != infos.end(); ++i)
+    {
+        if (i->numCoords > 0u)
+        {
+            double cx = 0.5 * (i->box[0] + i->box[2]);
+            double cy = 0.5 * (i->box[1] + i->box[3]);
+            std::uint32_t hx = (std::uint32_t)osg::clampBetween(65535.0 * (cx - dataBounds.xMin()) / width, 0.0, 65535.0);
+            std::uint32_t hy = (std::uint32_t)osg::clampBetween(65535.0 * (cy - dataBounds.yMin()) / height, 0.0, 65535.0);
+            i->hilbert = hilbert(hx, hy) >> 1; // leave ~0u for empties
+        }
+    }
+
+    std::vector<std::uint64_t> order(n); // position -> input index
+    for (std::uint64_t i = 0; i < n; ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+        [&infos](std::uint64_t a, std::uint64_t b) { return infos[a].hilbert < infos[b].hilbert; });
+
+    std::vector<std::uint64_t> position(n); // input index -> position
+    std::vector<std::uint64_t> firstPart(n), firstCoord(n);
+    std::uint64_t numParts = 0u, numCoords = 0u;
+    for (std::uint64_t s = 0; s < n; ++s)
+    {
+        const BuildInfo& info = infos[order[s]];
+        position[order[s]] = s;
+        firstPart[s] = numParts;
+        firstCoord[s] = numCoords;
+        numParts += info.numParts;
+        numCoords += info.numCoords;
+    }
+
+    // Pack the R-tree bottom-up: leaves in Hilbert order, then one level
+    // of parents per pass until a single root remains.
+    std::vector<Node> nodes;
+    std::vector<std::uint64_t> levels;
+    nodes.reserve(n + n / (nodeSize - 1u) + 1u);
+    for (std::uint64_t s = 0; s < n; ++s)
+    {
+        Node leaf;
+        ::memcpy(leaf.box, infos[order[s]].box, sizeof(leaf.box));
+        leaf.index = s;
+        nodes.push_back(leaf);
+    }
+    if (n > 0u)
+    {
+        levels.push_back(n);
+        std::uint64_t levelStart = 0u, levelEnd = n;
+        while (levelEnd - levelStart > 1u)
+        {
+            for (std::uint64_t i = levelStart; i < levelEnd; i += nodeSize)
+            {
+                Node parent;
+                parent.box[0] = parent.box[1] = DBL_MAX;
+                parent.box[2] = parent.box[3] = -DBL_MAX;
+                parent.index = i;
+                std::uint64_t end = std::min(i + nodeSize, levelEnd);
+                for (std::uint64_t c = i; c < end; ++c)
+                {
+                    const Node& child = nodes[c];
+                    parent.box[0] = std::min(parent.box[0], child.box[0]);
+                    parent.box[1] = std::min(parent.box[1], child.box[1]);
+                    parent.box[2] = std::max(parent.box[2], child.box[2]);
+                    parent.box[3] = std::max(parent.box[3], child.box[3]);
+                }
+                nodes.push_back(parent);
+            }
+            levelStart = levelEnd;
+            levelEnd = nodes.size();
+            levels.push_back(levelEnd);
+        }
+    }
+
+    std::vector<FIDEntry> fids(n);
+    for (std::uint64_t s = 0; s < n; ++s)
+    {
+        fids[s].fid = infos[order[s]].fid;
+        fids[s].position = s;
+    }
+    std::sort(fids.begin(), fids.end(),
+        [](const FIDEntry& a, const FIDEntry& b) { return a.fid < b.fid; });
+
+    // Lay out the sections
+    std::string wkt = profile->getSRS()->getWKT();
+
+    Header h;
+    ::memset(&h, 0, sizeof(h));
+    ::memcpy(h.magic, MAGIC, 4);
+    h.version = VERSION;
+    h.byteOrder = BYTE_ORDER;
+    h.nodeSize = nodeSize;
+    h.numFeatures = n;
+    h.numNodes = nodes.size();
+    h.numParts = numParts;
+    h.numCoords = numCoords;
+    h.numFields = schema.size();
+    h.numLevels = levels.size();
+    h.geometryType = input->getGeometryType();
+    h.extent[0] = profile->getExtent().xMin();
+    h.extent[1] = profile->getExtent().yMin();
+    h.extent[2] = profile->getExtent().xMax();
+    h.extent[3] = profile->getExtent().yMax();
+
+    std::uint64_t offset = align8(sizeof(Header));
+    h.srsOffset = offset;       h.srsLength = wkt.size();       offset = align8(offset + wkt.size());
+    h.levelsOffset = offset;    offset += levels.size() * 8u;
+    h.nodesOffset = offset;     offset += nodes.size() * sizeof(Node);
+    h.featuresOffset = offset;  offset += n * sizeof(FeatureRecord);
+    h.fidsOffset = offset;      offset += n * sizeof(FIDEntry);
+    h.partsOffset = offset;     offset += numParts * sizeof(Part);
+    h.coordsOffset = offset;    offset += numCoords * sizeof(osg::Vec3d);
+    h.fieldsOffset = offset;    offset += schema.size() * sizeof(Field);
+
+    std::vector<Field> fields;
+    std::vector<std::string> names;
+    std::string nameHeap;
+    for (std::map<std::string, AttributeType>::const_iterator i = schema.begin(); i != schema.end(); ++i)
+    {
+        Field f;
+        f.type = i->second != ATTRTYPE_UNSPECIFIED ? i->second : ATTRTYPE_STRING;
+        f.nameOffset = nameHeap.size();
+        f.nameLength = i->first.size();
+        nameHeap += i->first;
+        f.dataOffset = offset;      offset = align8(offset + n * columnWidth(f.type));
+        f.nullsOffset = offset;     offset = align8(offset + (n + 7u) / 8u);
+        fields.push_back(f);
+        names.push_back(i->first);
+    }
+    h.stringsOffset = offset;
+
+    // Pass 2: write everything at its final position
+    std::string tempFile = filename + ".tmp";
+    Util::makeDirectoryForFile(filename);
+    std::fstream out(tempFile.c_str(), std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!out.is_open())
+        return Status(Status::ResourceUnavailable, Stringify() << "Cannot write \"" << tempFile << "\"");
+
+    writeAt(out, h.srsOffset, wkt.data(), wkt.size());
+    writeAt(out, h.levelsOffset, levels.empty() ? 0L : &levels[0], levels.size());
+    writeAt(out, h.nodesOffset, nodes.empty() ? 0L : &nodes[0], nodes.size());
+    writeAt(out, h.fidsOffset, fids.empty() ? 0L : &fids[0], fids.size());
+    writeAt(out, h.fieldsOffset, fields.empty() ? 0L : &fields[0], fields.size());
+    writeAt(out, h.stringsOffset, nameHeap.data(), nameHeap.size());
+    std::vector<Node>().swap(nodes);
+    std::vector<FIDEntry>().swap(fids);
+
+    std::uint64_t heapEnd = nameHeap.size();
+    std::vector<std::vector<std::uint8_t> > nulls(fields.size(), std::vector<std::uint8_t>((n + 7u) / 8u, 0u));
+
+    std::uint64_t k = 0u;
+    bool mismatch = false;
+    cursor = input->createFeatureCursor(Query(), progress);
+    while (cursor.valid() && cursor->hasMore() && !mismatch)
+    {
+        if (progress && progress->isCanceled())
+            break;
+
+        Feature* feature = cursor->nextFeature();
+        if (k >= n || feature->getFID() != infos[k].fid)
+        {
+            mismatch = true;
+            break;
+        }
+
+        std::uint64_t s = position[k++];
+
+        parts.clear();
+        coords.clear();
+        if (feature->getGeometry())
+            encode(feature->getGeometry(), parts, coords);
+
+        for (std::vector<Part>::iterator p = parts.begin(); p != parts.end(); ++p)
+            p->firstCoord += firstCoord[s];
+
+        FeatureRecord record;
+        record.fid = feature->getFID();
+        record.firstPart = firstPart[s];
+        record.numParts = parts.size();
+        record.flags =
+            (!feature->getGeometry() ? FLAG_NO_GEOMETRY : 0u) |
+            (feature->getGeometry() && feature->getGeometry()->getType() == Geometry::TYPE_MULTI ? FLAG_MULTI : 0u);
+
+        writeAt(out, h.featuresOffset + s * sizeof(FeatureRecord), &record, 1u);
+        writeAt(out, h.partsOffset + firstPart[s] * sizeof(Part), parts.empty() ? 0L : &parts[0], parts.size());
+        writeAt(out, h.coordsOffset + firstCoord[s] * sizeof(osg::Vec3d), coords.empty() ? 0L : &coords[0], coords.size());
+
+        const AttributeTable& attrs = feature->getAttrs();
+        for (unsigned i = 0; i < fields.size(); ++i)
+        {
+            AttributeTable::const_iterator a = attrs.find(names[i]);
+            if (a == attrs.end() || !a->second.second.set || a->second.first == ATTRTYPE_DOUBLEARRAY)
+                continue;
+
+            const Field& f = fields[i];
+            std::uint64_t at = f.dataOffset + s * columnWidth(f.type);
+            nulls[i][s >> 3] |= (std::uint8_t)(1u << (s & 7u));
+
+            if (f.type == ATTRTYPE_INT)
+            {
+                long long value = a->second.getInt();
+                writeAt(out, at, &value, 1u);
+            }
+            else if (f.type == ATTRTYPE_DOUBLE)
+            {
+                double value = a->second.getDouble();
+                writeAt(out, at, &value, 1u);
+            }
+            else if (f.type == ATTRTYPE_BOOL)
+            {
+                std::uint8_t value = a->second.getBool() ? 1u : 0u;
+                writeAt(out, at, &value, 1u);
+            }
+            else
+            {
+                std::string value = a->second.getString();
+                StringRef ref;
+                ref.offset = heapEnd;
+                ref.length = value.size();
+                ref.reserved = 0u;
+                writeAt(out, at, &ref, 1u);
+                writeAt(out, h.stringsOffset + heapEnd, value.data(), value.size());
+                heapEnd += value.size();
+            }
+        }
+    }
+    cursor = 0L;
+
+    for (unsigned i = 0; i < fields.size(); ++i)
+    {
+        writeAt(out, fields[i].nullsOffset, nulls[i].empty() ? 0L : &nulls[i][0], nulls[i].size());
+    }
+
+    h.stringsLength = heapEnd;
+    writeAt(out, 0u, &h, 1u);
+
+    bool ok = !out.fail() && !mismatch && k == n;
+    out.close();
+
+    if (!ok)
+    {
+        ::remove(tempFile.c_str());
+        if (progress && progress->isCanceled())
+            return Status(Status::GeneralError, "Canceled");
+        if (mismatch || k != n)
+            return Status(Status::GeneralError, "Feature source returned different features on the second pass");
+        return Status(Status::ResourceUnavailable, Stringify() << "Failed to write \"" << tempFile << "\"");
+    }
+
+    ::remove(filename.c_str());
+    if (::rename(tempFile.c_str(), filename.c_str()) != 0)
+    {
+        ::remove(tempFile.c_str());
+        return Status(Status::ResourceUnavailable, Stringify() << "Failed to create \"" << filename << "\"");
+    }
+
+    OE_INFO << LC << "Packed " << n << " features into \"" << filename << "\"" << std::endl;
+    return Status::NoError;
+}
@@ -186,6 +186,7 @@ PagedNode2::PagedNode2() :
     _maxPixels(FLT_MAX),
     _useRange(true),
     _priorityScale(1.0f),
+    _priority(0.0f),
     _refinePolicy(REFINE_REPLACE),
     _preCompile(true),
     _autoUnload(true)
@@ -328,6 +329,9 @@ PagedNode2::computeBound() const
 
 void PagedNode2::load(float priority, const osg::Object* host)
 {
+    // remember the latest priority so the paging manager can order merges
+    _priority = priority;
+
     if (_load != nullptr &&
         _loadTriggered.exchange(true) == false)
     {
@@ -440,16 +444,51 @@ bool PagedNode2::isLoaded() const
 
 PagingManager::PagingManager() :
     _trackerMutex(OE_MUTEX_NAME),
-    _mergeMutex(OE_MUTEX_NAME),
     _tracker(),
+    _mergeScheduler("osgearth_paging"),
     _mergesPerFrame(4u),
     _newFrame(false)
 {
+    _mergeScheduler.setMaxMergesPerFrame(_mergesPerFrame);
     setCullingActive(false);
     ADJUST_UPDATE_TRAV_COUNT(this, +1);
     JobArena::get(PAGEDNODE_ARENA_NAME)->setConcurrency(4u);
 }
 
+void
+PagingManager::setMergesPerFrame(unsigned value)
+{
+    _mergesPerFrame = value;
+    _mergeScheduler.setMaxMergesPerFrame(value);
+}
+
+void
+PagingManager::setMergeTimeBudget(unsigned micros)
+{
+    _mergeScheduler.setTimeBudget(micros);
+}
+
+void
+PagingManager::merge(PagedNode2* host)
+{
+    osg::observer_ptr<PagedNode2> node(host);
+    int revision = host->_revision;
+
+    _mergeScheduler.push(
+        [node, revision]() -> bool
+        {
+            osg::ref_ptr<PagedNode2> next;
+            return node.lock(next) && next->merge(revision);
+        },
+        [node]() -> float
+        {
+            // a node that has gone away costs nothing to discard
+            osg::ref_ptr<PagedNode2> next;
+            return node.lock(next) ? next->_priority.load() : FLT_MAX;
+        },
+        host->_compiled.get()->className());
+}
+
 void
 PagingManager::traverse(osg::NodeVisitor& nv)
 {
@@ -469,10 +508,11 @@ PagingManager::traverse(osg::NodeVisitor& nv)
         {
             ScopedMutexLock lock(_trackerMutex); // unnecessary?
 
+            // 0 means "no limit", which to the tracker would mean "expire nothing"
             _tracker.flush(
                 nv,
                 0.0f,
-                _mergesPerFrame,
+                _mergesPerFrame > 0u ? _mergesPerFrame : ~0u,
                 [](osg::ref_ptr<PagedNode2>& node) -> bool {
                     if (node->getAutoUnload())
                     {
@@ -484,23 +524,7 @@ PagingManager::traverse(osg::NodeVisitor& nv)
         }
 
         // Handle merges
-        if (_mergeQueue.empty() == false)
-        {
-            ScopedMutexLock lock(_mergeMutex); // unnecessary?
-
-            unsigned count = 0u;
-            while (_mergeQueue.empty() == false && count < _mergesPerFrame)
-            {
-                ToMerge& front = _mergeQueue.front();
-                osg::ref_ptr<PagedNode2> next;
-                if (front._node.lock(next))
-                {
-                    if (next->merge(front._revision))
-                        ++count;
-                }
-                _mergeQueue.pop();
-            }
-        }
+        _mergeScheduler.run();
     }
 
     osg::Group::traverse(nv);
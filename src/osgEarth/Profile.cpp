@@ -327,7 +327,8 @@ Profile::Profile(const SpatialReference* srs,
                  unsigned int numTilesWideAtLod0,
                  unsigned int numTilesHighAtLod0) :
 
-    _extent(srs, xmin, ymin, xmax, ymax)
+    _extent(srs, xmin, ymin, xmax, ymax),
+    _tileIDIndex(~0u)
 {
     OE_SOFT_ASSERT(srs!=nullptr, __func__);
 
@@ -355,7 +356,8 @@ Profile::Profile(const SpatialReference* srs,
                  unsigned int numTilesWideAtLod0,
                  unsigned int numTilesHighAtLod0 ) :
 
-    _extent(srs, xmin, ymin, xmax, ymax)
+    _extent(srs, xmin, ymin, xmax, ymax),
+    _tileIDIndex(~0u)
 {
     OE_SOFT_ASSERT(srs!=nullptr, __func__);
 
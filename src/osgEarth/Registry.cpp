@@ -118,6 +118,9 @@ _blacklist("Reg.BlackList(OE)")
     osgDB::Registry::instance()->addArchiveExtension( "kmz" );
     osgDB::Registry::instance()->addArchiveExtension( "3tz");
     osgDB::Registry::instance()->addFileExtensionAlias( "3tz", "zip" );
+
+    // compiled earth files (see osgearth_compileearth)
+    osgDB::Registry::instance()->addFileExtensionAlias( "earthb", "earth" );
     //osgDB::Registry::instance()->addFileExtensionAlias( "kmz", "kml" );
 
     osgDB::Registry::instance()->addMimeTypeExtensionMapping( "application/vnd.google-earth.kml+xml", "kml" );
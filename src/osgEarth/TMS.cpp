@@ -1081,7 +1081,9 @@ TMS::Options::getMetadata()
         "properties" : [
           { "name": "url", "description" : "Location of the TMS repository", "type" : "string", "default" : "" },
           { "name": "tms_type", "description" : "Set to 'google' to invert the Y index", "type" : "string", "default" : "" },
-          { "name": "format", "description" : "Image format to assume (e.g. jpeg, png)", "type" : "string", "default" : "" }
+          { "name": "format", "description" : "Image format to assume (e.g. jpeg, png)", "type" : "string", "default" : "" },
+          { "name": "availability", "description" : "Location of a layer.json file listing the available tile ranges", "type" : "string", "default" : "" },
+          { "name": "learn_availability", "description" : "Remember tiles the server reports as missing", "type" : "bool", "default" : "false" }
         ]
       }
     ));
@@ -1090,9 +1092,13 @@ TMS::Options::getMetadata()
 void
 TMS::Options::readFrom(const Config& conf)
 {
+    learnAvailability().setDefault(false);
+
     conf.get("url", _url);
     conf.get("format", _format);
     conf.get("tms_type", _tmsType);
+    conf.get("availability", _availability);
+    conf.get("learn_availability", _learnAvailability);
 }
 
 void
@@ -1101,6 +1107,8 @@ TMS::Options::writeTo(Config& conf) const
     conf.set("url", _url);
     conf.set("tms_type", _tmsType);
     conf.set("format", _format);
+    conf.set("availability", _availability);
+    conf.set("learn_availability", _learnAvailability);
 }
 
 //........................................................................
@@ -1126,6 +1134,8 @@ REGISTER_OSGEARTH_LAYER(tmsimage, TMSImageLayer);
 OE_LAYER_PROPERTY_IMPL(TMSImageLayer, URI, URL, url);
 OE_LAYER_PROPERTY_IMPL(TMSImageLayer, std::string, TMSType, tmsType);
 OE_LAYER_PROPERTY_IMPL(TMSImageLayer, std::string, Format, format);
+OE_LAYER_PROPERTY_IMPL(TMSImageLayer, URI, AvailabilityURL, availability);
+OE_LAYER_PROPERTY_IMPL(TMSImageLayer, bool, LearnAvailability, learnAvailability);
 
 void
 TMSImageLayer::init()
@@ -1161,6 +1171,25 @@ TMSImageLayer::openImplementation()
         setProfile(profile.get());
     }
 
+    // Index of the tiles that exist, for sparse repositories
+    if (options().availability().isSet() || options().learnAvailability() == true)
+    {
+        osg::ref_ptr<TileAvailability> availability = new TileAvailability(getProfile());
+
+        if (options().availability().isSet())
+        {
+            // layer.json ranges count rows from the south, like TMS
+            ReadResult rr = options().availability()->readString(getReadOptions());
+            if (rr.failed() || !availability->readLayerJSON(rr.getString(), true))
+            {
+                OE_WARN << LC << "Failed to read tile availability from "
+                    << options().availability()->full() << std::endl;
+            }
+        }
+
+        setAvailability(availability.get());
+    }
+
     return Status::NoError;
 }
 
@@ -1187,8 +1216,19 @@ TMSImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* p
 
     if (r.succeeded())
         return GeoImage(r.releaseImage(), key.getExtent());
-    else
-        return GeoImage(Status(r.errorDetail()));
+
+    if (r.code() == ReadResult::RESULT_NOT_FOUND)
+    {
+        if (options().learnAvailability() == true &&
+            (!progress || !progress->isCanceled()))
+        {
+            reportMissingTile(key);
+        }
+
+        return GeoImage(Status(Status::ResourceUnavailable, r.errorDetail()));
+    }
+
+    return GeoImage(Status(r.errorDetail()));
 }
 
 Status
@@ -1239,6 +1279,8 @@ REGISTER_OSGEARTH_LAYER(tmselevation, TMSElevationLayer);
 OE_LAYER_PROPERTY_IMPL(TMSElevationLayer, URI, URL, url);
 OE_LAYER_PROPERTY_IMPL(TMSElevationLayer, std::string, TMSType, tmsType);
 OE_LAYER_PROPERTY_IMPL(TMSElevationLayer, std::string, Format, format);
+OE_LAYER_PROPERTY_IMPL(TMSElevationLayer, URI, AvailabilityURL, availability);
+OE_LAYER_PROPERTY_IMPL(TMSElevationLayer, bool, LearnAvailability, learnAvailability);
 
 void
 TMSElevationLayer::init()
@@ -1260,6 +1302,9 @@ TMSElevationLayer::openImplementation()
     // elevation; we just convert the resulting image to a heightfield
     _imageLayer = new TMSImageLayer(options());
 
+    // Missing tiles are learned by this layer, not the image layer
+    _imageLayer->setLearnAvailability(false);
+
     // Initialize and open the image layer
     _imageLayer->setReadOptions(getReadOptions());
     Status status;
@@ -1278,6 +1323,13 @@ TMSElevationLayer::openImplementation()
     setProfile(_imageLayer->getProfile());
     dataExtents() = _imageLayer->getDataExtents();
 
+    // Share the image layer's tile ranges, but do the learning here so the
+    // missing tiles are saved in (and loaded from) this layer's cache bin.
+    osg::ref_ptr<TileAvailability> availability = _imageLayer->getAvailability();
+    if (!availability.valid() && options().learnAvailability() == true)
+        availability = new TileAvailability(getProfile());
+    setAvailability(availability.get());
+
     return Status::NoError;
 }
 
@@ -1315,6 +1367,13 @@ TMSElevationLayer::createHeightFieldImplementation(const TileKey& key, ProgressC
     }
     else
     {
+        if (image.getStatus().code() == Status::ResourceUnavailable &&
+            options().learnAvailability() == true &&
+            (!progress || !progress->isCanceled()))
+        {
+            reportMissingTile(key);
+        }
+
         return GeoHeightField(image.getStatus());
     }
 }
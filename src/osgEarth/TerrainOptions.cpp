@@ -63,6 +63,7 @@ TerrainOptions::getConfig() const
     conf.set( "morph_elevation", morphTerrain() );
     conf.set( "morph_imagery", morphImagery() );
     conf.set( "merges_per_frame", mergesPerFrame() );
+    conf.set( "merge_time_budget", mergeTimeBudget() );
     conf.set( "priority_scale", priorityScale() );
     conf.set( "texture_compression", textureCompression());
     conf.set( "concurrency", concurrency());
@@ -102,6 +103,7 @@ TerrainOptions::fromConfig(const Config& conf)
     morphTerrain().init(true);
     morphImagery().init(true);
     mergesPerFrame().init(20u);
+    mergeTimeBudget().init(0u);
     priorityScale().init(1.0f);
     textureCompression().setDefault("");
     concurrency().setDefault(4u);
@@ -138,6 +140,7 @@ TerrainOptions::fromConfig(const Config& conf)
     conf.get( "morph_terrain", morphTerrain() );
     conf.get( "morph_imagery", morphImagery() );
     conf.get( "merges_per_frame", mergesPerFrame() );
+    conf.get( "merge_time_budget", mergeTimeBudget() );
     conf.get( "priority_scale", priorityScale());
     conf.get( "texture_compression", textureCompression());
     conf.get( "concurrency", concurrency());
@@ -195,6 +198,7 @@ OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, NormalizeEdges, normalizeEdges);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, MorphTerrain, morphTerrain);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, MorphImagery, morphImagery);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, MergesPerFrame, mergesPerFrame);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, MergeTimeBudget, mergeTimeBudget);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, float, PriorityScale, priorityScale);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, std::string, TextureCompressionMethod, textureCompression);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, Concurrency, concurrency);
@@ -23,6 +23,7 @@
 #include <osgEarth/LandCoverLayer>
 #include <osgEarth/TerrainConstraintLayer>
 #include <osgEarth/Metrics>
+#include <osgEarth/Math>
 
 #include <osg/Texture2D>
 #include <osg/Texture2DArray>
@@ -580,6 +581,60 @@ TerrainTileModelFactory::addElevation(
 
         if ( elevTex.valid() )
         {
+            // Layer whose cache bin holds our derived products, if any:
+            ElevationLayer* derivedCacheLayer = nullptr;
+            for (const auto& layer : layers)
+            {
+                if (layer->isOpen() && layer->getCacheDerivedData())
+                {
+                    derivedCacheLayer = layer.get();
+                    break;
+                }
+            }
+
+            // Try to reuse a normal map generated from these exact heights
+            // on a previous run. The normals along the tile's edges sample
+            // the neighboring tiles, so their heights are part of the key.
+            if (derivedCacheLayer && !elevTex->getNormalMapTexture())
+            {
+                std::size_t normalMapRevision = elevTex->getHeightFieldRevision();
+
+                const int offsets[4][2] = { {-1,0}, {1,0}, {0,-1}, {0,1} };
+                for (int n = 0; n < 4; ++n)
+                {
+                    std::size_t neighborRevision = 0u;
+                    TileKey neighborKey = key.createNeighborKey(offsets[n][0], offsets[n][1]);
+                    osg::ref_ptr<ElevationTexture> neighborTex;
+                    if (neighborKey.valid() &&
+                        map->getElevationPool()->getTile(neighborKey, true, neighborTex, &_workingSet, progress) &&
+                        neighborTex.valid())
+                    {
+                        neighborRevision = neighborTex->getHeightFieldRevision();
+                    }
+                    normalMapRevision = hash_value_unsigned(normalMapRevision, neighborRevision);
+                }
+
+                osg::ref_ptr<osg::Image> normalMap = derivedCacheLayer->readNormalMap(
+                    key, normalMapRevision);
+
+                if (normalMap.valid())
+                {
+                    elevTex->setNormalMap(normalMap.get());
+                }
+                else
+                {
+                    elevTex->generateNormalMap(map, &_workingSet, progress);
+
+                    if (elevTex->getNormalMapTexture())
+                    {
+                        derivedCacheLayer->writeNormalMap(
+                            key,
+                            normalMapRevision,
+                            elevTex->getNormalMapTexture()->getImage(0));
+                    }
+                }
+            }
+
             // Make a normal map if it doesn't already exist
             elevTex->generateNormalMap(map, &_workingSet, progress);
 
@@ -592,6 +647,12 @@ TerrainTileModelFactory::addElevation(
             // Keep the heightfield pointer around for legacy 3rd party usage (VRF)
             layerModel->setHeightField(elevTex->getHeightField());
 
+            if (elevTex->getExtrema().x() <= elevTex->getExtrema().y())
+            {
+                layerModel->setMinHeight(elevTex->getExtrema().x());
+                layerModel->setMaxHeight(elevTex->getExtrema().y());
+            }
+
             model->elevationModel() = layerModel.get();
         }
     }
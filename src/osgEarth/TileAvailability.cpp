@@ -0,0 +1,260 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/TileAvailability>
+#include <osgEarth/Profile>
+#include <osgEarth/JsonUtils>
+#include <algorithm>
+#include <sstream>
+
+using namespace osgEarth;
+using namespace osgEarth::Threading;
+
+#define LC "[TileAvailability] "
+
+TileAvailability::TileAvailability(const Profile* profile) :
+    _profile(profile),
+    _mutex("OE.TileAvailability")
+{
+    //nop
+}
+
+void
+TileAvailability::addAvailableRange(unsigned lod, unsigned minX, unsigned minY, unsigned maxX, unsigned maxY)
+{
+    if (minX > maxX || minY > maxY)
+        return;
+
+    Range range;
+    range.minX = minX, range.minY = minY;
+    range.maxX = maxX, range.maxY = maxY;
+
+    ScopedWriteLock lock(_mutex);
+    if (lod >= _ranges.size())
+        _ranges.resize(lod + 1);
+
+    // keep the level sorted by minX and update the reach of what follows
+    std::vector<Range>& ranges = _ranges[lod];
+    auto pos = std::upper_bound(ranges.begin(), ranges.end(), range,
+        [](const Range& a, const Range& b) { return a.minX < b.minX; });
+    pos = ranges.insert(pos, range);
+
+    unsigned reach = pos == ranges.begin() ? 0u : (pos - 1)->reach;
+    for (; pos != ranges.end(); ++pos)
+    {
+        reach = std::max(reach, pos->maxX);
+        pos->reach = reach;
+    }
+}
+
+bool
+TileAvailability::hasRanges() const
+{
+    ScopedReadLock lock(_mutex);
+    return !_ranges.empty();
+}
+
+bool
+TileAvailability::readLayerJSON(const std::string& json, bool invertY)
+{
+    Json::Reader reader;
+    Json::Value root(Json::objectValue);
+    if (!reader.parse(json, root, false) || !root.isObject())
+        return false;
+
+    const Json::Value& available = root["available"];
+    if (!available.isArray())
+        return false;
+
+    for (Json::ArrayIndex lod = 0; lod < available.size(); ++lod)
+    {
+        const Json::Value& level = available[lod];
+        if (!level.isArray())
+            continue;
+
+        unsigned cols = 0u, rows = 0u;
+        if (invertY && _profile.valid())
+            _profile->getNumTiles(lod, cols, rows);
+
+        for (Json::ArrayIndex i = 0; i < level.size(); ++i)
+        {
+            const Json::Value& r = level[i];
+            if (!r.isObject())
+                continue;
+
+            unsigned minX = r["startX"].asUInt(), maxX = r["endX"].asUInt();
+            unsigned minY = r["startY"].asUInt(), maxY = r["endY"].asUInt();
+
+            if (invertY)
+            {
+                if (maxY >= rows)
+                    continue;
+                unsigned flippedMinY = rows - 1u - maxY;
+                maxY = rows - 1u - minY;
+                minY = flippedMinY;
+            }
+
+            addAvailableRange(lod, minX, minY, maxX, maxY);
+        }
+    }
+
+    // Levels with no ranges have no tiles, but still
+    // count as listed so deeper levels are unavailable.
+    ScopedWriteLock lock(_mutex);
+    if (_ranges.size() < available.size())
+        _ranges.resize(available.size());
+
+    return true;
+}
+
+bool
+TileAvailability::isSameProfile(const Profile* profile) const
+{
+    // keys almost always share the layer's profile object
+    return
+        profile == _profile.get() ||
+        (profile && _profile.valid() && profile->isHorizEquivalentTo(_profile.get()));
+}
+
+bool
+TileAvailability::setMissing(const TileKey& key)
+{
+    if (!key.valid() || !isSameProfile(key.getProfile()))
+        return false;
+
+    return setMissing(key.getLOD(), key.getTileX(), key.getTileY());
+}
+
+bool
+TileAvailability::setMissing(unsigned lod, unsigned x, unsigned y)
+{
+    Tile tile;
+    tile.lod = lod, tile.x = x, tile.y = y;
+
+    ScopedWriteLock lock(_mutex);
+    return _missing.insert(tile).second;
+}
+
+unsigned
+TileAvailability::getNumMissing() const
+{
+    ScopedReadLock lock(_mutex);
+    return _missing.size();
+}
+
+bool
+TileAvailability::inRanges(unsigned lod, unsigned x, unsigned y) const
+{
+    if (_ranges.empty())
+        return true;
+
+    if (lod >= _ranges.size())
+        return false;
+
+    // only ranges starting at or before x can contain it, and the scan
+    // back can stop once nothing before reaches x
+    const std::vector<Range>& ranges = _ranges[lod];
+    Range probe;
+    probe.minX = x;
+    auto end = std::upper_bound(ranges.begin(), ranges.end(), probe,
+        [](const Range& a, const Range& b) { return a.minX < b.minX; });
+
+    for (auto r = end; r != ranges.begin(); )
+    {
+        --r;
+        if (r->reach < x)
+            break;
+        if (x <= r->maxX && y >= r->minY && y <= r->maxY)
+            return true;
+    }
+    return false;
+}
+
+bool
+TileAvailability::isAvailable(const TileKey& key) const
+{
+    return getBestAvailableTileKey(key) == key;
+}
+
+TileKey
+TileAvailability::getBestAvailableTileKey(const TileKey& key) const
+{
+    if (!key.valid() || !isSameProfile(key.getProfile()))
+        return key;
+
+    ScopedReadLock lock(_mutex);
+
+    // Climb until a tile is in the listed ranges and not known to be missing.
+    Tile tile;
+    tile.lod = key.getLOD(), tile.x = key.getTileX(), tile.y = key.getTileY();
+    for (;;)
+    {
+        if (inRanges(tile.lod, tile.x, tile.y) &&
+            (_missing.empty() || _missing.find(tile) == _missing.end()))
+        {
+            break;
+        }
+
+        if (tile.lod == 0u)
+            return TileKey::INVALID;
+
+        tile.lod--, tile.x >>= 1, tile.y >>= 1;
+    }
+
+    return tile.lod == key.getLOD() ? key : key.createAncestorKey(tile.lod);
+}
+
+Config
+TileAvailability::getMissingConfig() const
+{
+    ScopedReadLock lock(_mutex);
+
+    // store in tile order so the record does not churn between saves
+    std::vector<Tile> tiles(_missing.begin(), _missing.end());
+    std::sort(tiles.begin(), tiles.end());
+
+    std::stringstream buf;
+    for (auto& tile : tiles)
+    {
+        if (&tile != &tiles.front())
+            buf << ' ';
+        buf << tile.lod << '/' << tile.x << '/' << tile.y;
+    }
+
+    Config conf("availability");
+    conf.set("missing", buf.str());
+    return conf;
+}
+
+void
+TileAvailability::addMissing(const Config& conf)
+{
+    std::istringstream tiles(conf.value("missing"));
+    std::string tile;
+
+    while (tiles >> tile)
+    {
+        unsigned lod, x, y;
+        char s1, s2;
+        std::istringstream in(tile);
+        if (in >> lod >> s1 >> x >> s2 >> y && s1 == '/' && s2 == '/')
+        {
+            setMissing(lod, x, y);
+        }
+    }
+}
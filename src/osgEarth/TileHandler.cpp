@@ -34,8 +34,18 @@ bool TileHandler::hasData( const TileKey& key ) const
 {
     return true;
 }
+
+void TileHandler::getCompleted( const std::vector<TileKey>& keys, std::vector<bool>& output ) const
+{
+    output.assign( keys.size(), false );
+}
         
 std::string TileHandler::getProcessString() const
 {
     return "";
 }
+
+std::string TileHandler::getSignature() const
+{
+    return "";
+}
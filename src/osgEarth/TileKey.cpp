@@ -19,12 +19,210 @@
 
 #include <osgEarth/TileKey>
 #include <osgEarth/Math>
+#include <osgEarth/Notify>
+#include <osgEarth/Threading>
+#include <atomic>
 #include <stdio.h>
 
 using namespace osgEarth;
 
 //------------------------------------------------------------------------
 
+namespace
+{
+    // Spreads the low 32 bits of v into the even bits of a 64-bit word
+    inline std::uint64_t spreadBits(std::uint64_t v)
+    {
+        v &= 0x00000000FFFFFFFFULL;
+        v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+        v = (v | (v << 8))  & 0x00FF00FF00FF00FFULL;
+        v = (v | (v << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+        v = (v | (v << 2))  & 0x3333333333333333ULL;
+        v = (v | (v << 1))  & 0x5555555555555555ULL;
+        return v;
+    }
+
+    // Inverse of spreadBits
+    inline unsigned compactBits(std::uint64_t v)
+    {
+        v &= 0x5555555555555555ULL;
+        v = (v | (v >> 1))  & 0x3333333333333333ULL;
+        v = (v | (v >> 2))  & 0x0F0F0F0F0F0F0F0FULL;
+        v = (v | (v >> 4))  & 0x00FF00FF00FF00FFULL;
+        v = (v | (v >> 8))  & 0x0000FFFF0000FFFFULL;
+        v = (v | (v >> 16)) & 0x00000000FFFFFFFFULL;
+        return (unsigned)v;
+    }
+
+    // Process-wide profile intern table. Slots are written once under the
+    // mutex and published through "count", so readers need no lock.
+    struct ProfileTable
+    {
+        ProfileTable() : count(1u) { }
+        Threading::Mutex mutex;
+        osg::ref_ptr<const Profile> profiles[TileID::MAX_PROFILES + 1];
+        std::atomic<unsigned> count;
+    };
+
+    // Never destroyed, so profiles outlive any static teardown that
+    // still converts IDs.
+    ProfileTable& profileTable()
+    {
+        static ProfileTable* s_table = new ProfileTable();
+        return *s_table;
+    }
+}
+
+TileID::TileID(unsigned profileIndex, unsigned lod, unsigned x, unsigned y) :
+    _bits(0ULL)
+{
+    if (profileIndex > 0u && profileIndex <= MAX_PROFILES &&
+        lod <= MAX_LOD &&
+        (x >> COORD_BITS) == 0u && (y >> COORD_BITS) == 0u)
+    {
+        _bits =
+            ((std::uint64_t)profileIndex << 59) |
+            ((std::uint64_t)lod << 54) |
+            spreadBits(x) |
+            (spreadBits(y) << 1);
+    }
+}
+
+unsigned
+TileID::getTileX() const
+{
+    return compactBits(_bits & MORTON_MASK);
+}
+
+unsigned
+TileID::getTileY() const
+{
+    return compactBits((_bits & MORTON_MASK) >> 1);
+}
+
+TileID
+TileID::createParentID() const
+{
+    unsigned lod = getLOD();
+    if (!valid() || lod == 0u)
+        return TileID();
+
+    // dropping the low bit of x and y drops the low two Morton bits
+    return TileID(
+        (_bits & ~((0x1FULL << 54) | MORTON_MASK)) |
+        ((std::uint64_t)(lod - 1u) << 54) |
+        (getMortonCode() >> 2));
+}
+
+TileID
+TileID::createChildID(unsigned quadrant) const
+{
+    unsigned lod = getLOD();
+    std::uint64_t morton = getMortonCode();
+    if (!valid() || lod == MAX_LOD || quadrant > 3u || (morton >> 52) != 0ULL)
+        return TileID();
+
+    // the quadrant number is the low two Morton bits of the child
+    return TileID(
+        (_bits & ~((0x1FULL << 54) | MORTON_MASK)) |
+        ((std::uint64_t)(lod + 1u) << 54) |
+        (morton << 2) | (std::uint64_t)quadrant);
+}
+
+namespace
+{
+    // Scans the published slots [first, count) for a match (assumes count
+    // was loaded with acquire ordering).
+    unsigned findSlot(ProfileTable& table, const Profile* profile, unsigned first, unsigned count)
+    {
+        for (unsigned i = first; i < count; ++i)
+        {
+            if (table.profiles[i].get() == profile)
+                return i;
+        }
+        for (unsigned i = first; i < count; ++i)
+        {
+            if (table.profiles[i]->isHorizEquivalentTo(profile))
+                return i;
+        }
+        return 0u;
+    }
+}
+
+unsigned
+TileID::findProfile(const Profile* profile)
+{
+    if (!profile)
+        return 0u;
+
+    unsigned cached = profile->_tileIDIndex.load(std::memory_order_acquire);
+    if (cached != ~0u)
+        return cached;
+
+    ProfileTable& table = profileTable();
+    unsigned index = findSlot(table, profile, 1u, table.count.load(std::memory_order_acquire));
+    if (index > 0u)
+        profile->_tileIDIndex.store(index, std::memory_order_release);
+    return index;
+}
+
+unsigned
+TileID::internProfile(const Profile* profile)
+{
+    if (!profile)
+        return 0u;
+
+    // Common case: this profile object was looked up before.
+    unsigned cached = profile->_tileIDIndex.load(std::memory_order_acquire);
+    if (cached != ~0u)
+        return cached;
+
+    ProfileTable& table = profileTable();
+
+    unsigned count = table.count.load(std::memory_order_acquire);
+    unsigned index = findSlot(table, profile, 1u, count);
+
+    if (index == 0u)
+    {
+        Threading::ScopedMutexLock lock(table.mutex);
+
+        // check any slots added while we waited for the lock
+        unsigned first = count;
+        count = table.count.load(std::memory_order_acquire);
+        index = findSlot(table, profile, first, count);
+
+        if (index == 0u)
+        {
+            if (count > MAX_PROFILES)
+            {
+                OE_WARN << "[TileID] Profile table is full; TileIDs for "
+                    << profile->toString() << " will be invalid" << std::endl;
+            }
+            else
+            {
+                table.profiles[count] = profile;
+                table.count.store(count + 1u, std::memory_order_release);
+                index = count;
+            }
+        }
+    }
+
+    // A full table never frees a slot, so a miss is final too.
+    profile->_tileIDIndex.store(index, std::memory_order_release);
+    return index;
+}
+
+const Profile*
+TileID::getProfile(unsigned profileIndex)
+{
+    ProfileTable& table = profileTable();
+    if (profileIndex == 0u || profileIndex >= table.count.load(std::memory_order_acquire))
+        return 0L;
+    return table.profiles[profileIndex].get();
+}
+
+//------------------------------------------------------------------------
+
 TileKey TileKey::INVALID( 0, 0, 0, 0L );
 
 //------------------------------------------------------------------------
@@ -48,6 +246,35 @@ TileKey::TileKey(const TileKey& rhs) :
     //NOP
 }
 
+TileKey::TileKey(const TileID& id, const Profile* profile) :
+    _lod(id.getLOD()),
+    _x(id.getTileX()),
+    _y(id.getTileY())
+{
+    const Profile* idProfile = id.getProfile();
+    if (idProfile && profile && profile->isHorizEquivalentTo(idProfile))
+        _profile = profile;
+    rehash();
+}
+
+TileID
+TileKey::getID() const
+{
+    if (!valid())
+        return TileID();
+
+    return TileID(TileID::internProfile(_profile.get()), _lod, _x, _y);
+}
+
+TileID
+TileKey::findID() const
+{
+    if (!valid())
+        return TileID();
+
+    return TileID(TileID::findProfile(_profile.get()), _lod, _x, _y);
+}
+
 void
 TileKey::rehash()
 {
@@ -22,11 +22,17 @@
 #include <osgEarth/URI>
 #include <osgEarth/Map>
 #include <osgEarth/MemCache>
+#include <osgEarth/DataExtentIndex>
+#include <osgEarth/TileAvailability>
+#include <cstdio>
 
 using namespace osgEarth;
 
 #define LC "[TileLayer] Layer \"" << getName() << "\" "
 
+// number of newly learned missing tiles that triggers a save to the cache
+#define AVAILABILITY_SAVE_INTERVAL 64u
+
 //------------------------------------------------------------------------
 
 Config
@@ -302,6 +308,9 @@ TileLayer::init()
 
     _writingRequested = false;
     _profileMatchesMapProfile = true;
+    _availabilityLoaded = false;
+    _availabilityUnsaved = 0u;
+    _availabilityCreated = 0;
 
     // If the user asked for a custom profile, install it now
     if (options().profile().isSet())
@@ -406,6 +415,9 @@ TileLayer::openForWriting()
 Status
 TileLayer::closeImplementation()
 {
+    if (_availability.valid() && _availabilityUnsaved > 0u)
+        saveAvailability();
+
     return Layer::closeImplementation();
 }
 
@@ -594,6 +606,60 @@ TileLayer::getCacheBinMetadata(const Profile* profile)
     return i != _cacheBinMetadata.end() ? i->second.get() : 0L;
 }
 
+std::string
+TileLayer::getCacheKey(const TileKey& key) const
+{
+    // the cache key combines the Key and the horizontal profile.
+    return Cache::makeCacheKey(
+        Stringify() << key.str() << "-" << std::hex << key.getProfile()->getHorizSignature(),
+        getCacheKeyPrefix());
+}
+
+void
+TileLayer::makeMemCacheKey(const TileKey& key, char* buf) const
+{
+    // The packed ID covers the LOD, tile x/y and the horizontal profile,
+    // so there's no need to format the profile signature. Don't claim a
+    // profile slot just for this; the string key works for any profile.
+    TileID id = key.findID();
+    if (id.valid())
+    {
+        sprintf(buf, "%d/%llx", getRevision(), (unsigned long long)id.bits());
+    }
+    else
+    {
+        snprintf(buf, 64, "%d/%s/%s",
+            getRevision(),
+            key.str().c_str(),
+            key.getProfile()->getHorizSignature().c_str());
+    }
+}
+
+void
+TileLayer::getCacheRecordStatus(const std::vector<TileKey>& keys,
+                                std::vector<CacheBin::RecordStatus>& output)
+{
+    output.assign(keys.size(), CacheBin::STATUS_NOT_FOUND);
+
+    if (keys.empty())
+        return;
+
+    const CachePolicy& policy = getCacheSettings()->cachePolicy().get();
+    if (!policy.isCacheReadable())
+        return;
+
+    CacheBin* bin = getCacheBin(keys.front().getProfile());
+    if (!bin)
+        return;
+
+    std::vector<std::string> cacheKeys;
+    cacheKeys.reserve(keys.size());
+    for (unsigned i = 0; i < keys.size(); ++i)
+        cacheKeys.push_back(getCacheKey(keys[i]));
+
+    bin->getRecordStatuses(cacheKeys, output);
+}
+
 bool
 TileLayer::isKeyInLegalRange(const TileKey& key) const
 {
@@ -748,6 +814,7 @@ TileLayer::dirtyDataExtents()
 {
     Threading::ScopedMutexLock lock(layerMutex());
     _dataExtentsUnion = GeoExtent::INVALID;
+    std::atomic_store(&_dataExtentsIndex, std::shared_ptr<DataExtentIndex>());
 }
 
 const DataExtent&
@@ -777,6 +844,33 @@ TileLayer::getDataExtentsUnion() const
     return _dataExtentsUnion;
 }
 
+std::shared_ptr<DataExtentIndex>
+TileLayer::getDataExtentsIndex() const
+{
+    const DataExtentList& de = getDataExtents();
+
+    // Layers often fill in dataExtents() without dirtying them, so
+    // rebuild whenever the list changes size too.
+    std::shared_ptr<DataExtentIndex> index = std::atomic_load(&_dataExtentsIndex);
+    if (index == nullptr || index->size() != de.size())
+    {
+        Threading::ScopedMutexLock lock(layerMutex());
+
+        index = std::atomic_load(&_dataExtentsIndex);
+        if (index == nullptr || index->size() != de.size()) // double-check
+        {
+            index = std::make_shared<DataExtentIndex>(de);
+
+            // remembering answers only pays off when queries are not trivial
+            if (de.size() > 256u)
+                index->setCacheSize(4096u);
+
+            std::atomic_store(&_dataExtentsIndex, index);
+        }
+    }
+    return index;
+}
+
 const GeoExtent&
 TileLayer::getExtent() const
 {
@@ -830,64 +924,151 @@ TileLayer::getBestAvailableTileKey(const TileKey& key) const
 
     // Next check against the data extents.
     const DataExtentList& de = getDataExtents();
+    TileKey best;
 
-    // If we have mo data extents available, just return the MDL-limited input key.
+    // If we have mo data extents available, just use the MDL-limited input key.
     if (de.empty())
     {
-        return localLOD > MDL ? key.createAncestorKey(MDL) : key;
+        best = localLOD > MDL ? key.createAncestorKey(MDL) : key;
+    }
+    else
+    {
+        // Reject if the extents don't overlap at all.
+        if (!getDataExtentsUnion().intersects(key.getExtent()))
+        {
+            return TileKey::INVALID;
+        }
+
+        // Find the best level the extents offer for this key.
+        int bestLOD = getDataExtentsIndex()->getBestAvailableLevel(key, localLOD);
+
+        if (bestLOD < 0)
+        {
+            return TileKey::INVALID;
+        }
+
+        // The key itself is good.
+        if (bestLOD >= (int)localLOD)
+        {
+            best = localLOD > MDL ? key.createAncestorKey(MDL) : key;
+        }
+
+        // The extents only go as high as some lower level.
+        else
+        {
+            best = key.createAncestorKey(osg::minimum(key.getLOD(), osg::minimum((unsigned)bestLOD, MDL)));
+        }
     }
 
-    // Reject if the extents don't overlap at all.
-    if (!getDataExtentsUnion().intersects(key.getExtent()))
+    // Finally, skip over tiles the source is known not to have.
+    if (_availability.valid() && best.valid())
     {
-        return TileKey::INVALID;
+        if (!_availabilityLoaded)
+            loadAvailability();
+
+        best = _availability->getBestAvailableTileKey(best);
     }
 
-    bool     intersects = false;
-    unsigned highestLOD = 0;
+    return best;
+}
+
+TileAvailability*
+TileLayer::getAvailability() const
+{
+    return _availability.get();
+}
+
+void
+TileLayer::setAvailability(TileAvailability* value)
+{
+    _availability = value;
+    _availabilityLoaded = false;
+    _availabilityUnsaved = 0u;
+    _availabilityCreated = 0;
+}
+
+void
+TileLayer::reportMissingTile(const TileKey& key) const
+{
+    if (!_availability.valid())
+        return;
 
-    // Check each data extent in turn:
-    for (DataExtentList::const_iterator itr = de.begin(); itr != de.end(); ++itr)
+    // In cache-only mode a miss just means the tile was never cached.
+    const CacheSettings* cacheSettings = getCacheSettings();
+    if (cacheSettings && cacheSettings->cachePolicy()->isCacheOnly())
+        return;
+
+    // load first, so a save cannot clobber what earlier sessions learned
+    if (!_availabilityLoaded)
+        loadAvailability();
+
+    if (_availability->setMissing(key) &&
+        ++_availabilityUnsaved >= AVAILABILITY_SAVE_INTERVAL)
     {
-        // check for 2D intersection:
-        if (key.getExtent().intersects(*itr))
-        {
-            // check that the extent isn't higher-resolution than our key:
-            if ( !itr->minLevel().isSet() || localLOD >= (int)itr->minLevel().get() )
-            {
-                // Got an intersetion; now test the LODs:
-                intersects = true;
+        saveAvailability();
+    }
+}
 
-                // Is the high-LOD set? If not, there's not enough information
-                // so just assume our key might be good.
-                if ( itr->maxLevel().isSet() == false )
-                {
-                    return localLOD > MDL ? key.createAncestorKey(MDL) : key;
-                }
+std::string
+TileLayer::getAvailabilityKey() const
+{
+    return Stringify() << std::hex << getProfile()->getHorizSignature() << "_availability";
+}
 
-                // Is our key at a lower or equal LOD than the max key in this extent?
-                // If so, our key is good.
-                else if ( localLOD <= (int)itr->maxLevel().get() )
-                {
-                    return localLOD > MDL ? key.createAncestorKey(MDL) : key;
-                }
+void
+TileLayer::loadAvailability() const
+{
+    if (_availabilityLoaded.exchange(true))
+        return;
 
-                // otherwise, record the highest encountered LOD that
-                // intersects our key.
-                else if ( itr->maxLevel().get() > highestLOD )
-                {
-                    highestLOD = itr->maxLevel().get();
-                }
+    _availabilityCreated = DateTime().asTimeStamp();
+
+    CacheSettings* cacheSettings = const_cast<CacheSettings*>(getCacheSettings());
+    if (!cacheSettings || cacheSettings->isCacheDisabled() || !getProfile())
+        return;
+
+    CacheBin* bin = cacheSettings->getCacheBin();
+    if (!bin || !cacheSettings->cachePolicy()->isCacheReadable())
+        return;
+
+    // The record carries the time learning started. Once that expires the
+    // record is dropped whole, so the layer asks again for tiles that may
+    // since have appeared.
+    ReadResult rr = bin->readString(getAvailabilityKey(), getReadOptions());
+    if (rr.succeeded())
+    {
+        Config conf;
+        if (conf.fromJSON(rr.getString()))
+        {
+            TimeStamp created = conf.value<TimeStamp>("created", rr.lastModifiedTime());
+            if (!cacheSettings->cachePolicy()->isExpired(created))
+            {
+                _availabilityCreated = created;
+                _availability->addMissing(conf);
+                OE_DEBUG << LC << "Loaded " << _availability->getNumMissing() << " missing tiles from the cache" << std::endl;
             }
         }
     }
+}
 
-    if ( intersects )
-    {
-        return key.createAncestorKey(osg::minimum(key.getLOD(), osg::minimum(highestLOD, MDL)));
-    }
+void
+TileLayer::saveAvailability() const
+{
+    _availabilityUnsaved = 0u;
+
+    CacheSettings* cacheSettings = const_cast<CacheSettings*>(getCacheSettings());
+    if (!cacheSettings || cacheSettings->isCacheDisabled() || !getProfile())
+        return;
 
-    return TileKey::INVALID;
+    CacheBin* bin = cacheSettings->getCacheBin();
+    if (!bin || !cacheSettings->cachePolicy()->isCacheWriteable())
+        return;
+
+    Config conf = _availability->getMissingConfig();
+    conf.set("created", _availabilityCreated);
+    std::string data = conf.toJSON(false);
+    osg::ref_ptr<StringObject> temp = new StringObject(data);
+    bin->write(getAvailabilityKey(), temp.get(), getReadOptions());
 }
 
 bool
@@ -0,0 +1,213 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/TileMesh>
+#include <osgEarth/Endian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    const char MAGIC[4] = { 'O', 'E', 'T', 'M' };
+    const std::uint16_t VERSION = 2;
+
+    enum Flags
+    {
+        FLAG_HAS_CONSTRAINTS = 1 << 0,
+        FLAG_EMPTY = 1 << 1
+    };
+
+    // magic, version, flags, vertex count, index count, vertex bounds
+    const std::size_t HEADER_SIZE = 4 + 2 + 2 + 4 + 4 + 6*4;
+
+    // vertex components are quantized to 16 bits across the bounds
+    const std::size_t VERTEX_SIZE = 3 * 2;
+    const float QUANT_MAX = 65535.0f;
+
+    inline void put16(char*& p, std::uint16_t value)
+    {
+        value = OE_ENCODE_SHORT(value);
+        ::memcpy(p, &value, 2); p += 2;
+    }
+
+    inline void put32(char*& p, std::uint32_t value)
+    {
+        value = OE_ENCODE_INT(value);
+        ::memcpy(p, &value, 4); p += 4;
+    }
+
+    inline void putFloat(char*& p, float value)
+    {
+        std::uint32_t bits = OE_ENCODE_FLOAT(value);
+        ::memcpy(p, &bits, 4); p += 4;
+    }
+
+    inline std::uint16_t get16(const char*& p)
+    {
+        std::uint16_t value;
+        ::memcpy(&value, p, 2); p += 2;
+        return OE_DECODE_SHORT(value);
+    }
+
+    inline std::uint32_t get32(const char*& p)
+    {
+        std::uint32_t value;
+        ::memcpy(&value, p, 4); p += 4;
+        return OE_DECODE_INT(value);
+    }
+
+    inline float getFloat(const char*& p)
+    {
+        std::uint32_t bits;
+        ::memcpy(&bits, p, 4); p += 4;
+        return OE_DECODE_FLOAT(bits);
+    }
+}
+
+TileMesh::TileMesh() :
+    hasConstraints(false),
+    empty(false)
+{
+    //nop
+}
+
+void
+TileMesh::clear()
+{
+    verts.clear();
+    markers.clear();
+    indices.clear();
+    hasConstraints = false;
+    empty = false;
+}
+
+void
+TileMesh::write(std::string& out) const
+{
+    const std::size_t numVerts = verts.size();
+
+    osg::Vec3f vmin, vmax;
+    if (numVerts > 0)
+    {
+        vmin = vmax = verts.front();
+        for (const auto& v : verts)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                vmin[k] = std::min(vmin[k], v[k]);
+                vmax[k] = std::max(vmax[k], v[k]);
+            }
+        }
+    }
+
+    out.resize(HEADER_SIZE + numVerts*(VERTEX_SIZE + 1) + indices.size()*2);
+    char* p = &out[0];
+
+    ::memcpy(p, MAGIC, 4); p += 4;
+    put16(p, VERSION);
+    put16(p, (hasConstraints ? FLAG_HAS_CONSTRAINTS : 0) | (empty ? FLAG_EMPTY : 0));
+    put32(p, (std::uint32_t)numVerts);
+    put32(p, (std::uint32_t)indices.size());
+
+    for (int k = 0; k < 3; ++k)
+        putFloat(p, vmin[k]);
+    for (int k = 0; k < 3; ++k)
+        putFloat(p, vmax[k]);
+
+    for (const auto& v : verts)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            float range = vmax[k] - vmin[k];
+            float t = range > 0.0f ? (v[k] - vmin[k]) / range : 0.0f;
+            put16(p, (std::uint16_t)std::lround(osg::clampBetween(t, 0.0f, 1.0f) * QUANT_MAX));
+        }
+    }
+
+    for (std::size_t i = 0; i < numVerts; ++i)
+    {
+        *p++ = (char)(i < markers.size() ? markers[i] : 0);
+    }
+
+    for (auto index : indices)
+    {
+        put16(p, index);
+    }
+}
+
+bool
+TileMesh::read(const std::string& in)
+{
+    clear();
+
+    if (in.size() < HEADER_SIZE || ::memcmp(in.data(), MAGIC, 4) != 0)
+        return false;
+
+    const char* p = in.data() + 4;
+    if (get16(p) != VERSION)
+        return false;
+
+    std::uint16_t flags = get16(p);
+    std::uint32_t numVerts = get32(p);
+    std::uint32_t numIndices = get32(p);
+
+    // every index must be addressable with 16 bits, and the buffer must
+    // hold exactly what the header promises.
+    if (numVerts > 0xFFFF ||
+        in.size() != HEADER_SIZE + (std::size_t)numVerts*(VERTEX_SIZE + 1) + (std::size_t)numIndices*2)
+    {
+        return false;
+    }
+
+    osg::Vec3f vmin, vmax;
+    for (int k = 0; k < 3; ++k)
+        vmin[k] = getFloat(p);
+    for (int k = 0; k < 3; ++k)
+        vmax[k] = getFloat(p);
+
+    verts.resize(numVerts);
+    for (auto& v : verts)
+    {
+        for (int k = 0; k < 3; ++k)
+            v[k] = vmin[k] + (vmax[k] - vmin[k]) * ((float)get16(p) / QUANT_MAX);
+    }
+
+    markers.assign(
+        reinterpret_cast<const std::uint8_t*>(p),
+        reinterpret_cast<const std::uint8_t*>(p) + numVerts);
+    p += numVerts;
+
+    indices.resize(numIndices);
+    for (auto& index : indices)
+    {
+        index = get16(p);
+        if (index >= numVerts)
+        {
+            clear();
+            return false;
+        }
+    }
+
+    hasConstraints = (flags & FLAG_HAS_CONSTRAINTS) != 0;
+    empty = (flags & FLAG_EMPTY) != 0;
+    return true;
+}
@@ -19,7 +19,20 @@
 #include <osgEarth/TileVisitor>
 #include <osgEarth/CacheEstimator>
 #include <osgEarth/FileUtils>
+#include <osgEarth/StringUtils>
+#include <osgDB/FileUtils>
 #include <thread>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <cstdio>
+#include <ctime>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
 
 #if OSG_VERSION_GREATER_OR_EQUAL(3,5,10)
 #include <osg/os_utils>
@@ -309,6 +322,747 @@ bool MultithreadedTileVisitor::handleTile(const TileKey& key)
 
 /*****************************************************************************************/
 
+TileKeyListVisitor::TileKeyListVisitor()
+{
+}
+
+void TileKeyListVisitor::setKeys(const TileKeyList& keys)
+{
+    _keys = keys;
+}
+
+void TileKeyListVisitor::run(const Profile* mapProfile)
+{
+    _profile = mapProfile;
+
+    resetProgress();
+    _total = _keys.size();
+
+    osg::Timer_t lastWrite = osg::Timer::instance()->tick();
+
+    for (TileKeyList::iterator itr = _keys.begin(); itr != _keys.end(); ++itr)
+    {
+        if (_progress && _progress->isCanceled())
+        {
+            break;
+        }
+
+        handleTile( *itr );
+
+        osg::Timer_t now = osg::Timer::instance()->tick();
+        if (!_progressFile.empty() && osg::Timer::instance()->delta_s(lastWrite, now) >= 1.0)
+        {
+            writeProgress( _processed, _total );
+            lastWrite = now;
+        }
+    }
+
+    writeProgress( _processed, _total );
+}
+
+void TileKeyListVisitor::writeProgress(unsigned processed, unsigned total) const
+{
+    if (!_progressFile.empty())
+    {
+        std::ofstream out( _progressFile.c_str(), std::ios::out | std::ios::trunc );
+        out << processed << " " << total << std::endl;
+    }
+}
+
+/*****************************************************************************************/
+
+namespace
+{
+    void removeEmptyDirectory(const std::string& path)
+    {
+#ifdef _WIN32
+        ::_rmdir( path.c_str() );
+#else
+        ::rmdir( path.c_str() );
+#endif
+    }
+}
+
+std::string
+MultiprocessTileVisitor::quoteArgument(const std::string& arg)
+{
+#ifdef _WIN32
+    // Microsoft C runtime rules: backslashes are literal unless they
+    // precede a double quote, in which case they (and the quote) are
+    // escaped with a backslash.
+    std::string out = "\"";
+    unsigned slashes = 0u;
+    for (char c : arg)
+    {
+        if (c == '\\')
+        {
+            ++slashes;
+        }
+        else
+        {
+            if (c == '"')
+                out.append(slashes + 1u, '\\');
+            slashes = 0u;
+        }
+        out.push_back(c);
+    }
+    out.append(slashes, '\\');
+    out.push_back('"');
+    return out;
+#else
+    // POSIX shell: everything inside single quotes is literal, and a
+    // single quote itself is written as '\''
+    if (!arg.empty() && arg.find_first_not_of(
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-+=.,:/@%") == std::string::npos)
+    {
+        return arg;
+    }
+
+    std::string out = "'";
+    for (char c : arg)
+    {
+        if (c == '\'')
+            out.append("'\\''");
+        else
+            out.push_back(c);
+    }
+    out.push_back('\'');
+    return out;
+#endif
+}
+
+MultiprocessTileVisitor::MultiprocessTileVisitor():
+_numProcesses(Threading::getConcurrency()),
+_batchSize(0),
+_succeeded(false)
+{
+}
+
+MultiprocessTileVisitor::MultiprocessTileVisitor(TileHandler* handler) :
+TileVisitor(handler),
+_numProcesses(Threading::getConcurrency()),
+_batchSize(0),
+_succeeded(false)
+{
+}
+
+bool MultiprocessTileVisitor::handleTile(const TileKey& key)
+{
+    // Just collect the key; the worker processes do the real work.
+    _collected.push_back( key );
+    return true;
+}
+
+void MultiprocessTileVisitor::run(const Profile* mapProfile)
+{
+    _succeeded = false;
+    _failedTaskFiles.clear();
+
+    if (!_tileHandler.valid() || _tileHandler->getProcessString().empty())
+    {
+        OE_WARN << "[MultiprocessTileVisitor] TileHandler does not provide a process string" << std::endl;
+        return;
+    }
+
+    unsigned numProcesses = osg::maximum( _numProcesses, 1u );
+
+    // Walk the pyramid to collect every key
+    _collected.clear();
+    TileVisitor::run( mapProfile );
+
+    resetProgress();
+    _total = _collected.size();
+
+    if (_progress.valid() && _progress->isCanceled())
+        return;
+
+    if (_collected.empty())
+    {
+        _succeeded = true;
+        return;
+    }
+
+    // Split the keys into task lists. The keys were collected depth-first, so
+    // each contiguous run is a spatially coherent chunk of the pyramid.
+    unsigned batchSize = _batchSize > 0 ? _batchSize : (_collected.size() + numProcesses - 1) / numProcesses;
+    unsigned numTasks = (_collected.size() + batchSize - 1) / batchSize;
+
+    // A folder of our own, so concurrent runs cannot trample each other's files
+    std::string taskDir = getTempName(
+        (_tempDirectory.empty() ? std::string(".") : _tempDirectory) + "/osgearth_tasks", "");
+
+    if (!osgEarth::makeDirectory( taskDir ))
+    {
+        OE_WARN << "[MultiprocessTileVisitor] Failed to create " << taskDir << std::endl;
+        return;
+    }
+
+    std::vector<std::string> taskFiles, progressFiles;
+    for (unsigned t = 0; t < numTasks; ++t)
+    {
+        TaskList tasks( mapProfile );
+        TileKeyList::iterator begin = _collected.begin() + t*batchSize;
+        TileKeyList::iterator end = _collected.begin() + osg::minimum( (unsigned)_collected.size(), (t+1)*batchSize );
+        tasks.getKeys().assign( begin, end );
+
+        taskFiles.push_back( Stringify() << taskDir << "/" << t << ".tiles" );
+        progressFiles.push_back( Stringify() << taskDir << "/" << t << ".progress" );
+        tasks.save( taskFiles.back() );
+    }
+
+    _collected.clear();
+
+    OE_INFO << "[MultiprocessTileVisitor] Running " << numTasks << " task lists of " << batchSize
+        << " tiles on " << numProcesses << " processes" << std::endl;
+
+    // Each job runs one worker process and blocks until it exits.
+    std::shared_ptr<JobArena> arena = std::make_shared<JobArena>("oe.mptilevisitor", numProcesses);
+    JobGroup group;
+    std::atomic<unsigned> finished(0u);
+    std::atomic_bool canceled(false);
+    std::vector<int> results( numTasks, -1 );
+    std::string processString = _tileHandler->getProcessString();
+
+    for (unsigned t = 0; t < numTasks; ++t)
+    {
+        std::string command = Stringify()
+            << processString
+            << " --tiles " << quoteArgument(taskFiles[t])
+            << " --progress " << quoteArgument(progressFiles[t])
+            << " --worker " << t
+            << (_earthFile.empty() ? std::string() : " " + quoteArgument(_earthFile));
+
+#ifdef _WIN32
+        // cmd.exe strips the first and last quote from the command line,
+        // so wrap it in one more pair to keep the quoted arguments intact.
+        command = "\"" + command + "\"";
+#endif
+
+        int* result = &results[t];
+
+        auto delegate = [command, result, &finished, &canceled](Cancelable*)
+        {
+            // A running worker cannot be stopped, but after a cancel
+            // the ones still waiting never start.
+            if (!canceled)
+            {
+                OE_DEBUG << "[MultiprocessTileVisitor] " << command << std::endl;
+                *result = OS_SYSTEM( command.c_str() );
+                if (*result != 0)
+                {
+                    OE_WARN << "[MultiprocessTileVisitor] Worker returned " << *result << ": " << command << std::endl;
+                }
+            }
+            ++finished;
+        };
+
+        Job job(arena.get(), &group);
+        job.setName("worker");
+        job.dispatch(delegate);
+    }
+
+    // Combine the progress reported by the workers
+    std::vector<unsigned> processed( numTasks, 0u );
+    bool done = false;
+    while (!done)
+    {
+        done = (finished == numTasks);
+        if (!done)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
+
+        if (!canceled && _progress.valid() && _progress->isCanceled())
+        {
+            OE_WARN << "[MultiprocessTileVisitor] Canceled; waiting for the running workers to finish" << std::endl;
+            canceled = true;
+        }
+
+        for (unsigned t = 0; t < numTasks; ++t)
+        {
+            std::ifstream in( progressFiles[t].c_str() );
+            unsigned count = 0u;
+            if (in >> count && count > processed[t])
+                processed[t] = count;
+        }
+
+        unsigned total = 0u;
+        for (unsigned t = 0; t < numTasks; ++t)
+            total += processed[t];
+
+        if (total > _processed)
+        {
+            incrementProgress( total - _processed );
+        }
+    }
+
+    group.join();
+
+    // Keep the task list of every worker that failed (or never ran) so
+    // its tiles can be run again; clean up the rest.
+    for (unsigned t = 0; t < numTasks; ++t)
+    {
+        if (results[t] == 0)
+        {
+            ::remove( taskFiles[t].c_str() );
+            ::remove( progressFiles[t].c_str() );
+        }
+        else
+        {
+            _failedTaskFiles.push_back( taskFiles[t] );
+        }
+    }
+
+    _succeeded = _failedTaskFiles.empty();
+
+    if (_succeeded)
+    {
+        removeEmptyDirectory( taskDir );
+    }
+    else
+    {
+        OE_WARN << "[MultiprocessTileVisitor] " << _failedTaskFiles.size() << " of " << numTasks
+            << " task lists did not complete; keeping them in " << taskDir << std::endl;
+    }
+}
+
+/*****************************************************************************************/
+
+TileJournal::TileJournal() :
+_mutex("TileJournal")
+{
+}
+
+TileJournal::~TileJournal()
+{
+    close();
+}
+
+std::uint64_t TileJournal::pack( unsigned lod, unsigned x, unsigned y )
+{
+    return ((std::uint64_t)lod << 58) | ((std::uint64_t)x << 29) | (std::uint64_t)y;
+}
+
+bool TileJournal::open( const std::string& filename, const std::string& header )
+{
+    Threading::ScopedMutexLock lock( _mutex );
+
+    _entries.clear();
+
+    // header lines start with '@' so they cannot be mistaken for entries
+    std::string headerLines;
+    {
+        std::istringstream in( header );
+        std::string line;
+        while (getline(in, line))
+        {
+            headerLines += "@ " + line + "\n";
+        }
+    }
+
+    bool exists = osgDB::fileExists( filename );
+    bool writeHeader = !exists;
+    if (exists)
+    {
+        // Same format as the TaskList. A line that was only partially
+        // written when the process died fails to parse and is ignored.
+        std::ifstream in( filename.c_str(), std::ios::in );
+        std::string line;
+        std::string existingHeader;
+        while (getline(in, line))
+        {
+            if (!line.empty() && line[0] == '@')
+            {
+                existingHeader += line + "\n";
+                continue;
+            }
+
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::vector< std::string > parts;
+            StringTokenizer(line, parts, "," );
+            if (parts.size() == 3)
+            {
+                unsigned lod = as<unsigned>(parts[0], ~0u);
+                unsigned x = as<unsigned>(parts[1], ~0u);
+                unsigned y = as<unsigned>(parts[2], ~0u);
+                if (lod < 32u && x != ~0u && y != ~0u)
+                {
+                    _entries.insert( pack(lod, x, y) );
+                }
+            }
+        }
+
+        if (!header.empty() && existingHeader != headerLines)
+        {
+            if (existingHeader.empty() && _entries.empty())
+            {
+                // nothing recorded yet; adopt this run
+                writeHeader = true;
+            }
+            else
+            {
+                OE_WARN << "[TileJournal] " << filename << " was written by a different run "
+                    << "(data, profile, levels or extents changed); refusing to resume from it" << std::endl;
+                _entries.clear();
+                return false;
+            }
+        }
+    }
+    else
+    {
+        osgEarth::makeDirectoryForFile( filename );
+    }
+
+    _out.open( filename.c_str(), std::ios::out | std::ios::app );
+    if (!_out.is_open())
+    {
+        OE_WARN << "[TileJournal] Failed to open " << filename << " for writing" << std::endl;
+        return false;
+    }
+
+    if (!exists)
+    {
+        _out << "# osgEarth tile journal: completed work units (lod, x, y)" << std::endl;
+    }
+
+    if (writeHeader)
+    {
+        _out << headerLines << std::flush;
+    }
+
+    return true;
+}
+
+bool TileJournal::contains( const TileKey& key ) const
+{
+    Threading::ScopedMutexLock lock( _mutex );
+    return _entries.find( pack(key.getLevelOfDetail(), key.getTileX(), key.getTileY()) ) != _entries.end();
+}
+
+void TileJournal::append( const TileKey& key )
+{
+    Threading::ScopedMutexLock lock( _mutex );
+    _entries.insert( pack(key.getLevelOfDetail(), key.getTileX(), key.getTileY()) );
+    if (_out.is_open())
+    {
+        // flush every entry so that a crash loses at most the units in flight
+        _out << key.getLevelOfDetail() << ", " << key.getTileX() << ", " << key.getTileY() << std::endl;
+    }
+}
+
+unsigned TileJournal::size() const
+{
+    Threading::ScopedMutexLock lock( _mutex );
+    return _entries.size();
+}
+
+void TileJournal::close()
+{
+    Threading::ScopedMutexLock lock( _mutex );
+    if (_out.is_open())
+    {
+        _out.close();
+    }
+}
+
+/*****************************************************************************************/
+
+namespace
+{
+    // Maximum number of keys to query/handle in one batch before the
+    // traversal splits into per-parent batches to bound memory
+    const unsigned MAX_BATCH_SIZE = 1024u;
+}
+
+ParallelTileVisitor::Stats::Stats() :
+unitsTotal(0), unitsResumed(0), unitsDone(0), tilesHandled(0), tilesSkipped(0), elapsedSeconds(0.0)
+{
+}
+
+double ParallelTileVisitor::Stats::tilesPerSecond() const
+{
+    return elapsedSeconds > 0.0 ? (double)(tilesHandled + tilesSkipped) / elapsedSeconds : 0.0;
+}
+
+double ParallelTileVisitor::Stats::etaSeconds() const
+{
+    unsigned remaining = unitsTotal - unitsResumed - unitsDone;
+    return unitsDone > 0 ? elapsedSeconds * (double)remaining / (double)unitsDone : 0.0;
+}
+
+ParallelTileVisitor::ParallelTileVisitor() :
+_numThreads(Threading::getConcurrency()),
+_reportInterval(10.0),
+_unitsTotal(0), _unitsResumed(0), _unitsDone(0), _tilesHandled(0), _tilesSkipped(0),
+_startTime(0)
+{
+}
+
+ParallelTileVisitor::ParallelTileVisitor(TileHandler* handler) :
+TileVisitor(handler),
+_numThreads(Threading::getConcurrency()),
+_reportInterval(10.0),
+_unitsTotal(0), _unitsResumed(0), _unitsDone(0), _tilesHandled(0), _tilesSkipped(0),
+_startTime(0)
+{
+}
+
+ParallelTileVisitor::Stats ParallelTileVisitor::getStats() const
+{
+    Stats stats;
+    stats.unitsTotal = _unitsTotal;
+    stats.unitsResumed = _unitsResumed;
+    stats.unitsDone = _unitsDone;
+    stats.tilesHandled = _tilesHandled;
+    stats.tilesSkipped = _tilesSkipped;
+    stats.elapsedSeconds = _startTime != 0 ? osg::Timer::instance()->delta_s(_startTime, osg::Timer::instance()->tick()) : 0.0;
+    return stats;
+}
+
+void ParallelTileVisitor::report() const
+{
+    Stats stats = getStats();
+    OE_NOTICE << "[ParallelTileVisitor] "
+        << "units " << (stats.unitsResumed + stats.unitsDone) << "/" << stats.unitsTotal
+        << " (" << stats.unitsResumed << " resumed), "
+        << "tiles " << stats.tilesHandled << " (" << stats.tilesSkipped << " already done), "
+        << std::fixed << std::setprecision(1) << stats.tilesPerSecond() << " tiles/s, "
+        << "ETA " << (stats.unitsDone > 0 ? prettyPrintTime(stats.etaSeconds()) : std::string("unknown"))
+        << std::endl;
+}
+
+std::string ParallelTileVisitor::getJournalHeader() const
+{
+    // one "name: value" per line; values must not contain line breaks
+    std::string data = _tileHandler.valid() ? _tileHandler->getSignature() : std::string();
+    std::replace( data.begin(), data.end(), '\n', ' ' );
+    std::replace( data.begin(), data.end(), '\r', ' ' );
+
+    std::stringstream buf;
+    buf << "data: " << data << "\n"
+        << "profile: " << (_profile.valid() ? _profile->getFullSignature() : std::string()) << "\n"
+        << "levels: " << _minLevel << "-" << _maxLevel << "\n";
+
+    buf << std::setprecision(12);
+    for (std::vector<GeoExtent>::const_iterator i = _extents.begin(); i != _extents.end(); ++i)
+    {
+        buf << "extent: "
+            << (i->getSRS() ? i->getSRS()->getHorizInitString() : std::string()) << " "
+            << i->xMin() << " " << i->yMin() << " " << i->xMax() << " " << i->yMax() << "\n";
+    }
+    return buf.str();
+}
+
+void ParallelTileVisitor::run(const Profile* mapProfile)
+{
+    _profile = mapProfile;
+
+    resetProgress();
+    _unitsTotal = 0;
+    _unitsResumed = 0;
+    _unitsDone = 0;
+    _tilesHandled = 0;
+    _tilesSkipped = 0;
+    _startTime = osg::Timer::instance()->tick();
+
+    estimate();
+
+    if (!_journalFile.empty())
+    {
+        if (!_journal.open(_journalFile, getJournalHeader()))
+            return;
+
+        OE_INFO << "[ParallelTileVisitor] Journal " << _journalFile << " has "
+            << _journal.size() << " completed units" << std::endl;
+    }
+
+    // Partition: walk the top of the pyramid, one level at a time, until there
+    // are enough independent subtrees to keep all the threads busy. Tiles above
+    // the partition level are handled here (they are few, and cheap to skip on
+    // a resumed run since the handler reports them as complete).
+    unsigned targetUnits = 16u * osg::maximum(_numThreads, 1u);
+
+    std::vector<TileKey> units;
+    mapProfile->getRootKeys(units);
+    unsigned level = 0;
+
+    while (units.size() < targetUnits && level < _maxLevel)
+    {
+        if (_progress.valid() && _progress->isCanceled())
+            return;
+
+        std::vector<TileKey> next;
+        processBatch(units, level + 1, &next);
+        units.swap(next);
+        ++level;
+
+        if (units.empty())
+            break;
+    }
+
+    _unitsTotal = units.size();
+
+    OE_INFO << "[ParallelTileVisitor] " << units.size() << " work units at level " << level
+        << " on " << _numThreads << " threads" << std::endl;
+
+    // Process the work units in parallel.
+    std::shared_ptr<JobArena> arena = std::make_shared<JobArena>("oe.paralleltilevisitor", _numThreads);
+    JobGroup group;
+    std::atomic<unsigned> finished(0u);
+    unsigned dispatched = 0u;
+
+    for (unsigned i = 0; i < units.size(); ++i)
+    {
+        if (!_journalFile.empty() && _journal.contains(units[i]))
+        {
+            ++_unitsResumed;
+            continue;
+        }
+
+        TileKey unit = units[i];
+        auto delegate = [this, unit, &finished](Cancelable*)
+        {
+            processUnit(unit);
+            ++finished;
+        };
+
+        Job job(arena.get(), &group);
+        job.setName("processUnit");
+        job.dispatch(delegate);
+        ++dispatched;
+    }
+
+    // Wait for the units to finish, reporting throughput as we go.
+    osg::Timer_t lastReport = osg::Timer::instance()->tick();
+    while (finished < dispatched)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        osg::Timer_t now = osg::Timer::instance()->tick();
+        if (_reportInterval > 0.0 && osg::Timer::instance()->delta_s(lastReport, now) >= _reportInterval)
+        {
+            report();
+            lastReport = now;
+        }
+    }
+
+    group.join();
+
+    if (_reportInterval > 0.0)
+    {
+        report();
+    }
+
+    _journal.close();
+}
+
+void ParallelTileVisitor::processUnit(const TileKey& root)
+{
+    if (_progress.valid() && _progress->isCanceled())
+        return;
+
+    std::vector<TileKey> batch(1, root);
+    processBatch(batch, ~0u, nullptr);
+
+    // Only journal the unit if the whole subtree was processed
+    if (!_progress.valid() || !_progress->isCanceled())
+    {
+        if (!_journalFile.empty())
+        {
+            _journal.append(root);
+        }
+        ++_unitsDone;
+    }
+}
+
+void ParallelTileVisitor::processBatch(const std::vector<TileKey>& keys, unsigned stopLevel, std::vector<TileKey>* stopped)
+{
+    if (keys.empty() || (_progress.valid() && _progress->isCanceled()))
+        return;
+
+    // Keys that have a chance of succeeding:
+    std::vector<TileKey> candidates;
+    candidates.reserve(keys.size());
+
+    for (unsigned i = 0; i < keys.size(); ++i)
+    {
+        const TileKey& key = keys[i];
+        if (!hasData(key) || !intersects(key.getExtent()))
+            continue;
+
+        if (stopped && key.getLevelOfDetail() >= stopLevel)
+            stopped->push_back(key);
+        else
+            candidates.push_back(key);
+    }
+
+    // Ask the handler in one call which of the tiles are already done
+    std::vector<TileKey> toQuery;
+    for (unsigned i = 0; i < candidates.size(); ++i)
+    {
+        if (candidates[i].getLevelOfDetail() >= _minLevel)
+            toQuery.push_back(candidates[i]);
+    }
+
+    std::vector<bool> completed;
+    if (_tileHandler.valid() && !toQuery.empty())
+        _tileHandler->getCompleted(toQuery, completed);
+    completed.resize(toQuery.size(), false);
+
+    std::vector<TileKey> children;
+    unsigned q = 0;
+
+    for (unsigned i = 0; i < candidates.size(); ++i)
+    {
+        const TileKey& key = candidates[i];
+        unsigned lod = key.getLevelOfDetail();
+
+        bool traverseChildren = false;
+
+        if (lod < _minLevel)
+        {
+            traverseChildren = true;
+        }
+        else if (completed[q++])
+        {
+            ++_tilesSkipped;
+            incrementProgress(1);
+            traverseChildren = true;
+        }
+        else
+        {
+            ++_tilesHandled;
+            traverseChildren = handleTile(key);
+        }
+
+        if (traverseChildren && lod < _maxLevel)
+        {
+            for (unsigned c = 0; c < 4; ++c)
+            {
+                children.push_back(key.createChildKey(c));
+            }
+        }
+    }
+
+    if (children.size() <= MAX_BATCH_SIZE)
+    {
+        processBatch(children, stopLevel, stopped);
+    }
+    else
+    {
+        // Continue depth-first, one group of siblings at a time
+        for (unsigned i = 0; i < children.size(); i += 4)
+        {
+            std::vector<TileKey> siblings(children.begin() + i, children.begin() + i + 4);
+            processBatch(siblings, stopLevel, stopped);
+        }
+    }
+}
+
+/*****************************************************************************************/
+
 TaskList::TaskList(const Profile* profile):
 _profile( profile )
 {
@@ -332,6 +332,11 @@ WFSFeatureSource::getFeatures(const std::string& buffer, const std::string& mime
     bool json = isJSON(mimeType);
     bool gml = isGML(mimeType);
 
+    if (json && readGeoJSON(buffer, features))
+    {
+        return true;
+    }
+
     // find the right driver for the given mime type
     OGRSFDriverH ogrDriver =
         json ? OGRGetDriverByName("GeoJSON") :
@@ -126,6 +126,8 @@ XYZImageLayerOptions::getConfig() const
     conf.set("url", _url);
     conf.set("format", _format);
     conf.set("invert_y", _invertY);
+    conf.set("availability", _availability);
+    conf.set("learn_availability", _learnAvailability);
     return conf;
 }
 
@@ -133,10 +135,13 @@ void
 XYZImageLayerOptions::fromConfig(const Config& conf)
 {
     invertY().setDefault(false);
+    learnAvailability().setDefault(false);
 
     conf.get("url", _url);
     conf.get("format", _format);
     conf.get("invert_y", _invertY);
+    conf.get("availability", _availability);
+    conf.get("learn_availability", _learnAvailability);
 }
 
 Config
@@ -147,7 +152,9 @@ XYZImageLayerOptions::getMetadata()
             "properties": [
             { "name": "url",      "description": "Location of the TMS repository", "type": "string", "default": "" },
             { "name": "invert_y", "description": "Set to true invert the Y index", "type": "bool", "default": "false" },
-            { "name": "format",   "description": "Image format to assume (e.g. jpeg, png)", "type": "string", "default": "" }
+            { "name": "format",   "description": "Image format to assume (e.g. jpeg, png)", "type": "string", "default": "" },
+            { "name": "availability", "description": "Location of a layer.json file listing the available tile ranges", "type": "string", "default": "" },
+            { "name": "learn_availability", "description": "Remember tiles the server reports as missing", "type": "bool", "default": "false" }
             ]
         }
     ) );
@@ -163,16 +170,22 @@ XYZElevationLayerOptions::getConfig() const
     conf.set("format", _format);
     conf.set("invert_y", _invertY);
     conf.set("elevation_encoding", _elevationEncoding);
+    conf.set("availability", _availability);
+    conf.set("learn_availability", _learnAvailability);
     return conf;
 }
 
 void
 XYZElevationLayerOptions::fromConfig(const Config& conf)
 {
+    learnAvailability().setDefault(false);
+
     conf.get("url", _url);
     conf.get("format", _format);
     conf.get("invert_y", _invertY);
     conf.get("elevation_encoding", _elevationEncoding);
+    conf.get("availability", _availability);
+    conf.get("learn_availability", _learnAvailability);
 }
 
 Config
@@ -184,7 +197,9 @@ XYZElevationLayerOptions::getMetadata()
             { "name": "url",      "description": "Location of the TMS repository", "type": "string", "default": "" },
             { "name": "invert_y", "description": "Set to true invert the Y index", "type": "bool", "default": "false" },
             { "name": "format",   "description": "Image format to assume (e.g. jpeg, png)", "type": "string", "default": "" },
-            { "name": "elevation_encoding", "description": "How elevation is encoded (mapbox, e.g.)", "type": "string", "default": "" }
+            { "name": "elevation_encoding", "description": "How elevation is encoded (mapbox, e.g.)", "type": "string", "default": "" },
+            { "name": "availability", "description": "Location of a layer.json file listing the available tile ranges", "type": "string", "default": "" },
+            { "name": "learn_availability", "description": "Remember tiles the server reports as missing", "type": "bool", "default": "false" }
             ]
         }
     ) );
@@ -197,6 +212,8 @@ REGISTER_OSGEARTH_LAYER(xyzimage, XYZImageLayer);
 OE_LAYER_PROPERTY_IMPL(XYZImageLayer, URI, URL, url);
 OE_LAYER_PROPERTY_IMPL(XYZImageLayer, bool, InvertY, invertY);
 OE_LAYER_PROPERTY_IMPL(XYZImageLayer, std::string, Format, format);
+OE_LAYER_PROPERTY_IMPL(XYZImageLayer, URI, AvailabilityURL, availability);
+OE_LAYER_PROPERTY_IMPL(XYZImageLayer, bool, LearnAvailability, learnAvailability);
 
 void
 XYZImageLayer::init()
@@ -228,6 +245,25 @@ XYZImageLayer::openImplementation()
         setProfile(profile.get());
     }
 
+    // Index of the tiles that exist, for sparse repositories
+    if (options().availability().isSet() || options().learnAvailability() == true)
+    {
+        osg::ref_ptr<TileAvailability> availability = new TileAvailability(getProfile());
+
+        if (options().availability().isSet())
+        {
+            // layer.json ranges always count rows from the south, whatever invert_y says
+            ReadResult rr = options().availability()->readString(getReadOptions());
+            if (rr.failed() || !availability->readLayerJSON(rr.getString(), true))
+            {
+                OE_WARN << LC << "Failed to read tile availability from "
+                    << options().availability()->full() << std::endl;
+            }
+        }
+
+        setAvailability(availability.get());
+    }
+
     return Status::NoError;
 }
 
@@ -243,8 +279,19 @@ XYZImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* p
 
     if (r.succeeded())
         return GeoImage(r.releaseImage(), key.getExtent());
-    else
-        return GeoImage(Status(r.errorDetail()));
+
+    if (r.code() == ReadResult::RESULT_NOT_FOUND)
+    {
+        if (options().learnAvailability() == true &&
+            (!progress || !progress->isCanceled()))
+        {
+            reportMissingTile(key);
+        }
+
+        return GeoImage(Status(Status::ResourceUnavailable, r.errorDetail()));
+    }
+
+    return GeoImage(Status(r.errorDetail()));
 }
 
 //........................................................................
@@ -254,6 +301,8 @@ REGISTER_OSGEARTH_LAYER(xyzelevation, XYZElevationLayer);
 OE_LAYER_PROPERTY_IMPL(XYZElevationLayer, URI, URL, url);
 OE_LAYER_PROPERTY_IMPL(XYZElevationLayer, bool, InvertY, invertY);
 OE_LAYER_PROPERTY_IMPL(XYZElevationLayer, std::string, Format, format);
+OE_LAYER_PROPERTY_IMPL(XYZElevationLayer, URI, AvailabilityURL, availability);
+OE_LAYER_PROPERTY_IMPL(XYZElevationLayer, bool, LearnAvailability, learnAvailability);
 OE_LAYER_PROPERTY_IMPL(XYZElevationLayer, std::string, ElevationEncoding, elevationEncoding);
 
 void
@@ -273,6 +322,9 @@ XYZElevationLayer::openImplementation()
     // elevation; we just convert the resulting image to a heightfield
     _imageLayer = new XYZImageLayer(options());
 
+    // Missing tiles are learned by this layer, not the image layer
+    _imageLayer->setLearnAvailability(false);
+
     // Initialize and open the image layer
     _imageLayer->setReadOptions(getReadOptions());
     Status status = _imageLayer->open();
@@ -282,6 +334,13 @@ XYZElevationLayer::openImplementation()
 
     setProfile(_imageLayer->getProfile());            
 
+    // Share the image layer's tile ranges, but do the learning here so the
+    // missing tiles are saved in (and loaded from) this layer's cache bin.
+    osg::ref_ptr<TileAvailability> availability = _imageLayer->getAvailability();
+    if (!availability.valid() && options().learnAvailability() == true)
+        availability = new TileAvailability(getProfile());
+    setAvailability(availability.get());
+
     return Status::NoError;
 }
 
@@ -325,7 +384,13 @@ XYZElevationLayer::createHeightFieldImplementation(const TileKey& key, ProgressC
             return GeoHeightField(hf, key.getExtent());
         }
     }
-    
+    else if (
+        geoImage.getStatus().code() == Status::ResourceUnavailable &&
+        options().learnAvailability() == true &&
+        (!progress || !progress->isCanceled()))
+    {
+        reportMissingTile(key);
+    }
 
     return GeoHeightField::INVALID;
 }
@@ -212,6 +212,11 @@ XYZFeatureSource::getFeatures(const std::string& buffer, const TileKey& key, con
     }
     else
     {
+        if (isJSON(mimeType) && readGeoJSON(buffer, features))
+        {
+            return true;
+        }
+
         // find the right driver for the given mime type
         OGR_SCOPED_LOCK;
 
@@ -96,6 +96,13 @@ public:
   /// \return Returns the number of entries found
   int Search(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], std::vector<DATATYPE>* hits, int maxHits) const;
 
+  /// Visit everything within search rectangle
+  /// \param a_min Min of search bounding rect
+  /// \param a_max Max of search bounding rect
+  /// \param a_callback Called for each hit. Return 'true' to continue searching, 'false' to stop.
+  /// \return Returns the number of entries visited
+  int Search(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], const std::function<bool(const DATATYPE&)>& a_callback) const;
+
   /// Find nearest neighbors (GW/Pelican 20201001
   /// \param point Point from which to search
   /// \param hits Output containing results (near to far)
@@ -388,6 +395,7 @@ protected:
   ELEMTYPEREAL RectDistSquared(const ELEMTYPE* point, const Rect& rect) const;
   void ReInsert(Node* a_node, ListNode** a_listNode);
   bool Search(Node* a_node, Rect* a_rect, int& a_foundCount, std::vector<DATATYPE>* hits, int maxHits) const;
+  bool Search(Node* a_node, Rect* a_rect, int& a_foundCount, const std::function<bool(const DATATYPE&)>& a_callback) const;
   void RemoveAllRec(Node* a_node);
   void Reset();
   void CountRec(Node* a_node, int& a_count);
@@ -606,6 +614,30 @@ int RTREE_QUAL::Search(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDI
   return foundCount;
 }
 
+RTREE_TEMPLATE
+int RTREE_QUAL::Search(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], const std::function<bool(const DATATYPE&)>& a_callback) const
+{
+#ifdef _DEBUG
+  for(int index=0; index<NUMDIMS; ++index)
+  {
+    assert(a_min[index] <= a_max[index]);
+  }
+#endif //_DEBUG
+
+  Rect rect;
+
+  for(int axis=0; axis<NUMDIMS; ++axis)
+  {
+    rect.m_min[axis] = a_min[axis];
+    rect.m_max[axis] = a_max[axis];
+  }
+
+  int foundCount = 0;
+  Search(m_root, &rect, foundCount, a_callback);
+
+  return foundCount;
+}
+
 RTREE_TEMPLATE
 ELEMTYPEREAL RTREE_QUAL::RectDistSquared(const ELEMTYPE* p, const Rect& rect) const
 {    
@@ -1808,6 +1840,51 @@ bool RTREE_QUAL::Search(Node* a_node, Rect* a_rect, int& a_foundCount, std::vect
   return true; // Continue searching
 }
 
+
+// Search in an index tree or subtree for all data retangles that overlap the argument rectangle,
+// passing each one to a callback that can stop the search.
+RTREE_TEMPLATE
+bool RTREE_QUAL::Search(Node* a_node, Rect* a_rect, int& a_foundCount, const std::function<bool(const DATATYPE&)>& a_callback) const
+{
+  assert(a_node);
+  assert(a_node->m_level >= 0);
+  assert(a_rect);
+
+  if(a_node->IsInternalNode())
+  {
+    // This is an internal node in the tree
+    for(int index=0; index < a_node->m_count; ++index)
+    {
+      if(Overlap(a_rect, &a_node->m_branch[index].m_rect))
+      {
+        if(!Search(a_node->m_branch[index].m_child, a_rect, a_foundCount, a_callback))
+        {
+          // The callback indicated to stop searching
+          return false;
+        }
+      }
+    }
+  }
+  else
+  {
+    // This is a leaf node
+    for(int index=0; index < a_node->m_count; ++index)
+    {
+      if(Overlap(a_rect, &a_node->m_branch[index].m_rect))
+      {
+        ++a_foundCount;
+
+        if(a_callback && !a_callback(a_node->m_branch[index].m_data))
+        {
+          return false; // Don't continue searching
+        }
+      }
+    }
+  }
+
+  return true; // Continue searching
+}
+
 } // namespace
 
 #undef RTREE_TEMPLATE
@@ -647,6 +647,8 @@ namespace weemesh
     {
         std::unordered_set<edge_t, edge_t> _edges;
 
+        edgeset_t() { }
+
         edgeset_t(const mesh_t& mesh, int marker_mask)
         {
             for (auto& tri_iter : mesh._triangles)
@@ -658,16 +660,25 @@ namespace weemesh
 
         void add_triangle(const triangle_t& tri, const mesh_t& mesh, int marker_mask)
         {
-            bool m0 = (mesh._markers[tri.i0] & marker_mask) != 0;
-            bool m1 = (mesh._markers[tri.i1] & marker_mask) != 0;
-            bool m2 = (mesh._markers[tri.i2] & marker_mask) != 0;
+            add_triangle(tri.i0, tri.i1, tri.i2, mesh._markers, marker_mask);
+        }
+
+        // adds the edges of triangle (i0,i1,i2) whose endpoints both
+        // have a marker matching the mask; MARKERS is any indexable
+        // container of marker values
+        template<typename MARKERS>
+        void add_triangle(int i0, int i1, int i2, const MARKERS& markers, int marker_mask)
+        {
+            bool m0 = (markers[i0] & marker_mask) != 0;
+            bool m1 = (markers[i1] & marker_mask) != 0;
+            bool m2 = (markers[i2] & marker_mask) != 0;
 
             if (m0 && m1)
-                _edges.emplace(edge_t(tri.i0, tri.i1));
+                _edges.emplace(edge_t(i0, i1));
             if (m1 && m2)
-                _edges.emplace(edge_t(tri.i1, tri.i2));
+                _edges.emplace(edge_t(i1, i2));
             if (m2 && m0)
-                _edges.emplace(edge_t(tri.i2, tri.i0));
+                _edges.emplace(edge_t(i2, i0));
         }
     };
 
@@ -27,6 +27,7 @@
 #include <osgEarth/Registry>
 #include <osgEarth/NetworkMonitor>
 #include <osgEarth/Metrics>
+#include <osgEarth/MetricsRegistry>
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
 #include <fstream>
@@ -110,6 +111,8 @@ namespace
 
         RecordStatus getRecordStatus(const std::string& key) override;
 
+        void getRecordStatuses(const std::vector<std::string>& keys, std::vector<RecordStatus>& output) override;
+
         bool clear() override;
 
     protected:
@@ -184,6 +187,23 @@ bool FileSystemCacheBin::_s_debug = false;
 
 namespace
 {
+    struct FileSystemCacheMetrics
+    {
+        MetricsRegistry::Counter& reads;
+        MetricsRegistry::Counter& hits;
+        MetricsRegistry::Counter& writes;
+
+        FileSystemCacheMetrics() :
+            reads(MetricsRegistry::instance().counter("osgearth_cache_reads_total", "Cache bin read requests", "driver=\"filesystem\"")),
+            hits(MetricsRegistry::instance().counter("osgearth_cache_hits_total", "Cache bin reads that found a record", "driver=\"filesystem\"")),
+            writes(MetricsRegistry::instance().counter("osgearth_cache_writes_total", "Cache bin writes", "driver=\"filesystem\"")) { }
+
+        static FileSystemCacheMetrics& get() {
+            static FileSystemCacheMetrics s_metrics;
+            return s_metrics;
+        }
+    };
+
     FileSystemCache::FileSystemCache(const CacheOptions& options) :
         Cache(options)
     {
@@ -374,6 +394,8 @@ namespace
     ReadResult
     FileSystemCacheBin::readImage(const std::string& key, const osgDB::Options* readOptions)
     {
+        FileSystemCacheMetrics::get().reads.increment();
+
         if ( !binValidForReading() )
             return ReadResult(ReadResult::RESULT_NOT_FOUND);
 
@@ -412,6 +434,8 @@ namespace
 
                 NetworkMonitor::end(handle, "OK");
 
+                FileSystemCacheMetrics::get().hits.increment();
+
                 return rr;
             }
         }
@@ -439,6 +463,8 @@ namespace
         if (_s_debug)
             OE_NOTICE << LC << "Read image \"" << key << "\" from cache bin [" << getID() << "] path=" << fileURI.full() << "." << OSG_EXT << std::endl;
 
+        FileSystemCacheMetrics::get().hits.increment();
+
         return rr;
     }
 
@@ -447,6 +473,8 @@ namespace
     {
         OE_PROFILING_ZONE;
 
+        FileSystemCacheMetrics::get().reads.increment();
+
         if ( !binValidForReading() )
             return ReadResult(ReadResult::RESULT_NOT_FOUND);
 
@@ -485,6 +513,8 @@ namespace
 
                 NetworkMonitor::end(handle, "OK");
 
+                FileSystemCacheMetrics::get().hits.increment();
+
                 return rr;
             }
         }
@@ -512,6 +542,8 @@ namespace
         if (_s_debug)
             OE_NOTICE << LC << "Read object \"" << key << "\" from cache bin [" << getID() << "] path=" << fileURI.full() << "." << OSG_EXT << std::endl;
 
+        FileSystemCacheMetrics::get().hits.increment();
+
         return rr;
     }
 
@@ -551,6 +583,8 @@ namespace
         if ( !binValidForWriting() || !raw_object)
             return false;
 
+        FileSystemCacheMetrics::get().writes.increment();
+
         // convert the key into a legal filename:
         URI fileURI( key, _metaPath );
 
@@ -669,6 +703,22 @@ namespace
         return STATUS_OK;
     }
 
+    void
+    FileSystemCacheBin::getRecordStatuses(const std::vector<std::string>& keys, std::vector<RecordStatus>& output)
+    {
+        output.assign(keys.size(), STATUS_NOT_FOUND);
+
+        if ( !binValidForReading() )
+            return;
+
+        for (unsigned i = 0; i < keys.size(); ++i)
+        {
+            URI fileURI( keys[i], _metaPath );
+            if ( osgDB::fileExists(fileURI.full() + OSG_EXT) )
+                output[i] = STATUS_OK;
+        }
+    }
+
     bool
     FileSystemCacheBin::remove(const std::string& key)
     {
@@ -26,7 +26,10 @@
 #include <osgDB/Registry>
 #include <string>
 #include <sstream>
+#include <iterator>
 #include <osgEarth/Common>
+#include <osgEarth/FileUtils>
+#include <fstream>
 
 using namespace osgEarth_osgearth;
 using namespace osgEarth;
@@ -103,7 +106,9 @@ class ReaderWriterEarth : public osgDB::ReaderWriter
         
         virtual bool acceptsExtension(const std::string& extension) const
         {
-            return osgDB::equalCaseInsensitive( extension, "earth" );
+            return
+                osgDB::equalCaseInsensitive( extension, "earth" ) ||
+                osgDB::equalCaseInsensitive( extension, "earthb" );
         }
 
         virtual ReadResult readObject(const std::string& file_name, const osgDB::Options* options) const
@@ -121,12 +126,29 @@ class ReaderWriterEarth : public osgDB::ReaderWriter
             if ( !acceptsExtension( osgDB::getFileExtension(fileName) ) )
                 return WriteResult::FILE_NOT_HANDLED;
 
-            std::ofstream out( fileName.c_str());
+            bool binary = osgDB::equalCaseInsensitive( osgDB::getFileExtension(fileName), "earthb" );
+
+            std::ofstream out( fileName.c_str(), binary ? std::ios::out | std::ios::binary : std::ios::out );
             if ( out.is_open() )
             {
                 osg::ref_ptr<osgDB::Options> myOptions = Registry::instance()->cloneOrCreateOptions(options);
                 URIContext( fileName ).store( myOptions.get() );
 
+                if ( binary )
+                {
+                    Config conf;
+                    if ( !serialize( node, myOptions.get(), conf ) )
+                        return WriteResult::ERROR_IN_WRITING_FILE;
+
+                    // wrap it like XmlDocument does, so it reads back the same way
+                    Config doc;
+                    doc.setReferrer( conf.referrer() );
+                    doc.add( conf );
+                    std::string data = doc.toBinary();
+                    out.write( data.data(), data.size() );
+                    return out.good() ? WriteResult::FILE_SAVED : WriteResult::ERROR_IN_WRITING_FILE;
+                }
+
                 return writeNode( node, out, myOptions.get() );
             }
 
@@ -134,11 +156,25 @@ class ReaderWriterEarth : public osgDB::ReaderWriter
         }
 
         virtual WriteResult writeNode(const osg::Node& node, std::ostream& out, const osgDB::Options* options ) const
+        {
+            Config conf;
+            if ( !serialize( node, options, conf ) )
+                return WriteResult::ERROR_IN_WRITING_FILE; // i.e., no MapNode found in the graph.
+
+            // dump that Config out as XML.
+            osg::ref_ptr<XmlDocument> xml = new XmlDocument( conf );
+            xml->store( out );
+
+            return WriteResult::FILE_SAVED;
+        }
+
+        //! Serializes the MapNode in a graph to a Config
+        bool serialize(const osg::Node& node, const osgDB::Options* options, Config& conf) const
         {
             osg::Node* searchNode = const_cast<osg::Node*>( &node );
             MapNode* mapNode = MapNode::findMapNode( searchNode );
             if ( !mapNode )
-                return WriteResult::ERROR_IN_WRITING_FILE; // i.e., no MapNode found in the graph.
+                return false;
             
             // decode the context from the options (might be there, might not)
             URIContext uriContext( options );
@@ -164,13 +200,8 @@ class ReaderWriterEarth : public osgDB::ReaderWriter
                 }
             }
 
-            Config conf = ser.serialize( mapNode, uriContext.referrer() );
-
-            // dump that Config out as XML.
-            osg::ref_ptr<XmlDocument> xml = new XmlDocument( conf );
-            xml->store( out );
-
-            return WriteResult::FILE_SAVED;
+            conf = ser.serialize( mapNode, uriContext.referrer() );
+            return true;
         }
 
         virtual ReadResult readNode(const std::string& fileName, const osgDB::Options* readOptions) const
@@ -199,6 +230,27 @@ class ReaderWriterEarth : public osgDB::ReaderWriter
                 {
                     fullFileName = osgDB::findDataFile( fileName, readOptions );
                     if (fullFileName.empty()) return ReadResult::FILE_NOT_FOUND;
+
+                    // A compiled earth file decodes straight from a mapping of the file.
+                    // XML never starts with an 'O', so one byte tells them apart.
+                    bool compiled = false;
+                    {
+                        std::ifstream probe( fullFileName.c_str(), std::ios::in | std::ios::binary );
+                        compiled = probe.is_open() && probe.peek() == 'O';
+                    }
+
+                    Util::MappedFile file;
+                    if ( compiled && file.map(fullFileName) && Config::isBinary(file.data(), file.size()) )
+                    {
+                        osg::ref_ptr<osgDB::Options> myReadOptions = Registry::instance()->cloneOrCreateOptions(readOptions);
+                        URIContext( fullFileName ).store( myReadOptions.get() );
+
+                        Config docConf;
+                        if ( !docConf.fromBinary(file.data(), file.size(), fullFileName) )
+                            return ReadResult::ERROR_IN_READING_FILE;
+
+                        return readConfig( docConf, myReadOptions.get() );
+                    }
                 }
 
                 osgEarth::ReadResult r = URI(fullFileName).readString( readOptions );
@@ -222,11 +274,31 @@ class ReaderWriterEarth : public osgDB::ReaderWriter
             // from an "anonymous" stream here)
             URIContext uriContext( readOptions ); 
 
+            // A compiled earth file starts with a signature; XML never starts with an 'O'.
+            if ( in.peek() == 'O' )
+            {
+                std::string buffer(
+                    (std::istreambuf_iterator<char>(in)),
+                    std::istreambuf_iterator<char>() );
+
+                Config docConf;
+                if ( !docConf.fromBinary(buffer.data(), buffer.size(), uriContext.referrer()) )
+                    return ReadResult::ERROR_IN_READING_FILE;
+
+                return readConfig( docConf, readOptions );
+            }
+
             osg::ref_ptr<XmlDocument> doc = XmlDocument::load( in, uriContext );
             if ( !doc.valid() )
                 return ReadResult::ERROR_IN_READING_FILE;
 
-            Config docConf = doc->getConfig();
+            return readConfig( doc->getConfig(), readOptions );
+        }
+
+        //! Creates the map from a decoded earth file
+        ReadResult readConfig(const Config& docConf, const osgDB::Options* readOptions) const
+        {
+            URIContext uriContext( readOptions );
 
             // support both "map" and "earth" tag names at the top level
             Config conf;
@@ -24,6 +24,7 @@
 #include <osgEarth/TerrainEngineNode>
 #include <osgEarth/Terrain>
 #include <osgEarth/Metrics>
+#include <osgEarth/MetricsRegistry>
 #include <osg/NodeVisitor>
 
 using namespace osgEarth::REX;
@@ -88,15 +89,28 @@ LoadTileDataOperation::dispatch(bool async)
 
     auto load = [engine, map, key, manifest, enableCancel] (Cancelable* progress)
     {
+        static MetricsRegistry::Histogram& s_latency = MetricsRegistry::instance().histogram(
+            "osgearth_rex_tile_load_seconds", "Time to create the data model for one terrain tile");
+        static MetricsRegistry::Counter& s_loaded = MetricsRegistry::instance().counter(
+            "osgearth_rex_tiles_loaded_total", "Terrain tile data models created");
+
         osg::ref_ptr<ProgressCallback> wrapper =
             enableCancel ? new ProgressCallback(progress) : nullptr;
 
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
         osg::ref_ptr<TerrainTileModel> result = engine->createTileModel(
             map.get(),
             key,
             manifest,
             wrapper.get());
 
+        if (result.valid())
+        {
+            s_latency.record(std::chrono::steady_clock::now() - start);
+            s_loaded.increment();
+        }
+
         return result;
     };
 
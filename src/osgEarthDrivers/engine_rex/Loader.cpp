@@ -17,10 +17,12 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include "Loader"
+#include "TileNode"
 
 #include <osgEarth/Utils>
 #include <osgEarth/NodeUtils>
 #include <osgEarth/Metrics>
+#include <osgEarth/MetricsRegistry>
 #include <osgEarth/GLUtils>
 
 #include <osgUtil/IncrementalCompileOperation>
@@ -35,7 +37,7 @@ using namespace osgEarth::REX;
 #define LC "[Merger] "
 
 Merger::Merger() :
-    _mergesPerFrame(~0)
+    _mergeScheduler("osgearth_rex")
 {
     setCullingActive(false);
     setNumChildrenRequiringUpdateTraversal(+1);
@@ -50,7 +52,13 @@ Merger::~Merger()
 void
 Merger::setMergesPerFrame(unsigned value)
 {
-    _mergesPerFrame = value;
+    _mergeScheduler.setMaxMergesPerFrame(value);
+}
+
+void
+Merger::setMergeTimeBudget(unsigned micros)
+{
+    _mergeScheduler.setTimeBudget(micros);
 }
 
 void
@@ -58,7 +66,34 @@ Merger::clear()
 {
     ScopedMutexLock lock(_mutex);
     _compileQueue = CompileQueue();
-    _mergeQueue = MergeQueue();
+    _mergeScheduler.clear();
+}
+
+void
+Merger::schedule(LoadTileDataOperationPtr data)
+{
+    osg::observer_ptr<TileNode> tile = data->_tilenode;
+
+    // Whole tiles and layer updates cost very different amounts to merge,
+    // so the scheduler learns their costs separately.
+    const char* category = data->_manifest.empty() ? "tile" : "layers";
+
+    _mergeScheduler.push(
+        [data]() -> bool
+        {
+            osg::ref_ptr<TileNode> tilenode;
+            return
+                data->_result.isAvailable() &&
+                data->_tilenode.lock(tilenode) &&
+                data->merge();
+        },
+        [tile]() -> float
+        {
+            // a tile that has gone away costs nothing to discard
+            osg::ref_ptr<TileNode> tilenode;
+            return tile.lock(tilenode) ? tilenode->getLoadPriority() : FLT_MAX;
+        },
+        category);
 }
 
 void
@@ -91,13 +126,12 @@ Merger::merge(LoadTileDataOperationPtr data, osg::NodeVisitor& nv)
         }
         else
         {
-            _mergeQueue.push(data);
+            schedule(data);
         }
     }
     else
     {
-        ScopedMutexLock lock(_mutex);
-        _mergeQueue.push(data);
+        schedule(data);
     }
 }
 
@@ -110,60 +144,40 @@ Merger::traverse(osg::NodeVisitor& nv)
     }
     else if (nv.getVisitorType() == nv.UPDATE_VISITOR && _clock.update())
     {
-        ScopedMutexLock lock(_mutex);
+        static MetricsRegistry::Gauge& s_compileQueueDepth = MetricsRegistry::instance().gauge(
+            "osgearth_rex_compile_queue_depth", "Tiles waiting on GL object compilation");
 
-        // First check the GL compile queue
-        while (!_compileQueue.empty())
         {
-            ToCompile& next = _compileQueue.front();
+            ScopedMutexLock lock(_mutex);
 
-            if (next._compiled.isAvailable())
-            {
-                // compile finished, put it on the merge queue
-                _mergeQueue.emplace(std::move(next._data));
-                _compileQueue.pop();
-            }
-            else if (next._compiled.isAbandoned())
+            // First check the GL compile queue
+            while (!_compileQueue.empty())
             {
-                // compile canceled, ditch it
-                _compileQueue.pop();
-            }
-            else
-            {
-                // nothing to do -- bail out
-                break;
-            }
-        }
+                ToCompile& next = _compileQueue.front();
 
-        unsigned count = 0u;
-        unsigned max_count = _mergesPerFrame;
-        if (max_count == 0)
-            max_count = INT_MAX;
-
-        while (!_mergeQueue.empty() && count < max_count)
-        {
-            LoadTileDataOperationPtr next = _mergeQueue.front();
-            _mergeQueue.pop();
-
-            if (next != nullptr)
-            {
-                if (next->_result.isAvailable())
+                if (next._compiled.isAvailable())
+                {
+                    // compile finished, schedule it for merging
+                    schedule(next._data);
+                    _compileQueue.pop();
+                }
+                else if (next._compiled.isAbandoned())
                 {
-                    next->merge();
+                    // compile canceled, ditch it
+                    _compileQueue.pop();
                 }
                 else
                 {
-                    //OE_INFO << LC << "Abandoned " << next->_name << std::endl;
+                    // nothing to do -- bail out
+                    break;
                 }
             }
 
-            ++count;
+            s_compileQueueDepth.set(_compileQueue.size());
         }
 
-        //if (count > 0)
-        //{
-        //    OE_INFO << LC << "Merged " << count << std::endl;
-        //}
+        // Merge in priority order until we hit the per-frame limits
+        _mergeScheduler.run();
     }
 
     osg::Node::traverse(nv);
@@ -7,15 +7,71 @@
 #include <osgEarth/TerrainConstraintLayer>
 //#include <osgEarth/rtree.h>
 #include <osgEarth/weemesh.h>
+#include <osgEarth/Cache>
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <sstream>
+#include <unordered_set>
 
 #define LC "[MeshEditor] "
 
 using namespace osgEarth;
 using namespace osgEarth::REX;
+using namespace osgEarth::Util;
 using namespace weemesh;
 
+namespace
+{
+    // 64-bit FNV-1a; stable across runs, unlike std::hash.
+    inline void fnv1a(std::uint64_t& h, const void* data, std::size_t len)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < len; ++i)
+        {
+            h ^= p[i];
+            h *= 0x100000001b3ull;
+        }
+    }
+
+    //! Hashes everything about an edit that affects the resulting mesh:
+    //! the layer's editing options and each feature's ID and geometry.
+    std::uint64_t hashEdit(const MeshEditor::Edit& edit)
+    {
+        std::uint64_t h = 0xcbf29ce484222325ull;
+
+        unsigned char flags[2] = {
+            (unsigned char)(edit._layer->getHasElevation() ? 1 : 0),
+            (unsigned char)(edit._layer->getRemoveInterior() ? 1 : 0) };
+        fnv1a(h, flags, sizeof(flags));
+
+        for (auto& f : edit._features)
+        {
+            const Feature* feature = f.get();
+            FeatureID fid = feature->getFID();
+            fnv1a(h, &fid, sizeof(fid));
+
+            const Geometry* geom = feature->getGeometry();
+            if (!geom)
+                continue;
+
+            ConstGeometryIterator iter(geom, true);
+            while (iter.hasMore())
+            {
+                const Geometry* part = iter.next();
+                std::uint32_t size = (std::uint32_t)part->size();
+                fnv1a(h, &size, sizeof(size));
+                for (auto& p : *part)
+                {
+                    double xyz[3] = { p.x(), p.y(), p.z() };
+                    fnv1a(h, xyz, sizeof(xyz));
+                }
+            }
+        }
+        return h;
+    }
+}
+
 MeshEditor::MeshEditor(const TileKey& key, unsigned tileSize, const Map* map, ProgressCallback* progress) :
     _key( key ), 
     _tileSize(tileSize),
@@ -68,6 +124,48 @@ MeshEditor::MeshEditor(const TileKey& key, unsigned tileSize, const Map* map, Pr
             }
         }
     }
+
+    // Edited meshes are stored in the map's cache, keyed by the tile and by
+    // the content of every feature that contributed edits. Layer revisions
+    // restart with each process, so they cannot identify a persistent record.
+    Cache* cache = map->getCache();
+    if (!_edits.empty() && cache)
+    {
+        // The mesh depends on every contributing layer, so honour the most
+        // restrictive of their cache policies.
+        _cachePolicy = map->getCachePolicy();
+        for (auto& edit : _edits)
+        {
+            const CachePolicy& lp = edit._layer->getCachePolicy();
+            if (lp.empty())
+                continue;
+
+            if (lp.usage().isSet() && lp.usage().get() > _cachePolicy.usage().get())
+                _cachePolicy.usage() = lp.usage().get();
+            if (lp.maxAge().isSet() && (!_cachePolicy.maxAge().isSet() || lp.maxAge().get() < _cachePolicy.maxAge().get()))
+                _cachePolicy.maxAge() = lp.maxAge().get();
+            if (lp.minTime().isSet() && (!_cachePolicy.minTime().isSet() || lp.minTime().get() > _cachePolicy.minTime().get()))
+                _cachePolicy.minTime() = lp.minTime().get();
+        }
+
+        // a cache-only constraint layer still lets us build the mesh from
+        // its features, so treat it as read-only here.
+        if (_cachePolicy.isCacheOnly() && !map->getCachePolicy().isCacheOnly())
+            _cachePolicy.usage() = CachePolicy::USAGE_READ_ONLY;
+    }
+
+    if (!_edits.empty() && cache && _cachePolicy.isCacheEnabled())
+    {
+        _cacheBin = cache->addBin("rex_constrained_meshes");
+
+        std::stringstream buf;
+        buf << key.str() << "-" << std::hex << key.getProfile()->getHorizSignature()
+            << "-" << std::dec << tileSize;
+        for (auto& edit : _edits)
+            buf << "-" << edit._layer->getCacheID() << ":" << std::hex << hashEdit(edit) << std::dec;
+
+        _cacheKey = Cache::makeCacheKey(buf.str(), "mesh");
+    }
 }
 
 #define addSkirtDataForIndex(INDEX, HEIGHT) \
@@ -97,24 +195,13 @@ MeshEditor::MeshEditor(const TileKey& key, unsigned tileSize, const Map* map, Pr
 }
 
 bool
-MeshEditor::createTileMesh(
-    SharedGeometry* sharedGeom,
-    unsigned tileSize,
-    double skirtHeightRatio,
+MeshEditor::editTileMesh(
+    TileMesh& out,
+    const osg::Matrix& world2local,
     Cancelable* progress)
 {
-    // uncomment for easier debugging
-    //static Mutex m;
-    //ScopedMutexLock lock(m);
-
-    // Establish a local reference frame for the tile:
-    osg::Vec3d centerWorld;
+    const unsigned tileSize = _tileSize;
     const GeoExtent& keyExtent = _key.getExtent();
-    GeoPoint centroid = keyExtent.getCentroid();
-    centroid.toWorld(centerWorld);
-    osg::Matrix world2local, local2world;
-    centroid.createWorldToLocal(world2local);
-    local2world.invert(world2local);
     GeoLocator locator(keyExtent);
     const SpatialReference* tileSRS = keyExtent.getSRS();
 
@@ -139,9 +226,6 @@ MeshEditor::createTileMesh(
 
     mesh._verts.reserve(tileSize*tileSize);
 
-    double xscale = -zmin / 0.5*(xmax - xmin);
-    double yscale = -zmin / 0.5*(ymax - ymin);
-
     for (unsigned row = 0; row < tileSize; ++row)
     {
         double ny = (double)row / (double)(tileSize - 1);
@@ -318,24 +402,121 @@ MeshEditor::createTileMesh(
                 // if ALL triangles are unused, it's an empty tile.
                 if (mesh._triangles.empty())
                 {
-                    _tileEmpty = true;
-                    sharedGeom->setHasConstraints(true);
-                    return false;
+                    out.clear();
+                    out.empty = true;
+                    out.hasConstraints = true;
+                    return true;
                 }
             }
         }
     }
 
+    // Harvest the edited mesh.
+    out.clear();
+
+    out.verts.reserve(mesh._verts.size());
+    out.markers.reserve(mesh._verts.size());
+    for (unsigned i = 0; i < mesh._verts.size(); ++i)
+    {
+        const vert_t& vert = mesh._verts[i];
+        out.verts.push_back(osg::Vec3f(vert.x(), vert.y(), vert.z()));
+        out.markers.push_back((std::uint8_t)mesh.get_marker((int)i));
+    }
+
+    out.indices.reserve(mesh._triangles.size() * 3);
+    for (const auto& tri : mesh._triangles)
+    {
+        out.indices.push_back(tri.second.i0);
+        out.indices.push_back(tri.second.i1);
+        out.indices.push_back(tri.second.i2);
+    }
+
+    out.hasConstraints = mesh._num_edits > 0;
+
+    return true;
+}
+
+bool
+MeshEditor::readCachedMesh(TileMesh& out) const
+{
+    if (!_cacheBin.valid() || !_cachePolicy.isCacheReadable())
+        return false;
+
+    ReadResult r = _cacheBin->readString(_cacheKey, nullptr);
+    if (r.failed() || _cachePolicy.isExpired(r.lastModifiedTime()))
+        return false;
+
+    if (!out.read(r.getString()))
+    {
+        OE_DEBUG << LC << _key.str() << " - ignoring unreadable mesh record" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void
+MeshEditor::writeCachedMesh(const TileMesh& mesh) const
+{
+    if (!_cacheBin.valid() || !_cachePolicy.isCacheWriteable())
+        return;
+
+    osg::ref_ptr<StringObject> record = new StringObject();
+    std::string buf;
+    mesh.write(buf);
+    record->setString(buf);
+    _cacheBin->write(_cacheKey, record.get(), nullptr);
+}
+
+bool
+MeshEditor::createTileMesh(
+    SharedGeometry* sharedGeom,
+    unsigned tileSize,
+    double skirtHeightRatio,
+    Cancelable* progress)
+{
+    // uncomment for easier debugging
+    //static Mutex m;
+    //ScopedMutexLock lock(m);
+
+    // Establish a local reference frame for the tile:
+    osg::Vec3d centerWorld;
+    const GeoExtent& keyExtent = _key.getExtent();
+    GeoPoint centroid = keyExtent.getCentroid();
+    centroid.toWorld(centerWorld);
+    osg::Matrix world2local, local2world;
+    centroid.createWorldToLocal(world2local);
+    local2world.invert(world2local);
+    GeoLocator locator(keyExtent);
+
+    // Reuse a previously edited mesh if we can; otherwise do the edits.
+    TileMesh mesh;
+    if (!readCachedMesh(mesh))
+    {
+        if (!editTileMesh(mesh, world2local, progress))
+            return false;
+
+        writeCachedMesh(mesh);
+    }
+
+    // if ALL triangles are unused, it's an empty tile.
+    if (mesh.empty)
+    {
+        _tileEmpty = true;
+        sharedGeom->setHasConstraints(true);
+        return false;
+    }
+
     // We have an edited mesh, now turn it back into something OSG can render.
     using Vec3Ptr = osg::ref_ptr<osg::Vec3Array>;
     Vec3Ptr verts = dynamic_cast<osg::Vec3Array*>(sharedGeom->getVertexArray());
-    verts->reserve(mesh._verts.size());
+    verts->reserve(mesh.verts.size());
 
     Vec3Ptr normals = dynamic_cast<osg::Vec3Array*>(sharedGeom->getNormalArray());
-    normals->reserve(mesh._verts.size());
+    normals->reserve(mesh.verts.size());
 
     Vec3Ptr texCoords = dynamic_cast<osg::Vec3Array*>(sharedGeom->getTexCoordArray());
-    texCoords->reserve(mesh._verts.size());
+    texCoords->reserve(mesh.verts.size());
 
     Vec3Ptr neighbors = dynamic_cast<osg::Vec3Array*>(sharedGeom->getNeighborArray());
 
@@ -344,14 +525,13 @@ MeshEditor::createTileMesh(
     osg::Vec3d world;
     osg::BoundingSphere tileBound;
 
-    int ptr = 0;
     int original_grid_size = tileSize * tileSize;
 
-    for(auto& vert : mesh._verts)
+    for(int ptr = 0; ptr < (int)mesh.verts.size(); ++ptr)
     {
-        int marker = mesh.get_marker(vert);
+        int marker = mesh.markers[ptr];
 
-        osg::Vec3d v(vert.x(), vert.y(), vert.z());
+        osg::Vec3d v(mesh.verts[ptr]);
         osg::Vec3d unit;
         verts->push_back(v);
         world = v * local2world;
@@ -396,18 +576,14 @@ MeshEditor::createTileMesh(
         }
 
         tileBound.expandBy(verts->back());
-
-        ++ptr;
     }
 
     // TODO: combine this with the skirt gen for speed
     osg::DrawElements* de = new osg::DrawElementsUShort(GL_TRIANGLES);
-    de->reserveElements(mesh._triangles.size() * 3);
-    for (const auto& tri : mesh._triangles)
+    de->reserveElements(mesh.indices.size());
+    for (auto index : mesh.indices)
     {
-        de->addElement(tri.second.i0);
-        de->addElement(tri.second.i1);
-        de->addElement(tri.second.i2);
+        de->addElement(index);
     }
     sharedGeom->setDrawElements(de);
 
@@ -417,7 +593,13 @@ MeshEditor::createTileMesh(
         double skirtHeight = skirtHeightRatio * tileBound.radius();
 
         // collect all edges marked as boundaries
-        edgeset_t boundary_edges(mesh, VERTEX_BOUNDARY);
+        edgeset_t boundary_edges;
+        for (std::size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+        {
+            boundary_edges.add_triangle(
+                mesh.indices[t], mesh.indices[t+1], mesh.indices[t+2],
+                mesh.markers, VERTEX_BOUNDARY);
+        }
 
         // Add the skirt geometry. We don't share verts with the surface mesh
         // because we need to mark skirts verts so we can conditionally render
@@ -443,7 +625,7 @@ MeshEditor::createTileMesh(
     }
 
     // Mark the geometry appropriately
-    sharedGeom->setHasConstraints(mesh._num_edits > 0);
+    sharedGeom->setHasConstraints(mesh.hasConstraints);
 
     return true;
-}
\ No newline at end of file
+}
@@ -290,6 +290,7 @@ RexTerrainEngineNode::setMap(const Map* map, const TerrainOptions& inOptions)
     // Geometry compiler/merger
     _merger = new Merger();
     _merger->setMergesPerFrame(options().mergesPerFrame().get());
+    _merger->setMergeTimeBudget(options().mergeTimeBudget().get());
     this->addChild(_merger.get());
 
     // Loader concurrency (size of the thread pool)
@@ -338,6 +339,14 @@ RexTerrainEngineNode::setMap(const Map* map, const TerrainOptions& inOptions)
     // Calculate the LOD morphing parameters:
     unsigned maxLOD = options().maxLOD().getOrUse(DEFAULT_MAX_LOD);
 
+    // The tile registry indexes tiles by packed TileID, which requires an
+    // interned map profile (normally claimed by the Map itself). Tiles it
+    // cannot pack fall back to slower string keys.
+    if (TileID::internProfile(map->getProfile()) == 0u)
+    {
+        OE_WARN << LC << "Map profile could not be interned; terrain tiles will be tracked by string key" << std::endl;
+    }
+
     _selectionInfo.initialize(
         0u, // always zero, not the terrain options firstLOD
         osg::minimum(options().maxLOD().get(), maxLOD ),
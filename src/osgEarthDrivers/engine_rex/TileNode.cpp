@@ -102,6 +102,7 @@ TileNode::create(const TileKey& key, TileNode* parent, EngineContext* context, C
         return;
 
     _key = key;
+    _id = TileNodeID(key);
     _context = context;
 
     createGeometry(progress);
@@ -100,7 +100,7 @@ TileNodeRegistry::setDirty(const GeoExtent& extent,
     
     for( TileTable::iterator i = _tiles.begin(); i != _tiles.end(); ++i )
     {
-        const TileKey& key = i->first;
+        const TileKey& key = i->second._tile->getKey();
 
         if (minLevel <= key.getLOD() && 
             maxLevel >= key.getLOD() &&
@@ -127,7 +127,7 @@ TileNodeRegistry::add(TileNode* tile)
     TrackerEntry* se;
     TableEntry* te;
 
-    TileTable::iterator i = _tiles.find(tile->getKey());
+    TileTable::iterator i = _tiles.find(tile->getID());
     if (i != _tiles.end())
     {
         // found an orphan! Reuse and overwrite it.
@@ -139,7 +139,7 @@ TileNodeRegistry::add(TileNode* tile)
     }
     else
     {
-        te = &_tiles[tile->getKey()];
+        te = &_tiles[tile->getID()];
         se = new TrackerEntry();
     }
 
@@ -163,20 +163,20 @@ TileNodeRegistry::add(TileNode* tile)
         // If we're recycling, we need to remove the old listeners first
         if (recyclingOrphan)
         {
-            stopListeningFor(key.createNeighborKey(1, 0), key);
-            stopListeningFor(key.createNeighborKey(0, 1), key);
+            stopListeningFor(TileNodeID(key.createNeighborKey(1, 0)), tile->getID());
+            stopListeningFor(TileNodeID(key.createNeighborKey(0, 1)), tile->getID());
         }
 
-        startListeningFor(key.createNeighborKey(1, 0), tile);
-        startListeningFor(key.createNeighborKey(0, 1), tile);
+        startListeningFor(TileNodeID(key.createNeighborKey(1, 0)), tile);
+        startListeningFor(TileNodeID(key.createNeighborKey(0, 1)), tile);
 
         // check for tiles that are waiting on this tile, and notify them!
-        TileKeyOneToMany::iterator notifier = _notifiers.find( tile->getKey() );
+        TileIDOneToMany::iterator notifier = _notifiers.find( tile->getID() );
         if ( notifier != _notifiers.end() )
         {
-            TileKeySet& listeners = notifier->second;
+            TileIDSet& listeners = notifier->second;
 
-            for(TileKeySet::iterator listener = listeners.begin(); listener != listeners.end(); ++listener)
+            for(TileIDSet::iterator listener = listeners.begin(); listener != listeners.end(); ++listener)
             {
                 TileTable::iterator i = _tiles.find( *listener );
                 if ( i != _tiles.end())
@@ -197,37 +197,40 @@ TileNodeRegistry::add(TileNode* tile)
 }
 
 void
-TileNodeRegistry::startListeningFor(const TileKey& tileToWaitFor, TileNode* waiter)
+TileNodeRegistry::startListeningFor(const TileNodeID& tileToWaitFor, TileNode* waiter)
 {
     // ASSUME EXCLUSIVE LOCK
 
+    if (!tileToWaitFor.valid())
+        return;
+
     TileTable::iterator i = _tiles.find(tileToWaitFor);
     if (i != _tiles.end())
     {
         TileNode* tile = i->second._tile.get();
 
-        OE_DEBUG << LC << waiter->getKey().str() << " listened for " << tileToWaitFor.str()
+        OE_DEBUG << LC << waiter->getKey().str() << " listened for another tile"
             << ", but it was already in the repo.\n";
 
         waiter->notifyOfArrival( tile );
     }
     else
     {
-        OE_DEBUG << LC << waiter->getKey().str() << " listened for " << tileToWaitFor.str() << ".\n";
-        _notifiers[tileToWaitFor].insert( waiter->getKey() );
+        OE_DEBUG << LC << waiter->getKey().str() << " listened for another tile.\n";
+        _notifiers[tileToWaitFor].insert( waiter->getID() );
     }
 }
 
 void
-TileNodeRegistry::stopListeningFor(const TileKey& tileToWaitFor, const TileKey& waiterKey)
+TileNodeRegistry::stopListeningFor(const TileNodeID& tileToWaitFor, const TileNodeID& waiterID)
 {
     // ASSUME EXCLUSIVE LOCK
 
-    TileKeyOneToMany::iterator i = _notifiers.find(tileToWaitFor);
+    TileIDOneToMany::iterator i = _notifiers.find(tileToWaitFor);
     if (i != _notifiers.end())
     {
         // remove the waiter from this set:
-        i->second.erase(waiterKey);
+        i->second.erase(waiterID);
 
         // if the set is now empty, remove the set entirely
         if (i->second.empty())
@@ -281,7 +284,7 @@ TileNodeRegistry::update(TileNode* tile, osg::NodeVisitor& nv)
     _mutex.lock();
 
     // Find the tracker for this tile and update its timestamp
-    TileTable::iterator i = _tiles.find(tile->getKey());
+    TileTable::iterator i = _tiles.find(tile->getID());
     if (i != _tiles.end())
     {
         TableEntry& e = i->second;
@@ -341,8 +344,8 @@ TileNodeRegistry::collectDormantTiles(
             if (_notifyNeighbors)
             {
                 // remove neighbor listeners:
-                stopListeningFor(key.createNeighborKey(1, 0), key);
-                stopListeningFor(key.createNeighborKey(0, 1), key);
+                stopListeningFor(TileNodeID(key.createNeighborKey(1, 0)), se->_tile->getID());
+                stopListeningFor(TileNodeID(key.createNeighborKey(0, 1)), se->_tile->getID());
             }
 
             // back up the iterator so we can safely erase the tracker entry:
@@ -353,7 +356,7 @@ TileNodeRegistry::collectDormantTiles(
             output.push_back(se->_tile);
 
             // remove it from the main tile table:
-            _tiles.erase(key);
+            _tiles.erase(se->_tile->getID());
 
             // remove it from the tracker list:
             _tracker.erase(tmp);
@@ -385,7 +388,7 @@ TileNodeRegistry::get(const TileKey& key) const
 
     ScopedMutexLock scopelock(_mutex);
 
-    auto iter = _tiles.find(key);
+    auto iter = _tiles.find(TileNodeID(key));
     if (iter != _tiles.end())
     {
         result = iter->second._tile.get();
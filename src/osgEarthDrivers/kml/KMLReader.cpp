@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include "KMLReader"
+#include "KMLStreamReader"
 #include "KML_Root"
 #include "KML_Geometry"
 #include <osgEarth/Registry>
@@ -26,6 +27,7 @@
 #include <osgEarth/ScreenSpaceLayout>
 #include <stack>
 #include <iterator>
+#include <fstream>
 
 using namespace osgEarth_kml;
 using namespace osgEarth;
@@ -43,16 +45,21 @@ _options( options )
 osg::Node*
 KMLReader::read( std::istream& in, const osgDB::Options* dbOptions )
 {
+    if ( _options && _options->streaming() == true )
+    {
+        KMLStreamReader reader( _mapNode, _options );
+        return reader.read( in, dbOptions );
+    }
+
     OE_INFO << LC << "Loading KML.." << std::endl;
     // pull the URI context out of the DB options:
     URIContext context(dbOptions);
 
 	// Load the XML
     osg::Timer_t start = osg::Timer::instance()->tick();
-	std::stringstream buffer;
-    buffer << in.rdbuf();
-    std::string xmlStr;
-    xmlStr = buffer.str();
+    std::string xmlStr(
+        (std::istreambuf_iterator<char>(in)),
+        std::istreambuf_iterator<char>() );
 	xml_document<> doc;
 	doc.parse<0>(&xmlStr[0]);
 
@@ -65,6 +72,23 @@ KMLReader::read( std::istream& in, const osgDB::Options* dbOptions )
 	return node;
 }
 
+osg::Node*
+KMLReader::readFile( const std::string& filename, const osgDB::Options* dbOptions )
+{
+    if ( _options && _options->streaming() == true )
+    {
+        // maps the file rather than reading it
+        KMLStreamReader reader( _mapNode, _options );
+        return reader.readFile( filename, dbOptions );
+    }
+
+    std::ifstream in( filename.c_str(), std::ios::binary );
+    if ( !in.is_open() )
+        return 0L;
+
+    return read( in, dbOptions );
+}
+
 osg::Node*
 KMLReader::read( xml_document<>& doc, const osgDB::Options* dbOptions )
 {
@@ -0,0 +1,745 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "KMLStreamReader"
+#include "KML_Common"
+#include "KML_Container"
+#include "KML_Document"
+#include "KML_Folder"
+#include "KML_PhotoOverlay"
+#include "KML_ScreenOverlay"
+#include "KML_GroundOverlay"
+#include "KML_NetworkLink"
+#include "KML_Placemark"
+#include "KML_Style"
+#include "KML_StyleMap"
+#include <osgEarth/FileUtils>
+#include <osgEarth/MergeScheduler>
+#include <osgEarth/NodeUtils>
+#include <osgEarth/Registry>
+#include <osgEarth/Threading>
+#include <osg/Timer>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stack>
+#include <vector>
+
+using namespace osgEarth_kml;
+using namespace osgEarth;
+
+#undef LC
+#define LC "[KMLStreamReader] "
+
+namespace
+{
+    // time to spend attaching built batches to the scene graph each frame
+    const unsigned MERGE_BUDGET_MICROS = 2000u;
+
+    // KML source text: either a read-only mapping of a local file, or the
+    // contents of a stream.
+    class Buffer
+    {
+    public:
+        Buffer() : _data(0L), _size(0u) { }
+
+        bool map(const std::string& filename)
+        {
+            if (!_file.map(filename, Util::MappedFile::ACCESS_SEQUENTIAL))
+                return false;
+            _data = _file.data();
+            _size = _file.size();
+            return true;
+        }
+
+        void read(std::istream& in)
+        {
+            _string.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            _data = _string.data();
+            _size = _string.size();
+        }
+
+        const char* begin() const { return _data; }
+        const char* end() const { return _data + _size; }
+
+    private:
+        Util::MappedFile _file;
+        std::string _string;
+        const char* _data;
+        std::size_t _size;
+    };
+
+    //........................................................................
+
+    struct Tag
+    {
+        enum Type { OPEN, CLOSE, EMPTY };
+        Type        _type;
+        const char* _begin;  // the '<'
+        const char* _end;    // one past the '>'
+        std::string _name;   // lower case, as the DOM reader matches names
+    };
+
+    inline bool startsWith(const char* p, const char* end, const char* token, std::size_t len)
+    {
+        return (std::size_t)(end - p) >= len && ::memcmp(p, token, len) == 0;
+    }
+
+    // Returns the position just past the next "token", or "end"
+    inline const char* skipPast(const char* p, const char* end, const char* token, std::size_t len)
+    {
+        for (; p + len <= end; ++p)
+        {
+            p = (const char*)::memchr(p, token[0], end - p);
+            if (!p || p + len > end)
+                break;
+            if (::memcmp(p, token, len) == 0)
+                return p + len;
+        }
+        return end;
+    }
+
+    // Pulls the next element tag out of [p, end), skipping text, comments,
+    // CDATA, processing instructions and declarations. Returns false at the
+    // end of the buffer.
+    bool nextTag(const char*& p, const char* end, Tag& tag)
+    {
+        while (p < end)
+        {
+            const char* lt = (const char*)::memchr(p, '<', end - p);
+            if (!lt)
+            {
+                p = end;
+                return false;
+            }
+
+            if (startsWith(lt, end, "<!--", 4))
+            {
+                p = skipPast(lt + 4, end, "-->", 3);
+                continue;
+            }
+            if (startsWith(lt, end, "<![CDATA[", 9))
+            {
+                p = skipPast(lt + 9, end, "]]>", 3);
+                continue;
+            }
+            if (startsWith(lt, end, "<?", 2))
+            {
+                p = skipPast(lt + 2, end, "?>", 2);
+                continue;
+            }
+            if (startsWith(lt, end, "<!", 2))
+            {
+                p = skipPast(lt + 2, end, ">", 1);
+                continue;
+            }
+
+            const char* q = lt + 1;
+            tag._type = Tag::OPEN;
+            if (q < end && *q == '/')
+            {
+                tag._type = Tag::CLOSE;
+                ++q;
+            }
+
+            const char* name = q;
+            while (q < end && !::isspace((unsigned char)*q) && *q != '>' && *q != '/')
+                ++q;
+            tag._name.assign(name, q);
+            for (auto& c : tag._name)
+                c = (char)::tolower((unsigned char)c);
+
+            // find the end of the tag, ignoring any '>' in an attribute value
+            char quote = 0;
+            for (; q < end; ++q)
+            {
+                if (quote)
+                {
+                    if (*q == quote)
+                        quote = 0;
+                }
+                else if (*q == '"' || *q == '\'')
+                    quote = *q;
+                else if (*q == '>')
+                    break;
+            }
+            if (q == end)
+            {
+                p = end;
+                return false;
+            }
+
+            if (tag._type == Tag::OPEN && *(q - 1) == '/')
+                tag._type = Tag::EMPTY;
+
+            tag._begin = lt;
+            tag._end = q + 1;
+            p = tag._end;
+            return true;
+        }
+        return false;
+    }
+
+    // Given the start tag just read, advances "p" past the end of its
+    // element and returns that position.
+    const char* endOfElement(const char*& p, const char* end, const Tag& start)
+    {
+        if (start._type == Tag::EMPTY)
+            return start._end;
+
+        Tag tag;
+        int depth = 1;
+        while (depth > 0 && nextTag(p, end, tag))
+        {
+            if (tag._type == Tag::OPEN)
+                ++depth;
+            else if (tag._type == Tag::CLOSE)
+                --depth;
+        }
+        return p;
+    }
+
+    // Parses one element's worth of XML in place; returns the element,
+    // or NULL if the XML is malformed.
+    xml_node<>* parseFragment(xml_document<>& doc, std::string& xml)
+    {
+        try
+        {
+            doc.parse<0>(&xml[0]);
+        }
+        catch (rapidxml::parse_error& e)
+        {
+            OE_WARN << LC << "Skipping malformed KML: " << e.what() << std::endl;
+            return 0L;
+        }
+        return doc.first_node();
+    }
+
+    inline bool isContainer(const std::string& name)
+    {
+        return name == "document" || name == "folder";
+    }
+
+    inline bool isFeature(const std::string& name)
+    {
+        return
+            name == "placemark" ||
+            name == "groundoverlay" ||
+            name == "screenoverlay" ||
+            name == "photooverlay" ||
+            name == "networklink";
+    }
+
+    //........................................................................
+
+    // Options for one batch: the user's, except that icons and labels go
+    // into a group of the batch's own, which the merge moves into the
+    // user's group on the update thread.
+    struct BatchOptions : public KMLOptions
+    {
+        BatchOptions(const KMLOptions& rhs, osg::Group* icons) : KMLOptions(rhs)
+        {
+            _iconAndLabelGroup = icons;
+        }
+    };
+
+    // Everything the reader, the builders and the merges share. Owned by
+    // the root node and by the running jobs; merges only run while the
+    // root node is alive, so they hold a raw pointer.
+    struct StreamState
+    {
+        StreamState() :
+            _merger("osgearth_kml"),
+            _canceled(false),
+            _loaded(false),
+            _inFlight(0),
+            _maxInFlight(std::max(2, 2 * (int)Threading::getConcurrency())) { }
+
+        Buffer                      _buffer;
+        KMLOptions                  _options;
+        KMLContext                  _cx;            // never changes once the styles are read
+        URIResultCache              _uriCache;
+        osg::observer_ptr<osg::Group> _root;
+        MergeScheduler              _merger;
+        std::atomic<bool>           _canceled;
+        std::atomic<bool>           _loaded;
+        std::atomic<int>            _inFlight;
+        const int                   _maxInFlight;
+        Threading::Event            _batchDone;
+        osg::Timer_t                _start;
+
+        //! Group to attach to; NULL means the root
+        osg::ref_ptr<osg::Group> resolve(const osg::ref_ptr<osg::Group>& group)
+        {
+            if (group.valid())
+                return group;
+            osg::ref_ptr<osg::Group> root;
+            _root.lock(root);
+            return root;
+        }
+    };
+
+    // Root of a streamed KML graph. Attaches the built batches during the
+    // UPDATE traversal until the whole document is loaded.
+    class KMLStreamNode : public osg::Group
+    {
+    public:
+        KMLStreamNode(std::shared_ptr<StreamState> state) :
+            _state(state),
+            _complete(false)
+        {
+            ADJUST_UPDATE_TRAV_COUNT(this, +1);
+        }
+
+        void traverse(osg::NodeVisitor& nv) override
+        {
+            if (nv.getVisitorType() == nv.UPDATE_VISITOR && !_complete)
+            {
+                // check before merging, so nothing queued in between is missed
+                bool loaded = _state->_loaded && _state->_inFlight == 0;
+
+                _state->_merger.run();
+
+                if (loaded && _state->_merger.getQueueSize() == 0u)
+                {
+                    _complete = true;
+                    ADJUST_UPDATE_TRAV_COUNT(this, -1);
+
+                    OE_INFO << LC << "Streamed " << getName() << " in "
+                        << osg::Timer::instance()->delta_s(_state->_start, osg::Timer::instance()->tick())
+                        << "s" << std::endl;
+                }
+            }
+            osg::Group::traverse(nv);
+        }
+
+    protected:
+        virtual ~KMLStreamNode()
+        {
+            // stop the reader and builders; they hold the state until they notice
+            _state->_canceled = true;
+            _state->_merger.clear();
+        }
+
+    private:
+        std::shared_ptr<StreamState> _state;
+        bool _complete;
+    };
+
+    //........................................................................
+
+    // Reads every shared style into the context's style sheet, so the
+    // placemark batches can resolve their style URLs without a lock.
+    void readStyles(StreamState& state)
+    {
+        const char* p = state._buffer.begin();
+        const char* end = state._buffer.end();
+
+        std::vector<std::string> styleMaps;
+
+        Tag tag;
+        while (!state._canceled && nextTag(p, end, tag))
+        {
+            if (tag._type == Tag::CLOSE)
+                continue;
+
+            if (tag._name == "style")
+            {
+                const char* begin = tag._begin;
+                std::string xml(begin, endOfElement(p, end, tag));
+                xml_document<> doc;
+                xml_node<>* node = parseFragment(doc, xml);
+                if (node)
+                {
+                    KML_Style style;
+                    style.scan(node, state._cx);
+                }
+            }
+            else if (tag._name == "stylemap")
+            {
+                // style maps refer to styles, so resolve them last
+                const char* begin = tag._begin;
+                styleMaps.push_back(std::string(begin, endOfElement(p, end, tag)));
+            }
+        }
+
+        for (auto& xml : styleMaps)
+        {
+            xml_document<> doc;
+            xml_node<>* node = parseFragment(doc, xml);
+            if (node)
+            {
+                KML_StyleMap styleMap;
+                styleMap.scan2(node, state._cx);
+            }
+        }
+
+        state._cx._activeStyle = Style();
+    }
+
+    // A Document or Folder being read
+    struct Frame
+    {
+        std::string              _name;
+        osg::ref_ptr<osg::Group> _group;   // NULL for the root
+        osg::ref_ptr<osg::Group> _parent;  // NULL for the root
+        std::string              _shell;   // the container's own elements (name, LookAt, etc.)
+        bool                     _attached;
+    };
+
+    // Placemarks waiting to be built
+    struct Batch
+    {
+        Batch() : _count(0u) { }
+        osg::ref_ptr<osg::Group> _target;
+        std::string              _xml;
+        unsigned                 _count;
+    };
+
+    // Queues a merge that applies the container's own elements to its
+    // group and attaches it. KML orders a feature's own elements before
+    // its children, so this runs before anything is added to the group.
+    void attach(StreamState& state, Frame& frame)
+    {
+        if (frame._attached)
+            return;
+        frame._attached = true;
+
+        std::shared_ptr<std::string> xml;
+        if (!frame._shell.empty())
+        {
+            xml = std::make_shared<std::string>("<" + frame._name + ">");
+            xml->append(frame._shell);
+            xml->append("</" + frame._name + ">");
+            frame._shell.clear();
+        }
+
+        StreamState* s = &state;
+        osg::ref_ptr<osg::Group> group = frame._group;
+        osg::ref_ptr<osg::Group> parent = frame._parent;
+
+        state._merger.push(
+            [s, xml, group, parent]()
+            {
+                osg::ref_ptr<osg::Group> target = s->resolve(parent);
+                if (!target.valid())
+                    return false;
+
+                if (xml)
+                {
+                    xml_document<> doc;
+                    xml_node<>* node = parseFragment(doc, *xml);
+                    if (node)
+                    {
+                        KMLContext cx = s->_cx;
+                        KML_Container container;
+                        container.build(node, cx, group.get());
+                    }
+                }
+
+                target->addChild(group.get());
+                return true;
+            },
+            0.0f,
+            "container");
+    }
+
+    // Builds a batch of features into a new group, and queues a merge
+    // that moves them into the target group.
+    void buildBatch(std::shared_ptr<StreamState> state, std::shared_ptr<std::string> xml, osg::ref_ptr<osg::Group> target)
+    {
+        if (!state->_canceled)
+        {
+            xml_document<> doc;
+            xml_node<>* top = parseFragment(doc, *xml);
+            if (top)
+            {
+                osg::ref_ptr<osg::Group> batch = new osg::Group();
+                osg::ref_ptr<osg::Group> icons;
+
+                KMLContext cx = state->_cx;
+                cx._groupStack.push(batch.get());
+
+                std::unique_ptr<BatchOptions> options;
+                if (state->_options.iconAndLabelGroup().valid())
+                {
+                    icons = new osg::Group();
+                    options.reset(new BatchOptions(state->_options, icons.get()));
+                    cx._options = options.get();
+                }
+
+                for_features(build, top, cx);
+
+                StreamState* s = state.get();
+                state->_merger.push(
+                    [s, batch, icons, target]()
+                    {
+                        osg::ref_ptr<osg::Group> parent = s->resolve(target);
+                        if (!parent.valid())
+                            return false;
+
+                        for (unsigned i = 0; i < batch->getNumChildren(); ++i)
+                            parent->addChild(batch->getChild(i));
+                        batch->removeChildren(0, batch->getNumChildren());
+
+                        if (icons.valid())
+                        {
+                            osg::ref_ptr<osg::Group> userGroup = s->_options.iconAndLabelGroup();
+                            for (unsigned i = 0; i < icons->getNumChildren(); ++i)
+                                userGroup->addChild(icons->getChild(i));
+                            icons->removeChildren(0, icons->getNumChildren());
+                        }
+                        return true;
+                    },
+                    0.0f,
+                    "batch");
+            }
+        }
+
+        // decrement after queuing the merge; the root node relies on it
+        --state->_inFlight;
+        state->_batchDone.set();
+    }
+
+    // Hands the pending placemarks to a builder job
+    void flush(std::shared_ptr<StreamState> state, Batch& batch)
+    {
+        if (batch._count == 0u)
+            return;
+
+        // don't let the reader get too far ahead of the builders
+        while (state->_inFlight >= state->_maxInFlight && !state->_canceled)
+            state->_batchDone.waitAndReset();
+
+        batch._xml.append("</kml>");
+        std::shared_ptr<std::string> xml = std::make_shared<std::string>();
+        xml->swap(batch._xml);
+        osg::ref_ptr<osg::Group> target = batch._target;
+        batch._target = 0L;
+        batch._count = 0u;
+
+        ++state->_inFlight;
+
+        Job job(JobArena::get("oe.kml"));
+        job.setName("KML batch");
+        job.dispatch([state, xml, target](Cancelable*)
+            {
+                buildBatch(state, xml, target);
+            });
+    }
+
+    // Walks the document, attaching containers as they open and cutting
+    // their features into batches.
+    void readFeatures(std::shared_ptr<StreamState> state)
+    {
+        const char* p = state->_buffer.begin();
+        const char* end = state->_buffer.end();
+
+        const unsigned batchSize = std::max(1u, state->_options.streamingBatchSize().get());
+
+        std::vector<Frame> stack;
+        Batch batch;
+        Tag tag;
+
+        while (!state->_canceled && nextTag(p, end, tag))
+        {
+            if (tag._type == Tag::CLOSE)
+            {
+                if (!stack.empty() && tag._name == stack.back()._name)
+                {
+                    attach(*state, stack.back());
+                    flush(state, batch);
+                    stack.pop_back();
+                }
+                continue;
+            }
+
+            if (stack.empty())
+            {
+                if (tag._name == "kml" && tag._type == Tag::OPEN)
+                {
+                    Frame root;
+                    root._name = tag._name;
+                    root._attached = true;
+                    stack.push_back(root);
+                }
+                continue;
+            }
+
+            if (isContainer(tag._name))
+            {
+                attach(*state, stack.back());
+                flush(state, batch);
+
+                Frame frame;
+                frame._name = tag._name;
+                frame._group = new osg::Group();
+                frame._parent = stack.back()._group;
+                frame._attached = false;
+
+                if (tag._type == Tag::EMPTY)
+                    attach(*state, frame);
+                else
+                    stack.push_back(frame);
+            }
+
+            else if (isFeature(tag._name))
+            {
+                Frame& frame = stack.back();
+                attach(*state, frame);
+
+                const char* begin = tag._begin;
+                const char* stop = endOfElement(p, end, tag);
+
+                if (batch._count == 0u)
+                {
+                    batch._target = frame._group;
+                    batch._xml = "<kml>";
+                }
+                batch._xml.append(begin, stop);
+
+                if (++batch._count >= batchSize)
+                    flush(state, batch);
+            }
+
+            else
+            {
+                // styles are already in the sheet; anything else belongs
+                // to the container itself.
+                const char* begin = tag._begin;
+                const char* stop = endOfElement(p, end, tag);
+
+                Frame& frame = stack.back();
+                if (!frame._attached &&
+                    tag._name != "style" &&
+                    tag._name != "stylemap" &&
+                    tag._name != "schema")
+                {
+                    frame._shell.append(begin, stop);
+                }
+            }
+        }
+
+        // close out anything a truncated document left open
+        while (!stack.empty())
+        {
+            attach(*state, stack.back());
+            flush(state, batch);
+            stack.pop_back();
+        }
+
+        state->_loaded = true;
+    }
+
+    // Sets up the context and the root node, and starts reading
+    osg::Node* startStream(
+        std::shared_ptr<StreamState> state,
+        MapNode*                     mapNode,
+        const KMLOptions&            options,
+        const osgDB::Options*        dbOptions)
+    {
+        URIContext context(dbOptions);
+
+        state->_options = options;
+
+        KMLContext& cx = state->_cx;
+        cx._mapNode  = mapNode;
+        cx._sheet    = new StyleSheet();
+        cx._options  = &state->_options;
+        cx._srs      = mapNode->getMapSRS()->getGeographicSRS();
+        cx._referrer = context.referrer();
+
+        // install a resource cache if there isn't one already; it lives as
+        // long as the state, which outlives every job that reads through it.
+        if ( !URIResultCache::from(dbOptions) )
+        {
+            osgDB::Options* newOptions = Registry::instance()->cloneOrCreateOptions(dbOptions);
+            state->_uriCache.apply( newOptions );
+            cx._dbOptions = newOptions;
+        }
+        else
+        {
+            cx._dbOptions = dbOptions;
+        }
+
+        osg::ref_ptr<KMLStreamNode> root = new KMLStreamNode(state);
+        root->setName( context.referrer() );
+
+        // Make sure the KML gets rendered after the terrain.
+        root->getOrCreateStateSet()->setRenderBinDetails(2, "RenderBin");
+
+        state->_root = root.get();
+
+        state->_merger.setTimeBudget( MERGE_BUDGET_MICROS );
+
+        // The reader waits on the builders, so it gets an arena of its own.
+        Job job(JobArena::get("oe.kml.reader"));
+        job.setName( "KML reader" );
+        job.dispatch([state](Cancelable*)
+            {
+                osg::Timer_t start = osg::Timer::instance()->tick();
+                readStyles(*state);
+                OE_INFO << LC << "  Styles took " << osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick()) << std::endl;
+
+                readFeatures(state);
+            });
+
+        return root.release();
+    }
+}
+
+//........................................................................
+
+KMLStreamReader::KMLStreamReader( MapNode* mapNode, const KMLOptions* options ) :
+_mapNode( mapNode )
+{
+    if ( options )
+        _options = *options;
+}
+
+osg::Node*
+KMLStreamReader::read( std::istream& in, const osgDB::Options* dbOptions )
+{
+    std::shared_ptr<StreamState> state = std::make_shared<StreamState>();
+    state->_start = osg::Timer::instance()->tick();
+    state->_buffer.read( in );
+    return startStream( state, _mapNode, _options, dbOptions );
+}
+
+osg::Node*
+KMLStreamReader::readFile( const std::string& filename, const osgDB::Options* dbOptions )
+{
+    std::shared_ptr<StreamState> state = std::make_shared<StreamState>();
+    state->_start = osg::Timer::instance()->tick();
+    if ( !state->_buffer.map(filename) )
+    {
+        OE_DEBUG << LC << "Cannot map \"" << filename << "\"; reading it instead" << std::endl;
+        std::ifstream in( filename.c_str(), std::ios::binary );
+        if ( !in.is_open() )
+        {
+            OE_WARN << LC << "Cannot open \"" << filename << "\"" << std::endl;
+            return 0L;
+        }
+        state->_buffer.read( in );
+    }
+    return startStream( state, _mapNode, _options, dbOptions );
+}
@@ -51,10 +51,10 @@ KML_Placemark::build( xml_node<>* node, KMLContext& cx )
 
 	xml_node<>* style = node->first_node("style", 0, false);
 	if ( style )
-	{	// process an "inline" style
+	{	// process an "inline" style. The scan pass already put it in the
+		// style sheet, so just parse it; placemarks may build in parallel.
 		KML_Style kmlStyle;
-		kmlStyle.scan(style, cx);
-		masterStyle = masterStyle.combineWith(cx._activeStyle);
+		masterStyle = masterStyle.combineWith(kmlStyle.parse(style, cx));
 	}
 
     // parse the geometry. the placemark must have geometry to be valid. The 
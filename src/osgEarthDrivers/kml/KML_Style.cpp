@@ -27,21 +27,22 @@ using namespace osgEarth_kml;
 void
 KML_Style::scan( xml_node<>* node, KMLContext& cx )
 {
-    Style style( getValue(node, "id") );
+    Style style = parse( node, cx );
+    cx._sheet->addStyle( style );
+    cx._activeStyle = style;
+}
 
+Style
+KML_Style::parse( xml_node<>* node, KMLContext& cx )
+{
+    Style style( getValue(node, "id") );
     KML_IconStyle icon;
     icon.scan( node->first_node("iconstyle", 0, false), style, cx );
-
     KML_LabelStyle label;
     label.scan( node->first_node("labelstyle", 0, false), style, cx );
-
     KML_LineStyle line;
     line.scan( node->first_node("linestyle", 0, false), style, cx );
-
     KML_PolyStyle poly;
     poly.scan( node->first_node("polystyle", 0, false), style, cx );
-
-    cx._sheet->addStyle( style );
-
-    cx._activeStyle = style;
+    return style;
 }
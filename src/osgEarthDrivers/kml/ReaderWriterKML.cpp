@@ -75,6 +75,22 @@ struct ReaderWriterKML : public osgDB::ReaderWriter
             // propagate the source URI along to the stream reader
             osg::ref_ptr<osgDB::Options> myOptions = Registry::instance()->cloneOrCreateOptions(dbOptions);
             URIContext(url).store( myOptions.get() );
+
+            // a streaming read of a local file maps it instead of reading it
+            const KML::KMLOptions* kmlOptions = dbOptions ?
+                static_cast<const KML::KMLOptions*>(dbOptions->getPluginData("osgEarth::KMLOptions")) : 0L;
+
+            if ( kmlOptions && kmlOptions->streaming() == true && !osgDB::containsServerAddress(url) && osgDB::fileExists(url) )
+            {
+                MapNode* mapNode = const_cast<MapNode*>(
+                    static_cast<const MapNode*>( dbOptions->getPluginData("osgEarth::MapNode")) );
+                if ( !mapNode )
+                    return ReadResult("Missing required MapNode option");
+
+                KMLReader reader( mapNode, kmlOptions );
+                return ReadResult( reader.readFile(url, myOptions.get()) );
+            }
+
             return readNode( URIStream(url), myOptions.get() );
         }
     }
@@ -23,12 +23,16 @@
 #include "GroundCoverLayer"
 #include "NoiseTextureFactory"
 #include <osgEarth/ImageUtils>
+#include <algorithm>
+#include <deque>
 
 using namespace osgEarth;
 using namespace osgEarth::Splat;
 
 #define LC "[GroundCoverFeatureGenerator] "
 
+#define EXPORT_ARENA_NAME "oe.gcexport"
+
 //...................................................................
 
 namespace
@@ -66,13 +70,14 @@ namespace
         float height;
         float sizeVariation;
         Config assetConfig;
+        std::vector<std::pair<std::string, std::string>> properties;
     };
 
     typedef std::vector<AssetLUTEntry> AssetLUTVector;
 
     typedef UnorderedMap<const LandCoverGroup*, AssetLUTVector> AssetLUT;
 
-    void buildLUT(const BiomeZone& zone, AssetLUT& lut)
+    void buildLUT(const BiomeZone& zone, const std::vector<std::string>& propNames, AssetLUT& lut)
     {
         for(std::vector<LandCoverGroup>::const_iterator b = zone.getLandCoverGroups().begin();
             b != zone.getLandCoverGroups().end();
@@ -92,6 +97,14 @@ namespace
                 entry.sizeVariation = i->options().sizeVariation().getOrUse(
                     group->options().sizeVariation().get());
 
+                // resolve the pass-thru properties once, not per instance
+                for (const auto& name : propNames)
+                {
+                    std::string value = entry.assetConfig.value(name);
+                    if (!value.empty())
+                        entry.properties.emplace_back(name, value);
+                }
+
                 for(int k=0; k<(int)i->options().selectionWeight().get(); ++k)
                 {
                     assets.push_back(entry);
@@ -145,7 +158,9 @@ namespace
 //...................................................................
 
 GroundCoverFeatureGenerator::GroundCoverFeatureGenerator() :
-    _status(Status::ConfigurationError)
+    _status(Status::ConfigurationError),
+    _concurrency(0u),
+    _patternsMutex(OE_MUTEX_NAME)
 {
     //nop
 }
@@ -183,6 +198,12 @@ GroundCoverFeatureGenerator::addBillboardPropertyName(const std::string& name)
     _propNames.push_back(name);
 }
 
+void
+GroundCoverFeatureGenerator::setConcurrency(unsigned value)
+{
+    _concurrency = value;
+}
+
 const Status&
 GroundCoverFeatureGenerator::getStatus() const
 {
@@ -272,6 +293,10 @@ GroundCoverFeatureGenerator::initialize()
     // create noise texture
     NoiseTextureFactory noise;
     _noiseTexture = noise.create(256u, 4u);
+    {
+        Threading::ScopedMutexLock lock(_patternsMutex);
+        _patterns.clear();
+    }
 
     // layers we're going to request
     if (_lclayer.valid()) 
@@ -288,6 +313,21 @@ GroundCoverFeatureGenerator::initialize()
 
 Status
 GroundCoverFeatureGenerator::getFeatures(const GeoExtent& extent, FeatureList& output) const
+{
+    return getFeatures(
+        extent,
+        [&output](const TileKey&, FeatureList& features)
+        {
+            output.insert(output.end(), features.begin(), features.end());
+            return true;
+        });
+}
+
+Status
+GroundCoverFeatureGenerator::getFeatures(
+    const GeoExtent& extent,
+    const Sink& sink,
+    ProgressCallback* progress) const
 {
     if (!_map.valid() || _map->getProfile()==NULL)
         return Status(Status::ConfigurationError, "No map, or profile not set");
@@ -302,18 +342,70 @@ GroundCoverFeatureGenerator::getFeatures(const GeoExtent& extent, FeatureList& o
     _map->getProfile()->getIntersectingTiles(extent, _gclayer->getLOD(), keys);
     if (keys.empty())
         return Status(Status::AssertionFailure, "No keys intersect extent");
-    
-    for(std::vector<TileKey>::const_iterator i = keys.begin();
-        i != keys.end();
-        ++i)
+
+    unsigned concurrency = _concurrency > 0u ? _concurrency : Threading::getConcurrency();
+
+    struct TileResult
     {
-        Status s = getFeatures(*i, output);
+        Status status;
+        FeatureList features;
+    };
+
+    // A private arena, so the concurrency applies to this call only.
+    std::shared_ptr<JobArena> arena = std::make_shared<JobArena>(EXPORT_ARENA_NAME, concurrency);
+
+    // Generate tiles in parallel, but keep only a small window of them in
+    // flight and hand them to the sink in key order. Each tile's output
+    // depends on nothing but the tile, so the results do not depend on
+    // the number of threads.
+    const unsigned window = std::max(concurrency * 2u, 1u);
+    std::deque<Future<TileResult>> pending;
+    unsigned next = 0u;
+    Status status = Status::NoError;
 
-        if (s.isError())
-            return s;
+    for (unsigned i = 0u; i < keys.size(); ++i)
+    {
+        for (; next < keys.size() && next < i + window; ++next)
+        {
+            TileKey key = keys[next];
+            Job job(arena.get());
+            job.setPriority(-(float)next); // earliest tile first
+            pending.push_back(job.dispatch<TileResult>(
+                [this, key](Cancelable*)
+                {
+                    TileResult result;
+                    result.status = getFeatures(key, result.features);
+                    return result;
+                }));
+        }
+
+        TileResult result = pending.front().get();
+        pending.pop_front();
+
+        if (result.status.isError())
+        {
+            status = result.status;
+            break;
+        }
+
+        if (!sink(keys[i], result.features))
+        {
+            status = Status(Status::GeneralError, "Stopped by the sink");
+            break;
+        }
+
+        if (progress && progress->reportProgress((double)(i + 1), (double)keys.size()))
+        {
+            status = Status(Status::GeneralError, "Canceled");
+            break;
+        }
     }
 
-    return Status::NoError;
+    // the jobs reference this object, so wait for any still running
+    for (auto& future : pending)
+        future.join();
+
+    return status;
 }
 
 const BiomeZone&
@@ -338,6 +430,63 @@ GroundCoverFeatureGenerator::selectZone(const GeoPoint& p) const
     return _gclayer->getZones()[0];
 }
 
+std::shared_ptr<const GroundCoverFeatureGenerator::InstancePattern>
+GroundCoverFeatureGenerator::getInstancePattern(unsigned numInstances) const
+{
+    Threading::ScopedMutexLock lock(_patternsMutex);
+
+    std::shared_ptr<const InstancePattern>& pattern = _patterns[numInstances];
+    if (pattern == nullptr)
+    {
+        // from here on out, we are mimicing the GroundCover.VS.glsl shader logic.
+        // The noise lookup and the jitter depend only on the instance's
+        // place in the tile, so sample them once for all tiles.
+        ImageUtils::PixelReader sampleNoise;
+        sampleNoise.setTexture(_noiseTexture.get());
+
+        int numInstancesX = numInstances;
+        int numInstancesY = numInstances;
+        unsigned totalNumInstances = numInstancesX * numInstancesY;
+
+        std::shared_ptr<InstancePattern> instances = std::make_shared<InstancePattern>(totalNumInstances);
+
+        osg::Vec2f offset, halfSpacing, tilec, shift;
+        osg::Vec4f noise(0,0,0,0);
+
+        halfSpacing.set(
+            0.5f / (float)numInstancesX,
+            0.5f / (float)numInstancesY);
+
+        for(unsigned instanceID = 0; instanceID < totalNumInstances; ++instanceID)
+        {
+            offset.set(
+                (float)(instanceID % numInstancesX),
+                (float)(instanceID / numInstancesY));
+
+            tilec.set(
+                halfSpacing.x() + offset.x() / (float)numInstancesX,
+                halfSpacing.y() + offset.y() / (float)numInstancesY);
+
+            sampleNoise(noise, tilec.x(), tilec.y());
+
+            shift.set(
+                fract(noise[NOISE_RANDOM]*1.5)*2.0f - 1.0f,
+                fract(noise[NOISE_RANDOM_2]*1.5)*2.0f - 1.0f);
+
+            tilec.x() += shift.x()*halfSpacing.x();
+            tilec.y() += shift.y()*halfSpacing.y();
+
+            Instance& instance = (*instances)[instanceID];
+            instance._tilec = tilec;
+            instance._noise = noise;
+        }
+
+        pattern = instances;
+    }
+
+    return pattern;
+}
+
 Status
 GroundCoverFeatureGenerator::getFeatures(const TileKey& key, FeatureList& output) const
 {
@@ -362,10 +511,6 @@ GroundCoverFeatureGenerator::getFeatures(const TileKey& key, FeatureList& output
 
     const BiomeZone& zone = selectZone(p);
 
-    // noise sampler:
-    ImageUtils::PixelReader sampleNoise;
-    sampleNoise.setTexture(_noiseTexture.get());
-
     // mask texture/matrix:
     osg::Texture* maskTex = NULL;
     osg::Matrix maskMat;
@@ -418,7 +563,7 @@ GroundCoverFeatureGenerator::getFeatures(const TileKey& key, FeatureList& output
     // TODO: we could do this in initialize(), but we want to leave the door open
     // for supporting multiple zones in the future -GW
     AssetLUT assetLUT;
-    buildLUT(zone, assetLUT);
+    buildLUT(zone, _propNames, assetLUT);
 
     // calculate instance count based on tile extents
     unsigned lod = _gclayer->getLOD();
@@ -431,45 +576,29 @@ GroundCoverFeatureGenerator::getFeatures(const TileKey& key, FeatureList& output
     unsigned vboTileSize = (unsigned)(tileWidth_m / spacing_m);
     if (vboTileSize & 0x01) vboTileSize += 1;
 
-    // from here on out, we are mimicing the GroundCover.VS.glsl shader logic.
-    int numInstancesX = vboTileSize;
-    int numInstancesY = vboTileSize;
-    unsigned totalNumInstances = numInstancesX * numInstancesY;
+    std::shared_ptr<const InstancePattern> pattern = getInstancePattern(vboTileSize);
 
-    osg::Vec2f offset, halfSpacing, tilec, shift;
-    osg::Vec4f noise(0,0,0,0);
+    const GeoExtent& keyExtent = key.getExtent();
 
-    for(unsigned instanceID = 0; instanceID < totalNumInstances; ++instanceID)
+    // Cull the pattern in stages, each one a single pass over one texture
+    // for the instances still standing: land cover and fill, then the
+    // mask, then elevation for the keepers only.
+    struct Candidate
     {
-        offset.set(
-            (float)(instanceID % numInstancesX),
-            (float)(instanceID / numInstancesY));
-
-        halfSpacing.set(
-            0.5f / (float)numInstancesX,
-            0.5f / (float)numInstancesY);
-
-        tilec.set(
-            halfSpacing.x() + offset.x() / (float)numInstancesX,
-            halfSpacing.y() + offset.y() / (float)numInstancesY);
-
-        sampleNoise(noise, tilec.x(), tilec.y());
-
-        shift.set(
-            fract(noise[NOISE_RANDOM]*1.5)*2.0f - 1.0f,
-            fract(noise[NOISE_RANDOM_2]*1.5)*2.0f - 1.0f);
-
-        tilec.x() += shift.x()*halfSpacing.x();
-        tilec.y() += shift.y()*halfSpacing.y();
+        const Instance* instance;
+        const LandCoverGroup* group;
+        float fill;
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve(pattern->size());
 
-        // check the land cover
+    for(const auto& instance : *pattern)
+    {
         const LandCoverGroup* group = NULL;
-        //const GroundCoverBiome* biome = NULL;
-        const LandCoverClass* lcclass = NULL;
         if (lcTex)
         {
-            sample(landCover, lcSampler, lcMat, tilec.x(), tilec.y());
-            lcclass = _lcdict->getClassByValue((int)landCover.r());
+            sample(landCover, lcSampler, lcMat, instance._tilec.x(), instance._tilec.y());
+            const LandCoverClass* lcclass = _lcdict->getClassByValue((int)landCover.r());
             if (lcclass == NULL)
                 continue;
             group = zone.getLandCoverGroup(lcclass);
@@ -477,53 +606,59 @@ GroundCoverFeatureGenerator::getFeatures(const TileKey& key, FeatureList& output
                 continue;
         }
 
-        // check the mask
-        if (maskTex)
-        {
-            sample(mask, maskSampler, maskMat, tilec.x(), tilec.y());
-            if (mask.r() > 0.0)
-                continue;
-        }
-
-        // check the fill
         float fill =
-            group->options().fill().isSet() ? group->options().fill().get() :
+            group && group->options().fill().isSet() ? group->options().fill().get() :
             zone.options().fill().get();
 
-        if (noise[NOISE_SMOOTH] > fill)
+        if (instance._noise[NOISE_SMOOTH] > fill)
             continue;
-        else
-            noise[NOISE_SMOOTH] /= fill;
 
-        // clamp
-        float z = 0.0;
-        if (elevTex)
+        Candidate c = { &instance, group, fill };
+        candidates.push_back(c);
+    }
+
+    if (maskTex)
+    {
+        std::size_t kept = 0u;
+        for (const auto& c : candidates)
         {
-            sample(elev, elevSampler, elevMat, tilec.x(), tilec.y());
-            //if (fabs(elev.r()) > 30000.0f)
-            //{
-            //    OE_WARN << "That's a problem.. elevation value is " << elev.r() << std::endl;
-            //    osg::Vec4f val;
-            //    sample(val, elevSampler, elevMat, tilec.x(), tilec.y());
-            //    OE_WARN << "val.r() = " << val.r() << std::endl;
-            //    
-            //}
+            sample(mask, maskSampler, maskMat, c.instance->_tilec.x(), c.instance->_tilec.y());
+            if (mask.r() <= 0.0)
+                candidates[kept++] = c;
+        }
+        candidates.resize(kept);
+    }
+
+    std::vector<float> heights(candidates.size(), 0.0f);
+    if (elevTex)
+    {
+        for (std::size_t i = 0; i < candidates.size(); ++i)
+        {
+            sample(elev, elevSampler, elevMat, candidates[i].instance->_tilec.x(), candidates[i].instance->_tilec.y());
             if (elev.r() != NO_DATA_VALUE)
-            {
-                z = elev.r();
-            }
+                heights[i] = elev.r();
         }
+    }
+
+    output.reserve(output.size() + candidates.size());
+
+    for (std::size_t i = 0; i < candidates.size(); ++i)
+    {
+        const osg::Vec2f& tilec = candidates[i].instance->_tilec;
+        osg::Vec4f noise = candidates[i].instance->_noise;
+        noise[NOISE_SMOOTH] /= candidates[i].fill;
+        const LandCoverGroup* group = candidates[i].group;
 
         // keeper
         Point* point = new Point();
 
         point->push_back(osg::Vec3d(
-            key.getExtent().xMin() + tilec.x()*key.getExtent().width(),
-            key.getExtent().yMin() + tilec.y()*key.getExtent().height(),
+            keyExtent.xMin() + tilec.x()*keyExtent.width(),
+            keyExtent.yMin() + tilec.y()*keyExtent.height(),
             0.0));
 
-        osg::ref_ptr<Feature> feature = new Feature(point, key.getExtent().getSRS());
-        feature->set("elevation", z);
+        osg::ref_ptr<Feature> feature = new Feature(point, keyExtent.getSRS());
+        feature->set("elevation", heights[i]);
 
         // Resolve the symbol so we can add attributes
         if (group)
@@ -538,15 +673,9 @@ GroundCoverFeatureGenerator::getFeatures(const TileKey& key, FeatureList& output
             feature->set("height", height);
 
             // Store any pass-thru properties
-            for(std::vector<std::string>::const_iterator i = _propNames.begin();
-                i != _propNames.end(); 
-                ++i)
+            for(const auto& prop : asset.properties)
             {
-                std::string value = asset.assetConfig.value(*i);
-                if (!value.empty())
-                {
-                    feature->set(*i, value);
-                }
+                feature->set(prop.first, prop.second);
             }
         }
 
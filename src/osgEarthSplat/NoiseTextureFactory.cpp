@@ -22,8 +22,16 @@
 #include <osgEarth/Random>
 #include <osgEarth/SimplexNoise>
 #include <osgEarth/Registry>
+#include <osgEarth/Cache>
+#include <osgEarth/Threading>
+#include <osgEarth/StringUtils>
 #include <osgEarth/Metrics>
 #include <osg/Texture2D>
+#include <osg/observer_ptr>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <tuple>
 
 using namespace osgEarth;
 using namespace osgEarth::Splat;
@@ -32,18 +40,197 @@ using namespace osgEarth::Util;
 
 #define LC "[NoiseTextureFactory] "
 
+#define NOISE_ARENA_NAME "oe.noise"
+#define NOISE_CACHE_BIN "oe.noise"
+
+// Bump this whenever the noise generation changes, so stale
+// images in the disk cache are not used.
+#define NOISE_VERSION 1
+
+namespace
+{
+    using ImageKey = std::tuple<unsigned, unsigned, unsigned>;
+
+    // Images created in this process and still in use. The registry only
+    // observes them; the gate serializes work on each key so that two
+    // layers asking for the same noise at once do not both generate it,
+    // while requests for other keys carry on.
+    struct ImageRegistry
+    {
+        ImageRegistry() : mutex(OE_MUTEX_NAME), gate(OE_MUTEX_NAME) { }
+        Threading::Mutex mutex;
+        Threading::Gate<std::string> gate;
+        std::map<ImageKey, osg::observer_ptr<osg::Image>> images;
+    };
+
+    ImageRegistry& getImageRegistry()
+    {
+        static ImageRegistry s_registry;
+        return s_registry;
+    }
+
+    std::string makeNoiseCacheKey(unsigned dim, unsigned chans, unsigned seed)
+    {
+        return Stringify()
+            << "noise_" << dim << "_" << chans << "_" << seed << "_v" << NOISE_VERSION;
+    }
+
+    void writeU32(std::string& out, unsigned value)
+    {
+        for (int i = 0; i < 4; ++i)
+            out.push_back((char)((value >> (8 * i)) & 0xff));
+    }
+
+    unsigned readU32(const std::string& in, unsigned offset)
+    {
+        unsigned value = 0u;
+        for (int i = 0; i < 4; ++i)
+            value |= (unsigned)(unsigned char)in[offset + i] << (8 * i);
+        return value;
+    }
+
+    const char NOISE_MAGIC[4] = { 'O', 'E', 'N', 'Z' };
+    const unsigned NOISE_HEADER_SIZE = 16u;
+
+    // Disk record: magic, version, dim, channels, then the top level texels.
+    // Mipmaps are rebuilt on load; that is quick compared to the noise.
+    std::string encodeImage(const osg::Image* image, unsigned dim, unsigned chans)
+    {
+        unsigned bytes = image->getImageSizeInBytes();
+        std::string out;
+        out.reserve(NOISE_HEADER_SIZE + bytes);
+        out.append(NOISE_MAGIC, 4);
+        writeU32(out, NOISE_VERSION);
+        writeU32(out, dim);
+        writeU32(out, chans);
+        out.append((const char*)image->data(), bytes);
+        return out;
+    }
+
+    osg::Image* allocateImage(unsigned dim, unsigned chans)
+    {
+        GLenum type = chans >= 2u ? GL_RGBA : GL_RED;
+        GLenum textureFormat = chans >= 2u ? GL_RGBA8 : GL_R8;
+
+        osg::Image* image = new osg::Image();
+        image->allocateImage(dim, dim, 1, type, GL_UNSIGNED_BYTE);
+        image->setInternalTextureFormat(textureFormat);
+        return image;
+    }
+
+    osg::Image* decodeImage(const std::string& in, unsigned dim, unsigned chans)
+    {
+        if (in.size() < NOISE_HEADER_SIZE ||
+            in.compare(0, 4, NOISE_MAGIC, 4) != 0 ||
+            readU32(in, 4) != NOISE_VERSION ||
+            readU32(in, 8) != dim ||
+            readU32(in, 12) != chans)
+        {
+            return nullptr;
+        }
+
+        osg::ref_ptr<osg::Image> image = allocateImage(dim, chans);
+        if (in.size() != NOISE_HEADER_SIZE + image->getImageSizeInBytes())
+            return nullptr;
+
+        ::memcpy(image->data(), in.data() + NOISE_HEADER_SIZE, image->getImageSizeInBytes());
+        ImageUtils::mipmapImageInPlace(image.get());
+        return image.release();
+    }
+
+    CacheBin* getNoiseCacheBin(bool write)
+    {
+        const optional<CachePolicy>& policy = Registry::instance()->overrideCachePolicy();
+        if (policy.isSet() && !(write ? policy->isCacheWriteable() : policy->isCacheReadable()))
+            return nullptr;
+
+        Cache* cache = Registry::instance()->getDefaultCache();
+        if (cache == nullptr || cache->getStatus().isError())
+            return nullptr;
+
+        CacheBin* bin = cache->getBin(NOISE_CACHE_BIN);
+        return bin ? bin : cache->addBin(NOISE_CACHE_BIN);
+    }
+}
+
 osg::Texture*
-NoiseTextureFactory::create(unsigned dim, unsigned chans) const
+NoiseTextureFactory::create(unsigned dim, unsigned chans, unsigned seed) const
+{
+    OE_PROFILING_ZONE;
+    chans = osg::clampBetween(chans, 1u, 4u);
+
+    ImageRegistry& registry = getImageRegistry();
+    ImageKey imageKey(dim, chans, seed);
+    std::string cacheKey = makeNoiseCacheKey(dim, chans, seed);
+
+    Threading::ScopedGate<std::string> gate(registry.gate, cacheKey);
+
+    osg::ref_ptr<osg::Image> image;
+    {
+        Threading::ScopedMutexLock lock(registry.mutex);
+        auto i = registry.images.find(imageKey);
+        if (i != registry.images.end())
+            i->second.lock(image);
+    }
+
+    if (!image.valid())
+    {
+        CacheBin* bin = getNoiseCacheBin(false);
+        if (bin)
+        {
+            ReadResult r = bin->readString(cacheKey, nullptr);
+            if (r.succeeded())
+            {
+                image = decodeImage(r.getString(), dim, chans);
+            }
+        }
+
+        if (!image.valid())
+        {
+            image = createImage(dim, chans, seed);
+
+            bin = getNoiseCacheBin(true);
+            if (bin)
+            {
+                osg::ref_ptr<StringObject> record = new StringObject();
+                record->setString(encodeImage(image.get(), dim, chans));
+                bin->write(cacheKey, record.get(), nullptr);
+            }
+        }
+
+        Threading::ScopedMutexLock lock(registry.mutex);
+
+        // drop the entries for images nobody uses any more
+        for (auto i = registry.images.begin(); i != registry.images.end(); )
+        {
+            if (!i->second.valid())
+                i = registry.images.erase(i);
+            else
+                ++i;
+        }
+
+        registry.images[imageKey] = image.get();
+    }
+
+    // make a texture:
+    osg::Texture2D* tex = new osg::Texture2D( image.get() );
+    tex->setWrap(tex->WRAP_S, tex->REPEAT);
+    tex->setWrap(tex->WRAP_T, tex->REPEAT);
+    tex->setFilter(tex->MIN_FILTER, tex->LINEAR_MIPMAP_LINEAR);
+    tex->setFilter(tex->MAG_FILTER, tex->LINEAR);
+    tex->setMaxAnisotropy( 1.0f );
+    tex->setUnRefImageDataAfterApply(Registry::instance()->unRefImageDataAfterApply().get());
+
+    return tex;
+}
+
+osg::Image*
+NoiseTextureFactory::createImage(unsigned dim, unsigned chans, unsigned seed) const
 {
     OE_PROFILING_ZONE;
     chans = osg::clampBetween(chans, 1u, 4u);
 
-    GLenum type = chans >= 2u ? GL_RGBA : GL_RED;
-    GLenum textureFormat = chans >= 2u ? GL_RGBA8 : GL_R8;
-    
-    osg::Image* image = new osg::Image();
-    image->allocateImage(dim, dim, 1, type, GL_UNSIGNED_BYTE);
-    image->setInternalTextureFormat(textureFormat);
+    osg::Image* image = allocateImage(dim, chans);
 
     // 0 = SMOOTH
     // 1 = NOISE
@@ -53,10 +240,33 @@ NoiseTextureFactory::create(unsigned dim, unsigned chans) const
     const float P[4] = { 0.8f,  1.0f,  0.9f, 0.9f };
     const float L[4] = { 2.2f,  1.0f,  1.0f, 4.0f };
 
-    Random random(0, Random::METHOD_FAST);
-    
+    // The seed shifts the (repeating) simplex domain, so every seed
+    // still tiles seamlessly. Seed 0 is unshifted.
+    double seedS = fmod((double)seed * 0.6180339887, 1.0);
+    double seedT = fmod((double)seed * 0.7548776662, 1.0);
+
+    std::vector<std::vector<float>> values(chans, std::vector<float>(dim*dim));
+
+    // Split the rows into bands and generate them in parallel.
+    unsigned concurrency = Threading::getConcurrency();
+    unsigned bandSize = std::max(dim / (concurrency * 4u), 1u);
+    unsigned numBands = (dim + bandSize - 1u) / bandSize;
+
+    std::vector<float> bandMin(numBands * chans, 10.0f);
+    std::vector<float> bandMax(numBands * chans, -10.0f);
+
+    JobArena* arena = JobArena::get(NOISE_ARENA_NAME);
+    arena->setConcurrency(concurrency);
+
+    JobGroup noiseGroup;
+    Job noiseJob(arena, &noiseGroup);
+
     for(unsigned k=0; k<chans; ++k)
     {
+        // channels 1 and 2 are white noise; see below.
+        if (k == 1 || k == 2)
+            continue;
+
         // Configure the noise function:
         Util::SimplexNoise noise;
         noise.setNormalize( true );
@@ -66,65 +276,76 @@ NoiseTextureFactory::create(unsigned dim, unsigned chans) const
         noise.setLacunarity( L[k] );
         noise.setOctaves( 8 );
 
-        float nmin = 10.0f;
-        float nmax = -10.0f;
-
-        // write repeating noise to the image:
-        ImageUtils::PixelReader read ( image );
-        ImageUtils::PixelWriter write( image );
-        osg::Vec4f v;
-
-        for(int t=0; t<(int)dim; ++t)
+        for (unsigned band = 0; band < numBands; ++band)
         {
-            double rt = (double)t/(double)dim;
-            for(int s=0; s<(int)dim; ++s)
-            {
-                double rs = (double)s/(double)dim;
-                read(v, s, t);
-                double n;
+            float* out = values[k].data();
+            float* nmin = &bandMin[band*chans + k];
+            float* nmax = &bandMax[band*chans + k];
 
-                if ( k == 1 || k == 2 )
-                {
-                    n = (float)random.next();
-                }
-                else
+            noiseJob.dispatch([=](Cancelable*)
+            {
+                unsigned tEnd = std::min((band + 1u) * bandSize, dim);
+                for(unsigned t = band * bandSize; t < tEnd; ++t)
                 {
-                    n = noise.getTiledValue(rs, rt);
-                    n = osg::clampBetween(n, 0.0, 1.0);
+                    double rt = (double)t/(double)dim + seedT;
+                    for(unsigned s=0; s<dim; ++s)
+                    {
+                        double rs = (double)s/(double)dim + seedS;
+                        float n = (float)osg::clampBetween(noise.getTiledValue(rs, rt), 0.0, 1.0);
+                        if ( n < *nmin ) *nmin = n;
+                        if ( n > *nmax ) *nmax = n;
+                        out[t*dim + s] = n;
+                    }
                 }
+            });
+        }
+    }
 
-                if ( n < nmin ) nmin = n;
-                if ( n > nmax ) nmax = n;
-                
-                v[k] = n;
-                write(v, s, t);
-            }
+    // White noise is cheap, and generating it in one sequence keeps
+    // it identical from run to run.
+    Random random(seed, Random::METHOD_FAST);
+    for(unsigned k=1; k<=2 && k<chans; ++k)
+    {
+        float* out = values[k].data();
+        for(unsigned i=0; i<dim*dim; ++i)
+            out[i] = (float)random.next();
+    }
+
+    noiseGroup.join();
+
+    // histogram stretch to [0..1] for simplex noise
+    for(unsigned k=0; k<chans; ++k)
+    {
+        if (k == 1 || k == 2)
+            continue;
+
+        float nmin = 10.0f, nmax = -10.0f;
+        for(unsigned band = 0; band < numBands; ++band)
+        {
+            nmin = std::min(nmin, bandMin[band*chans + k]);
+            nmax = std::max(nmax, bandMax[band*chans + k]);
         }
-   
-        // histogram stretch to [0..1] for simplex noise
-        if ( k != 1 && k != 2 )
+
+        float range = nmax > nmin ? nmax - nmin : 1.0f;
+        for(auto& v : values[k])
+            v = osg::clampBetween((v-nmin)/range, 0.0f, 1.0f);
+    }
+
+    // write the noise to the image:
+    ImageUtils::PixelWriter write( image );
+    osg::Vec4f v(0,0,0,0);
+    for(unsigned t=0; t<dim; ++t)
+    {
+        for(unsigned s=0; s<dim; ++s)
         {
-            for(int x=0; x<(int)(dim*dim); ++x)
-            {
-                int s = x%int(dim), t = x/(int)dim;
-                read(v, s, t);
-                v[k] = osg::clampBetween((v[k]-nmin)/(nmax-nmin), 0.0f, 1.0f);
-                write(v, s, t);
-            }
+            for(unsigned k=0; k<chans; ++k)
+                v[k] = values[k][t*dim + s];
+            write(v, s, t);
         }
-    }    
-    
+    }
+
     // create mipmaps
     ImageUtils::mipmapImageInPlace(image);
 
-    // make a texture:
-    osg::Texture2D* tex = new osg::Texture2D( image );
-    tex->setWrap(tex->WRAP_S, tex->REPEAT);
-    tex->setWrap(tex->WRAP_T, tex->REPEAT);
-    tex->setFilter(tex->MIN_FILTER, tex->LINEAR_MIPMAP_LINEAR);
-    tex->setFilter(tex->MAG_FILTER, tex->LINEAR);
-    tex->setMaxAnisotropy( 1.0f );
-    tex->setUnRefImageDataAfterApply(Registry::instance()->unRefImageDataAfterApply().get());
-
-    return tex;
+    return image;
 }
@@ -0,0 +1,91 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+#include <osgEarth/Config>
+
+using namespace osgEarth;
+
+TEST_CASE("Config binary encoding")
+{
+    Config map("map");
+    map.set("name", "world");
+    map.set("version", 2);
+
+    Config layer("GDALImage");
+    layer.set("name", "imagery");
+    layer.set("url", "world.tif");
+    map.add(layer);
+    map.add("GDALImage", Config("name", "more imagery"));
+    map.mutable_child("GDALImage")->mutable_child("url")->setIsLocation(true);
+
+    Config include("options");
+    include.set("lighting", true);
+    include.setExternalRef("options.xml");
+    include.setReferrer("http://example.com/includes/options.xml");
+    map.add(include);
+
+    std::string data = map.toBinary();
+    REQUIRE(Config::isBinary(data.data(), data.size()));
+
+    SECTION("Round trips")
+    {
+        Config result;
+        REQUIRE(result.fromBinary(data.data(), data.size(), "http://example.com/maps/world.earth"));
+
+        REQUIRE(result.key() == "map");
+        REQUIRE(result.value("name") == "world");
+        REQUIRE(result.child("version").isNumber());
+        REQUIRE(result.children("GDALImage").size() == 2u);
+        REQUIRE(result.child("GDALImage").value("url") == "world.tif");
+        REQUIRE(result.child("GDALImage").child("url").isLocation());
+        REQUIRE(result.child("options").externalRef() == "options.xml");
+        REQUIRE(result.toJSON() == map.toJSON());
+    }
+
+    SECTION("Resolves referrers against the load location")
+    {
+        Config result;
+        REQUIRE(result.fromBinary(data.data(), data.size(), "http://example.com/maps/world.earth"));
+
+        REQUIRE(result.referrer() == "http://example.com/maps/world.earth");
+        REQUIRE(result.child("GDALImage").child("url").referrer() == "http://example.com/maps/world.earth");
+        REQUIRE(result.child("options").referrer() == "http://example.com/includes/options.xml");
+        REQUIRE(result.child("options").child("lighting").referrer() == "http://example.com/includes/options.xml");
+    }
+
+    SECTION("Rejects damaged data")
+    {
+        Config result;
+        REQUIRE_FALSE(result.fromBinary(data.data(), data.size() / 2));
+        REQUIRE_FALSE(result.fromBinary("<map/>", 6));
+
+        // make the root its own first child (values are little-endian)
+        std::string cyclic = data;
+        unsigned numStrings = 0u;
+        for (int i = 0; i < 4; ++i)
+            numStrings |= (unsigned)(unsigned char)cyclic[8 + i] << (8 * i);
+        for (int i = 0; i < 4; ++i)
+            cyclic[16 + 4 * (numStrings + 1) + 16 + i] = 0;
+        REQUIRE_FALSE(result.fromBinary(cyclic.data(), cyclic.size()));
+    }
+}
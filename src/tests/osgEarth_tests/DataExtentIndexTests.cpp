@@ -0,0 +1,150 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+#include <osgEarth/DataExtentIndex>
+#include <osgEarth/Profile>
+#include <random>
+
+using namespace osgEarth;
+
+namespace
+{
+    // The linear scan TileLayer::getBestAvailableTileKey used to do
+    int linearBestLevel(const DataExtentList& de, const TileKey& key, unsigned localLOD)
+    {
+        bool intersects = false;
+        unsigned highestLOD = 0;
+
+        for (auto& e : de)
+        {
+            if (key.getExtent().intersects(e))
+            {
+                if (!e.minLevel().isSet() || localLOD >= e.minLevel().get())
+                {
+                    intersects = true;
+                    if (!e.maxLevel().isSet() || localLOD <= e.maxLevel().get())
+                        return localLOD;
+                    else if (e.maxLevel().get() > highestLOD)
+                        highestLOD = e.maxLevel().get();
+                }
+            }
+        }
+        return intersects ? (int)highestLOD : -1;
+    }
+}
+
+TEST_CASE("DataExtentIndex")
+{
+    osg::ref_ptr<const Profile> geodetic = Profile::create("global-geodetic");
+    osg::ref_ptr<const Profile> mercator = Profile::create("spherical-mercator");
+    const SpatialReference* wgs84 = geodetic->getSRS();
+
+    SECTION("Finds the best level")
+    {
+        DataExtentList de;
+        de.push_back(DataExtent(GeoExtent(wgs84, -180, -90, 180, 90), 0u, 5u));
+        de.push_back(DataExtent(GeoExtent(wgs84, 10, 10, 20, 20), 3u, 12u));
+        de.push_back(DataExtent(GeoExtent(wgs84, 170, -10, -170, 10), 0u));
+
+        DataExtentIndex index(de);
+        REQUIRE(index.size() == 3u);
+
+        TileKey inside = geodetic->createTileKey(15.0, 15.0, 10);
+        TileKey outside = geodetic->createTileKey(-100.0, 45.0, 10);
+        TileKey wrapped = geodetic->createTileKey(-175.0, 0.0, 14);
+
+        REQUIRE(index.getBestAvailableLevel(inside, 10) == 10);
+        REQUIRE(index.getBestAvailableLevel(inside, 14) == 12);
+        REQUIRE(index.getBestAvailableLevel(outside, 10) == 5);
+        REQUIRE(index.getBestAvailableLevel(wrapped, 14) == 14);
+    }
+
+    SECTION("Rejects keys outside the extents")
+    {
+        DataExtentList de;
+        de.push_back(DataExtent(GeoExtent(wgs84, 10, 10, 20, 20), 3u, 12u));
+
+        DataExtentIndex index(de);
+        REQUIRE(index.getBestAvailableLevel(geodetic->createTileKey(-100.0, 45.0, 8), 8) == -1);
+
+        // the extent starts at level 3, so nothing is available above that
+        REQUIRE(index.getBestAvailableLevel(geodetic->createTileKey(15.0, 15.0, 2), 2) == -1);
+    }
+
+    SECTION("Matches a linear scan")
+    {
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> lon(-180.0, 180.0), lat(-85.0, 85.0), size(0.01, 40.0);
+        std::uniform_int_distribution<unsigned> level(0u, 16u), choice(0u, 9u);
+
+        DataExtentList de;
+        for (unsigned i = 0; i < 500; ++i)
+        {
+            double x = lon(gen), y = lat(gen), w = size(gen), h = size(gen);
+            GeoExtent extent(wgs84, x, y, x + w, osg::minimum(y + h, 90.0));
+
+            // some in another SRS, to exercise the geographic comparison
+            if (choice(gen) == 0u)
+            {
+                extent = GeoExtent(mercator->getSRS(),
+                    x * 1e5, y * 1e5, osg::minimum((x + w) * 1e5, 2e7), osg::minimum((y + h) * 1e5, 2e7));
+            }
+
+            unsigned minLevel = level(gen), maxLevel = level(gen);
+            unsigned c = choice(gen);
+            if (c == 0u)
+                de.push_back(DataExtent(extent));
+            else if (c == 1u)
+                de.push_back(DataExtent(extent, minLevel));
+            else
+                de.push_back(DataExtent(extent, osg::minimum(minLevel, maxLevel), osg::maximum(minLevel, maxLevel)));
+        }
+
+        DataExtentIndex index(de);
+
+        for (unsigned i = 0; i < 2000; ++i)
+        {
+            unsigned lod = level(gen) + 1u;
+            const Profile* profile = (i % 4 == 0) ? mercator.get() : geodetic.get();
+            double scale = profile->getSRS()->isGeographic() ? 1.0 : 1e5;
+            TileKey key = profile->createTileKey(lon(gen) * scale, lat(gen) * 0.9 * scale, lod);
+            REQUIRE(key.valid());
+
+            unsigned localLOD = geodetic->getEquivalentLOD(profile, lod);
+            REQUIRE(index.getBestAvailableLevel(key, localLOD) == linearBestLevel(de, key, localLOD));
+        }
+    }
+
+    SECTION("Caches answers")
+    {
+        DataExtentList de;
+        de.push_back(DataExtent(GeoExtent(wgs84, 10, 10, 20, 20), 3u, 12u));
+
+        DataExtentIndex index(de);
+        index.setCacheSize(16u);
+
+        TileKey key = geodetic->createTileKey(15.0, 15.0, 14);
+        REQUIRE(index.getBestAvailableLevel(key, 14) == 12);
+        REQUIRE(index.getBestAvailableLevel(key, 14) == 12);
+    }
+}
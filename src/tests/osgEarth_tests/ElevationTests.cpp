@@ -0,0 +1,225 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/Elevation>
+#include <osgEarth/ElevationLayer>
+#include <osgEarth/HeightFieldUtils>
+#include <osgEarth/Map>
+#include <osgEarth/Profile>
+#include <osgEarth/GeoData>
+#include <osg/Shape>
+#include <osg/Texture2D>
+#include <cmath>
+
+using namespace osgEarth;
+
+namespace
+{
+    ElevationTexture* makeTexture(const TileKey& key, unsigned size, float range, bool uniform)
+    {
+        osg::ref_ptr<osg::HeightField> hf = new osg::HeightField();
+        hf->allocate(size, size);
+        float* resolutions = new float[size*size];
+        for (unsigned row = 0; row < size; ++row)
+        {
+            for (unsigned col = 0; col < size; ++col)
+            {
+                hf->setHeight(col, row, -50.0f + range * std::sin(0.1f*(float)(col*row)));
+                resolutions[row*size + col] = uniform ? 30.0f : (float)(col + 1);
+            }
+        }
+        hf->setHeight(3, 4, NO_DATA_VALUE);
+
+        return new ElevationTexture(key, GeoHeightField(hf.get(), key.getExtent()), resolutions);
+    }
+
+    // Rolling terrain from a non-square grid, steep enough that the
+    // normals lean well away from vertical.
+    class WaveElevationLayer : public ElevationLayer
+    {
+    public:
+        META_Layer(osgEarth, WaveElevationLayer, ElevationLayer::Options, ElevationLayer, wave_elevation);
+
+    protected:
+        Status openImplementation() override
+        {
+            Status parent = ElevationLayer::openImplementation();
+            if (parent.isError())
+                return parent;
+
+            setProfile(Profile::create("global-geodetic"));
+            return STATUS_OK;
+        }
+
+        GeoHeightField createHeightFieldImplementation(const TileKey& key, ProgressCallback* progress) const override
+        {
+            const unsigned cols = 97, rows = 49;
+            const GeoExtent& ex = key.getExtent();
+
+            osg::ref_ptr<osg::HeightField> hf = HeightFieldUtils::createReferenceHeightField(ex, cols, rows, 0u);
+            for (unsigned row = 0; row < rows; ++row)
+            {
+                double y = ex.yMin() + ex.height()*(double)row / (double)(rows - 1);
+                for (unsigned col = 0; col < cols; ++col)
+                {
+                    double x = ex.xMin() + ex.width()*(double)col / (double)(cols - 1);
+                    hf->setHeight(col, row, (float)(500.0 * sin(x*200.0) * cos(y*150.0)));
+                }
+            }
+            return GeoHeightField(hf.get(), ex);
+        }
+    };
+
+    // Unpacks an octahedral-encoded normal (see packNormal)
+    osg::Vec3 unpackNormal(const GLubyte* rg)
+    {
+        osg::Vec3 n(
+            2.0f*(float)rg[0] / 255.0f - 1.0f,
+            2.0f*(float)rg[1] / 255.0f - 1.0f,
+            0.0f);
+        n.z() = 1.0f - fabs(n.x()) - fabs(n.y());
+        if (n.z() < 0.0f)
+        {
+            float x = n.x();
+            n.x() = (1.0f - fabs(n.y())) * (x >= 0.0f ? 1.0f : -1.0f);
+            n.y() = (1.0f - fabs(x)) * (n.y() >= 0.0f ? 1.0f : -1.0f);
+        }
+        n.normalize();
+        return n;
+    }
+}
+
+TEST_CASE("CompactElevation")
+{
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+    TileKey key(8, 100, 50, profile.get());
+    const unsigned size = 33;
+
+    SECTION("Uniform resolution")
+    {
+        osg::ref_ptr<ElevationTexture> tex = makeTexture(key, size, 1000.0f, true);
+        REQUIRE(tex->getResolutions() == nullptr);
+        REQUIRE(tex->getResolution(7, 9) == 30.0f);
+    }
+
+    SECTION("Round trip within tolerance")
+    {
+        osg::ref_ptr<ElevationTexture> tex = makeTexture(key, size, 1000.0f, false);
+        REQUIRE(tex->getResolutions() != nullptr);
+
+        osg::ref_ptr<CompactElevation> compact = CompactElevation::create(tex.get(), 0.05f);
+        REQUIRE(compact.valid());
+        REQUIRE(compact->getMaxError() <= 0.05f);
+        REQUIRE(compact->getTileKey() == key);
+
+        osg::ref_ptr<ElevationTexture> decoded = compact->createTexture();
+        const osg::HeightField* in = tex->getHeightField();
+        const osg::HeightField* out = decoded->getHeightField();
+        REQUIRE(out->getNumColumns() == size);
+        REQUIRE(out->getNumRows() == size);
+
+        for (unsigned row = 0; row < size; ++row)
+        {
+            for (unsigned col = 0; col < size; ++col)
+            {
+                if (in->getHeight(col, row) == NO_DATA_VALUE)
+                    REQUIRE(out->getHeight(col, row) == NO_DATA_VALUE);
+                else
+                    REQUIRE(std::fabs(out->getHeight(col, row) - in->getHeight(col, row)) <= 0.05f);
+
+                REQUIRE(decoded->getResolution(col, row) == tex->getResolution(col, row));
+            }
+        }
+
+        REQUIRE(compact->getSizeInBytes() < size*size*2*sizeof(float));
+    }
+
+    SECTION("Extrema and revision")
+    {
+        osg::ref_ptr<ElevationTexture> a = makeTexture(key, size, 1000.0f, true);
+        osg::ref_ptr<ElevationTexture> b = makeTexture(key, size, 1000.0f, true);
+        osg::ref_ptr<ElevationTexture> c = makeTexture(key, size, 999.0f, true);
+
+        // NO_DATA does not count toward the extrema
+        REQUIRE(a->getExtrema().x() >= -1050.0f);
+        REQUIRE(a->getExtrema().y() <= 950.0f);
+        REQUIRE(a->getExtrema().x() < a->getExtrema().y());
+
+        REQUIRE(a->getHeightFieldRevision() == b->getHeightFieldRevision());
+        REQUIRE(a->getHeightFieldRevision() != c->getHeightFieldRevision());
+    }
+
+    SECTION("Tolerance too tight")
+    {
+        // 16 bits over a 20km range cannot hold 1cm
+        osg::ref_ptr<ElevationTexture> tex = makeTexture(key, size, 10000.0f, true);
+        REQUIRE(!CompactElevation::create(tex.get(), 0.01f));
+    }
+}
+
+TEST_CASE("NormalMapGenerator")
+{
+    osg::ref_ptr<Map> map = new Map();
+    osg::ref_ptr<WaveElevationLayer> layer = new WaveElevationLayer();
+    map->addLayer(layer.get());
+    REQUIRE(layer->getStatus().isOK());
+
+    // at 60 degrees north a cell is half as wide as it is tall, in meters
+    TileKey key(8, 100, 42, map->getProfile());
+
+    NormalMapGenerator gen;
+    osg::ref_ptr<osg::Texture2D> direct = gen.createNormalMap(key, map.get(), NULL, NULL);
+    osg::ref_ptr<osg::Texture2D> sampled = gen.createNormalMapBySampling(key, map.get(), NULL, NULL);
+    REQUIRE(direct.valid());
+    REQUIRE(sampled.valid());
+
+    const osg::Image* a = direct->getImage();
+    const osg::Image* b = sampled->getImage();
+    REQUIRE(a->s() == b->s());
+    REQUIRE(a->t() == b->t());
+
+    // Same normals everywhere, including the edges where the direct
+    // kernel has to reach into the neighboring tiles. The maps are RG
+    // only; neither carries curvature yet.
+    double sumError = 0.0;
+    float maxError = 0.0f;
+    unsigned leaning = 0u;
+    for (int t = 0; t < a->t(); ++t)
+    {
+        for (int s = 0; s < a->s(); ++s)
+        {
+            osg::Vec3 na = unpackNormal(a->data(s, t));
+            osg::Vec3 nb = unpackNormal(b->data(s, t));
+            float error = (na - nb).length();
+            sumError += error;
+            maxError = osg::maximum(maxError, error);
+            if (na.z() < 0.9f)
+                ++leaning;
+        }
+    }
+
+    REQUIRE(leaning > 0u);
+    REQUIRE(maxError < 0.05f);
+    REQUIRE(sumError / (double)(a->s()*a->t()) < 0.01);
+}
@@ -24,8 +24,21 @@
 
 #include <osgEarth/Feature>
 #include <osgEarth/GeometryUtils>
+#include <osgEarth/GeoJSONReader>
+#include <osgEarth/OGRFeatureSource>
+#include <osgEarth/PackedFeatureSource>
+#include <osgEarth/FeatureTileCache>
+#include <osgEarth/Profile>
+#include <osgEarth/FileUtils>
+#include <osgEarth/StringUtils>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cstdio>
+#include <cstring>
 
 using namespace osgEarth;
+using namespace osgEarth::Util;
 
 TEST_CASE("Feature::splitAcrossDateLine doesn't modify features that don't cross the dateline") {
     osg::ref_ptr< Feature > feature = new Feature(GeometryUtils::geometryFromWKT("POLYGON((-81 26, -40.5 45, -40.5 75.5, -81 60))"), osgEarth::SpatialReference::create("wgs84"));
@@ -109,3 +122,297 @@ TEST_CASE("Feature handles attributes correctly.") {
         REQUIRE(feature->getBool("bool") == false);
     }
 }
+
+TEST_CASE("GeoJSONReader") {
+    const std::string json =
+        "{\"type\":\"FeatureCollection\",\"features\":["
+        "{\"type\":\"Feature\",\"id\":7,"
+        "\"geometry\":{\"type\":\"Point\",\"coordinates\":[1.5,-20.0,3]},"
+        "\"properties\":{\"Name\":\"one\",\"value\":1,\"flag\":true}},"
+        "{\"type\":\"Feature\","
+        "\"properties\":{\"name\":\"two\",\"value\":2.5},"
+        "\"geometry\":{\"coordinates\":[[[0,0],[1,0],[1,1],[0,1],[0,0]],[[0.2,0.2],[0.2,0.4],[0.4,0.4],[0.2,0.2]]],\"type\":\"Polygon\"}}"
+        "]}";
+
+    GeoJSONReader reader;
+    FeatureList features;
+
+    SECTION("Reads geometry and attributes") {
+        REQUIRE(reader.read(json, features));
+        REQUIRE(features.size() == 2);
+
+        Feature* first = features.front().get();
+        REQUIRE(first->getFID() == 7);
+        REQUIRE(first->getGeometry()->getType() == Geometry::TYPE_POINT);
+        REQUIRE((*first->getGeometry())[0] == osg::Vec3d(1.5, -20.0, 3.0));
+        REQUIRE(first->getString("name") == "one");
+        REQUIRE(first->getBool("flag") == true);
+
+        Feature* second = features.back().get();
+        REQUIRE(second->getFID() == 1);
+        Polygon* poly = dynamic_cast<Polygon*>(second->getGeometry());
+        REQUIRE(poly != 0L);
+        REQUIRE(poly->size() == 4);
+        REQUIRE(poly->getHoles().size() == 1);
+        REQUIRE(second->isSet("flag") == false);
+    }
+
+    SECTION("Infers a schema across features") {
+        REQUIRE(reader.read(json, features));
+        REQUIRE(reader.getSchema().find("value")->second == ATTRTYPE_DOUBLE);
+        REQUIRE(reader.getSchema().find("name")->second == ATTRTYPE_STRING);
+        REQUIRE(features.front()->getAttrs().find("value")->second.first == ATTRTYPE_DOUBLE);
+        REQUIRE(features.front()->getDouble("value") == 1.0);
+    }
+
+    SECTION("Projects attributes") {
+        std::set<std::string> names;
+        names.insert("NAME");
+        reader.setAttributes(names);
+        REQUIRE(reader.read(json, features));
+        REQUIRE(features.front()->getAttrs().size() == 1);
+        REQUIRE(features.front()->getString("name") == "one");
+
+        features.clear();
+        reader.setGeometryOnly(true);
+        REQUIRE(reader.read(json, features));
+        REQUIRE(features.front()->getAttrs().empty());
+        REQUIRE(features.back()->getGeometry() != 0L);
+    }
+
+    SECTION("Rejects what it cannot read") {
+        REQUIRE_FALSE(reader.read("{\"type\":\"FeatureCollection\",\"features\":[{]}", features));
+        REQUIRE_FALSE(reader.read("{\"type\":\"Topology\",\"objects\":{}}", features));
+        REQUIRE(features.empty());
+    }
+}
+
+TEST_CASE("PackedFeatureSource") {
+    // 20x20 grid of points, one per integer coordinate
+    std::stringstream json;
+    json << "{\"type\":\"FeatureCollection\",\"features\":[";
+    for (int i = 0; i < 400; ++i)
+    {
+        json << (i > 0 ? "," : "")
+            << "{\"type\":\"Feature\",\"id\":" << (1000 + i)
+            << ",\"properties\":{\"name\":\"p" << i << "\",\"index\":" << i << "}"
+            << ",\"geometry\":{\"type\":\"Point\",\"coordinates\":[" << (i % 20) << "," << (i / 20) << "]}}";
+    }
+    json << "]}";
+
+    std::string inputFile = getTempName(getTempPath(), ".geojson");
+    std::string storeFile = getTempName(getTempPath(), ".oepf");
+    {
+        std::ofstream fout(inputFile.c_str(), std::ios::out | std::ios::binary);
+        fout << json.str();
+    }
+
+    osg::ref_ptr<OGRFeatureSource> input = new OGRFeatureSource();
+    input->setURL(inputFile);
+    input->setOGRDriver("GeoJSON");
+    REQUIRE(input->open().isOK());
+
+    osg::ref_ptr<PackedFeatureSource> packed = new PackedFeatureSource();
+    packed->setURL(storeFile);
+    packed->setFeatureSource(input.get());
+    REQUIRE(packed->open().isOK());
+    REQUIRE(packed->getFeatureCount() == 400);
+    REQUIRE(packed->getSchema().find("index")->second == ATTRTYPE_INT);
+
+    SECTION("Bounding box queries match the source") {
+        Query query;
+        query.bounds() = Bounds(4.5, 4.5, 8.5, 8.5);
+        FeatureList features;
+        osg::ref_ptr<FeatureCursor> cursor = packed->createFeatureCursor(query, 0L);
+        REQUIRE(cursor.valid());
+        cursor->fill(features);
+        REQUIRE(features.size() == 16);
+        for (FeatureList::const_iterator i = features.begin(); i != features.end(); ++i)
+        {
+            const osg::Vec3d& p = (*i->get()->getGeometry())[0];
+            int index = (int)i->get()->getInt("index");
+            REQUIRE(p.x() == (double)(index % 20));
+            REQUIRE(p.y() == (double)(index / 20));
+            REQUIRE(i->get()->getFID() == 1000 + index);
+            std::string name = Stringify() << "p" << index;
+            REQUIRE(i->get()->getString("name") == name);
+        }
+    }
+
+    SECTION("Features can be fetched by FID") {
+        osg::ref_ptr<Feature> feature = packed->getFeature(1042);
+        REQUIRE(feature.valid());
+        REQUIRE(feature->getInt("index") == 42);
+        REQUIRE(packed->getFeature(1) == 0L);
+    }
+
+    SECTION("Expression queries return nothing rather than everything") {
+        Query query;
+        query.expression() = "index < 10";
+        osg::ref_ptr<FeatureCursor> cursor = packed->createFeatureCursor(query, 0L);
+        REQUIRE_FALSE(cursor.valid());
+    }
+
+    SECTION("Damaged stores are rejected or skipped") {
+        std::string data;
+        {
+            std::ifstream fin(storeFile.c_str(), std::ios::in | std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+        }
+
+        std::string damagedFile = getTempName(getTempPath(), ".oepf");
+
+        // a truncated header fails at open
+        {
+            std::ofstream fout(damagedFile.c_str(), std::ios::out | std::ios::binary);
+            fout << data.substr(0, 100);
+        }
+        osg::ref_ptr<PackedFeatureSource> truncated = new PackedFeatureSource();
+        truncated->setURL(damagedFile);
+        REQUIRE(truncated->open().isError());
+        truncated = 0L;
+
+        // a bad node is only found, and skipped, when a query reaches it:
+        // point the first leaf past the last feature
+        std::uint64_t nodesOffset, badIndex = 400u;
+        ::memcpy(&nodesOffset, &data[120], 8);
+        ::memcpy(&data[(size_t)nodesOffset + 32u], &badIndex, 8);
+        {
+            std::ofstream fout(damagedFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            fout << data;
+        }
+
+        osg::ref_ptr<PackedFeatureSource> damaged = new PackedFeatureSource();
+        damaged->setURL(damagedFile);
+        REQUIRE(damaged->open().isOK());
+
+        Query query;
+        query.bounds() = Bounds(-1.0, -1.0, 20.0, 20.0);
+        FeatureList features;
+        osg::ref_ptr<FeatureCursor> cursor = damaged->createFeatureCursor(query, 0L);
+        REQUIRE(cursor.valid());
+        cursor->fill(features);
+        REQUIRE(features.size() == 399);
+
+        damaged->close();
+        damaged = 0L;
+        ::remove(damagedFile.c_str());
+    }
+
+    packed->close();
+    input->close();
+    ::remove(storeFile.c_str());
+    ::remove(inputFile.c_str());
+}
+
+TEST_CASE("FeatureTileCache") {
+    osg::ref_ptr<Polygon> poly = new Polygon();
+    poly->push_back(osg::Vec3d(0, 0, 0));
+    poly->push_back(osg::Vec3d(1, 0, 0));
+    poly->push_back(osg::Vec3d(1, 1, 5));
+    osg::ref_ptr<Ring> hole = new Ring();
+    hole->push_back(osg::Vec3d(0.2, 0.2, 0));
+    hole->push_back(osg::Vec3d(0.4, 0.2, 0));
+    hole->push_back(osg::Vec3d(0.4, 0.4, 0));
+    poly->getHoles().push_back(hole.get());
+
+    osg::ref_ptr<MultiGeometry> multi = new MultiGeometry();
+    multi->add(new Point());
+    multi->getComponents().back()->push_back(osg::Vec3d(-1, -2, -3));
+    multi->add(poly.get());
+
+    osg::ref_ptr<Feature> feature = new Feature(multi.get(), SpatialReference::get("wgs84"), Style(), 1234567890123LL);
+    feature->set("name", std::string("road"));
+    feature->set("lanes", 4);
+    feature->set("width", 7.5);
+    feature->set("paved", true);
+    feature->setNull("owner", ATTRTYPE_STRING);
+
+    FeatureList features;
+    features.push_back(feature.get());
+    features.push_back(new Feature(0L, SpatialReference::get("wgs84"), Style(), 7));
+
+    SECTION("Round-trips features through the binary encoding") {
+        std::string buf;
+        REQUIRE(FeatureTileCache::write(features, buf));
+
+        FeatureList output;
+        REQUIRE(FeatureTileCache::read(buf, 0L, output));
+        REQUIRE(output.size() == 2);
+
+        Feature* f = output.front().get();
+        REQUIRE(f->getFID() == 1234567890123LL);
+        REQUIRE(f->getString("name") == "road");
+        REQUIRE(f->getInt("lanes") == 4);
+        REQUIRE(f->getDouble("width") == 7.5);
+        REQUIRE(f->getBool("paved") == true);
+        REQUIRE(f->hasAttr("owner"));
+        REQUIRE(f->isSet("owner") == false);
+
+        MultiGeometry* g = dynamic_cast<MultiGeometry*>(f->getGeometry());
+        REQUIRE(g != 0L);
+        REQUIRE(g->getComponents().size() == 2);
+        REQUIRE((*g->getComponents()[0])[0] == osg::Vec3d(-1, -2, -3));
+        Polygon* p = dynamic_cast<Polygon*>(g->getComponents()[1].get());
+        REQUIRE(p != 0L);
+        REQUIRE(p->size() == 3);
+        REQUIRE(p->getHoles().size() == 1);
+        REQUIRE((*p)[2] == osg::Vec3d(1, 1, 5));
+
+        REQUIRE(output.back()->getFID() == 7);
+        REQUIRE(output.back()->getGeometry() == 0L);
+
+        // truncated or foreign buffers are rejected
+        output.clear();
+        REQUIRE_FALSE(FeatureTileCache::read(buf.substr(0, buf.size() - 1), 0L, output));
+        REQUIRE_FALSE(FeatureTileCache::read("not a feature tile", 0L, output));
+        REQUIRE(output.empty());
+    }
+
+    SECTION("Copies features and evicts the least recently used tiles") {
+        osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+        TileKey k0(1, 0, 0, profile.get()), k1(1, 1, 0, profile.get()), k2(1, 2, 0, profile.get());
+
+        std::size_t tileBytes = 0u;
+        for (FeatureList::const_iterator i = features.begin(); i != features.end(); ++i)
+            tileBytes += FeatureTileCache::getSizeInBytes(i->get());
+
+        // room for two tiles
+        osg::ref_ptr<FeatureTileCache> cache = new FeatureTileCache(tileBytes * 2u + 512u);
+        cache->put(k0, features);
+        cache->put(k1, features);
+
+        FeatureList output;
+        REQUIRE(cache->get(k0, output));
+        REQUIRE(output.size() == 2);
+        REQUIRE(output.front().get() != feature.get());
+        dynamic_cast<MultiGeometry*>(output.front()->getGeometry())->getComponents().clear();
+
+        cache->put(k2, features);
+        output.clear();
+        REQUIRE(cache->get(k0, output));
+        REQUIRE(dynamic_cast<MultiGeometry*>(output.front()->getGeometry())->getComponents().size() == 2);
+        REQUIRE_FALSE(cache->get(k1, output));
+        REQUIRE(cache->get(k2, output));
+        REQUIRE(cache->getSizeInBytes() <= cache->getMaxBytes());
+    }
+
+    SECTION("Drops the tiles a change touches") {
+        osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+        TileKey west(1, 0, 0, profile.get()), east(1, 2, 0, profile.get());
+
+        osg::ref_ptr<FeatureTileCache> cache = new FeatureTileCache(1024u * 1024u);
+        cache->put(west, features);
+        cache->put(east, features);
+
+        cache->remove(GeoExtent(profile->getSRS(), -140.0, 40.0, -130.0, 50.0));
+
+        FeatureList output;
+        REQUIRE_FALSE(cache->get(west, output));
+        REQUIRE(cache->get(east, output));
+
+        cache->remove(GeoExtent::INVALID);
+        REQUIRE_FALSE(cache->get(east, output));
+        REQUIRE(cache->getSizeInBytes() == 0u);
+    }
+}
@@ -0,0 +1,149 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ImageKernels>
+#include <osgEarth/ImageUtils>
+#include <cstdlib>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // odd width, to exercise the scalar tails of the SIMD loops
+    osg::Image* createTestImage(GLenum pixelFormat, unsigned s = 37, unsigned t = 9)
+    {
+        osg::Image* image = new osg::Image();
+        image->allocateImage(s, t, 1, pixelFormat, GL_UNSIGNED_BYTE);
+        std::srand(7);
+        for (unsigned i = 0; i < image->getTotalSizeInBytes(); ++i)
+            image->data()[i] = (unsigned char)(std::rand() & 0xFF);
+        return image;
+    }
+
+    // Largest per-channel difference in 8-bit units
+    float maxDifference(const osg::Image* a, const osg::Image* b)
+    {
+        ImageUtils::PixelReader readA(a), readB(b);
+        float diff = 0.0f;
+        for (int t = 0; t < a->t(); ++t)
+            for (int s = 0; s < a->s(); ++s)
+                for (int c = 0; c < 4; ++c)
+                    diff = osg::maximum(diff, std::abs(readA(s, t)[c] - readB(s, t)[c]) * 255.0f);
+        return diff;
+    }
+}
+
+TEST_CASE("ImageKernels")
+{
+    SECTION("Layouts")
+    {
+        osg::ref_ptr<osg::Image> rgba = createTestImage(GL_RGBA);
+        osg::ref_ptr<osg::Image> rgb = createTestImage(GL_RGB);
+        REQUIRE(ImageKernels::getLayout(rgba.get()) == ImageKernels::LAYOUT_RGBA8);
+        REQUIRE(ImageKernels::getLayout(rgb.get()) == ImageKernels::LAYOUT_RGB8);
+
+        osg::ref_ptr<osg::Image> rg = new osg::Image();
+        rg->allocateImage(4, 4, 1, GL_RG, GL_UNSIGNED_BYTE);
+        REQUIRE(ImageKernels::getLayout(rg.get()) == ImageKernels::LAYOUT_UNSUPPORTED);
+        REQUIRE(ImageKernels::premultiplyAlpha(rg.get()) == false);
+    }
+
+    SECTION("Premultiplied alpha matches the per-pixel path")
+    {
+        osg::ref_ptr<osg::Image> image = createTestImage(GL_RGBA);
+        osg::ref_ptr<osg::Image> expected = ImageUtils::cloneImage(image.get());
+
+        ImageUtils::PixelReader read(expected.get());
+        ImageUtils::PixelWriter write(expected.get());
+        for (int t = 0; t < expected->t(); ++t)
+        {
+            for (int s = 0; s < expected->s(); ++s)
+            {
+                osg::Vec4f c = read(s, t);
+                write(osg::Vec4f(c.r()*c.a(), c.g()*c.a(), c.b()*c.a(), c.a()), s, t);
+            }
+        }
+
+        REQUIRE(ImageKernels::premultiplyAlpha(image.get()));
+        REQUIRE(maxDifference(image.get(), expected.get()) <= 1.0f);
+    }
+
+    SECTION("RGB8 converts to RGBA8")
+    {
+        osg::ref_ptr<osg::Image> rgb = createTestImage(GL_RGB);
+        osg::ref_ptr<osg::Image> rgba = ImageUtils::convertToRGBA8(rgb.get());
+        REQUIRE(rgba.valid());
+        REQUIRE(maxDifference(rgb.get(), rgba.get()) == 0.0f);
+    }
+
+    SECTION("Empty image test")
+    {
+        osg::ref_ptr<osg::Image> image = ImageUtils::createEmptyImage(37, 9);
+        REQUIRE(ImageUtils::isEmptyImage(image.get(), 0.0f));
+
+        ImageUtils::PixelWriter write(image.get());
+        write(osg::Vec4f(1, 1, 1, 0.5f), 36, 8);
+        REQUIRE(ImageUtils::isEmptyImage(image.get(), 0.6f));
+        REQUIRE(ImageUtils::isEmptyImage(image.get(), 0.4f) == false);
+    }
+
+    SECTION("Resize matches the per-pixel path")
+    {
+        osg::ref_ptr<osg::Image> input = createTestImage(GL_RGBA);
+
+        // the generic path writes to an image of a different format
+        osg::ref_ptr<osg::Image> expected = new osg::Image();
+        expected->allocateImage(23, 17, 1, GL_RGB, GL_UNSIGNED_BYTE);
+        REQUIRE(ImageUtils::resizeImage(input.get(), 23, 17, expected, 0, true));
+
+        osg::ref_ptr<osg::Image> output;
+        REQUIRE(ImageUtils::resizeImage(input.get(), 23, 17, output, 0, true));
+        REQUIRE(ImageKernels::getLayout(output.get()) == ImageKernels::LAYOUT_RGBA8);
+
+        // compare color only
+        ImageUtils::PixelReader readA(output.get()), readB(expected.get());
+        float diff = 0.0f;
+        for (int t = 0; t < 17; ++t)
+            for (int s = 0; s < 23; ++s)
+                for (int c = 0; c < 3; ++c)
+                    diff = osg::maximum(diff, std::abs(readA(s, t)[c] - readB(s, t)[c]) * 255.0f);
+        REQUIRE(diff <= 1.0f);
+    }
+
+    SECTION("Mipmaps are box filtered")
+    {
+        osg::ref_ptr<osg::Image> input = createTestImage(GL_RGBA, 16, 8);
+        osg::ref_ptr<const osg::Image> output = ImageUtils::mipmapImage(input.get());
+        REQUIRE(output->getNumMipmapLevels() == 5);
+
+        const unsigned char* level0 = output->data();
+        const unsigned char* level1 = output->getMipmapData(1);
+        for (int c = 0; c < 4; ++c)
+        {
+            int sum = level0[c] + level0[4 + c] + level0[16 * 4 + c] + level0[16 * 4 + 4 + c];
+            REQUIRE(level1[c] == (sum + 2) / 4);
+        }
+    }
+}
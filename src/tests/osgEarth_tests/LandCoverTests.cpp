@@ -0,0 +1,138 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/LandCover>
+#include <osgEarth/ImageUtils>
+#include <cstdlib>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // The per-pixel transcode LandCoverLayer used before the code table.
+    float transcode(float r, const std::vector<int>& codemap)
+    {
+        if (r != NO_DATA_VALUE)
+        {
+            int code = r < 1.0f ? (int)(r*255.0f) : (int)r;
+            if (code >= 0 && code < (int)codemap.size() && codemap[code] >= 0)
+                return (float)codemap[code];
+        }
+        return NO_DATA_VALUE;
+    }
+}
+
+TEST_CASE("LandCoverCodeTable")
+{
+    std::vector<std::pair<int, int> > mappings;
+    mappings.push_back(std::make_pair(0, 3));
+    mappings.push_back(std::make_pair(1, 2));
+    mappings.push_back(std::make_pair(11, 1));
+    mappings.push_back(std::make_pair(42, 5));
+    mappings.push_back(std::make_pair(42, 6)); // later mapping wins
+    mappings.push_back(std::make_pair(255, 7));
+    mappings.push_back(std::make_pair(300, 9));
+
+    std::vector<int> codemap(301, -1);
+    for (unsigned i = 0; i < mappings.size(); ++i)
+        codemap[mappings[i].first] = mappings[i].second;
+
+    LandCoverCodeTable table;
+    REQUIRE(table.empty());
+    table.compile(mappings);
+    REQUIRE(!table.empty());
+
+    SECTION("Codes")
+    {
+        REQUIRE(table.lookup(42) == 6.0f);
+        REQUIRE(table.lookup(300) == 9.0f);
+        REQUIRE(table.lookup(12) == NO_DATA_VALUE);
+        REQUIRE(table.lookup(-1) == NO_DATA_VALUE);
+        REQUIRE(table.reclassify(NO_DATA_VALUE) == NO_DATA_VALUE);
+        REQUIRE(table.reclassify(11.0f / 255.0f) == 1.0f); // normalized
+        REQUIRE(table.reclassify(42.7f) == 6.0f);          // truncated
+    }
+
+    SECTION("Sparse codes")
+    {
+        std::vector<std::pair<int, int> > sparse;
+        sparse.push_back(std::make_pair(5, 1));
+        sparse.push_back(std::make_pair(70000, 2));
+        sparse.push_back(std::make_pair(1000000, 4));
+        LandCoverCodeTable sparseTable;
+        sparseTable.compile(sparse);
+        REQUIRE(sparseTable.lookup(5) == 1.0f);
+        REQUIRE(sparseTable.lookup(70000) == 2.0f);
+        REQUIRE(sparseTable.lookup(1000000) == 4.0f);
+        REQUIRE(sparseTable.lookup(6) == NO_DATA_VALUE);
+    }
+
+    SECTION("Images match per-pixel transcoding")
+    {
+        osg::ref_ptr<osg::Image> inputs[3];
+
+        inputs[0] = new osg::Image();
+        inputs[0]->allocateImage(37, 9, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        inputs[1] = new osg::Image();
+        inputs[1]->allocateImage(37, 9, 1, GL_LUMINANCE, GL_UNSIGNED_SHORT);
+        inputs[2] = new osg::Image();
+        inputs[2]->allocateImage(37, 9, 1, GL_RED, GL_FLOAT);
+
+        std::srand(11);
+        for (unsigned i = 0; i < inputs[0]->getTotalSizeInBytes(); ++i)
+            inputs[0]->data()[i] = (unsigned char)(std::rand() & 0xFF);
+        for (unsigned i = 0; i < 37 * 9; ++i)
+        {
+            ((GLushort*)inputs[1]->data())[i] = (GLushort)(std::rand() % 310);
+            ((float*)inputs[2]->data())[i] =
+                i % 7 == 0 ? NO_DATA_VALUE :
+                i % 2 == 0 ? (float)(std::rand() % 310) + 0.5f :
+                (float)(std::rand() % 256) / 255.0f;
+        }
+
+        for (unsigned k = 0; k < 3; ++k)
+        {
+            osg::ref_ptr<osg::Image> output = LandCover::createImage(37, 9);
+            unsigned numWritten = table.reclassify(inputs[k].get(), output.get());
+
+            ImageUtils::PixelReader read(inputs[k].get());
+            unsigned expectedWritten = 0u;
+            bool match = true;
+            for (int t = 0; t < 9; ++t)
+            {
+                for (int s = 0; s < 37; ++s)
+                {
+                    float expected = transcode(read(s, t).r(), codemap);
+                    if (expected != NO_DATA_VALUE)
+                        ++expectedWritten;
+                    if (*(const float*)output->data(s, t) != expected)
+                        match = false;
+                }
+            }
+            REQUIRE(match);
+            REQUIRE(numWritten == expectedWritten);
+        }
+    }
+}
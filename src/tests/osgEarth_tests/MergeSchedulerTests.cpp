@@ -0,0 +1,166 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+#include <osgEarth/MergeScheduler>
+#include <memory>
+#include <vector>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+TEST_CASE("MergeScheduler")
+{
+    // fake clock; each merge advances it by its own cost
+    auto now = std::make_shared<std::uint64_t>(0u);
+
+    MergeScheduler ms;
+    ms.setClock([now]() { return *now; });
+
+    std::vector<int> merged;
+
+    auto makeMerge = [&merged, now](int id, std::uint64_t cost) {
+        return [&merged, now, id, cost]() {
+            *now += cost;
+            merged.push_back(id);
+            return true;
+        };
+    };
+
+    SECTION("Limits the merges per frame")
+    {
+        for (int i = 0; i < 10; ++i)
+            ms.push(makeMerge(i, 1), 0.0f, "test");
+
+        ms.setMaxMergesPerFrame(4);
+        REQUIRE(ms.run() == 4u);
+        REQUIRE(ms.getQueueSize() == 6u);
+        REQUIRE(merged == std::vector<int>({ 0, 1, 2, 3 }));
+
+        ms.setMaxMergesPerFrame(0);
+        REQUIRE(ms.run() == 6u);
+        REQUIRE(ms.getQueueSize() == 0u);
+    }
+
+    SECTION("Merges in priority order")
+    {
+        float priorityOfTwo = 0.0f;
+
+        ms.push(makeMerge(0, 1), 1.0f, "test");
+        ms.push(makeMerge(1, 1), 5.0f, "test");
+        ms.push(makeMerge(2, 1), [&]() { return priorityOfTwo; }, "test");
+        ms.push(makeMerge(3, 1), 5.0f, "test");
+
+        // dynamic priorities are re-evaluated at the start of each frame
+        priorityOfTwo = 10.0f;
+        ms.setMaxMergesPerFrame(2);
+        ms.run();
+        REQUIRE(merged == std::vector<int>({ 2, 1 }));
+
+        ms.run();
+        REQUIRE(merged == std::vector<int>({ 2, 1, 3, 0 }));
+    }
+
+    SECTION("Merges that find nothing to do do not count")
+    {
+        ms.push([]() { return false; }, 10.0f, "test");
+        ms.push(makeMerge(1, 1), 0.0f, "test");
+
+        ms.setMaxMergesPerFrame(1);
+        REQUIRE(ms.run() == 1u);
+        REQUIRE(merged == std::vector<int>({ 1 }));
+        REQUIRE(ms.getQueueSize() == 0u);
+    }
+
+    SECTION("Stays within the time budget")
+    {
+        ms.setTimeBudget(1000);
+
+        for (int i = 0; i < 4; ++i)
+            ms.push(makeMerge(i, 400), 0.0f, "heavy");
+
+        // After the first merge it knows a heavy merge costs ~400us, so it
+        // stops before the third would overrun the budget
+        REQUIRE(ms.run() == 2u);
+        REQUIRE(ms.getEstimatedCost("heavy") == Approx(400.0));
+        REQUIRE(ms.run() == 2u);
+        REQUIRE(ms.getQueueSize() == 0u);
+
+        // An expensive merge still runs alone rather than stalling the queue
+        ms.push(makeMerge(8, 5000), 0.0f, "huge");
+        ms.push(makeMerge(9, 5000), 0.0f, "huge");
+        REQUIRE(ms.run() == 1u);
+        REQUIRE(ms.run() == 1u);
+        REQUIRE(ms.getEstimatedCost("huge") == Approx(5000.0));
+    }
+
+    SECTION("Learns the cost of each category")
+    {
+        ms.setTimeBudget(1000);
+
+        ms.push(makeMerge(0, 900), 0.0f, "heavy");
+        ms.push(makeMerge(1, 10), 0.0f, "light");
+        ms.run();
+
+        // a cheap merge fits in what is left of the budget; a heavy one does not
+        ms.push(makeMerge(2, 900), 0.0f, "heavy");
+        ms.push(makeMerge(3, 10), 0.0f, "light");
+        ms.push(makeMerge(4, 10), 0.0f, "light");
+        merged.clear();
+        ms.run();
+        REQUIRE(merged == std::vector<int>({ 2, 3, 4 }));
+
+        merged.clear();
+        ms.push(makeMerge(5, 10), 1.0f, "light");
+        ms.push(makeMerge(6, 900), 0.0f, "heavy");
+        ms.run();
+        REQUIRE(merged == std::vector<int>({ 5, 6 }));
+
+        merged.clear();
+        ms.push(makeMerge(7, 900), 1.0f, "heavy");
+        ms.push(makeMerge(8, 900), 0.0f, "heavy");
+        ms.run();
+        REQUIRE(merged == std::vector<int>({ 7 }));
+    }
+
+    SECTION("Publishes metrics")
+    {
+        MergeScheduler withMetrics("test_scheduler");
+        MetricsRegistry& reg = MetricsRegistry::instance();
+        MetricsRegistry::Gauge& depth = reg.gauge("test_scheduler_merge_queue_depth", "");
+        MetricsRegistry::Counter& count = reg.counter("test_scheduler_merges_total", "");
+        std::uint64_t before = count.value();
+
+        withMetrics.push([]() { return true; }, 0.0f, "test");
+        withMetrics.push([]() { return true; }, 0.0f, "test");
+        withMetrics.push([]() { return true; }, 0.0f, "test");
+        REQUIRE(depth.value() == 3);
+
+        withMetrics.setMaxMergesPerFrame(2);
+        withMetrics.run();
+        REQUIRE(depth.value() == 1);
+        REQUIRE(count.value() == before + 2u);
+
+        withMetrics.clear();
+        REQUIRE(depth.value() == 0);
+    }
+}
@@ -0,0 +1,136 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+#include <osgEarth/MetricsRegistry>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+TEST_CASE("MetricsRegistry")
+{
+    MetricsRegistry& reg = MetricsRegistry::instance();
+
+    SECTION("Counters and gauges")
+    {
+        MetricsRegistry::Counter& c = reg.counter("test_counter_total", "A counter");
+        c.reset();
+        c.increment();
+        c.increment(41);
+        REQUIRE(c.value() == 42u);
+
+        // same name and labels return the same metric
+        REQUIRE(&reg.counter("test_counter_total", "A counter") == &c);
+        REQUIRE(&reg.counter("test_counter_total", "A counter", "kind=\"other\"") != &c);
+
+        MetricsRegistry::Gauge& g = reg.gauge("test_gauge", "A gauge");
+        g.set(10);
+        g.add(-3);
+        REQUIRE(g.value() == 7);
+    }
+
+    SECTION("A name keeps its first type")
+    {
+        reg.counter("test_typed_total", "A counter").increment(5);
+
+        MetricsRegistry::Gauge& g = reg.gauge("test_typed_total", "Not a counter");
+        g.set(99);
+        REQUIRE(&reg.gauge("test_typed_total", "Not a counter") == &g);
+
+        std::string prom = reg.toPrometheus();
+        REQUIRE(prom.find("# TYPE test_typed_total counter\n") != std::string::npos);
+        REQUIRE(prom.find("# TYPE test_typed_total gauge\n") == std::string::npos);
+        REQUIRE(prom.find("test_typed_total 99") == std::string::npos);
+    }
+
+    SECTION("Histogram buckets")
+    {
+        typedef MetricsRegistry::Histogram H;
+
+        // every value falls within its bucket
+        for (std::uint64_t v = 0; v < 100000; v += 7)
+        {
+            unsigned b = H::bucketOf(v);
+            REQUIRE(v < H::bucketUpperBound(b));
+            REQUIRE((b == 0 || v >= H::bucketUpperBound(b - 1)));
+        }
+
+        // and the buckets are at most 12.5% wide
+        for (unsigned b = H::SUB_BUCKETS; b < H::NUM_BUCKETS - 1; ++b)
+        {
+            std::uint64_t lo = H::bucketUpperBound(b - 1), hi = H::bucketUpperBound(b);
+            REQUIRE((hi - lo) * 8 <= lo);
+        }
+    }
+
+    SECTION("Histogram percentiles")
+    {
+        MetricsRegistry::Histogram& h = reg.histogram("test_latency_seconds", "A histogram");
+        h.reset();
+        for (std::uint64_t v = 1; v <= 1000; ++v)
+            h.record(v);
+
+        REQUIRE(h.count() == 1000u);
+        REQUIRE(h.sum() == 500500u);
+        REQUIRE(h.max() == 1000u);
+        REQUIRE(h.percentile(0.5) >= 500u);
+        REQUIRE(h.percentile(0.5) <= 500u * 9 / 8);
+        REQUIRE(h.percentile(0.99) >= 990u);
+        REQUIRE(h.percentile(1.0) == 1000u);
+        REQUIRE(h.countAtOrBelow(1000000u) == 1000u);
+        REQUIRE(h.countAtOrBelow(500u) >= 500u);
+        REQUIRE(h.countAtOrBelow(500u) <= 500u * 9 / 8);
+    }
+
+    SECTION("Export bounds are exact")
+    {
+        MetricsRegistry::Histogram& h = reg.histogram("test_bounds_seconds", "A histogram");
+        h.reset();
+        h.record(10000u);  // on the 0.01s bound
+        h.record(10001u);  // just above it, in the same log-linear bucket
+        h.record(24000u);
+
+        REQUIRE(h.countAtOrBelowExportBound(5) == 0u);  // 0.005s
+        REQUIRE(h.countAtOrBelowExportBound(6) == 1u);  // 0.01s
+        REQUIRE(h.countAtOrBelowExportBound(7) == 3u);  // 0.025s
+        REQUIRE(h.countAtOrBelowExportBound(15) == 3u);
+    }
+
+    SECTION("Export")
+    {
+        reg.counter("test_export_total", "Exported counter", "driver=\"memory\"").increment(3);
+        reg.histogram("test_export_seconds", "Exported histogram").record(std::chrono::milliseconds(20));
+
+        std::string prom = reg.toPrometheus();
+        REQUIRE(prom.find("# TYPE test_export_total counter\n") != std::string::npos);
+        REQUIRE(prom.find("test_export_total{driver=\"memory\"} 3\n") != std::string::npos);
+        REQUIRE(prom.find("# TYPE test_export_seconds histogram\n") != std::string::npos);
+        REQUIRE(prom.find("test_export_seconds_bucket{le=\"0.01\"} 0\n") != std::string::npos);
+        REQUIRE(prom.find("test_export_seconds_bucket{le=\"0.025\"} 1\n") != std::string::npos);
+        REQUIRE(prom.find("test_export_seconds_bucket{le=\"+Inf\"} 1\n") != std::string::npos);
+        REQUIRE(prom.find("test_export_seconds_count 1\n") != std::string::npos);
+
+        std::string json = reg.toJSON();
+        REQUIRE(json.find("\"test_export_total\"") != std::string::npos);
+        REQUIRE(json.find("\"p99_seconds\"") != std::string::npos);
+    }
+}
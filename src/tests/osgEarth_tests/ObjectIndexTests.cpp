@@ -0,0 +1,153 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+#include <osgEarth/Containers>
+#include <osgEarth/ObjectIndex>
+#include <osgEarth/FeatureSourceIndexNode>
+#include <osg/Geometry>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    osg::Geometry* makeGeometry(unsigned numVerts)
+    {
+        osg::Geometry* geom = new osg::Geometry();
+        geom->setVertexArray(new osg::Vec3Array(numVerts));
+        return geom;
+    }
+}
+
+TEST_CASE("flat_hash_map")
+{
+    flat_hash_map<FeatureID, unsigned> map;
+    REQUIRE(map.empty());
+
+    for (unsigned i = 0; i < 10000; ++i)
+        map[(FeatureID)i * 7] = i;
+    REQUIRE(map.size() == 10000);
+
+    SECTION("Find")
+    {
+        REQUIRE(map.find(7 * 500) != map.end());
+        REQUIRE(map.find(7 * 500)->second == 500);
+        REQUIRE(map.find(3) == map.end());
+    }
+
+    SECTION("Erase keeps probe chains intact")
+    {
+        for (unsigned i = 0; i < 10000; i += 2)
+            REQUIRE(map.erase((FeatureID)i * 7) == 1);
+        REQUIRE(map.size() == 5000);
+        for (unsigned i = 0; i < 10000; ++i)
+            REQUIRE((map.find((FeatureID)i * 7) != map.end()) == (i % 2 == 1));
+    }
+
+    SECTION("Iterate")
+    {
+        unsigned count = 0;
+        for (flat_hash_map<FeatureID, unsigned>::const_iterator i = map.begin(); i != map.end(); ++i)
+        {
+            REQUIRE(i->first == (FeatureID)i->second * 7);
+            ++count;
+        }
+        REQUIRE(count == 10000);
+    }
+}
+
+TEST_CASE("ObjectIndex")
+{
+    osg::ref_ptr<ObjectIndex> index = new ObjectIndex();
+    osg::ref_ptr<osg::Referenced> object = new osg::Referenced();
+
+    ObjectID oid = index->insert(object.get());
+    REQUIRE(index->get<osg::Referenced>(oid).get() == object.get());
+
+    index->remove(oid);
+    REQUIRE(index->get<osg::Referenced>(oid).valid() == false);
+    REQUIRE(index->size() == 0u);
+}
+
+TEST_CASE("FeatureSourceIndex")
+{
+    osg::ref_ptr<ObjectIndex> master = new ObjectIndex();
+    osg::ref_ptr<FeatureSourceIndex> index = new FeatureSourceIndex(0L, master.get(), FeatureSourceIndexOptions());
+    osg::ref_ptr<Feature> feature = new Feature(0L, 0L, Style(), 42LL);
+
+    osg::ref_ptr<FeatureSourceIndexNode> node1 = new FeatureSourceIndexNode(index.get());
+    osg::ref_ptr<FeatureSourceIndexNode> node2 = new FeatureSourceIndexNode(index.get());
+
+    // tagging the same feature twice in one node, and once in another,
+    // yields the same object ID:
+    ObjectID oid = node1->tagDrawable(makeGeometry(3), feature.get());
+    REQUIRE(oid != OSGEARTH_OBJECTID_EMPTY);
+    REQUIRE(node1->tagDrawable(makeGeometry(3), feature.get()) == oid);
+    REQUIRE(node2->tagDrawable(makeGeometry(3), feature.get()) == oid);
+    REQUIRE(index->getObjectID(42LL) == oid);
+    REQUIRE(index->getFeature(oid) == feature.get());
+
+    // the entry survives until the last node referencing it goes away:
+    node1 = 0L;
+    REQUIRE(index->getObjectID(42LL) == oid);
+    node2 = 0L;
+    REQUIRE(index->getObjectID(42LL) == OSGEARTH_OBJECTID_EMPTY);
+    REQUIRE(master->size() == 0u);
+}
+
+TEST_CASE("FeatureSourceIndex re-index of a shared feature")
+{
+    osg::ref_ptr<ObjectIndex> master = new ObjectIndex();
+    osg::ref_ptr<FeatureSourceIndex> index = new FeatureSourceIndex(0L, master.get(), FeatureSourceIndexOptions());
+    osg::ref_ptr<Feature> feature = new Feature(0L, 0L, Style(), 42LL);
+
+    osg::ref_ptr<FeatureSourceIndexNode> node1 = new FeatureSourceIndexNode(index.get());
+    ObjectID oid = node1->tagDrawable(makeGeometry(3), feature.get());
+
+    // a second node, as loaded from a serialized tile: its FID table and
+    // geometry carry a stale object ID for the same feature
+    FeatureSourceIndexNode::FIDMap fids;
+    fids[42LL] = oid + 1000u;
+    osg::Geometry* geom = makeGeometry(3);
+    master->tagDrawable(geom, oid + 1000u);
+
+    osg::ref_ptr<FeatureSourceIndexNode> node2 = new FeatureSourceIndexNode();
+    node2->setFIDMap(fids);
+    node2->addChild(geom);
+    FeatureSourceIndexNode::reconstitute(node2.get(), index.get());
+
+    // picking the re-indexed geometry finds the feature
+    ObjectID newoid = node2->getFIDMap().find(42LL)->second;
+    REQUIRE(newoid != oid);
+    REQUIRE(newoid != oid + 1000u);
+    REQUIRE(index->getFeature(newoid) == feature.get());
+    REQUIRE(index->getFeature(oid) == feature.get());
+
+    // and every object ID is released with the last reference
+    node2 = 0L;
+    REQUIRE(index->getFeature(oid) == feature.get());
+    node1 = 0L;
+    REQUIRE(index->getObjectID(42LL) == OSGEARTH_OBJECTID_EMPTY);
+    REQUIRE(index->getFeature(newoid) == 0L);
+    REQUIRE(master->size() == 0u);
+}
@@ -0,0 +1,141 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include <osgEarth/catch.hpp>
+#include <osgEarth/TileAvailability>
+#include <osgEarth/Profile>
+
+using namespace osgEarth;
+
+TEST_CASE("TileAvailability")
+{
+    osg::ref_ptr<const Profile> geodetic = Profile::create("global-geodetic");
+    osg::ref_ptr<const Profile> mercator = Profile::create("spherical-mercator");
+
+    SECTION("Everything is available by default")
+    {
+        osg::ref_ptr<TileAvailability> a = new TileAvailability(geodetic.get());
+        TileKey key(12, 100, 200, geodetic.get());
+        REQUIRE(a->hasRanges() == false);
+        REQUIRE(a->isAvailable(key));
+        REQUIRE(a->getBestAvailableTileKey(key) == key);
+    }
+
+    SECTION("Reads ranges from a layer.json")
+    {
+        // Southern hemisphere only, and nothing below level 1.
+        // Rows count from the south, as in TMS.
+        const char* json =
+            "{ \"available\": ["
+            "  [ { \"startX\": 0, \"startY\": 0, \"endX\": 1, \"endY\": 0 } ],"
+            "  [ { \"startX\": 0, \"startY\": 0, \"endX\": 3, \"endY\": 0 } ]"
+            "] }";
+
+        osg::ref_ptr<TileAvailability> a = new TileAvailability(geodetic.get());
+        REQUIRE(a->readLayerJSON(json, true));
+        REQUIRE(a->hasRanges());
+
+        // TileKey rows count from the north
+        REQUIRE(a->isAvailable(TileKey(1, 2, 1, geodetic.get())));
+        REQUIRE(a->isAvailable(TileKey(1, 2, 0, geodetic.get())) == false);
+        REQUIRE(a->getBestAvailableTileKey(TileKey(1, 2, 0, geodetic.get())) == TileKey(0, 1, 0, geodetic.get()));
+
+        // below the deepest listed level
+        REQUIRE(a->getBestAvailableTileKey(TileKey(3, 5, 6, geodetic.get())) == TileKey(1, 1, 1, geodetic.get()));
+
+        REQUIRE(a->readLayerJSON("{ \"nope\" }", true) == false);
+    }
+
+    SECTION("Finds tiles among many ranges at a level")
+    {
+        osg::ref_ptr<TileAvailability> a = new TileAvailability(geodetic.get());
+
+        // added out of order, overlapping in x
+        a->addAvailableRange(0, 0, 0, 1, 0);
+        a->addAvailableRange(2, 4, 0, 7, 0);
+        a->addAvailableRange(2, 0, 1, 6, 1);
+        a->addAvailableRange(2, 2, 2, 2, 2);
+        a->addAvailableRange(2, 1, 3, 1, 3);
+
+        REQUIRE(a->isAvailable(TileKey(2, 7, 0, geodetic.get())));
+        REQUIRE(a->isAvailable(TileKey(2, 5, 1, geodetic.get())));
+        REQUIRE(a->isAvailable(TileKey(2, 2, 2, geodetic.get())));
+        REQUIRE(a->isAvailable(TileKey(2, 1, 3, geodetic.get())));
+        REQUIRE(a->isAvailable(TileKey(2, 3, 0, geodetic.get())) == false);
+        REQUIRE(a->isAvailable(TileKey(2, 7, 1, geodetic.get())) == false);
+        REQUIRE(a->isAvailable(TileKey(2, 3, 2, geodetic.get())) == false);
+        REQUIRE(a->isAvailable(TileKey(2, 0, 3, geodetic.get())) == false);
+
+        // level 1 has no ranges, so nothing below level 0 is available there
+        REQUIRE(a->getBestAvailableTileKey(TileKey(2, 3, 0, geodetic.get())) == TileKey(0, 0, 0, geodetic.get()));
+    }
+
+    SECTION("Missing tiles do not take their subtrees with them")
+    {
+        osg::ref_ptr<TileAvailability> a = new TileAvailability(geodetic.get());
+        TileKey missing(3, 5, 2, geodetic.get());
+
+        REQUIRE(a->setMissing(missing));
+        REQUIRE(a->setMissing(missing) == false);
+        REQUIRE(a->getNumMissing() == 1u);
+
+        // the tile falls back to its parent...
+        REQUIRE(a->isAvailable(missing) == false);
+        REQUIRE(a->getBestAvailableTileKey(missing) == missing.createParentKey());
+        REQUIRE(a->isAvailable(TileKey(3, 4, 2, geodetic.get())));
+
+        // ...but data may still start deeper down
+        TileKey child = missing.createChildKey(0);
+        REQUIRE(a->isAvailable(child));
+
+        // a missing chain climbs until it finds a candidate
+        REQUIRE(a->setMissing(missing.createParentKey()));
+        REQUIRE(a->getBestAvailableTileKey(missing) == missing.createParentKey().createParentKey());
+
+        // an equivalent profile object shares the index
+        osg::ref_ptr<const Profile> geodetic2 = Profile::create("global-geodetic");
+        REQUIRE(a->isAvailable(TileKey(3, 5, 2, geodetic2.get())) == false);
+
+        // other profiles are not tracked
+        REQUIRE(a->setMissing(TileKey(0, 0, 0, mercator.get())) == false);
+        REQUIRE(a->isAvailable(TileKey(0, 0, 0, mercator.get())));
+    }
+
+    SECTION("Missing tiles survive serialization")
+    {
+        osg::ref_ptr<TileAvailability> a = new TileAvailability(geodetic.get());
+        a->setMissing(TileKey(3, 5, 2, geodetic.get()));
+        a->setMissing(TileKey(10, 100, 300, geodetic.get()));
+
+        Config conf = a->getMissingConfig();
+        Config copy;
+        REQUIRE(copy.fromJSON(conf.toJSON(false)));
+
+        osg::ref_ptr<TileAvailability> b = new TileAvailability(geodetic.get());
+        b->addMissing(copy);
+        REQUIRE(b->getNumMissing() == 2u);
+        REQUIRE(b->isAvailable(TileKey(3, 5, 2, geodetic.get())) == false);
+        REQUIRE(b->isAvailable(TileKey(10, 100, 300, geodetic.get())) == false);
+        REQUIRE(b->getMissingConfig().value("missing") == conf.value("missing"));
+    }
+}
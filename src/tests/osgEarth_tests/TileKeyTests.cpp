@@ -0,0 +1,105 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/TileKey>
+#include <osgEarth/Profile>
+#include <algorithm>
+#include <vector>
+
+using namespace osgEarth;
+
+TEST_CASE("TileID")
+{
+    osg::ref_ptr<const Profile> geodetic = Profile::create("global-geodetic");
+    osg::ref_ptr<const Profile> mercator = Profile::create("spherical-mercator");
+
+    SECTION("Round trip")
+    {
+        TileKey key(12, 3001, 1234, geodetic.get());
+        TileID id = key.getID();
+        REQUIRE(id.valid());
+        REQUIRE(id.getLOD() == 12u);
+        REQUIRE(id.getTileX() == 3001u);
+        REQUIRE(id.getTileY() == 1234u);
+        REQUIRE(TileKey(id, geodetic.get()) == key);
+
+        REQUIRE(!TileKey().getID().valid());
+        REQUIRE(!TileKey(TileID(), geodetic.get()).valid());
+        REQUIRE(!TileKey(id, mercator.get()).valid());
+    }
+
+    SECTION("Profiles")
+    {
+        // equivalent profiles intern to the same index
+        osg::ref_ptr<const Profile> geodetic2 = Profile::create("global-geodetic");
+        TileKey a(5, 10, 7, geodetic.get());
+        TileKey b(5, 10, 7, geodetic2.get());
+        TileKey c(5, 10, 7, mercator.get());
+        REQUIRE(a.getID() == b.getID());
+        REQUIRE(a.getID() != c.getID());
+        REQUIRE(TileKey(c.getID(), mercator.get()).getProfile() == mercator.get());
+
+        // the key keeps the caller's vertical datum
+        osg::ref_ptr<const Profile> geodeticEGM = Profile::create("wgs84", "egm96");
+        if (geodeticEGM.valid() && geodeticEGM->isHorizEquivalentTo(geodetic.get()))
+        {
+            REQUIRE(TileKey(a.getID(), geodeticEGM.get()).getProfile() == geodeticEGM.get());
+        }
+    }
+
+    SECTION("Parent and child")
+    {
+        TileKey key(9, 301, 122, geodetic.get());
+        for (unsigned q = 0; q < 4; ++q)
+        {
+            REQUIRE(key.getID().createChildID(q) == key.createChildKey(q).getID());
+        }
+        REQUIRE(key.getID().createParentID() == key.createParentKey().getID());
+        REQUIRE(!TileKey(0, 1, 0, geodetic.get()).getID().createParentID().valid());
+    }
+
+    SECTION("Limits")
+    {
+        // tile x and y must fit in 27 bits
+        REQUIRE(TileKey(26, (1u << 27) - 1u, 7u, geodetic.get()).getID().valid());
+        REQUIRE(!TileKey(27, (1u << 27), 7u, geodetic.get()).getID().valid());
+    }
+
+    SECTION("Morton order")
+    {
+        // IDs sort by LOD, then in Z-order within the LOD
+        std::vector<TileID> ids;
+        for (unsigned y = 0; y < 2; ++y)
+            for (unsigned x = 0; x < 2; ++x)
+                ids.push_back(TileKey(1, x, y, mercator.get()).getID());
+        ids.push_back(TileKey(0, 0, 0, mercator.get()).getID());
+        std::sort(ids.begin(), ids.end());
+
+        REQUIRE(ids[0].getLOD() == 0u);
+        REQUIRE((ids[1].getTileX() == 0u && ids[1].getTileY() == 0u));
+        REQUIRE((ids[2].getTileX() == 1u && ids[2].getTileY() == 0u));
+        REQUIRE((ids[3].getTileX() == 0u && ids[3].getTileY() == 1u));
+        REQUIRE((ids[4].getTileX() == 1u && ids[4].getTileY() == 1u));
+    }
+}
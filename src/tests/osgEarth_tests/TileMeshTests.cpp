@@ -0,0 +1,82 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/TileMesh>
+#include <cmath>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+TEST_CASE("TileMesh")
+{
+    TileMesh mesh;
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        mesh.verts.push_back(osg::Vec3f(0.5f*(float)i, -(float)i, 1234.5f));
+        mesh.markers.push_back((std::uint8_t)(i % 32));
+    }
+    for (unsigned i = 0; i + 2 < 100; ++i)
+    {
+        mesh.indices.push_back(i);
+        mesh.indices.push_back(i + 1);
+        mesh.indices.push_back(i + 2);
+    }
+    mesh.hasConstraints = true;
+
+    std::string record;
+    mesh.write(record);
+
+    SECTION("Round trip")
+    {
+        TileMesh decoded;
+        REQUIRE(decoded.read(record));
+        REQUIRE(decoded.verts.size() == mesh.verts.size());
+
+        // vertices are quantized to 16 bits across the bounds
+        // (x spans 49.5, y spans 99, z is constant)
+        for (unsigned i = 0; i < mesh.verts.size(); ++i)
+        {
+            REQUIRE(std::abs(decoded.verts[i].x() - mesh.verts[i].x()) <= 49.5f / 65535.0f);
+            REQUIRE(std::abs(decoded.verts[i].y() - mesh.verts[i].y()) <= 99.0f / 65535.0f);
+            REQUIRE(decoded.verts[i].z() == mesh.verts[i].z());
+        }
+
+        REQUIRE(decoded.markers == mesh.markers);
+        REQUIRE(decoded.indices == mesh.indices);
+        REQUIRE(decoded.hasConstraints == true);
+        REQUIRE(decoded.empty == false);
+    }
+
+    SECTION("Damaged records")
+    {
+        TileMesh decoded;
+        REQUIRE(!decoded.read(std::string()));
+        REQUIRE(!decoded.read(record.substr(0, record.size() - 1)));
+
+        std::string bad = record;
+        bad[0] = 'X';
+        REQUIRE(!decoded.read(bad));
+        REQUIRE(decoded.verts.empty());
+    }
+}
@@ -0,0 +1,132 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+#include <osgEarth/TileVisitor>
+#include <osgEarth/TileHandler>
+#include <osgEarth/Profile>
+#include <cstdio>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    struct CountingHandler : public TileHandler
+    {
+        std::atomic<unsigned> _count;
+        CountingHandler() : _count(0u) { }
+        bool handleTile(const TileKey& key, const TileVisitor& tv) override
+        {
+            ++_count;
+            return true;
+        }
+    };
+}
+
+TEST_CASE("ParallelTileVisitor")
+{
+    const char* journal = "osgEarth_tests_tile_journal.txt";
+    ::remove(journal);
+
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+
+    osg::ref_ptr<CountingHandler> handler = new CountingHandler();
+    osg::ref_ptr<ParallelTileVisitor> visitor = new ParallelTileVisitor(handler.get());
+    visitor->setNumThreads(2);
+    visitor->setMaxLevel(4);
+    visitor->setReportInterval(0.0);
+    visitor->setJournal(journal);
+
+    // 2 root tiles, 4 children each: 2 * (1+4+16+64+256)
+    visitor->run(profile.get());
+    REQUIRE(handler->_count == 682u);
+
+    ParallelTileVisitor::Stats stats = visitor->getStats();
+    REQUIRE(stats.unitsTotal > 0u);
+    REQUIRE(stats.unitsDone == stats.unitsTotal);
+    REQUIRE(stats.unitsResumed == 0u);
+
+    SECTION("Resume skips the journaled work units")
+    {
+        handler->_count = 0u;
+        visitor->run(profile.get());
+
+        stats = visitor->getStats();
+        REQUIRE(stats.unitsResumed == stats.unitsTotal);
+        REQUIRE(stats.unitsDone == 0u);
+
+        // only the tiles above the partition level are visited again
+        REQUIRE(handler->_count < 682u - stats.unitsTotal);
+    }
+
+    SECTION("A journal from a different run is refused")
+    {
+        handler->_count = 0u;
+        visitor->setMaxLevel(5);
+        visitor->run(profile.get());
+
+        REQUIRE(handler->_count == 0u);
+        REQUIRE(visitor->getStats().unitsDone == 0u);
+    }
+
+    SECTION("Journal")
+    {
+        TileJournal j;
+        REQUIRE(j.open(journal));
+        REQUIRE(j.size() == stats.unitsTotal);
+        REQUIRE(j.contains(TileKey(0, 0, 0, profile.get())) == false);
+    }
+
+    ::remove(journal);
+}
+
+TEST_CASE("TileKeyListVisitor")
+{
+    const char* progressFile = "osgEarth_tests_tile_progress.txt";
+
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+
+    TileKeyList keys;
+    keys.push_back(TileKey(3, 1, 2, profile.get()));
+    keys.push_back(TileKey(3, 2, 2, profile.get()));
+    keys.push_back(TileKey(5, 7, 9, profile.get()));
+
+    osg::ref_ptr<CountingHandler> handler = new CountingHandler();
+    osg::ref_ptr<TileKeyListVisitor> visitor = new TileKeyListVisitor();
+    visitor->setTileHandler(handler.get());
+    visitor->setKeys(keys);
+    visitor->setProgressFile(progressFile);
+    visitor->run(profile.get());
+
+    // only the listed keys, not their children
+    REQUIRE(handler->_count == 3u);
+
+    std::ifstream in(progressFile);
+    unsigned processed = 0, total = 0;
+    in >> processed >> total;
+    REQUIRE(processed == 3u);
+    REQUIRE(total == 3u);
+    in.close();
+
+    ::remove(progressFile);
+}